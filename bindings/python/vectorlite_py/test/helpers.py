@@ -3,11 +3,12 @@ import numpy as np
 import vectorlite_py
 
 SEED = 12345
-ELEMENT_TYPES = ['float32', 'bfloat16', 'float16']
+ELEMENT_TYPES = ['float32', 'bfloat16', 'float16', 'float8_e4m3', 'float8_e5m2', 'int8']
 # '' (empty space) is treated as 'l2' by vectorlite.
 SPACES = ['l2', 'ip', 'cosine', '']
 # Reading a quantized vector back as float32 is lossy; float32 is exact.
-DEQUANT_RTOL = {'float32': 0.0, 'bfloat16': 1e-2, 'float16': 1e-3}
+DEQUANT_RTOL = {'float32': 0.0, 'bfloat16': 1e-2, 'float16': 1e-3,
+                'float8_e4m3': 7e-2, 'float8_e5m2': 1.3e-1, 'int8': 1e-2}
 
 
 def get_connection(path=':memory:'):
@@ -58,6 +58,37 @@ def test_non_numeric_option_value_is_rejected(conn):
             f'create virtual table t using vectorlite(e float32[{DIM}], hnsw(max_elements=abc))')
 
 
+def test_rerank_is_rejected_for_non_binary_vectors(conn):
+    with pytest.raises(sqlite3.OperationalError, match='rerank'):
+        conn.cursor().execute(
+            f'create virtual table t using vectorlite(e float32[{DIM}], hnsw(max_elements=10, rerank=4))')
+
+
+def test_zero_int8_calibration_is_rejected(conn):
+    with pytest.raises(sqlite3.OperationalError, match='int8_calibration'):
+        conn.cursor().execute(
+            f'create virtual table t using vectorlite(e int8[{DIM}], hnsw(max_elements=10, int8_calibration=0))')
+
+
+@pytest.mark.parametrize('vector_type', ['float32', 'float8_e4m3', 'int8', 'binary'])
+@pytest.mark.parametrize('option', ['native_input', 'native_output'])
+def test_native_encoding_is_rejected_for_other_vector_types(conn, vector_type, option):
+    with pytest.raises(sqlite3.OperationalError, match=option):
+        conn.cursor().execute(
+            f'create virtual table t using vectorlite(e {vector_type}[{DIM}], hnsw(max_elements=10, {option}=true))')
+
+
+@pytest.mark.parametrize('definition', [
+    f'e bfloat16[{DIM}], hnsw(max_elements=10, pq=8)',
+    f'e float32[{DIM}], hnsw(max_elements=10, pq=5)',
+    f'e float32[{DIM}], hnsw(max_elements=10, pq=512)',
+    f'e float32[{DIM}], hnsw(max_elements=10, pq=8, pq_train=0)',
+])
+def test_invalid_pq_is_rejected(conn, definition):
+    with pytest.raises(sqlite3.OperationalError):
+        conn.cursor().execute(f'create virtual table t using vectorlite({definition})')
+
+
 def test_trailing_garbage_in_options_is_rejected(conn):
     with pytest.raises(sqlite3.OperationalError):
         conn.cursor().execute(
@@ -71,7 +102,7 @@ def test_non_hnsw_index_is_rejected(conn):
 
 def test_unknown_element_type_is_rejected(conn):
     with pytest.raises(sqlite3.OperationalError):
-        conn.cursor().execute(f'create virtual table t using vectorlite(e int8[{DIM}], hnsw(max_elements=10))')
+        conn.cursor().execute(f'create virtual table t using vectorlite(e int4[{DIM}], hnsw(max_elements=10))')
 
 
 def test_unknown_space_is_rejected(conn):
@@ -117,6 +117,190 @@ def test_rowid_in_filter_limits_candidates(conn):
     assert 1 in rowids
 
 
+def test_small_rowid_in_filter_returns_exact_distances(conn):
+    vectors = random_vectors(np.random.default_rng(31), 50, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors, space='l2')
+    query = np.float32(np.random.default_rng(32).random(DIM))
+    candidates = [3, 7, 11, 40, 48]
+    # k covers every candidate, so all of them are scored exactly.
+    result = cur.execute(
+        'select rowid, distance from t where knn_search(e, knn_param(?, ?)) and rowid in (3,7,11,40,48)',
+        (query.tobytes(), 10)).fetchall()
+    expected = sorted(candidates, key=lambda i: l2_squared(query, vectors[i]))
+    assert [r[0] for r in result] == expected
+    for rowid, distance in result:
+        assert np.isclose(distance, l2_squared(query, vectors[rowid]), rtol=1e-4)
+
+
+def test_large_rowid_in_filter_returns_exact_top_k(conn):
+    vectors = random_vectors(np.random.default_rng(34), 500, DIM)
+    cur = conn.cursor()
+    # A tiny ef would make graph search miss neighbors, exact scan doesn't.
+    _fill(cur, vectors, space='l2')
+    query = np.float32(np.random.default_rng(35).random(DIM))
+    candidates = list(range(0, 500, 2))
+    placeholders = ','.join('?' * len(candidates))
+    result = cur.execute(
+        f'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?)) and rowid in ({placeholders})',
+        (query.tobytes(), 10, 1, *candidates)).fetchall()
+    expected = sorted(candidates, key=lambda i: l2_squared(query, vectors[i]))[:10]
+    assert [r[0] for r in result] == expected
+    for rowid, distance in result:
+        assert np.isclose(distance, l2_squared(query, vectors[rowid]), rtol=1e-4)
+
+
+@pytest.mark.parametrize('vector_type', ['float16', 'bfloat16', 'float8_e4m3', 'float8_e5m2'])
+def test_half_precision_search_uses_unquantized_query(conn, vector_type):
+    vectors = random_vectors(np.random.default_rng(33), 30, DIM)
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e {vector_type}[{DIM}], hnsw(max_elements=30))')
+    for i in range(len(vectors)):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+    query = np.float32(np.random.default_rng(34).random(DIM))
+    result = cur.execute(
+        'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?))',
+        (query.tobytes(), 5, 30)).fetchall()
+    assert len(result) == 5
+    # Distances are computed between the float32 query and the stored half
+    # precision vectors, not a quantized copy of the query.
+    for rowid, distance in result:
+        stored = np.frombuffer(
+            cur.execute('select e from t where rowid = ?', (rowid,)).fetchone()[0], dtype=np.float32)
+        assert np.isclose(distance, l2_squared(query, stored), rtol=1e-4)
+
+
+def test_binary_search_returns_hamming_distance(conn):
+    # Center the vectors so that the sign bits carry information.
+    vectors = random_vectors(np.random.default_rng(35), 30, DIM) - np.float32(0.5)
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e binary[{DIM}], hnsw(max_elements=30))')
+    for i in range(len(vectors)):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+    row = cur.execute('select rowid, distance from t where knn_search(e, knn_param(?, ?, ?))',
+                      (vectors[3].tobytes(), 1, 30)).fetchone()
+    assert row[1] == 0.0
+    # Without rerank only the sign bits are kept.
+    stored = np.frombuffer(
+        cur.execute('select e from t where rowid = ?', (row[0],)).fetchone()[0], dtype=np.float32)
+    assert np.array_equal(stored, np.where(vectors[3] > 0, 1.0, -1.0))
+
+
+@pytest.mark.parametrize('space', ['l2', 'cosine'])
+def test_binary_rerank_returns_exact_distances(conn, space):
+    n = 30
+    vectors = random_vectors(np.random.default_rng(36), n, DIM) - np.float32(0.5)
+    cur = conn.cursor()
+    space_clause = '' if space == 'l2' else f' {space}'
+    cur.execute(f'create virtual table t using vectorlite(e binary[{DIM}]{space_clause}, '
+                f'hnsw(max_elements={n}, rerank={n}))')
+    for i in range(n):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+    query = np.float32(np.random.default_rng(37).random(DIM)) - np.float32(0.5)
+    # rerank * k >= n, so every vector is rescored at full precision.
+    result = cur.execute(
+        'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?))',
+        (query.tobytes(), 5, n)).fetchall()
+    expected = brute_force_knn(vectors, query, 5, space=space)
+    assert [r[0] for r in result] == [i for i, _ in expected]
+    for (_, distance), (_, expected_distance) in zip(result, expected):
+        assert np.isclose(distance, expected_distance, rtol=1e-4, atol=1e-5)
+    # The float32 vectors are kept for reranking.
+    stored = np.frombuffer(
+        cur.execute('select e from t where rowid = 7').fetchone()[0], dtype=np.float32)
+    if space == 'l2':
+        assert np.array_equal(stored, vectors[7])
+
+
+def test_binary_rerank_follows_updates_and_deletes(conn):
+    n = 30
+    vectors = random_vectors(np.random.default_rng(38), n, DIM) - np.float32(0.5)
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e binary[{DIM}], hnsw(max_elements={n}, rerank={n}))')
+    for i in range(n):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+    cur.execute('update t set e = ? where rowid = 1', (vectors[2].tobytes(),))
+    cur.execute('delete from t where rowid = 2')
+    # Its slot in the rerank store is reused.
+    cur.execute('insert into t(rowid, e) values (?, ?)', (n, vectors[3].tobytes()))
+    assert cur.execute('select e from t where rowid = 1').fetchone()[0] == vectors[2].tobytes()
+    assert cur.execute('select e from t where rowid = ?', (n,)).fetchone()[0] == vectors[3].tobytes()
+    rows = cur.execute('select rowid, distance from t where knn_search(e, knn_param(?, ?, ?))',
+                       (vectors[2].tobytes(), 1, n)).fetchall()
+    assert rows == [(1, 0.0)]
+    rows = cur.execute('select rowid, distance from t where knn_search(e, knn_param(?, ?, ?))',
+                       (vectors[3].tobytes(), 2, n)).fetchall()
+    assert sorted(rows) == [(3, 0.0), (n, 0.0)]
+
+
+def _fill_pq(cur, vectors, space='l2', pq_train=50):
+    space_clause = '' if space == 'l2' else f' {space}'
+    cur.execute(f'create virtual table t using vectorlite(e float32[{DIM}]{space_clause}, '
+                f'hnsw(max_elements={len(vectors)}, pq=8, pq_train={pq_train}))')
+    for i in range(len(vectors)):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+
+
+# Product quantized and int8 tables keep their first vectors in float32 until
+# there are enough of them to train the codebooks or derive the calibration.
+@pytest.mark.parametrize('vector_type, options', [
+    ('float32', 'pq=8, pq_train=50'),
+    ('int8', 'int8_calibration=30'),
+])
+def test_search_is_exact_before_training(conn, vector_type, options):
+    vectors = random_vectors(np.random.default_rng(38), 20, DIM)
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e {vector_type}[{DIM}], '
+                f'hnsw(max_elements=50, {options}))')
+    for i in range(len(vectors)):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+    cur.execute('delete from t where rowid = 4')
+    query = np.float32(np.random.default_rng(39).random(DIM))
+    result = cur.execute('select rowid, distance from t where knn_search(e, knn_param(?, ?))',
+                         (query.tobytes(), 5)).fetchall()
+    expected = brute_force_knn(np.delete(vectors, 4, axis=0), query, 5)
+    assert len(result) == 5
+    for (_, distance), (_, expected_distance) in zip(result, expected):
+        assert np.isclose(distance, expected_distance, rtol=1e-4)
+    result = cur.execute('select rowid from t where knn_search(e, knn_param(?, ?)) and rowid in (1, 2, 3)',
+                         (vectors[2].tobytes(), 1)).fetchall()
+    assert result == [(2,)]
+    stored = np.frombuffer(cur.execute('select e from t where rowid = 7').fetchone()[0], dtype=np.float32)
+    assert np.array_equal(stored, vectors[7])
+
+
+@pytest.mark.parametrize('space', ['l2', 'cosine'])
+def test_pq_search_after_training(conn, space):
+    n = 200
+    vectors = random_vectors(np.random.default_rng(40), n, DIM)
+    cur = conn.cursor()
+    _fill_pq(cur, vectors, space=space)
+    # Vectors are read back from their codes, so they are only approximate.
+    stored = np.frombuffer(cur.execute('select e from t where rowid = 0').fetchone()[0], dtype=np.float32)
+    expected = vectors[0] if space == 'l2' else vectors[0] / np.linalg.norm(vectors[0])
+    assert np.abs(stored - expected).max() < 0.5
+    recall = 0
+    for probe in range(0, n, 10):
+        result = cur.execute('select rowid from t where knn_search(e, knn_param(?, ?, ?))',
+                             (vectors[probe].tobytes(), 10, n)).fetchall()
+        assert len(result) == 10
+        recall += probe in [r[0] for r in result]
+    # Codes are lossy, but a vector should almost always be among its own
+    # 10 nearest neighbors.
+    assert recall >= 18
+    # Rowid filters with few candidates are scored exactly, with the same
+    # distances as graph search.
+    result = cur.execute(
+        'select rowid, distance from t where knn_search(e, knn_param(?, ?)) and rowid in (1, 2, 3)',
+        (vectors[2].tobytes(), 3)).fetchall()
+    assert sorted(r[0] for r in result) == [1, 2, 3]
+    graph_distances = dict(cur.execute(
+        'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?))',
+        (vectors[2].tobytes(), n, n)).fetchall())
+    for rowid, distance in result:
+        assert distance == graph_distances[rowid]
+
+
 def test_plain_rowid_filter_without_knn(conn):
     vectors = random_vectors(np.random.default_rng(29), 20, DIM)
     cur = conn.cursor()
@@ -125,6 +309,200 @@ def test_plain_rowid_filter_without_knn(conn):
     assert [r[0] for r in result] == [1, 2]
 
 
+def test_plain_rowid_in_filter_skips_missing_and_deleted_rows(conn):
+    vectors = random_vectors(np.random.default_rng(48), 20, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors, space='l2')
+    cur.execute('delete from t where rowid = 3')
+    result = cur.execute('select rowid from t where rowid in (1, 3, 5, 100) order by rowid').fetchall()
+    assert [r[0] for r in result] == [1, 5]
+
+
+def test_unselective_rowid_in_filter_searches_graph(conn):
+    n = 1000
+    vectors = random_vectors(np.random.default_rng(49), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors, space='l2')
+    # Most rows pass the filter, so with a small ef the graph is searched with
+    # it rather than scoring 900 rows.
+    candidates = [i for i in range(n) if i % 10 != 0]
+    placeholders = ','.join('?' * len(candidates))
+    for probe in (1, 2, 3):
+        result = cur.execute(
+            f'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?)) and rowid in ({placeholders})',
+            (vectors[probe].tobytes(), 10, 10, *candidates)).fetchall()
+        assert len(result) == 10
+        assert all(rowid % 10 != 0 for rowid, _ in result)
+        distances = [d for _, d in result]
+        assert distances == sorted(distances)
+
+
+def _fill_acl(cur, rowids):
+    cur.execute('create table acl(doc_id integer)')
+    cur.executemany('insert into acl(doc_id) values (?)', [(r,) for r in rowids])
+
+
+@pytest.mark.parametrize('num_allowed', [5, 300, 900])
+def test_rowid_bitmap_filters_knn_search(conn, num_allowed):
+    n = 1000
+    vectors = random_vectors(np.random.default_rng(56), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    allowed = sorted(np.random.default_rng(57).choice(n, num_allowed, replace=False).tolist())
+    # Out of order, duplicated and missing rowids don't matter.
+    _fill_acl(cur, allowed[::-1] + allowed[:3] + [n + 5])
+    query = np.float32(np.random.default_rng(58).random(DIM))
+    result = cur.execute(
+        'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?, '
+        '(select rowid_bitmap(doc_id) from acl)))',
+        (query.tobytes(), 10, n)).fetchall()
+    expected = brute_force_knn(vectors[allowed], query, 10)
+    assert [r[0] for r in result] == [allowed[i] for i, _ in expected]
+
+
+def test_rowid_bitmap_matches_rowid_in(conn):
+    n = 200
+    vectors = random_vectors(np.random.default_rng(59), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    allowed = list(range(0, n, 3))
+    _fill_acl(cur, allowed)
+    bitmap = cur.execute('select rowid_bitmap(doc_id) from acl').fetchone()[0]
+    placeholders = ','.join('?' * len(allowed))
+    for probe in (0, 1, 2):
+        from_bitmap = cur.execute(
+            'select rowid, distance from t where knn_search(e, knn_param(?, ?, null, ?))',
+            (vectors[probe].tobytes(), 5, bitmap)).fetchall()
+        from_in = cur.execute(
+            f'select rowid, distance from t where knn_search(e, knn_param(?, ?)) and rowid in ({placeholders})',
+            (vectors[probe].tobytes(), 5, *allowed)).fetchall()
+        assert from_bitmap == from_in
+
+
+def test_rowid_bitmap_with_rowid_range(conn):
+    n = 100
+    vectors = random_vectors(np.random.default_rng(60), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    _fill_acl(cur, range(0, n, 2))
+    result = cur.execute(
+        'select rowid from t where knn_search(e, knn_param(?, ?, ?, '
+        '(select rowid_bitmap(doc_id) from acl))) and rowid between 10 and 20',
+        (vectors[0].tobytes(), n, n)).fetchall()
+    assert sorted(r[0] for r in result) == [10, 12, 14, 16, 18, 20]
+
+
+def test_empty_rowid_bitmap_matches_nothing(conn):
+    vectors = random_vectors(np.random.default_rng(61), 20, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    _fill_acl(cur, [])
+    result = cur.execute(
+        'select rowid from t where knn_search(e, knn_param(?, ?, null, '
+        '(select rowid_bitmap(doc_id) from acl)))',
+        (vectors[0].tobytes(), 5)).fetchall()
+    assert result == []
+
+
+@pytest.mark.parametrize('bitmap', [b'', b'not a bitmap', 'text', 3])
+def test_knn_param_rejects_invalid_rowid_bitmap(conn, bitmap):
+    vectors = random_vectors(np.random.default_rng(62), 5, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    with pytest.raises(sqlite3.OperationalError):
+        cur.execute('select rowid from t where knn_search(e, knn_param(?, ?, null, ?))',
+                    (vectors[0].tobytes(), 3, bitmap)).fetchall()
+
+
+def test_rowid_bitmap_cannot_be_combined_with_rowid_in(conn):
+    vectors = random_vectors(np.random.default_rng(63), 5, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    with pytest.raises(sqlite3.OperationalError):
+        cur.execute(
+            'select rowid from t where knn_search(e, knn_param(?, ?, null, '
+            "(select rowid_bitmap(value) from json_each('[1, 2]')))) and rowid in (1, 3)",
+            (vectors[0].tobytes(), 3)).fetchall()
+
+
+@pytest.mark.parametrize('rowid', [-1, 'abc', 1.5])
+def test_rowid_bitmap_rejects_invalid_rowids(conn, rowid):
+    with pytest.raises(sqlite3.OperationalError):
+        conn.execute('select rowid_bitmap(?)', (rowid,)).fetchone()
+
+
+@pytest.mark.parametrize('predicate,allowed', [
+    ('rowid > 40', lambda i: i > 40),
+    ('rowid >= 40', lambda i: i >= 40),
+    ('rowid < 10', lambda i: i < 10),
+    ('rowid <= 10', lambda i: i <= 10),
+    ('rowid between 20 and 29', lambda i: 20 <= i <= 29),
+    ('rowid > 10.5 and rowid < 15.5', lambda i: 10 < i < 16),
+    ('rowid != 0 and rowid != 1', lambda i: i not in (0, 1)),
+    ('rowid >= 5 and rowid != 6 and rowid in (4, 5, 6, 7)', lambda i: i in (5, 7)),
+])
+def test_rowid_comparison_filters_knn_search(conn, predicate, allowed):
+    n = 50
+    vectors = random_vectors(np.random.default_rng(50), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    query = np.float32(np.random.default_rng(51).random(DIM))
+    result = cur.execute(
+        f'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?)) and {predicate}',
+        (query.tobytes(), 5, n)).fetchall()
+    candidates = [i for i in range(n) if allowed(i)]
+    expected = brute_force_knn(vectors[candidates], query, 5)
+    assert [r[0] for r in result] == [candidates[i] for i, _ in expected]
+
+
+@pytest.mark.parametrize('predicate,expected', [
+    ('rowid > 15', [16, 17, 18, 19]),
+    ('rowid between 3 and 6 and rowid != 4', [3, 5, 6]),
+    ('rowid < 0', []),
+    ('rowid > -100 and rowid < 2', [0, 1]),
+    ('rowid > null', []),
+    ('rowid != 5 and rowid >= 17', [17, 18, 19]),
+])
+def test_rowid_comparison_without_knn(conn, predicate, expected):
+    vectors = random_vectors(np.random.default_rng(52), 20, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    result = cur.execute(f'select rowid from t where {predicate} order by rowid').fetchall()
+    assert [r[0] for r in result] == expected
+
+
+def test_rowid_range_is_not_limited_by_rowid_density(conn):
+    vectors = random_vectors(np.random.default_rng(53), 20, DIM)
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e float32[{DIM}], hnsw(max_elements=20))')
+    # Sparse rowids, e.g. time buckets encoded in the high bits.
+    rowids = [i << 40 for i in range(20)]
+    for rowid, v in zip(rowids, vectors):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (rowid, v.tobytes()))
+    result = cur.execute('select rowid from t where knn_search(e, knn_param(?, ?, ?)) and rowid >= ?',
+                         (vectors[0].tobytes(), 20, 20, rowids[15])).fetchall()
+    assert sorted(r[0] for r in result) == rowids[15:]
+    result = cur.execute('select rowid from t where rowid < ? order by rowid', (rowids[3],)).fetchall()
+    assert [r[0] for r in result] == rowids[:3]
+
+
+def test_delete_by_rowid_range(conn):
+    vectors = random_vectors(np.random.default_rng(54), 20, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    cur.execute('delete from t where rowid >= 10')
+    result = cur.execute('select rowid from t where rowid >= 0 order by rowid').fetchall()
+    assert [r[0] for r in result] == list(range(10))
+
+
+def test_rowid_comparison_rejects_text(conn):
+    vectors = random_vectors(np.random.default_rng(55), 5, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    with pytest.raises(sqlite3.OperationalError):
+        cur.execute('select rowid from t where rowid > ?', ('abc',)).fetchall()
+
+
 def test_multiple_knn_search_unions_results(conn):
     vectors = random_vectors(np.random.default_rng(30), 50, DIM)
     cur = conn.cursor()
@@ -146,3 +524,397 @@ def test_unconstrained_scan_is_rejected(conn):
     # vectorlite requires a knn_search or rowid constraint on every query.
     with pytest.raises(sqlite3.OperationalError):
         cur.execute('select rowid from t').fetchall()
+
+
+def _in_radius(vectors, query, radius, inclusive=True):
+    distances = [(i, l2_squared(query, v)) for i, v in enumerate(vectors)]
+    return sorted((d, i) for i, d in distances if (d <= radius if inclusive else d < radius))
+
+
+def test_knn_param_max_distance_returns_rows_in_radius(conn):
+    n = 300
+    vectors = random_vectors(np.random.default_rng(64), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    query = vectors[0]
+    expected = _in_radius(vectors, query, 1.0)
+    assert 1 < len(expected) < n
+    result = cur.execute(
+        'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?, ?))',
+        (query.tobytes(), n, n, 1.0)).fetchall()
+    assert [r[0] for r in result] == [i for _, i in expected]
+    # k still caps the number of rows.
+    result = cur.execute(
+        'select rowid from t where knn_search(e, knn_param(?, ?, ?, ?))',
+        (query.tobytes(), 2, n, 1.0)).fetchall()
+    assert [r[0] for r in result] == [i for _, i in expected[:2]]
+
+
+def test_radius_search_with_small_ef_stays_in_radius(conn):
+    n = 1000
+    vectors = random_vectors(np.random.default_rng(65), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    for probe in range(5):
+        query = vectors[probe]
+        expected = {i for _, i in _in_radius(vectors, query, 1.2)}
+        result = cur.execute(
+            'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?)) and distance < ?',
+            (query.tobytes(), n, 10, 1.2)).fetchall()
+        assert result[0][0] == probe
+        assert {r[0] for r in result} <= expected
+        distances = [r[1] for r in result]
+        assert distances == sorted(distances)
+        assert all(d < 1.2 for d in distances)
+
+
+@pytest.mark.parametrize('op', ['<', '<='])
+def test_distance_comparison_is_pushed_down_exactly(conn, op):
+    n = 50
+    vectors = random_vectors(np.random.default_rng(66), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    query = vectors[0]
+    # The distance of the 6th nearest row is the bound.
+    bound = cur.execute(
+        'select distance from t where knn_search(e, knn_param(?, 6, ?)) order by distance desc limit 1',
+        (query.tobytes(), n)).fetchone()[0]
+    pushed = cur.execute(
+        f'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?)) and distance {op} ?',
+        (query.tobytes(), n, n, bound)).fetchall()
+    # Unary + keeps SQLite from passing the comparison to vectorlite.
+    filtered = cur.execute(
+        f'select rowid, distance from t where knn_search(e, knn_param(?, ?, ?)) and +distance {op} ?',
+        (query.tobytes(), n, n, bound)).fetchall()
+    assert pushed == filtered
+    assert len(pushed) == (5 if op == '<' else 6)
+
+
+def test_tightest_distance_bound_wins(conn):
+    n = 50
+    vectors = random_vectors(np.random.default_rng(67), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    query = vectors[0]
+    result = cur.execute(
+        'select rowid from t where knn_search(e, knn_param(?, ?, ?, ?)) and distance <= ? and distance < ?',
+        (query.tobytes(), n, n, 2.0, 1.5, 1.0)).fetchall()
+    assert [r[0] for r in result] == [i for _, i in _in_radius(vectors, query, 1.0, inclusive=False)]
+
+
+def test_distance_comparison_with_null_matches_nothing(conn):
+    vectors = random_vectors(np.random.default_rng(68), 20, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    result = cur.execute(
+        'select rowid from t where knn_search(e, knn_param(?, ?)) and distance < ?',
+        (vectors[0].tobytes(), 5, None)).fetchall()
+    assert result == []
+
+
+def test_distance_comparison_rejects_text(conn):
+    vectors = random_vectors(np.random.default_rng(69), 5, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    with pytest.raises(sqlite3.OperationalError):
+        cur.execute('select rowid from t where knn_search(e, knn_param(?, ?)) and distance < ?',
+                    (vectors[0].tobytes(), 3, 'abc')).fetchall()
+
+
+def test_distance_comparison_without_knn(conn):
+    vectors = random_vectors(np.random.default_rng(70), 5, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    # Rows have a distance of 0 without knn_search.
+    result = cur.execute('select rowid from t where rowid in (1, 2) and distance < 1 order by rowid').fetchall()
+    assert [r[0] for r in result] == [1, 2]
+    result = cur.execute('select rowid from t where rowid in (1, 2) and distance < 0').fetchall()
+    assert result == []
+    # A distance comparison alone doesn't restrict which rows are scanned.
+    with pytest.raises(sqlite3.OperationalError):
+        cur.execute('select rowid from t where distance < 1').fetchall()
+
+
+def test_max_distance_and_rowid_bitmap_in_any_order(conn):
+    n = 100
+    vectors = random_vectors(np.random.default_rng(71), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    _fill_acl(cur, range(0, n, 2))
+    query = vectors[0]
+    even = [i for i in range(0, n, 2)]
+    expected = [even[i] for _, i in _in_radius(vectors[even], query, 1.0)]
+    bitmap = '(select rowid_bitmap(doc_id) from acl)'
+    for params in (f'?, {bitmap}', f'{bitmap}, ?'):
+        result = cur.execute(
+            f'select rowid from t where knn_search(e, knn_param(?, ?, ?, {params}))',
+            (query.tobytes(), n, n, 1.0)).fetchall()
+        assert [r[0] for r in result] == expected
+
+
+@pytest.mark.parametrize('extra', [
+    '1.0, 2.0',
+    "1.0, 'abc'",
+    '(select rowid_bitmap(1)), (select rowid_bitmap(2))',
+])
+def test_knn_param_rejects_bad_extra_params(conn, extra):
+    vectors = random_vectors(np.random.default_rng(72), 5, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    with pytest.raises(sqlite3.OperationalError):
+        cur.execute(f'select rowid from t where knn_search(e, knn_param(?, 3, null, {extra}))',
+                    (vectors[0].tobytes(),)).fetchall()
+
+
+def _search_each(cur, queries, k, ef):
+    return [cur.execute('select rowid, distance from t where knn_search(e, knn_param(?, ?, ?))',
+                        (q.tobytes(), k, ef)).fetchall() for q in queries]
+
+
+def _search_batch(cur, queries, k, ef, rowid_filter=''):
+    rows = cur.execute(
+        'select query_index, rowid, distance from t '
+        f'where knn_search(e, knn_batch_param(?, ?, ?)){rowid_filter}',
+        (queries.tobytes(), k, ef)).fetchall()
+    per_query = [[] for _ in queries]
+    for query_index, rowid, distance in rows:
+        per_query[query_index].append((rowid, distance))
+    return per_query
+
+
+@pytest.mark.parametrize('space', ['l2', 'cosine'])
+@pytest.mark.parametrize('num_queries', [1, 7, 64])
+def test_batch_search_matches_individual_searches(conn, space, num_queries):
+    vectors = random_vectors(np.random.default_rng(41), 100, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors, space=space)
+    queries = random_vectors(np.random.default_rng(42), num_queries, DIM)
+    expected = _search_each(cur, queries, 5, 100)
+    result = _search_batch(cur, queries, 5, 100)
+    assert [[rowid for rowid, _ in rows] for rows in result] == \
+        [[rowid for rowid, _ in rows] for rows in expected]
+    for rows, expected_rows in zip(result, expected):
+        assert np.allclose([d for _, d in rows], [d for _, d in expected_rows], atol=1e-5)
+
+
+# The int8 table calibrates after its 10th row, so it is searched through the
+# int8 graph rather than the exact scan of pending vectors.
+@pytest.mark.parametrize('vector_type, options', [
+    ('float16', ''),
+    ('int8', ', int8_calibration=10'),
+    ('binary', ''),
+])
+def test_batch_search_of_quantized_tables(conn, vector_type, options):
+    vectors = random_vectors(np.random.default_rng(43), 50, DIM) - np.float32(0.5)
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e {vector_type}[{DIM}], hnsw(max_elements=50{options}))')
+    for i in range(len(vectors)):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+    queries = vectors[:20]
+    result = _search_batch(cur, queries, 3, 50)
+    assert result == _search_each(cur, queries, 3, 50)
+    if vector_type == 'int8':
+        recall = 0
+        for rows, query in zip(result, queries):
+            expected = brute_force_knn(vectors, query, 3)
+            recall += len({rowid for rowid, _ in rows} & {i for i, _ in expected})
+        assert recall >= 0.9 * 3 * len(queries)
+
+
+def test_batch_search_of_pq_table(conn):
+    vectors = random_vectors(np.random.default_rng(44), 200, DIM)
+    cur = conn.cursor()
+    _fill_pq(cur, vectors)
+    queries = vectors[:32]
+    assert _search_batch(cur, queries, 10, 200) == _search_each(cur, queries, 10, 200)
+
+
+def test_batch_search_with_rowid_filter(conn):
+    vectors = random_vectors(np.random.default_rng(45), 50, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    result = _search_batch(cur, vectors[:4], 3, 50, ' and rowid in (1, 2, 3, 10, 20)')
+    for rows in result:
+        assert len(rows) == 3
+        assert {rowid for rowid, _ in rows} <= {1, 2, 3, 10, 20}
+    assert result[1][0] == (1, 0.0)
+    assert result[2][0] == (2, 0.0)
+
+
+def test_query_index_of_single_search_is_zero(conn):
+    vectors = random_vectors(np.random.default_rng(46), 10, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    rows = cur.execute('select query_index from t where knn_search(e, knn_param(?, ?))',
+                       (vectors[0].tobytes(), 3)).fetchall()
+    assert rows == [(0,), (0,), (0,)]
+
+
+@pytest.mark.parametrize('queries', [b'', b'\x00' * (DIM * 4 + 4), b'\x00' * (DIM * 2)])
+def test_batch_search_rejects_malformed_queries(conn, queries):
+    vectors = random_vectors(np.random.default_rng(47), 10, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    with pytest.raises(sqlite3.OperationalError):
+        cur.execute('select rowid from t where knn_search(e, knn_batch_param(?, ?))',
+                    (queries, 3)).fetchall()
+
+
+def test_batch_search_with_max_distance(conn):
+    vectors = random_vectors(np.random.default_rng(73), 100, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    queries = vectors[:4]
+    rows = cur.execute(
+        'select query_index, rowid from t where knn_search(e, knn_batch_param(?, ?, ?, ?))',
+        (queries.tobytes(), 100, 100, 1.0)).fetchall()
+    for q, query in enumerate(queries):
+        expected = [i for _, i in _in_radius(vectors, query, 1.0)]
+        assert [rowid for query_index, rowid in rows if query_index == q] == expected
+
+
+def _search_stream(cur, query, k, ef, suffix='', params=()):
+    return cur.execute(
+        f'select rowid, distance from t where knn_search(e, knn_stream_param(?, ?, ?)){suffix}',
+        (query.tobytes(), k, ef, *params)).fetchall()
+
+
+def test_stream_search_matches_knn_param_with_high_ef(conn):
+    n = 300
+    vectors = random_vectors(np.random.default_rng(74), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    query = np.float32(np.random.default_rng(75).random(DIM))
+    expected = cur.execute('select rowid, distance from t where knn_search(e, knn_param(?, ?, ?))',
+                           (query.tobytes(), 10, n)).fetchall()
+    # ef >= n settles every row before the first is returned, so rows come in
+    # exact order.
+    assert _search_stream(cur, query, n, n, ' limit 10') == expected
+
+
+def test_stream_search_is_capped_by_k(conn):
+    n = 50
+    vectors = random_vectors(np.random.default_rng(76), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    assert len(_search_stream(cur, vectors[0], 5, 10)) == 5
+    result = _search_stream(cur, vectors[0], n + 10, n)
+    assert sorted(r[0] for r in result) == list(range(n))
+
+
+def test_stream_search_with_small_ef_returns_distinct_rows(conn):
+    n = 1000
+    vectors = random_vectors(np.random.default_rng(77), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    result = _search_stream(cur, vectors[3], n, 10)
+    assert result[0] == (3, 0.0)
+    rowids = [r[0] for r in result]
+    assert len(set(rowids)) == len(rowids)
+    # The search keeps widening until the whole graph is read.
+    assert len(rowids) >= 0.99 * n
+    for rowid, distance in result[:20]:
+        assert np.isclose(distance, l2_squared(vectors[3], vectors[rowid]), rtol=1e-4, atol=1e-4)
+
+
+def test_stream_search_with_join_filter_and_limit(conn):
+    n = 500
+    vectors = random_vectors(np.random.default_rng(78), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    cur.execute('create table meta(id integer primary key, tag integer)')
+    cur.executemany('insert into meta(id, tag) values (?, ?)', [(i, i % 7) for i in range(n)])
+    query = np.float32(np.random.default_rng(79).random(DIM))
+    # The filter can't be pushed down, so rows are read until 5 pass it.
+    result = cur.execute(
+        'select t.rowid from t cross join meta on meta.id = t.rowid '
+        'where knn_search(t.e, knn_stream_param(?, ?, ?)) and meta.tag = 0 limit 5',
+        (query.tobytes(), n, n)).fetchall()
+    tagged = [i for i in range(n) if i % 7 == 0]
+    expected = brute_force_knn(vectors[tagged], query, 5)
+    assert [r[0] for r in result] == [tagged[i] for i, _ in expected]
+
+
+def test_stream_search_with_rowid_filters(conn):
+    n = 300
+    vectors = random_vectors(np.random.default_rng(80), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    query = np.float32(np.random.default_rng(81).random(DIM))
+    allowed = [i for i in range(100, n) if i % 3 != 0]
+    expected = [allowed[i] for i, _ in brute_force_knn(vectors[allowed], query, 10)]
+    placeholders = ','.join('?' * len(allowed))
+    result = _search_stream(cur, query, 10, n, f' and rowid in ({placeholders})', allowed)
+    assert [r[0] for r in result] == expected
+    _fill_acl(cur, [i for i in range(n) if i % 3 != 0])
+    result = cur.execute(
+        'select rowid from t where knn_search(e, knn_stream_param(?, ?, ?, '
+        '(select rowid_bitmap(doc_id) from acl))) and rowid >= 100',
+        (query.tobytes(), 10, n)).fetchall()
+    assert [r[0] for r in result] == expected
+
+
+def test_stream_search_stays_in_radius(conn):
+    n = 300
+    vectors = random_vectors(np.random.default_rng(82), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    query = vectors[0]
+    expected = [i for _, i in _in_radius(vectors, query, 1.0)]
+    assert 1 < len(expected) < n
+    result = cur.execute(
+        'select rowid from t where knn_search(e, knn_stream_param(?, ?, ?, ?))',
+        (query.tobytes(), n, n, 1.0)).fetchall()
+    assert [r[0] for r in result] == expected
+    result = _search_stream(cur, query, n, 10, ' and distance <= ?', (1.0,))
+    assert {r[0] for r in result} <= set(expected)
+    assert result[0][0] == 0
+
+
+def test_stream_search_falls_back_to_eager_search(conn):
+    n = 30
+    vectors = random_vectors(np.random.default_rng(83), n, DIM) - np.float32(0.5)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    query = np.float32(np.random.default_rng(84).random(DIM)) - np.float32(0.5)
+    # Few candidates are scored exactly rather than searched.
+    result = _search_stream(cur, query, 2, 10, ' and rowid in (1, 5, 9, 20)')
+    expected = brute_force_knn(vectors[[1, 5, 9, 20]], query, 2)
+    assert [r[0] for r in result] == [[1, 5, 9, 20][i] for i, _ in expected]
+
+    # Reranked binary search returns its rows at once.
+    cur.execute(f'create virtual table b using vectorlite(e binary[{DIM}], '
+                f'hnsw(max_elements={n}, rerank={n}))')
+    for i in range(n):
+        cur.execute('insert into b(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+    expected = cur.execute('select rowid, distance from b where knn_search(e, knn_param(?, ?, ?))',
+                           (query.tobytes(), 5, n)).fetchall()
+    result = cur.execute('select rowid, distance from b where knn_search(e, knn_stream_param(?, ?, ?))',
+                         (query.tobytes(), 5, n)).fetchall()
+    assert result == expected
+
+
+def test_knn_stream_param_rejects_bad_params(conn):
+    vectors = random_vectors(np.random.default_rng(85), 10, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    for params in ((vectors[0].tobytes(), 0), (vectors[0].tobytes(), 3, 0), ('text', 3)):
+        with pytest.raises(sqlite3.OperationalError):
+            cur.execute(f'select rowid from t where knn_search(e, knn_stream_param({", ".join("?" * len(params))}))',
+                        params).fetchall()
+
+
+def test_stream_search_fails_if_index_is_replaced(conn, tmp_path):
+    n = 100
+    vectors = random_vectors(np.random.default_rng(86), n, DIM)
+    cur = conn.cursor()
+    _fill(cur, vectors)
+    index_path = str(tmp_path / 'index.bin')
+    cur.execute('insert into t(operation, path) values (?, ?)', ('save', index_path))
+    stream = conn.execute('select rowid from t where knn_search(e, knn_stream_param(?, ?, ?))',
+                          (vectors[0].tobytes(), n, 10))
+    assert stream.fetchone() == (0,)
+    # Loading frees the graph the stream is reading.
+    cur.execute('insert into t(operation, path) values (?, ?)', ('load', index_path))
+    with pytest.raises(sqlite3.OperationalError, match='index was replaced'):
+        stream.fetchall()
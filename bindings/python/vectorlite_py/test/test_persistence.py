@@ -128,6 +128,90 @@ def test_load_element_type_mismatch_is_rejected(conn):
             cur.execute('insert into dst(operation, path) values (?, ?)', ('load', index_path))
 
 
+@pytest.mark.parametrize('n', [10, 100])
+def test_int8_calibration_is_saved_alongside_index(conn, n):
+    # With n=10 the table is not calibrated yet and the pending float32
+    # vectors are saved instead.
+    options = 'hnsw(max_elements=100, int8_calibration=50)'
+    with tempfile.TemporaryDirectory() as d:
+        index_path = os.path.join(d, 'index.bin')
+        # Values far from [0, 1) so that a missing calibration would be noticed.
+        vectors = random_vectors(np.random.default_rng(65), n, DIM) * 100 - 50
+        cur = conn.cursor()
+        cur.execute(f'create virtual table src using vectorlite(e int8[{DIM}], {options})')
+        for i in range(n):
+            cur.execute('insert into src(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+        cur.execute('insert into src(operation, path) values (?, ?)', ('save', index_path))
+        assert os.path.exists(index_path + '.int8')
+
+        cur.execute(f'create virtual table dst using vectorlite(e int8[{DIM}], {options})')
+        cur.execute('insert into dst(operation, path) values (?, ?)', ('load', index_path))
+        back = np.frombuffer(cur.execute('select e from dst where rowid = 3').fetchone()[0], dtype=np.float32)
+        assert np.allclose(back, vectors[3], atol=1.0)
+        rows = cur.execute('select rowid from dst where knn_search(e, knn_param(?, 1))',
+                           (vectors[5].tobytes(),)).fetchall()
+        assert rows == [(5,)]
+
+        os.remove(index_path + '.int8')
+        cur.execute(f'create virtual table dst2 using vectorlite(e int8[{DIM}], {options})')
+        with pytest.raises(sqlite3.OperationalError):
+            cur.execute('insert into dst2(operation, path) values (?, ?)', ('load', index_path))
+
+
+@pytest.mark.parametrize('n', [10, 100])
+def test_pq_codebooks_are_saved_alongside_index(conn, n):
+    # With n=10 the codebooks are not trained yet and the pending float32
+    # vectors are saved instead.
+    options = 'hnsw(max_elements=100, pq=8, pq_train=50)'
+    with tempfile.TemporaryDirectory() as d:
+        index_path = os.path.join(d, 'index.bin')
+        vectors = random_vectors(np.random.default_rng(66), n, DIM)
+        cur = conn.cursor()
+        cur.execute(f'create virtual table src using vectorlite(e float32[{DIM}], {options})')
+        for i in range(n):
+            cur.execute('insert into src(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+        cur.execute('insert into src(operation, path) values (?, ?)', ('save', index_path))
+        assert os.path.exists(index_path + '.pq')
+        expected = cur.execute('select e from src where rowid = 3').fetchone()[0]
+
+        cur.execute(f'create virtual table dst using vectorlite(e float32[{DIM}], {options})')
+        cur.execute('insert into dst(operation, path) values (?, ?)', ('load', index_path))
+        assert cur.execute('select e from dst where rowid = 3').fetchone()[0] == expected
+
+        os.remove(index_path + '.pq')
+        cur.execute(f'create virtual table dst2 using vectorlite(e float32[{DIM}], {options})')
+        with pytest.raises(sqlite3.OperationalError):
+            cur.execute('insert into dst2(operation, path) values (?, ?)', ('load', index_path))
+
+
+def test_binary_rerank_vectors_are_saved_alongside_index(conn):
+    options = 'hnsw(max_elements=100, rerank=4)'
+    with tempfile.TemporaryDirectory() as d:
+        index_path = os.path.join(d, 'index.bin')
+        vectors = random_vectors(np.random.default_rng(67), 20, DIM) - np.float32(0.5)
+        cur = conn.cursor()
+        cur.execute(f'create virtual table src using vectorlite(e binary[{DIM}], {options})')
+        for i in range(len(vectors)):
+            cur.execute('insert into src(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+        cur.execute('delete from src where rowid = 4')
+        cur.execute('insert into src(operation, path) values (?, ?)', ('save', index_path))
+        assert os.path.exists(index_path + '.rerank')
+
+        cur.execute(f'create virtual table dst using vectorlite(e binary[{DIM}], {options})')
+        cur.execute('insert into dst(operation, path) values (?, ?)', ('load', index_path))
+        assert cur.execute('select e from dst where rowid = 3').fetchone()[0] == vectors[3].tobytes()
+        row = cur.execute('select rowid, distance from dst where knn_search(e, knn_param(?, 1))',
+                          (vectors[5].tobytes(),)).fetchone()
+        assert row == (5, 0.0)
+        cur.execute('insert into dst(rowid, e) values (?, ?)', (4, vectors[4].tobytes()))
+        assert cur.execute('select e from dst where rowid = 4').fetchone()[0] == vectors[4].tobytes()
+
+        os.remove(index_path + '.rerank')
+        cur.execute(f'create virtual table dst2 using vectorlite(e binary[{DIM}], {options})')
+        with pytest.raises(sqlite3.OperationalError):
+            cur.execute('insert into dst2(operation, path) values (?, ?)', ('load', index_path))
+
+
 def test_unknown_operation_is_rejected(conn):
     cur = conn.cursor()
     cur.execute(f'create virtual table t using vectorlite(e float32[{DIM}], hnsw(max_elements=10))')
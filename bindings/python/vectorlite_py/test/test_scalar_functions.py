@@ -4,7 +4,7 @@ import sqlite3
 import numpy as np
 import pytest
 import vectorlite_py
-from vectorlite_py.test.helpers import l2_squared, ip_distance, cosine_distance
+from vectorlite_py.test.helpers import DISTANCE_FN, l2_squared, ip_distance, cosine_distance
 
 
 @pytest.mark.parametrize('dim', [1, 3, 4, 16, 128])
@@ -32,6 +32,27 @@ def test_vector_distance_self_is_zero_for_l2(conn):
     assert np.isclose(d, 0.0, atol=1e-6)
 
 
+def test_vector_distance_over_many_rows(conn):
+    # The metric argument is parsed once per statement and reused across rows.
+    rng = np.random.default_rng(11)
+    vectors = np.float32(rng.random((50, 8)))
+    query = np.float32(rng.random(8))
+    cur = conn.cursor()
+    cur.execute('create temp table t(v blob)')
+    cur.executemany('insert into t(v) values (?)', [(v.tobytes(),) for v in vectors])
+    rows = cur.execute('select vector_distance(v, ?, "cosine") from t order by rowid',
+                       (query.tobytes(),)).fetchall()
+    expected = [cosine_distance(v, query) for v in vectors]
+    assert np.allclose([r[0] for r in rows], expected, atol=1e-5)
+
+
+def test_vector_distance_cosine_to_zero_vector_is_one(conn):
+    a = np.float32([1, 2, 3])
+    zero = np.float32([0, 0, 0])
+    d = conn.cursor().execute('select vector_distance(?, ?, "cosine")', (a.tobytes(), zero.tobytes())).fetchone()[0]
+    assert np.isclose(d, 1.0)
+
+
 def test_vector_distance_wrong_arg_count_is_rejected(conn):
     with pytest.raises(sqlite3.OperationalError):
         conn.cursor().execute('select vector_distance(?, ?)', (b'', b'')).fetchone()
@@ -56,6 +77,134 @@ def test_vector_distance_non_float_blob_is_rejected(conn):
         conn.cursor().execute('select vector_distance(?, ?, "l2")', (b'abc', b'abc')).fetchone()
 
 
+@pytest.mark.parametrize('space', ['l2', 'ip', 'cosine'])
+@pytest.mark.parametrize('num_queries,num_vectors', [(1, 1), (4, 2), (9, 7)])
+def test_vector_distance_matrix_matches_vector_distance(conn, space, num_queries, num_vectors):
+    dim = 37
+    rng = np.random.default_rng(5)
+    queries = np.float32(rng.random((num_queries, dim)))
+    vectors = np.float32(rng.random((num_vectors, dim)))
+    blob = conn.cursor().execute('select vector_distance_matrix(?, ?, ?, ?)',
+                                 (queries.tobytes(), vectors.tobytes(), space, dim)).fetchone()[0]
+    matrix = np.frombuffer(blob, dtype=np.float32).reshape(num_queries, num_vectors)
+    distance = DISTANCE_FN[space]
+    for i in range(num_queries):
+        for j in range(num_vectors):
+            assert np.isclose(matrix[i, j], distance(queries[i], vectors[j]), rtol=1e-4, atol=1e-4)
+
+
+def test_vector_distance_matrix_defaults_to_a_single_query(conn):
+    query = np.float32([1, 2, 3, 4])
+    vectors = np.float32([[1, 2, 3, 4], [0, 0, 0, 0], [1, 1, 1, 1]])
+    blob = conn.cursor().execute('select vector_distance_matrix(?, ?, "l2")',
+                                 (query.tobytes(), vectors.tobytes())).fetchone()[0]
+    expected = [l2_squared(query, v) for v in vectors]
+    assert np.allclose(np.frombuffer(blob, dtype=np.float32), expected, atol=1e-4)
+
+
+def test_vector_distance_matrix_of_no_vectors_is_empty(conn):
+    query = np.float32([1, 2, 3, 4]).tobytes()
+    blob = conn.cursor().execute('select vector_distance_matrix(?, ?, "l2")', (query, b'')).fetchone()[0]
+    assert blob == b''
+
+
+@pytest.mark.parametrize('args', [
+    (np.float32([1, 2, 3]).tobytes(), np.float32([1, 2, 3, 4]).tobytes(), 'l2'),  # not a multiple of dim
+    (np.float32([1, 2, 3, 4]).tobytes(), np.float32([1, 2, 3, 4]).tobytes(), 'l2', 3),
+    (np.float32([1, 2, 3, 4]).tobytes(), np.float32([1, 2, 3, 4]).tobytes(), 'l2', 0),
+    (np.float32([1, 2, 3, 4]).tobytes(), np.float32([1, 2, 3, 4]).tobytes(), 'manhattan'),
+    (b'', np.float32([1, 2, 3, 4]).tobytes(), 'l2'),
+    ('text', np.float32([1, 2, 3, 4]).tobytes(), 'l2'),
+])
+def test_vector_distance_matrix_invalid_arguments_are_rejected(conn, args):
+    placeholders = ', '.join('?' * len(args))
+    with pytest.raises(sqlite3.OperationalError):
+        conn.cursor().execute(f'select vector_distance_matrix({placeholders})', args).fetchone()
+
+
+def _create_vector_table(cur, vectors):
+    cur.execute('create temp table items(rowid integer primary key, v blob)')
+    cur.executemany('insert into items(rowid, v) values (?, ?)',
+                    [(i, v.tobytes()) for i, v in enumerate(vectors)])
+
+
+@pytest.mark.parametrize('space', ['l2', 'ip', 'cosine'])
+@pytest.mark.parametrize('k', [1, 10, 200])
+def test_vector_topk_matches_order_by(conn, space, k):
+    rng = np.random.default_rng(5)
+    vectors = np.float32(rng.random((100, 16)))
+    query = np.float32(rng.random(16))
+    cur = conn.cursor()
+    _create_vector_table(cur, vectors)
+
+    result = json.loads(cur.execute('select vector_topk(rowid, v, ?, ?, ?) from items',
+                                    (query.tobytes(), k, space)).fetchone()[0])
+    expected = cur.execute('select rowid, vector_distance(v, ?, ?) as d from items order by d, rowid limit ?',
+                           (query.tobytes(), space, k)).fetchall()
+    assert len(result) == min(k, len(vectors))
+    assert [r['rowid'] for r in result] == [rowid for rowid, _ in expected]
+    assert np.allclose([r['distance'] for r in result], [d for _, d in expected], atol=1e-5)
+
+
+@pytest.mark.parametrize('k', [3, 700])
+def test_vector_topk_over_many_rows_with_ties(conn, k):
+    # More rows than vector_topk buffers before selecting, and every vector
+    # appears 4 times.
+    rng = np.random.default_rng(6)
+    vectors = np.tile(np.float32(rng.random((1000, 8))), (4, 1))
+    query = np.float32(rng.random(8))
+    cur = conn.cursor()
+    _create_vector_table(cur, vectors)
+
+    result = json.loads(cur.execute('select vector_topk(rowid, v, ?, ?, "l2") from items',
+                                    (query.tobytes(), k)).fetchone()[0])
+    expected = cur.execute('select rowid, vector_distance(v, ?, "l2") as d from items order by d, rowid limit ?',
+                           (query.tobytes(), k)).fetchall()
+    assert [r['rowid'] for r in result] == [rowid for rowid, _ in expected]
+
+
+def test_vector_topk_skips_null_vectors(conn):
+    cur = conn.cursor()
+    _create_vector_table(cur, np.float32([[0, 0], [1, 1], [2, 2]]))
+    cur.execute('insert into items(rowid, v) values (3, null)')
+    result = json.loads(cur.execute('select vector_topk(rowid, v, ?, 10, "l2") from items',
+                                    (np.float32([0, 0]).tobytes(),)).fetchone()[0])
+    assert result == [{'rowid': 0, 'distance': 0.0}, {'rowid': 1, 'distance': 2.0},
+                      {'rowid': 2, 'distance': 8.0}]
+
+
+def test_vector_topk_of_no_rows_is_empty(conn):
+    cur = conn.cursor()
+    _create_vector_table(cur, np.float32([[1, 2]]))
+    out = cur.execute('select vector_topk(rowid, v, ?, 3, "l2") from items where rowid < 0',
+                      (np.float32([1, 2]).tobytes(),)).fetchone()[0]
+    assert json.loads(out) == []
+
+
+def test_vector_topk_per_group(conn):
+    cur = conn.cursor()
+    cur.execute('create temp table grouped(rowid integer primary key, g integer, v blob)')
+    for i in range(6):
+        cur.execute('insert into grouped values (?, ?, ?)', (i, i % 2, np.float32([i, 0]).tobytes()))
+    rows = cur.execute('select g, vector_topk(rowid, v, ?, 2, "l2") from grouped group by g order by g',
+                       (np.float32([0, 0]).tobytes(),)).fetchall()
+    assert [[r['rowid'] for r in json.loads(out)] for _, out in rows] == [[0, 2], [1, 3]]
+
+
+@pytest.mark.parametrize('args', [
+    (b'\x00' * 8, 0, 'l2'),
+    (b'\x00' * 8, 'a', 'l2'),
+    (b'\x00' * 8, 1, 'manhattan'),
+    ('not a blob', 1, 'l2'),
+    (b'\x00' * 12, 1, 'l2'),
+])
+def test_vector_topk_invalid_arguments_are_rejected(conn, args):
+    cur = conn.cursor()
+    _create_vector_table(cur, np.float32([[1, 2]]))
+    with pytest.raises(sqlite3.OperationalError):
+        cur.execute('select vector_topk(rowid, v, ?, ?, ?) from items', args).fetchone()
+
+
 @pytest.mark.parametrize('dim', [1, 4, 64])
 def test_json_round_trip(conn, dim):
     rng = np.random.default_rng(11)
@@ -76,11 +225,45 @@ def test_vector_to_json_format(conn):
     assert json.loads(j) == [1.0, 2.0, 3.0, 4.0]
 
 
+def test_vector_to_json_writes_float_precision(conn):
+    j = conn.cursor().execute('select vector_to_json(?)', (np.float32([0.1, 0.3, -1.5]).tobytes(),)).fetchone()[0]
+    assert j == '[0.1,0.3,-1.5]'
+
+
+def test_vector_to_json_writes_non_finite_as_null(conn):
+    v = np.float32([1, np.nan, np.inf, 2])
+    j = conn.cursor().execute('select vector_to_json(?)', (v.tobytes(),)).fetchone()[0]
+    assert json.loads(j) == [1.0, None, None, 2.0]
+
+
+@pytest.mark.parametrize('text', ['[1, [2]]', '[1, null]', '{"a": 1}', '[1,]', '[1] [2]'])
+def test_vector_from_json_rejects_non_flat_arrays(conn, text):
+    with pytest.raises(sqlite3.OperationalError):
+        conn.cursor().execute('select vector_from_json(?)', (text,)).fetchone()
+
+
 def test_vector_from_json_rejects_malformed_json(conn):
     with pytest.raises(sqlite3.OperationalError):
         conn.cursor().execute("select vector_from_json('not json')").fetchone()
 
 
+def test_vector_to_half_precision(conn):
+    v = np.float32([1, -2.5, 0.375, 1000, 65504])
+    cur = conn.cursor()
+    f16 = cur.execute('select vector_to_f16(?)', (v.tobytes(),)).fetchone()[0]
+    assert f16 == np.float16(v).tobytes()
+    bf16 = cur.execute('select vector_to_bf16(?)', (v[:4].tobytes(),)).fetchone()[0]
+    # These values are exact in bfloat16, which is the upper half of float32.
+    assert bf16 == (v[:4].view(np.uint32) >> 16).astype(np.uint16).tobytes()
+
+
+@pytest.mark.parametrize('function', ['vector_to_bf16', 'vector_to_f16'])
+@pytest.mark.parametrize('arg', ['a string', b'abc'])
+def test_vector_to_half_precision_rejects_invalid_input(conn, function, arg):
+    with pytest.raises(sqlite3.OperationalError):
+        conn.cursor().execute(f'select {function}(?)', (arg,)).fetchone()
+
+
 def test_vector_to_json_rejects_non_blob(conn):
     with pytest.raises(sqlite3.OperationalError):
         conn.cursor().execute('select vector_to_json(?)', ('a string',)).fetchone()
@@ -90,3 +273,33 @@ def test_vectorlite_info_reports_version_and_simd(conn):
     out = conn.cursor().execute('select vectorlite_info()').fetchone()[0]
     assert f'vectorlite extension version {vectorlite_py.__version__}' in out
     assert 'Best SIMD target in use:' in out
+
+
+def test_vectorlite_autotune_reports_tuned_tables(conn):
+    cur = conn.cursor()
+    cur.execute('create virtual table t_f32 using vectorlite(e float32[16] l2, hnsw(max_elements=100))')
+    cur.execute('create virtual table t_bf16 using vectorlite(e bfloat16[16] cosine, hnsw(max_elements=100))')
+    cur.execute('create virtual table t_int8 using vectorlite(e int8[16] l2, hnsw(max_elements=100))')
+    rng = np.random.default_rng(0)
+    data = rng.random((20, 16), dtype=np.float32)
+    for i, v in enumerate(data):
+        cur.execute('insert into t_f32(rowid, e) values (?, ?)', (i, v.tobytes()))
+
+    assert 'Autotuned' not in cur.execute('select vectorlite_info()').fetchone()[0]
+    tuned = cur.execute('select vectorlite_autotune()').fetchone()[0]
+    assert 'main.t_f32=' in tuned
+    assert 'main.t_bf16=' in tuned
+    # Quantized tables keep their distance function.
+    assert 't_int8' not in tuned
+
+    info = cur.execute('select vectorlite_info()').fetchone()[0]
+    assert f'Autotuned distance functions: {tuned}' in info
+
+    result = cur.execute('select rowid, distance from t_f32 where knn_search(e, knn_param(?, 1))',
+                         (data[3].tobytes(),)).fetchall()
+    assert result[0][0] == 3
+    assert math.isclose(result[0][1], 0.0, abs_tol=1e-5)
+
+
+def test_vectorlite_autotune_without_tables_is_empty(conn):
+    assert conn.cursor().execute('select vectorlite_autotune()').fetchone()[0] == ''
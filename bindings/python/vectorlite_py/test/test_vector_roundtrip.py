@@ -1,3 +1,5 @@
+import sqlite3
+
 import numpy as np
 import pytest
 from vectorlite_py.test.helpers import get_connection, random_vectors, ELEMENT_TYPES, DEQUANT_RTOL
@@ -34,6 +36,17 @@ def test_read_back_within_tolerance_for_all_types(vector_type):
     conn.close()
 
 
+@pytest.mark.parametrize('vector_type, max_value', [('float8_e4m3', 448.0), ('float8_e5m2', 57344.0)])
+def test_float8_saturates_out_of_range_values(conn, vector_type, max_value):
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e {vector_type}[4], hnsw(max_elements=10))')
+    v = np.float32([1e6, -1e6, 0.5, -3.0])
+    cur.execute('insert into t(rowid, e) values (?, ?)', (0, v.tobytes()))
+    back = np.frombuffer(cur.execute('select e from t where rowid = 0').fetchone()[0], dtype=np.float32)
+    # 0.5 and -3.0 are exactly representable in both formats.
+    assert back.tolist() == [max_value, -max_value, 0.5, -3.0]
+
+
 def test_cosine_column_is_normalized_on_read(conn):
     dim = 4
     cur = conn.cursor()
@@ -66,3 +79,166 @@ def test_round_trip_survives_many_rows(conn):
     for i in (0, n // 2, n - 1):
         back = cur.execute('select e from t where rowid = ?', (i,)).fetchone()[0]
         assert back == vectors[i].tobytes()
+
+
+@pytest.mark.parametrize('vector_type', ELEMENT_TYPES)
+def test_every_knn_result_reads_back_its_own_vector(vector_type):
+    dim = 16
+    n = 50
+    vectors = random_vectors(np.random.default_rng(6), n, dim)
+    conn = get_connection()
+    cur = conn.cursor()
+    # int8 vectors are calibrated on the first 10 and quantized from then on.
+    cur.execute(f'create virtual table t using vectorlite(e {vector_type}[{dim}], '
+                f'hnsw(max_elements={n}, int8_calibration=10))')
+    cur.executemany('insert into t(rowid, e) values (?, ?)', [(i, vectors[i].tobytes()) for i in range(n)])
+    rows = cur.execute('select rowid, e from t where knn_search(e, knn_param(?, ?))',
+                       (vectors[0].tobytes(), n)).fetchall()
+    assert len(rows) == n
+    rtol = DEQUANT_RTOL[vector_type]
+    for rowid, blob in rows:
+        back = np.frombuffer(blob, dtype=np.float32)
+        assert np.allclose(back, vectors[rowid], rtol=rtol, atol=rtol)
+    conn.close()
+
+
+def test_int8_calibration_covers_every_sampled_vector(conn):
+    dim = 16
+    vectors = random_vectors(np.random.default_rng(7), 20, dim)
+    # Only a vector late in the calibration sample spans a much wider range.
+    vectors[15, 0] = 20
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e int8[{dim}], hnsw(max_elements=20, int8_calibration=20))')
+    for i in range(20):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (i, vectors[i].tobytes()))
+        if i < 19:
+            # Not calibrated yet, vectors are kept as they are.
+            back = cur.execute('select e from t where rowid = ?', (i,)).fetchone()[0]
+            assert back == vectors[i].tobytes()
+    back = np.frombuffer(cur.execute('select e from t where rowid = 15').fetchone()[0], dtype=np.float32)
+    assert back[0] == pytest.approx(20, abs=0.2)
+
+
+def test_read_back_reflects_update(conn):
+    cur = conn.cursor()
+    cur.execute('create virtual table t using vectorlite(e float32[4], hnsw(max_elements=10))')
+    v1 = np.float32([1, 2, 3, 4])
+    v2 = np.float32([5, 6, 7, 8])
+    cur.execute('insert into t(rowid, e) values (?, ?)', (0, v1.tobytes()))
+    before = cur.execute('select e from t where rowid = 0').fetchone()[0]
+    cur.execute('update t set e = ? where rowid = 0', (v2.tobytes(),))
+    after = cur.execute('select e from t where rowid = 0').fetchone()[0]
+    assert before == v1.tobytes()
+    assert after == v2.tobytes()
+
+
+def to_bf16_bytes(v):
+    # Truncates, which is exact for values with at most 8 significant bits.
+    return (np.float32(v).view(np.uint32) >> 16).astype(np.uint16).tobytes()
+
+
+HALF_PRECISION_ENCODERS = {
+    'bfloat16': to_bf16_bytes,
+    'float16': lambda v: np.float16(v).tobytes(),
+}
+
+
+@pytest.mark.parametrize('vector_type', ['bfloat16', 'float16'])
+def test_half_precision_tables_take_and_return_native_blobs(conn, vector_type):
+    encode = HALF_PRECISION_ENCODERS[vector_type]
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e {vector_type}[4], '
+                'hnsw(max_elements=10, native_input=true, native_output=true))')
+    v1 = np.float32([1, -2, 0.5, 3])
+    v2 = np.float32([1.5, 0, -0.25, 8])
+    cur.execute('insert into t(rowid, e) values (?, ?)', (0, encode(v1)))
+    cur.execute('insert into t(rowid, e) values (?, ?)', (1, encode(v2)))
+    assert cur.execute('select e from t where rowid = 0').fetchone()[0] == encode(v1)
+    assert cur.execute('select e from t where rowid = 1').fetchone()[0] == encode(v2)
+
+    cur.execute('update t set e = ? where rowid = 1', (encode(v1),))
+    assert cur.execute('select e from t where rowid = 1').fetchone()[0] == encode(v1)
+    cur.execute('update t set e = ? where rowid = 1', (encode(v2),))
+
+    rows = cur.execute('select rowid, distance from t where knn_search(e, knn_param(?, 2))',
+                       (encode(v2),)).fetchall()
+    assert [rowid for rowid, _ in rows] == [1, 0]
+    assert np.isclose(rows[1][1], float(np.sum((v1 - v2) ** 2)))
+
+    rows = cur.execute('select query_index, rowid from t where knn_search(e, knn_batch_param(?, 1))',
+                       (encode(v1) + encode(v2),)).fetchall()
+    assert rows == [(0, 0), (1, 1)]
+
+
+@pytest.mark.parametrize('vector_type', ['bfloat16', 'float16'])
+def test_native_query_matches_float32_query(conn, vector_type):
+    encode = HALF_PRECISION_ENCODERS[vector_type]
+    dim = 8
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e {vector_type}[{dim}] cosine, hnsw(max_elements=20))')
+    cur.execute(f'create virtual table n using vectorlite(e {vector_type}[{dim}] cosine, '
+                'hnsw(max_elements=20, native_input=true))')
+    rng = np.random.default_rng(7)
+    vectors = np.float32(rng.integers(-8, 8, (20, dim)))
+    for i, v in enumerate(vectors):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (i, v.tobytes()))
+        cur.execute('insert into n(rowid, e) values (?, ?)', (i, encode(v)))
+    query = np.float32(rng.integers(-8, 8, dim))
+    native = cur.execute('select rowid, distance from n where knn_search(e, knn_param(?, 5))',
+                         (encode(query),)).fetchall()
+    f32 = cur.execute('select rowid, distance from t where knn_search(e, knn_param(?, 5))',
+                      (query.tobytes(),)).fetchall()
+    assert [rowid for rowid, _ in native] == [rowid for rowid, _ in f32]
+    assert np.allclose([d for _, d in native], [d for _, d in f32], atol=1e-2)
+
+
+def test_native_blob_of_wrong_size_is_rejected(conn):
+    cur = conn.cursor()
+    cur.execute('create virtual table t using vectorlite(e bfloat16[4], hnsw(max_elements=10, native_input=true))')
+    # The last one is a float32 vector of the table's dimension.
+    for blob in (b'\x00' * 6, b'\x00' * 10, b'\x00' * 16):
+        with pytest.raises(sqlite3.OperationalError, match='dimension'):
+            cur.execute('insert into t(rowid, e) values (?, ?)', (0, blob))
+    cur.execute('insert into t(rowid, e) values (?, ?)', (0, b'\x00' * 8))
+    with pytest.raises(sqlite3.OperationalError, match='dimension'):
+        cur.execute('select rowid from t where knn_search(e, knn_param(?, 1))', (b'\x00' * 16,)).fetchall()
+    with pytest.raises(sqlite3.OperationalError, match='dimension'):
+        cur.execute('update t set e = ? where rowid = 0', (b'\x00' * 16,))
+
+
+@pytest.mark.parametrize('vector_type', ['bfloat16', 'float16'])
+def test_float32_blob_of_native_size_is_rejected(conn, vector_type):
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e {vector_type}[4], hnsw(max_elements=10))')
+    # 2 float32 elements are as many bytes as 4 half precision ones, but only
+    # tables with native_input take blobs as such.
+    half_dim = np.float32([1, 2]).tobytes()
+    with pytest.raises(sqlite3.OperationalError, match='[Dd]imension'):
+        cur.execute('insert into t(rowid, e) values (?, ?)', (0, half_dim))
+    cur.execute('insert into t(rowid, e) values (?, ?)', (0, np.float32([1, 2, 3, 4]).tobytes()))
+    with pytest.raises(sqlite3.OperationalError, match='dimension'):
+        cur.execute('select rowid from t where knn_search(e, knn_param(?, 1))', (half_dim,)).fetchall()
+    with pytest.raises(sqlite3.OperationalError, match='[Dd]imension'):
+        cur.execute('update t set e = ? where rowid = 0', (half_dim,))
+
+
+@pytest.mark.parametrize('vector_type', ELEMENT_TYPES)
+@pytest.mark.parametrize('prefix', [b'VLBF', b'VLHF'])
+def test_float32_vectors_are_never_read_by_content(conn, vector_type, prefix):
+    # The first element, about 12435.08 or 12819.08, is spelled by the bytes
+    # of the tags that once marked native blobs.
+    dim = 4
+    v = np.frombuffer(prefix, dtype=np.float32).copy()
+    v = np.concatenate([v, np.float32([1, 2, 3])])
+    cur = conn.cursor()
+    cur.execute(f'create virtual table t using vectorlite(e {vector_type}[{dim}], hnsw(max_elements=10))')
+    cur.execute('insert into t(rowid, e) values (?, ?)', (0, v.tobytes()))
+    cur.execute('update t set e = ? where rowid = 0', (v.tobytes(),))
+    back = np.frombuffer(cur.execute('select e from t where rowid = 0').fetchone()[0], dtype=np.float32)
+    if vector_type != 'float8_e4m3':  # Saturates at 448.
+        assert np.allclose(back, v, rtol=DEQUANT_RTOL[vector_type])
+    rows = cur.execute('select rowid from t where knn_search(e, knn_param(?, 1))', (v.tobytes(),)).fetchall()
+    assert rows == [(0,)]
+    rows = cur.execute('select query_index, rowid from t where knn_search(e, knn_batch_param(?, 1))',
+                       (v.tobytes() * 2,)).fetchall()
+    assert rows == [(0, 0), (1, 0)]
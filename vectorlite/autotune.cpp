@@ -0,0 +1,279 @@
+#include "autotune.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "hnswlib/hnswlib.h"
+#include "hwy/base.h"
+#include "macros.h"
+#include "ops/ops.h"
+#include "vector_space.h"
+
+namespace vectorlite {
+
+namespace {
+
+// Each candidate is timed against kNumVectors vectors for kNumRounds rounds,
+// and its fastest round counts. Rounds of different candidates are
+// interleaved so that frequency scaling affects them alike.
+constexpr size_t kNumVectors = 64;
+constexpr size_t kNumRounds = 5;
+// Elements processed per round, which keeps a round around a millisecond.
+constexpr size_t kElementsPerRound = 1 << 21;
+
+std::vector<DistanceFuncCandidate> ToCandidates(
+    const std::vector<ops::DistanceFuncVariant>& variants) {
+  std::vector<DistanceFuncCandidate> candidates;
+  candidates.reserve(variants.size());
+  for (const auto& variant : variants) {
+    candidates.push_back({variant.target, variant.func});
+  }
+  return candidates;
+}
+
+template <typename T>
+std::vector<DistanceFuncCandidate> GetHighwayCandidates(
+    DistanceType distance_type, size_t dim) {
+  if (distance_type == DistanceType::L2) {
+    return ToCandidates(ops::GetL2DistanceSquaredFuncVariants<T>(dim));
+  }
+  return ToCandidates(ops::GetInnerProductDistanceFuncVariants<T>(dim));
+}
+
+// kNumVectors + 1 random float32 vectors, stored contiguously. The first one
+// serves as the query.
+std::vector<float> GenerateVectors(size_t dim) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::vector<float> floats((kNumVectors + 1) * dim);
+  for (float& value : floats) {
+    value = dis(gen);
+  }
+  return floats;
+}
+
+// `floats` in the storage format of `vector_type`.
+std::vector<uint8_t> ToStorageFormat(VectorType vector_type,
+                                     const std::vector<float>& floats,
+                                     size_t element_size) {
+  std::vector<uint8_t> data(floats.size() * element_size);
+  if (vector_type == VectorType::BFloat16) {
+    ops::QuantizeF32ToBF16(floats.data(),
+                           reinterpret_cast<hwy::bfloat16_t*>(data.data()),
+                           floats.size());
+  } else if (vector_type == VectorType::Float16) {
+    ops::QuantizeF32ToF16(floats.data(),
+                          reinterpret_cast<hwy::float16_t*>(data.data()),
+                          floats.size());
+  } else if (vector_type == VectorType::Float8E4M3) {
+    ops::QuantizeF32ToF8(floats.data(),
+                         reinterpret_cast<ops::float8_e4m3_t*>(data.data()),
+                         floats.size());
+  } else if (vector_type == VectorType::Float8E5M2) {
+    ops::QuantizeF32ToF8(floats.data(),
+                         reinterpret_cast<ops::float8_e5m2_t*>(data.data()),
+                         floats.size());
+  } else {
+    VECTORLITE_ASSERT(vector_type == VectorType::Float32);
+    std::copy_n(reinterpret_cast<const uint8_t*>(floats.data()), data.size(),
+                data.begin());
+  }
+  return data;
+}
+
+template <typename T>
+std::vector<DistanceFuncCandidate> GetMixedHighwayCandidates(
+    DistanceType distance_type, size_t dim) {
+  if (distance_type == DistanceType::L2) {
+    return ToCandidates(ops::GetMixedL2DistanceSquaredFuncVariants<T>(dim));
+  }
+  return ToCandidates(ops::GetMixedInnerProductDistanceFuncVariants<T>(dim));
+}
+
+}  // namespace
+
+std::vector<DistanceFuncCandidate> GetDistanceFuncCandidates(
+    const VectorSpace& space) {
+  const size_t dim = space.dimension();
+  switch (space.vector_type) {
+    case VectorType::Float32: {
+      auto candidates = GetHighwayCandidates<float>(space.distance_type, dim);
+      // hnswlib's distance functions take the dimension as a size_t param,
+      // like vectorlite's float32 spaces.
+      if (space.distance_type == DistanceType::L2) {
+        candidates.push_back(
+            {"hnswlib", hnswlib::L2Space(dim).get_dist_func()});
+      } else {
+        candidates.push_back(
+            {"hnswlib", hnswlib::InnerProductSpace(dim).get_dist_func()});
+      }
+      return candidates;
+    }
+    case VectorType::BFloat16: {
+      auto candidates =
+          GetHighwayCandidates<hwy::bfloat16_t>(space.distance_type, dim);
+      if (space.distance_type == DistanceType::L2) {
+        // The bf16 dot kernels are only worth it on some data, so they are
+        // never the default and have to earn their place here.
+        for (const auto& variant :
+             ops::GetDotL2DistanceSquaredBF16FuncVariants()) {
+          candidates.push_back(
+              {absl::StrFormat("%s bf16 dot", variant.target), variant.func});
+        }
+      }
+      return candidates;
+    }
+    case VectorType::Float16:
+      return GetHighwayCandidates<hwy::float16_t>(space.distance_type, dim);
+    case VectorType::Float8E4M3:
+      return GetHighwayCandidates<ops::float8_e4m3_t>(space.distance_type,
+                                                      dim);
+    case VectorType::Float8E5M2:
+      return GetHighwayCandidates<ops::float8_e5m2_t>(space.distance_type,
+                                                      dim);
+    default:
+      // Quantized spaces wrap their kernels in functions that read the
+      // space's param.
+      return {};
+  }
+}
+
+std::vector<DistanceFuncCandidate> GetF32QueryDistanceFuncCandidates(
+    const VectorSpace& space) {
+  const size_t dim = space.dimension();
+  switch (space.vector_type) {
+    case VectorType::BFloat16:
+      return GetMixedHighwayCandidates<hwy::bfloat16_t>(space.distance_type,
+                                                        dim);
+    case VectorType::Float16:
+      return GetMixedHighwayCandidates<hwy::float16_t>(space.distance_type,
+                                                       dim);
+    case VectorType::Float8E4M3:
+      return GetMixedHighwayCandidates<ops::float8_e4m3_t>(
+          space.distance_type, dim);
+    case VectorType::Float8E5M2:
+      return GetMixedHighwayCandidates<ops::float8_e5m2_t>(
+          space.distance_type, dim);
+    default:
+      return {};
+  }
+}
+
+DistanceFuncCandidate SelectFastestDistanceFunc(
+    const VectorSpace& space,
+    const std::vector<DistanceFuncCandidate>& candidates, bool f32_query) {
+  VECTORLITE_ASSERT(!candidates.empty());
+  const size_t dim = space.dimension();
+  const size_t element_size = space.space->get_data_size() / dim;
+  const void* param = space.space->get_dist_func_param();
+  const std::vector<float> floats = GenerateVectors(dim);
+  const std::vector<uint8_t> data =
+      ToStorageFormat(space.vector_type, floats, element_size);
+  const void* query = f32_query ? static_cast<const void*>(floats.data())
+                                : static_cast<const void*>(data.data());
+  auto vector_at = [&](size_t j) {
+    return data.data() + (j + 1) * dim * element_size;
+  };
+
+  // Candidates must agree with the space's current distance function.
+  hnswlib::DISTFUNC<float> reference =
+      f32_query ? space.space->get_f32_query_dist_func()
+                : space.space->get_dist_func();
+  VECTORLITE_ASSERT(reference != nullptr);
+  std::vector<float> expected(kNumVectors);
+  for (size_t j = 0; j < kNumVectors; ++j) {
+    expected[j] = reference(query, vector_at(j), param);
+  }
+  auto agrees = [&](hnswlib::DISTFUNC<float> func) {
+    for (size_t j = 0; j < kNumVectors; ++j) {
+      const float distance = func(query, vector_at(j), param);
+      if (!(std::abs(distance - expected[j]) <=
+            1e-3f * std::max(1.0f, std::abs(expected[j])))) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  const size_t repetitions =
+      std::max<size_t>(1, kElementsPerRound / (kNumVectors * dim));
+  // Keeps the distance computations from being optimized away.
+  volatile float sink = 0.0f;
+  auto time_round = [&](hnswlib::DISTFUNC<float> func) {
+    const auto start = std::chrono::steady_clock::now();
+    float sum = 0.0f;
+    for (size_t r = 0; r < repetitions; ++r) {
+      for (size_t j = 0; j < kNumVectors; ++j) {
+        sum += func(query, vector_at(j), param);
+      }
+    }
+    sink = sum;
+    return std::chrono::steady_clock::now() - start;
+  };
+
+  std::vector<size_t> eligible;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    if (agrees(candidates[i].func)) {
+      eligible.push_back(i);
+    }
+  }
+  // The first candidate is the best target by Highway's ranking, which is
+  // what the space uses by default.
+  if (eligible.empty()) {
+    return candidates.front();
+  }
+
+  std::vector<std::chrono::steady_clock::duration> best_times(
+      candidates.size(), std::chrono::steady_clock::duration::max());
+  for (size_t round = 0; round < kNumRounds; ++round) {
+    for (size_t i : eligible) {
+      best_times[i] = std::min(best_times[i], time_round(candidates[i].func));
+    }
+  }
+  const size_t fastest = *std::min_element(
+      eligible.begin(), eligible.end(),
+      [&](size_t a, size_t b) { return best_times[a] < best_times[b]; });
+  return candidates[fastest];
+}
+
+absl::StatusOr<std::string> AutotuneDistanceFunc(
+    VectorSpace& space, hnswlib::HierarchicalNSW<float>& index) {
+  std::vector<DistanceFuncCandidate> candidates =
+      GetDistanceFuncCandidates(space);
+  if (candidates.empty()) {
+    return absl::UnimplementedError(
+        "Distance functions of quantized vector types can't be autotuned");
+  }
+
+  DistanceFuncCandidate fastest = SelectFastestDistanceFunc(space, candidates);
+  if (!space.space->set_dist_func(fastest.func)) {
+    return absl::UnimplementedError(
+        "The vector space's distance function can't be replaced");
+  }
+  index.fstdistfunc_ = fastest.func;
+
+  // Graph search with a float32 query uses the mixed precision function
+  // instead, see QueryExecutor::QueryDistanceFunc. The space is asked for it
+  // on every query, so the index doesn't need updating.
+  std::vector<DistanceFuncCandidate> f32_query_candidates =
+      GetF32QueryDistanceFuncCandidates(space);
+  if (f32_query_candidates.empty()) {
+    return fastest.name;
+  }
+  DistanceFuncCandidate fastest_f32_query = SelectFastestDistanceFunc(
+      space, f32_query_candidates, /*f32_query=*/true);
+  bool installed = space.space->set_f32_query_dist_func(fastest_f32_query.func);
+  VECTORLITE_ASSERT(installed);
+  return absl::StrFormat("%s (float32 query: %s)", fastest.name,
+                         fastest_f32_query.name);
+}
+
+}  // namespace vectorlite
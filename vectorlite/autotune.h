@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "hnswlib/hnswlib.h"
+#include "vector_space.h"
+
+namespace vectorlite {
+
+// A function that computes a vector space's distances, e.g. one compiled for a
+// specific SIMD target.
+struct DistanceFuncCandidate {
+  std::string name;
+  hnswlib::DISTFUNC<float> func;
+};
+
+// Returns the functions that can compute `space`'s distances: one per SIMD
+// target that is compiled in and supported by the CPU, plus hnswlib's own for
+// float32 spaces and the native bf16 dot kernels for bf16 L2 spaces. Empty if
+// the space's distance function can't be replaced, e.g. for quantized spaces.
+std::vector<DistanceFuncCandidate> GetDistanceFuncCandidates(
+    const VectorSpace& space);
+
+// Like GetDistanceFuncCandidates, for the mixed precision function that
+// compares a float32 query with vectors in `space`'s storage format, see
+// SpaceInterface::get_f32_query_dist_func. Empty if the space has none.
+std::vector<DistanceFuncCandidate> GetF32QueryDistanceFuncCandidates(
+    const VectorSpace& space);
+
+// Times `candidates` on random vectors in `space`'s storage format and returns
+// the fastest one whose distances agree with the space's current distance
+// function. With `f32_query`, the query is float32 and the candidates are
+// compared with the space's f32 query distance function instead.
+// `candidates` must not be empty.
+DistanceFuncCandidate SelectFastestDistanceFunc(
+    const VectorSpace& space,
+    const std::vector<DistanceFuncCandidate>& candidates,
+    bool f32_query = false);
+
+// Installs the fastest candidate into `space` and `index`, which caches the
+// space's distance function when it is created, and returns the candidate's
+// name. Spaces searched with float32 queries in mixed precision also get the
+// fastest f32 query distance function, whose name is appended as
+// "(float32 query: name)". Returns an UnimplementedError if the space can't be
+// tuned.
+absl::StatusOr<std::string> AutotuneDistanceFunc(
+    VectorSpace& space, hnswlib::HierarchicalNSW<float>& index);
+
+}  // namespace vectorlite
@@ -0,0 +1,165 @@
+#include "autotune.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "hnswlib/hnswlib.h"
+#include "hwy/base.h"
+#include "ops/ops.h"
+#include "vector_space.h"
+
+namespace vectorlite {
+namespace {
+
+std::vector<float> RandomVector(size_t dim, std::mt19937& gen) {
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::vector<float> v(dim);
+  for (float& value : v) {
+    value = dis(gen);
+  }
+  return v;
+}
+
+TEST(GetDistanceFuncCandidates, Float32IncludesHnswlibAndHighwayTargets) {
+  for (auto distance_type :
+       {DistanceType::L2, DistanceType::InnerProduct, DistanceType::Cosine}) {
+    auto space = VectorSpace::Create(37, distance_type, VectorType::Float32);
+    ASSERT_TRUE(space.ok());
+    auto candidates = GetDistanceFuncCandidates(*space);
+    ASSERT_GE(candidates.size(), 2);
+    EXPECT_EQ(candidates.back().name, "hnswlib");
+    for (const auto& candidate : candidates) {
+      EXPECT_FALSE(candidate.name.empty());
+      EXPECT_NE(candidate.func, nullptr);
+    }
+  }
+}
+
+TEST(GetDistanceFuncCandidates, HalfPrecisionIncludesHighwayTargetsOnly) {
+  for (auto vector_type :
+       {VectorType::BFloat16, VectorType::Float16, VectorType::Float8E4M3,
+        VectorType::Float8E5M2}) {
+    auto space = VectorSpace::Create(16, DistanceType::L2, vector_type);
+    ASSERT_TRUE(space.ok());
+    auto candidates = GetDistanceFuncCandidates(*space);
+    ASSERT_FALSE(candidates.empty());
+    for (const auto& candidate : candidates) {
+      EXPECT_NE(candidate.name, "hnswlib");
+    }
+  }
+}
+
+TEST(GetDistanceFuncCandidates, BFloat16L2IncludesDotKernels) {
+  auto space = VectorSpace::Create(16, DistanceType::L2, VectorType::BFloat16);
+  ASSERT_TRUE(space.ok());
+  auto candidates = GetDistanceFuncCandidates(*space);
+  // Empty on CPUs without native bf16 dot instructions.
+  for (const auto& variant : ops::GetDotL2DistanceSquaredBF16FuncVariants()) {
+    const std::string name = std::string(variant.target) + " bf16 dot";
+    EXPECT_TRUE(std::any_of(candidates.begin(), candidates.end(),
+                            [&](const DistanceFuncCandidate& candidate) {
+                              return candidate.name == name &&
+                                     candidate.func == variant.func;
+                            }))
+        << name;
+  }
+}
+
+TEST(GetDistanceFuncCandidates, QuantizedSpacesCantBeTuned) {
+  for (auto vector_type : {VectorType::Int8, VectorType::Binary}) {
+    auto space = VectorSpace::Create(64, DistanceType::L2, vector_type);
+    ASSERT_TRUE(space.ok());
+    EXPECT_TRUE(GetDistanceFuncCandidates(*space).empty());
+  }
+}
+
+TEST(AutotuneDistanceFunc, InstallsAFunctionThatAgreesWithTheDefault) {
+  const size_t dim = 100;
+  std::mt19937 gen(5);
+  for (auto distance_type : {DistanceType::L2, DistanceType::InnerProduct}) {
+    auto space =
+        VectorSpace::Create(dim, distance_type, VectorType::Float32);
+    ASSERT_TRUE(space.ok());
+    hnswlib::HierarchicalNSW<float> index(space->space.get(), 10);
+    auto original = space->space->get_dist_func();
+    const void* param = space->space->get_dist_func_param();
+
+    auto name = AutotuneDistanceFunc(*space, index);
+    ASSERT_TRUE(name.ok());
+    EXPECT_FALSE(name->empty());
+    EXPECT_EQ(index.fstdistfunc_, space->space->get_dist_func());
+
+    for (int i = 0; i < 10; ++i) {
+      auto v1 = RandomVector(dim, gen);
+      auto v2 = RandomVector(dim, gen);
+      float expected = original(v1.data(), v2.data(), param);
+      EXPECT_NEAR(index.fstdistfunc_(v1.data(), v2.data(), param), expected,
+                  1e-3f * std::max(1.0f, std::abs(expected)));
+    }
+  }
+}
+
+TEST(GetF32QueryDistanceFuncCandidates, OnlyForMixedPrecisionSpaces) {
+  for (auto vector_type :
+       {VectorType::BFloat16, VectorType::Float16, VectorType::Float8E4M3,
+        VectorType::Float8E5M2}) {
+    auto space =
+        VectorSpace::Create(16, DistanceType::InnerProduct, vector_type);
+    ASSERT_TRUE(space.ok());
+    auto candidates = GetF32QueryDistanceFuncCandidates(*space);
+    ASSERT_FALSE(candidates.empty());
+    for (const auto& candidate : candidates) {
+      EXPECT_NE(candidate.func, nullptr);
+    }
+  }
+  for (auto vector_type :
+       {VectorType::Float32, VectorType::Int8, VectorType::Binary}) {
+    auto space = VectorSpace::Create(64, DistanceType::L2, vector_type);
+    ASSERT_TRUE(space.ok());
+    EXPECT_TRUE(GetF32QueryDistanceFuncCandidates(*space).empty());
+  }
+}
+
+TEST(AutotuneDistanceFunc, AlsoTunesTheF32QueryDistanceFunc) {
+  const size_t dim = 100;
+  std::mt19937 gen(7);
+  for (auto distance_type : {DistanceType::L2, DistanceType::InnerProduct}) {
+    auto space = VectorSpace::Create(dim, distance_type, VectorType::BFloat16);
+    ASSERT_TRUE(space.ok());
+    hnswlib::HierarchicalNSW<float> index(space->space.get(), 10);
+    auto original = space->space->get_f32_query_dist_func();
+    ASSERT_NE(original, nullptr);
+    const void* param = space->space->get_dist_func_param();
+
+    auto name = AutotuneDistanceFunc(*space, index);
+    ASSERT_TRUE(name.ok());
+    EXPECT_NE(name->find("(float32 query: "), std::string::npos);
+    auto tuned = space->space->get_f32_query_dist_func();
+
+    for (int i = 0; i < 10; ++i) {
+      auto query = RandomVector(dim, gen);
+      auto v = RandomVector(dim, gen);
+      std::vector<hwy::bfloat16_t> stored(dim);
+      ops::QuantizeF32ToBF16(v.data(), stored.data(), dim);
+      float expected = original(query.data(), stored.data(), param);
+      EXPECT_NEAR(tuned(query.data(), stored.data(), param), expected,
+                  1e-3f * std::max(1.0f, std::abs(expected)));
+    }
+  }
+}
+
+TEST(AutotuneDistanceFunc, FailsForQuantizedSpaces) {
+  auto space = VectorSpace::Create(64, DistanceType::L2, VectorType::Int8);
+  ASSERT_TRUE(space.ok());
+  hnswlib::HierarchicalNSW<float> index(space->space.get(), 10);
+  auto original = index.fstdistfunc_;
+  EXPECT_FALSE(AutotuneDistanceFunc(*space, index).ok());
+  EXPECT_EQ(index.fstdistfunc_, original);
+}
+
+}  // namespace
+}  // namespace vectorlite
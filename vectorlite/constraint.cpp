@@ -2,8 +2,20 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <memory>
-#include <mutex>
+#include <optional>
+#include <queue>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "absl/base/optimization.h"
 #include "absl/cleanup/cleanup.h"
@@ -12,9 +24,13 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
+#include "distance.h"
 #include "hnswlib/hnswlib.h"
 #include "macros.h"
+#include "ops/ops.h"
+#include "product_quantizer.h"
 #include "quantization.h"
+#include "space_interface.h"
 #include "sqlite3ext.h"
 #include "util.h"
 #include "vector.h"
@@ -52,11 +68,159 @@ absl::Status RowIdIn::DoMaterialize(const sqlite3_api_routines* sqlite3_api,
     // TODO: handle rowid out of range
     hnswlib::labeltype rowid =
         static_cast<hnswlib::labeltype>(sqlite3_value_int64(rowid_value));
-    rowids_.insert(rowid);
+    // SQLite hands over IN values in ascending order, which RowidBitmap
+    // appends cheaply.
+    rowids_.Add(rowid);
   }
   return absl::OkStatus();
 }
 
+std::optional<RowIdCompare::Op> RowIdCompare::FromSqliteOp(unsigned char op) {
+  switch (op) {
+    case SQLITE_INDEX_CONSTRAINT_GT:
+      return Op::kGreaterThan;
+    case SQLITE_INDEX_CONSTRAINT_GE:
+      return Op::kGreaterEqual;
+    case SQLITE_INDEX_CONSTRAINT_LT:
+      return Op::kLessThan;
+    case SQLITE_INDEX_CONSTRAINT_LE:
+      return Op::kLessEqual;
+    case SQLITE_INDEX_CONSTRAINT_NE:
+      return Op::kNotEqual;
+    default:
+      return std::nullopt;
+  }
+}
+
+std::string_view RowIdCompare::ShortName(Op op) {
+  switch (op) {
+    case Op::kGreaterThan:
+      return kGreaterThanShortName;
+    case Op::kGreaterEqual:
+      return kGreaterEqualShortName;
+    case Op::kLessThan:
+      return kLessThanShortName;
+    case Op::kLessEqual:
+      return kLessEqualShortName;
+    case Op::kNotEqual:
+      return kNotEqualShortName;
+  }
+  return "";
+}
+
+// Converts `value` to int64, saturating at the ends of its range.
+static int64_t SaturateToInt64(double value) {
+  // 2^63, the smallest double above the int64 range.
+  constexpr double kTwoToThe63 = 9223372036854775808.0;
+  if (value >= kTwoToThe63) {
+    return std::numeric_limits<int64_t>::max();
+  }
+  if (value < -kTwoToThe63) {
+    return std::numeric_limits<int64_t>::min();
+  }
+  return static_cast<int64_t>(value);
+}
+
+absl::Status RowIdCompare::DoMaterialize(
+    const sqlite3_api_routines* sqlite3_api, sqlite3_value* arg) {
+  VECTORLITE_ASSERT(sqlite3_api != nullptr);
+  VECTORLITE_ASSERT(arg != nullptr);
+  switch (sqlite3_value_type(arg)) {
+    case SQLITE_INTEGER:
+      value_ = sqlite3_value_int64(arg);
+      return absl::OkStatus();
+    case SQLITE_FLOAT: {
+      // Rowids are integers, so e.g. rowid > 2.5 is rowid > 2 and
+      // rowid >= 2.5 is rowid >= 3.
+      double value = sqlite3_value_double(arg);
+      switch (op_) {
+        case Op::kGreaterThan:
+        case Op::kLessEqual:
+          value_ = SaturateToInt64(std::floor(value));
+          break;
+        case Op::kGreaterEqual:
+        case Op::kLessThan:
+          value_ = SaturateToInt64(std::ceil(value));
+          break;
+        case Op::kNotEqual:
+          // Rowids are never negative, so -1 excludes none of them.
+          value_ = value == std::floor(value) ? SaturateToInt64(value) : -1;
+          break;
+      }
+      return absl::OkStatus();
+    }
+    case SQLITE_NULL:
+      null_value_ = true;
+      return absl::OkStatus();
+    default:
+      return absl::InvalidArgumentError(
+          "rowid must be compared with an INTEGER or REAL value");
+  }
+}
+
+std::string RowIdCompare::ToDebugString() const {
+  constexpr std::string_view kOperators[] = {">", ">=", "<", "<=", "!="};
+  std::string_view op = kOperators[static_cast<int>(op_)];
+  if (!materialized()) {
+    return absl::StrFormat("rowid %s ?", op);
+  }
+  if (null_value_) {
+    return absl::StrFormat("rowid %s NULL", op);
+  }
+  return absl::StrFormat("rowid %s %d", op, value_);
+}
+
+std::optional<DistanceCompare::Op> DistanceCompare::FromSqliteOp(
+    unsigned char op) {
+  switch (op) {
+    case SQLITE_INDEX_CONSTRAINT_LT:
+      return Op::kLessThan;
+    case SQLITE_INDEX_CONSTRAINT_LE:
+      return Op::kLessEqual;
+    default:
+      return std::nullopt;
+  }
+}
+
+std::string_view DistanceCompare::ShortName(Op op) {
+  switch (op) {
+    case Op::kLessThan:
+      return kLessThanShortName;
+    case Op::kLessEqual:
+      return kLessEqualShortName;
+  }
+  return "";
+}
+
+absl::Status DistanceCompare::DoMaterialize(
+    const sqlite3_api_routines* sqlite3_api, sqlite3_value* arg) {
+  VECTORLITE_ASSERT(sqlite3_api != nullptr);
+  VECTORLITE_ASSERT(arg != nullptr);
+  switch (sqlite3_value_type(arg)) {
+    case SQLITE_INTEGER:
+    case SQLITE_FLOAT:
+      value_ = sqlite3_value_double(arg);
+      return absl::OkStatus();
+    case SQLITE_NULL:
+      null_value_ = true;
+      return absl::OkStatus();
+    default:
+      return absl::InvalidArgumentError(
+          "distance must be compared with an INTEGER or REAL value");
+  }
+}
+
+std::string DistanceCompare::ToDebugString() const {
+  std::string_view op = op_ == Op::kLessThan ? "<" : "<=";
+  if (!materialized()) {
+    return absl::StrFormat("distance %s ?", op);
+  }
+  if (null_value_) {
+    return absl::StrFormat("distance %s NULL", op);
+  }
+  return absl::StrFormat("distance %s %g", op, value_);
+}
+
 absl::Status KnnSearchConstraint::DoMaterialize(
     const sqlite3_api_routines* sqlite3_api, sqlite3_value* arg) {
   VECTORLITE_ASSERT(sqlite3_api != nullptr);
@@ -126,19 +290,220 @@ void QueryExecutor::Visit(const RowIdEquals& constraint) {
   rowid_constraint_ = &constraint;
 }
 
+void QueryExecutor::Visit(const RowIdCompare& constraint) {
+  if (!constraint.materialized()) {
+    status_ = absl::FailedPreconditionError("rowid comparison not materialized");
+    return;
+  }
+  if (!status_.ok()) {
+    return;
+  }
+
+  rowid_comparisons_.push_back(&constraint);
+}
+
+void QueryExecutor::Visit(const DistanceCompare& constraint) {
+  if (!constraint.materialized()) {
+    status_ =
+        absl::FailedPreconditionError("distance comparison not materialized");
+    return;
+  }
+  if (!status_.ok()) {
+    return;
+  }
+
+  distance_comparisons_.push_back(&constraint);
+}
+
+// The distances allowed by max_distance of knn_param() and by all distance
+// comparisons of a query: up to a bound, which is excluded if any of them is
+// a < comparison with the tightest value. Distances are compared as doubles,
+// like SQLite compares the distance column.
+class DistanceLimit {
+ public:
+  DistanceLimit(const KnnParam* knn_param,
+                const std::vector<const DistanceCompare*>& comparisons) {
+    if (knn_param != nullptr && knn_param->max_distance) {
+      Tighten(*knn_param->max_distance, /*exclusive=*/false);
+    }
+    for (const DistanceCompare* comparison : comparisons) {
+      if (comparison->null_value()) {
+        // Matches nothing.
+        Tighten(-std::numeric_limits<double>::infinity(), /*exclusive=*/true);
+      } else {
+        Tighten(comparison->value(),
+                comparison->op() == DistanceCompare::Op::kLessThan);
+      }
+    }
+  }
+
+  bool unbounded() const {
+    return bound_ == std::numeric_limits<double>::infinity() && !exclusive_;
+  }
+
+  // False for NaN, which compares false with anything.
+  bool Contains(float distance) const {
+    const auto value = static_cast<double>(distance);
+    return exclusive_ ? value < bound_ : value <= bound_;
+  }
+
+  // Drops the rows of `result` whose distance is out of the limit.
+  void Apply(QueryExecutor::QueryResult& result) const {
+    if (unbounded()) {
+      return;
+    }
+    result.erase(std::remove_if(result.begin(), result.end(),
+                                [this](const auto& row) {
+                                  return !Contains(row.first);
+                                }),
+                 result.end());
+  }
+
+ private:
+  void Tighten(double bound, bool exclusive) {
+    if (bound < bound_) {
+      bound_ = bound;
+      exclusive_ = exclusive;
+    } else if (bound == bound_) {
+      exclusive_ = exclusive_ || exclusive;
+    }
+  }
+
+  double bound_ = std::numeric_limits<double>::infinity();
+  bool exclusive_ = false;
+};
+
 namespace {
 
+// The rowids matched by all rowid comparisons of a query: an inclusive range
+// minus a few excluded rowids.
+class RowidRange {
+ public:
+  explicit RowidRange(const std::vector<const RowIdCompare*>& comparisons) {
+    for (const RowIdCompare* comparison : comparisons) {
+      if (comparison->null_value()) {
+        // Matches nothing.
+        min_ = 1;
+        max_ = 0;
+        continue;
+      }
+      const int64_t value = comparison->value();
+      switch (comparison->op()) {
+        case RowIdCompare::Op::kGreaterThan:
+          if (value == std::numeric_limits<int64_t>::max()) {
+            min_ = 1;
+            max_ = 0;
+          } else {
+            min_ = std::max(min_, value + 1);
+          }
+          break;
+        case RowIdCompare::Op::kGreaterEqual:
+          min_ = std::max(min_, value);
+          break;
+        case RowIdCompare::Op::kLessThan:
+          // Rowids are never negative, so this can't underflow for any
+          // rowid that can match.
+          max_ = std::min(max_, value <= 0 ? -1 : value - 1);
+          break;
+        case RowIdCompare::Op::kLessEqual:
+          max_ = std::min(max_, value);
+          break;
+        case RowIdCompare::Op::kNotEqual:
+          if (value >= 0) {
+            excluded_.push_back(static_cast<hnswlib::labeltype>(value));
+          }
+          break;
+      }
+    }
+  }
+
+  // Whether rowids are restricted at all.
+  bool unbounded() const {
+    return min_ == 0 && max_ == std::numeric_limits<int64_t>::max() &&
+           excluded_.empty();
+  }
+
+  bool empty() const { return min_ > max_; }
+
+  bool Contains(hnswlib::labeltype rowid) const {
+    const auto value = static_cast<int64_t>(rowid);
+    return value >= min_ && value <= max_ &&
+           std::find(excluded_.begin(), excluded_.end(), rowid) ==
+               excluded_.end();
+  }
+
+  // The number of rowids in [min, max], saturating at SIZE_MAX.
+  size_t span() const {
+    if (empty()) {
+      return 0;
+    }
+    const uint64_t span = static_cast<uint64_t>(max_) -
+                          static_cast<uint64_t>(min_);
+    return span >= std::numeric_limits<size_t>::max()
+               ? std::numeric_limits<size_t>::max()
+               : static_cast<size_t>(span) + 1;
+  }
+
+  // Returns every rowid in the range. Should only be called if span() is
+  // small.
+  std::vector<hnswlib::labeltype> Enumerate() const {
+    std::vector<hnswlib::labeltype> rowids;
+    if (empty()) {
+      return rowids;
+    }
+    rowids.reserve(span());
+    // Written so that max_ being INT64_MAX doesn't overflow.
+    for (int64_t value = min_;; ++value) {
+      if (Contains(static_cast<hnswlib::labeltype>(value))) {
+        rowids.push_back(static_cast<hnswlib::labeltype>(value));
+      }
+      if (value == max_) {
+        break;
+      }
+    }
+    return rowids;
+  }
+
+ private:
+  // Rowids are labels in hnswlib and thus never negative.
+  int64_t min_ = 0;
+  int64_t max_ = std::numeric_limits<int64_t>::max();
+  // There are usually only a handful, as each is a != in the query.
+  std::vector<hnswlib::labeltype> excluded_;
+};
+
+// Whether a knn search restricted to `num_candidates` rowids is cheaper to
+// execute by scoring every candidate than by searching the graph of `index`.
+// An exact scan scores each candidate once with batched kernels and returns
+// exact results. hnswlib instead keeps expanding the graph until ef nodes pass
+// its filter. With a filter of selectivity s = num_candidates / element count,
+// that expands about ef / s nodes, each comparing the query with up to maxM0_
+// neighbors, but never computes more distances than there are elements.
+bool ShouldScanExactly(const hnswlib::HierarchicalNSW<float>& index,
+                       size_t num_candidates, size_t k) {
+  const size_t num_elements = index.cur_element_count;
+  if (num_candidates == 0 || num_candidates >= num_elements) {
+    // Either nothing to score or no selectivity to exploit, in which case the
+    // graph search is never worse.
+    return num_candidates == 0 || num_candidates <= k;
+  }
+  const double ef = static_cast<double>(std::max(index.ef_, k));
+  const double expanded_nodes =
+      ef * static_cast<double>(num_elements) / num_candidates;
+  const double graph_cost = std::min(
+      expanded_nodes * index.maxM0_, static_cast<double>(num_elements));
+  return static_cast<double>(num_candidates) <= graph_cost;
+}
+
 class RowidInFilter : public hnswlib::BaseFilterFunctor {
  public:
-  explicit RowidInFilter(
-      const absl::flat_hash_set<hnswlib::labeltype>& rowid_in)
-      : rowid_in_(rowid_in) {}
+  explicit RowidInFilter(const RowidBitmap& rowid_in) : rowid_in_(rowid_in) {}
   virtual bool operator()(hnswlib::labeltype id) override {
-    return rowid_in_.contains(id);
+    return rowid_in_.Contains(id);
   }
 
  private:
-  const absl::flat_hash_set<hnswlib::labeltype>& rowid_in_;
+  const RowidBitmap& rowid_in_;
 };
 
 class RowidEqualsFilter : public hnswlib::BaseFilterFunctor {
@@ -152,29 +517,698 @@ class RowidEqualsFilter : public hnswlib::BaseFilterFunctor {
   hnswlib::labeltype rowid_;
 };
 
-std::unique_ptr<hnswlib::BaseFilterFunctor> MakeRowidFilter(
+// Tests a RowidRange and, if set, another rowid filter.
+class RowidRangeFilter : public hnswlib::BaseFilterFunctor {
+ public:
+  RowidRangeFilter(const RowidRange& range,
+                   std::unique_ptr<hnswlib::BaseFilterFunctor> other)
+      : range_(range), other_(std::move(other)) {}
+  virtual bool operator()(hnswlib::labeltype id) override {
+    return range_.Contains(id) && (other_ == nullptr || (*other_)(id));
+  }
+
+ private:
+  const RowidRange& range_;
+  std::unique_ptr<hnswlib::BaseFilterFunctor> other_;
+};
+
+// The rowids that a query is restricted to by rowid = or rowid IN (...), or by
+// a rowid_bitmap() blob passed to knn_param().
+using RowidSet = absl::variant<const RowidBitmap*, hnswlib::labeltype>;
+
+std::optional<RowidSet> ToRowidSet(
     std::optional<absl::variant<const RowIdIn*, const RowIdEquals*>>
         row_id_constraint) {
   if (!row_id_constraint) {
+    return std::nullopt;
+  }
+
+  return absl::visit(
+      absl::Overload(
+          [](const RowIdIn* rowid_in) -> RowidSet {
+            return &rowid_in->get_rowids();
+          },
+          [](const RowIdEquals* rowid_equals) -> RowidSet {
+            return rowid_equals->rowid();
+          }),
+      *row_id_constraint);
+}
+
+std::unique_ptr<hnswlib::BaseFilterFunctor> MakeRowidFilter(
+    std::optional<RowidSet> rowid_set) {
+  if (!rowid_set) {
     return nullptr;
   }
 
   return absl::visit(
       absl::Overload(
-          [](const RowIdIn* rowid_in)
+          [](const RowidBitmap* rowids)
               -> std::unique_ptr<hnswlib::BaseFilterFunctor> {
-            return std::make_unique<RowidInFilter>(rowid_in->get_rowids());
+            return std::make_unique<RowidInFilter>(*rowids);
           },
-          [](const RowIdEquals* rowid_equals)
+          [](hnswlib::labeltype rowid)
               -> std::unique_ptr<hnswlib::BaseFilterFunctor> {
-            return std::make_unique<RowidEqualsFilter>(rowid_equals->rowid());
+            return std::make_unique<RowidEqualsFilter>(rowid);
           }),
-      *row_id_constraint);
+      *rowid_set);
+}
+
+// `range` must outlive the returned filter.
+std::unique_ptr<hnswlib::BaseFilterFunctor> MakeRowidFilter(
+    std::optional<RowidSet> rowid_set, const RowidRange& range) {
+  auto filter = MakeRowidFilter(rowid_set);
+  if (range.unbounded()) {
+    return filter;
+  }
+  return std::make_unique<RowidRangeFilter>(range, std::move(filter));
+}
+
+// Returns the rowids that `rowid_set` and `range` can match if
+// ShouldScanExactly() picks an exact scan over them for a knn search of `k`
+// neighbors, otherwise std::nullopt. Also returns std::nullopt if rowids are
+// not restricted at all. Without a rowid set, the range is assumed to hold as
+// many rowids as it spans, which overestimates sparse rowids.
+std::optional<std::vector<hnswlib::labeltype>> GetCandidateRowids(
+    std::optional<RowidSet> rowid_set, const RowidRange& range,
+    const hnswlib::HierarchicalNSW<float>& index, size_t k) {
+  if (!rowid_set) {
+    if (range.unbounded() || !ShouldScanExactly(index, range.span(), k)) {
+      return std::nullopt;
+    }
+    return range.Enumerate();
+  }
+
+  return absl::visit(
+      absl::Overload(
+          [&index, &range, k](const RowidBitmap* rowids)
+              -> std::optional<std::vector<hnswlib::labeltype>> {
+            if (!ShouldScanExactly(index, rowids->size(), k)) {
+              return std::nullopt;
+            }
+            std::vector<hnswlib::labeltype> candidates;
+            candidates.reserve(rowids->size());
+            std::copy_if(rowids->begin(), rowids->end(),
+                         std::back_inserter(candidates),
+                         [&range](hnswlib::labeltype rowid) {
+                           return range.Contains(rowid);
+                         });
+            return candidates;
+          },
+          [&index, &range, k](hnswlib::labeltype rowid)
+              -> std::optional<std::vector<hnswlib::labeltype>> {
+            if (!ShouldScanExactly(index, 1, k)) {
+              return std::nullopt;
+            }
+            if (!range.Contains(rowid)) {
+              return std::vector<hnswlib::labeltype>();
+            }
+            return std::vector<hnswlib::labeltype>{rowid};
+          }),
+      *rowid_set);
+}
+
+// Stops graph search once the closest candidate left to expand is out of a
+// DistanceLimit, and doesn't queue neighbors out of it, since expanding them
+// rarely leads back into range. Both only apply once min_results results are
+// collected, so that a search entering the graph far from the query still
+// finds its way to the query's neighborhood. Otherwise it behaves like a
+// plain search with ef = max_results.
+class DistanceLimitStopCondition
+    : public hnswlib::BaseSearchStopCondition<float> {
+ public:
+  DistanceLimitStopCondition(const DistanceLimit& limit, size_t min_results,
+                             size_t max_results)
+      : limit_(limit),
+        min_results_(std::min(min_results, max_results)),
+        max_results_(max_results) {}
+
+  void add_point_to_result(hnswlib::labeltype, const void*, float) override {
+    ++num_results_;
+  }
+  void remove_point_from_result(hnswlib::labeltype, const void*,
+                                float) override {
+    --num_results_;
+  }
+  bool should_stop_search(float candidate_dist, float lower_bound) override {
+    if (candidate_dist > lower_bound && num_results_ >= max_results_) {
+      return true;
+    }
+    return num_results_ >= min_results_ && !limit_.Contains(candidate_dist);
+  }
+  bool should_consider_candidate(float candidate_dist,
+                                 float lower_bound) override {
+    if (num_results_ >= min_results_ && !limit_.Contains(candidate_dist)) {
+      return false;
+    }
+    return num_results_ < max_results_ || candidate_dist < lower_bound;
+  }
+  bool should_remove_extra() override { return num_results_ > max_results_; }
+  void filter_results(
+      std::vector<std::pair<float, hnswlib::labeltype>>& candidates) override {
+    // Candidates are sorted closer first.
+    while (!candidates.empty() && !limit_.Contains(candidates.back().first)) {
+      candidates.pop_back();
+    }
+  }
+
+ private:
+  const DistanceLimit& limit_;
+  const size_t min_results_;
+  const size_t max_results_;
+  size_t num_results_ = 0;
+};
+
+// Returns the k closest of `labels` given their `distances`, closer first.
+QueryExecutor::QueryResult SelectTopK(
+    const std::vector<float>& distances,
+    const std::vector<hnswlib::labeltype>& labels, size_t k) {
+  VECTORLITE_ASSERT(distances.size() == labels.size());
+  std::vector<uint32_t> indices(std::min(k, distances.size()));
+  const size_t num_selected =
+      ops::SelectTopK(distances.data(), distances.size(), k, indices.data());
+  QueryExecutor::QueryResult result;
+  result.reserve(num_selected);
+  for (size_t i = 0; i < num_selected; ++i) {
+    result.emplace_back(distances[indices[i]], labels[indices[i]]);
+  }
+  return result;
+}
+
+// Scores the query against every candidate present in `index` with a single
+// `batch_distance(vectors, num_vectors, out)` call and returns the k closest,
+// closer first. Used instead of graph search when a rowid constraint leaves at
+// few enough candidates, see ShouldScanExactly().
+template <class BatchDistanceFunc>
+QueryExecutor::QueryResult ExactKnnSearch(
+    const hnswlib::HierarchicalNSW<float>& index,
+    BatchDistanceFunc&& batch_distance,
+    const std::vector<hnswlib::labeltype>& candidates, size_t k) {
+  std::vector<const void*> vectors;
+  std::vector<hnswlib::labeltype> labels;
+  vectors.reserve(candidates.size());
+  labels.reserve(candidates.size());
+  ForEachLabelInIndex(index, candidates,
+                      [&](hnswlib::labeltype label, const char* data) {
+                        vectors.push_back(data);
+                        labels.push_back(label);
+                      });
+
+  std::vector<float> distances(vectors.size());
+  batch_distance(vectors.data(), vectors.size(), distances.data());
+  return SelectTopK(distances, labels, k);
+}
+
+// Rescores binary `candidates` against the float32 `query` with the float32
+// vectors of the rerank store, and returns the k closest, closer first.
+QueryExecutor::QueryResult RerankBinaryCandidates(
+    const hnswlib::HierarchicalNSW<float>& index,
+    const BinarySpaceParam& param, DistanceType distance_type,
+    const float* query, const std::vector<hnswlib::labeltype>& candidates,
+    size_t k) {
+  std::vector<const float*> vectors;
+  std::vector<hnswlib::labeltype> labels;
+  vectors.reserve(candidates.size());
+  labels.reserve(candidates.size());
+  ForEachLabelInIndex(
+      index, candidates, [&](hnswlib::labeltype label, const char*) {
+        const float* vector = param.rerank_store.Find(label);
+        VECTORLITE_ASSERT(vector != nullptr);
+        vectors.push_back(vector);
+        labels.push_back(label);
+      });
+
+  std::vector<float> distances(vectors.size());
+  if (distance_type == DistanceType::L2) {
+    ops::L2DistanceSquaredBatch(query, vectors.data(), vectors.size(),
+                                param.dim, distances.data());
+  } else {
+    ops::InnerProductDistanceBatch(query, vectors.data(), vectors.size(),
+                                   param.dim, distances.data());
+  }
+  return SelectTopK(distances, labels, k);
+}
+
+// Exact knn search over the float32 vectors of a product quantized table
+// whose codebooks are not trained yet, or of an int8 table that is not
+// calibrated yet.
+QueryExecutor::QueryResult SearchPendingVectors(
+    const std::unordered_map<uint64_t, std::vector<float>>& pending,
+    DistanceType distance_type, const float* query,
+    hnswlib::BaseFilterFunctor* rowid_filter, size_t k) {
+  std::vector<const float*> vectors;
+  std::vector<hnswlib::labeltype> labels;
+  vectors.reserve(pending.size());
+  labels.reserve(pending.size());
+  for (const auto& [rowid, vector] : pending) {
+    if (rowid_filter != nullptr && !(*rowid_filter)(rowid)) {
+      continue;
+    }
+    vectors.push_back(vector.data());
+    labels.push_back(rowid);
+  }
+  if (vectors.empty()) {
+    return {};
+  }
+
+  // All pending vectors have the table's dimension.
+  const size_t dim = pending.begin()->second.size();
+  std::vector<float> distances(vectors.size());
+  if (distance_type == DistanceType::L2) {
+    ops::L2DistanceSquaredBatch(query, vectors.data(), vectors.size(), dim,
+                                distances.data());
+  } else {
+    ops::InnerProductDistanceBatch(query, vectors.data(), vectors.size(), dim,
+                                   distances.data());
+  }
+  return SelectTopK(distances, labels, k);
 }
 
+// A KnnStream over the graph of an index. It runs the search loop hnswlib runs
+// on the bottom layer, but keeps every node it discovers, so that the search
+// can be resumed for more rows rather than restarted with a larger k.
+//
+// Like hnswlib's search with ef, the closest unreturned row is only returned
+// once no unexpanded node is closer than the ef-th closest unreturned row.
+// Each returned row thus lets the search widen a little.
+class GraphKnnStream : public KnnStream {
+ public:
+  // `query` is in the format `dist_func` expects, which is called with the
+  // distance function param of `index`. `ef` and `dist_func` are taken as
+  // they are now, as Execute() restores the index's own afterwards.
+  GraphKnnStream(const hnswlib::HierarchicalNSW<float>& index,
+                 std::string query, hnswlib::DISTFUNC<float> dist_func,
+                 size_t ef, size_t max_rows, const DistanceLimit& limit,
+                 std::optional<RowidSet> rowid_set, const RowidRange& range)
+      : index_(index),
+        query_(std::move(query)),
+        dist_func_(dist_func),
+        ef_(std::max<size_t>(ef, 1)),
+        remaining_(max_rows),
+        limit_(limit),
+        range_(range) {
+    // Rowid constraints and knn_param() don't outlive xFilter, unlike the
+    // stream.
+    if (rowid_set) {
+      if (auto* rowids = absl::get_if<const RowidBitmap*>(&*rowid_set)) {
+        rowids_ = **rowids;
+        rowid_set = &*rowids_;
+      }
+    }
+    rowid_filter_ = MakeRowidFilter(rowid_set, range_);
+    Start();
+  }
+
+  std::optional<std::pair<float, hnswlib::labeltype>> Next() override {
+    if (remaining_ == 0) {
+      return std::nullopt;
+    }
+    while (!frontier_.empty()) {
+      const auto [distance, id] = frontier_.top();
+      if (near_.size() >= ef_ && distance > std::prev(near_.end())->first) {
+        break;
+      }
+      // Like DistanceLimitStopCondition, nodes out of the limit are not
+      // expanded once ef rows are found.
+      if (num_rows_ >= ef_ && !limit_.Contains(distance)) {
+        break;
+      }
+      frontier_.pop();
+      Expand(id);
+    }
+    if (near_.empty()) {
+      remaining_ = 0;
+      return std::nullopt;
+    }
+
+    const auto row = *near_.begin();
+    near_.erase(near_.begin());
+    if (!far_.empty()) {
+      near_.insert(far_.top());
+      far_.pop();
+    }
+    if (!limit_.Contains(row.first)) {
+      // Rows come closer first, so the rest are out of the limit too.
+      remaining_ = 0;
+      return std::nullopt;
+    }
+    --remaining_;
+    return row;
+  }
+
+ private:
+  using Node = std::pair<float, hnswlib::tableint>;
+  using Row = std::pair<float, hnswlib::labeltype>;
+  template <class T>
+  using MinHeap = std::priority_queue<T, std::vector<T>, std::greater<T>>;
+
+  float Distance(hnswlib::tableint id) const {
+    return dist_func_(query_.data(), index_.getDataByInternalId(id),
+                      index_.dist_func_param_);
+  }
+
+  // Descends the upper layers greedily, like hnswlib's searchKnn.
+  void Start() {
+    if (index_.cur_element_count == 0) {
+      remaining_ = 0;
+      return;
+    }
+    visited_.assign(index_.cur_element_count, false);
+    hnswlib::tableint current = index_.enterpoint_node_;
+    float current_distance = Distance(current);
+    for (int level = index_.maxlevel_; level > 0; --level) {
+      bool changed = true;
+      while (changed) {
+        changed = false;
+        hnswlib::linklistsizeint* links = index_.get_linklist(current, level);
+        const auto* neighbors =
+            reinterpret_cast<const hnswlib::tableint*>(links + 1);
+        const size_t count = index_.getListCount(links);
+        for (size_t i = 0; i < count; ++i) {
+          const float distance = Distance(neighbors[i]);
+          if (distance < current_distance) {
+            current_distance = distance;
+            current = neighbors[i];
+            changed = true;
+          }
+        }
+      }
+    }
+    Discover(current, current_distance);
+  }
+
+  void Discover(hnswlib::tableint id, float distance) {
+    if (id >= visited_.size()) {
+      // Inserted after the stream started.
+      visited_.resize(id + 1, false);
+    }
+    visited_[id] = true;
+    // A NaN distance can't be ordered against the others.
+    if (std::isnan(distance)) {
+      return;
+    }
+    frontier_.emplace(distance, id);
+    if (index_.isMarkedDeleted(id)) {
+      return;
+    }
+    const hnswlib::labeltype label = index_.getExternalLabel(id);
+    if (rowid_filter_ == nullptr || (*rowid_filter_)(label)) {
+      AddRow(Row(distance, label));
+    }
+  }
+
+  void Expand(hnswlib::tableint id) {
+    hnswlib::linklistsizeint* links = index_.get_linklist0(id);
+    const auto* neighbors =
+        reinterpret_cast<const hnswlib::tableint*>(links + 1);
+    const size_t count = index_.getListCount(links);
+    for (size_t i = 0; i < count; ++i) {
+      const hnswlib::tableint neighbor = neighbors[i];
+      if (neighbor < visited_.size() && visited_[neighbor]) {
+        continue;
+      }
+      Discover(neighbor, Distance(neighbor));
+    }
+  }
+
+  // Keeps the ef closest unreturned rows in near_ and the others in far_.
+  void AddRow(const Row& row) {
+    ++num_rows_;
+    if (near_.size() < ef_) {
+      near_.insert(row);
+      return;
+    }
+    auto last = std::prev(near_.end());
+    if (row < *last) {
+      far_.push(*last);
+      near_.erase(last);
+      near_.insert(row);
+    } else {
+      far_.push(row);
+    }
+  }
+
+  const hnswlib::HierarchicalNSW<float>& index_;
+  const std::string query_;
+  const hnswlib::DISTFUNC<float> dist_func_;
+  const size_t ef_;
+  size_t remaining_;
+  const DistanceLimit limit_;
+  const RowidRange range_;
+  std::optional<RowidBitmap> rowids_;
+  std::unique_ptr<hnswlib::BaseFilterFunctor> rowid_filter_;
+
+  // Indexed by internal id.
+  std::vector<bool> visited_;
+  // Discovered nodes that are not expanded yet.
+  MinHeap<Node> frontier_;
+  // Unreturned rows: the ef closest, and the rest.
+  std::set<Row> near_;
+  MinHeap<Row> far_;
+  // Rows found so far, returned or not.
+  size_t num_rows_ = 0;
+};
+
 }  // namespace
 
-absl::StatusOr<QueryExecutor::QueryResult> QueryExecutor::Execute() const {
+hnswlib::DISTFUNC<float> QueryExecutor::QueryDistanceFunc() const {
+  switch (space_.vector_type) {
+    case VectorType::BFloat16:
+    case VectorType::Float16:
+    case VectorType::Float8E4M3:
+    case VectorType::Float8E5M2:
+      // A float32 query, or a native one that had to be decoded to be
+      // normalized, is compared against stored vectors with mixed precision
+      // kernels. This is more accurate than quantizing the query and saves a
+      // copy.
+      return native_input_ && !space_.normalize
+                 ? nullptr
+                 : space_.space->get_f32_query_dist_func();
+    case VectorType::ProductQuantized:
+      // The query is turned into a distance table, see ProductQuantizer.
+      return space_.pq_param()->quantizer.trained()
+                 ? PQSpace::TableDistanceFunc
+                 : nullptr;
+    default:
+      return nullptr;
+  }
+}
+
+QueryExecutor::QueryResult QueryExecutor::SearchGraph(
+    const void* query, size_t query_size, size_t k,
+    hnswlib::BaseFilterFunctor* rowid_filter, const DistanceLimit& limit,
+    std::string* graph_query) const {
+  if (graph_query != nullptr) {
+    graph_query->assign(static_cast<const char*>(query), query_size);
+    return QueryResult();
+  }
+  if (limit.unbounded()) {
+    return index_.searchKnnCloserFirst(query, k, rowid_filter);
+  }
+  DistanceLimitStopCondition stop_condition(limit, index_.ef_,
+                                            std::max(index_.ef_, k));
+  auto result =
+      index_.searchStopConditionClosest(query, stop_condition, rowid_filter);
+  if (result.size() > k) {
+    result.resize(k);
+  }
+  return result;
+}
+
+absl::StatusOr<QueryExecutor::QueryResult> QueryExecutor::Search(
+    std::string_view query_blob, hnswlib::BaseFilterFunctor* rowid_filter,
+    const std::optional<std::vector<hnswlib::labeltype>>& candidates,
+    const DistanceLimit& limit, std::string* graph_query) const {
+  const KnnParam* knn_param = vector_constraint_->knn_param();
+  const size_t k = knn_param->k;
+
+  // A query in the table's own encoding is only decoded to float32 if it
+  // needs to be normalized, otherwise it is searched as it is.
+  if (native_input_) {
+    absl::Status status = space_.CheckNativeBlob(query_blob);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  Vector query_vector;
+  if (!native_input_) {
+    auto query_view = VectorView::FromBlob(query_blob);
+    if (!query_view.ok()) {
+      return query_view.status();
+    }
+    if (space_.dimension() != query_view->dim()) {
+      std::string error = absl::StrFormat(
+          "query vector's dimension(%d) doesn't match %s's dimension: %d",
+          query_view->dim(), space_.vector_name, space_.dimension());
+      return absl::InvalidArgumentError(error);
+    }
+    query_vector = Vector(*query_view);
+  } else if (space_.normalize && space_.vector_type == VectorType::BFloat16) {
+    query_vector = Dequantize(*BF16VectorView::FromBlob(query_blob));
+  } else if (space_.normalize) {
+    query_vector = DequantizeF16(*F16VectorView::FromBlob(query_blob));
+  }
+
+  // `query` must be in the index's storage format.
+  auto search = [&](const void* query) -> QueryResult {
+    if (candidates) {
+      return ExactKnnSearch(
+          index_,
+          [&](const void* const* vectors, size_t num_vectors, float* out) {
+            space_.space->BatchDistance(query, vectors, num_vectors, out);
+          },
+          *candidates, k);
+    }
+    return SearchGraph(query, index_.data_size_, k, rowid_filter, limit,
+                       graph_query);
+  };
+  // Graph search with the function returned by QueryDistanceFunc() in place
+  // of the index's distance function, which Execute() has installed. hnswlib
+  // always passes the query as the first argument of its distance function
+  // during search, so `query` can be in a different format than the stored
+  // vectors.
+  auto search_with_query_func = [&](const void* query,
+                                    size_t query_size) -> QueryResult {
+    VECTORLITE_ASSERT(index_.fstdistfunc_ == QueryDistanceFunc());
+    return SearchGraph(query, query_size, k, rowid_filter, limit,
+                       graph_query);
+  };
+  // Searches a half precision or float8 index with a float32 query.
+  auto search_f32_query = [&](const float* query) -> QueryResult {
+    if (candidates) {
+      VECTORLITE_ASSERT(space_.space->get_f32_query_dist_func() != nullptr);
+      return ExactKnnSearch(
+          index_,
+          [&](const void* const* vectors, size_t num_vectors, float* out) {
+            space_.space->BatchF32QueryDistance(query, vectors, num_vectors,
+                                                out);
+          },
+          *candidates, k);
+    }
+    return search_with_query_func(query, space_.dimension() * sizeof(float));
+  };
+  try {
+    if (space_.vector_type == VectorType::Float32) {
+      if (!space_.normalize) {
+        return search(query_vector.data().data());
+      }
+
+      VECTORLITE_ASSERT(space_.normalize);
+      // Copy the query vector and normalize it.
+      Vector normalized_vector = Vector::Normalize(query_vector);
+
+      auto result = search(normalized_vector.data().data());
+      return result;
+    } else if (space_.vector_type == VectorType::BFloat16 ||
+               space_.vector_type == VectorType::Float16 ||
+               space_.vector_type == VectorType::Float8E4M3 ||
+               space_.vector_type == VectorType::Float8E5M2) {
+      if (native_input_ && !space_.normalize) {
+        // Query and stored vectors share their encoding.
+        return search(query_blob.data());
+      }
+      if (!space_.normalize) {
+        return search_f32_query(query_vector.data().data());
+      }
+
+      VECTORLITE_ASSERT(space_.normalize);
+      Vector normalized_vector = Vector::Normalize(query_vector);
+
+      auto result = search_f32_query(normalized_vector.data().data());
+      return result;
+    } else if (space_.vector_type == VectorType::Int8) {
+      const Int8Calibration* calibration = space_.int8_calibration();
+      Vector normalized_vector;
+      VectorView query = query_vector;
+      if (space_.normalize) {
+        normalized_vector = Vector::Normalize(query_vector);
+        query = normalized_vector;
+      }
+      if (!calibration->calibrated()) {
+        // Vectors are only kept in float32 until there are enough of them to
+        // derive the calibration from, so search them exactly.
+        return SearchPendingVectors(calibration->pending, space_.distance_type,
+                                    query.data().data(), rowid_filter, k);
+      }
+
+      std::vector<int8_t> quantized_vector =
+          QuantizeToInt8(query, *calibration);
+      return search(quantized_vector.data());
+    } else if (space_.vector_type == VectorType::Binary) {
+      Vector normalized_vector;
+      const float* query = query_vector.data().data();
+      if (space_.normalize) {
+        normalized_vector = Vector::Normalize(query_vector);
+        query = normalized_vector.data().data();
+      }
+      const BinarySpaceParam* param = space_.binary_param();
+      std::vector<uint8_t> code(param->code_size());
+      ops::QuantizeF32ToBinary(query, code.data(), param->dim);
+      if (param->rerank_factor == 0) {
+        // Distances are Hamming distances.
+        return search(code.data());
+      }
+
+      std::vector<hnswlib::labeltype> labels;
+      if (candidates) {
+        labels = *candidates;
+      } else {
+        // Graph search only compares binary codes. Over-fetch candidates so
+        // that reranking can recover the true top k.
+        auto binary_result = index_.searchKnnCloserFirst(
+            code.data(), k * param->rerank_factor, rowid_filter);
+        labels.reserve(binary_result.size());
+        for (const auto& [distance, label] : binary_result) {
+          labels.push_back(label);
+        }
+      }
+      return RerankBinaryCandidates(index_, *param, space_.distance_type,
+                                    query, labels, k);
+    } else if (space_.vector_type == VectorType::ProductQuantized) {
+      Vector normalized_vector;
+      const float* query = query_vector.data().data();
+      if (space_.normalize) {
+        normalized_vector = Vector::Normalize(query_vector);
+        query = normalized_vector.data().data();
+      }
+      const ProductQuantizer& quantizer = space_.pq_param()->quantizer;
+      if (!quantizer.trained()) {
+        // Vectors are only kept in float32 until there are enough of them
+        // to train the codebooks, so search them exactly.
+        return SearchPendingVectors(quantizer.pending(), space_.distance_type,
+                                    query, rowid_filter, k);
+      }
+
+      std::vector<float> table(quantizer.table_size());
+      quantizer.ComputeDistanceTable(query, table.data());
+      if (candidates) {
+        return ExactKnnSearch(
+            index_,
+            [&](const void* const* vectors, size_t num_vectors, float* out) {
+              // Rows that can be among the k closest get the same float32
+              // table lookups as graph search, so a row gets the same
+              // distance on both paths.
+              quantizer.FastScan(
+                  table.data(),
+                  reinterpret_cast<const uint8_t* const*>(vectors),
+                  num_vectors, k, out);
+            },
+            *candidates, k);
+      }
+      return search_with_query_func(table.data(),
+                                    table.size() * sizeof(float));
+    } else {
+      return absl::InternalError(
+          absl::StrFormat("Unknown vector type: %d", space_.vector_type));
+    }
+
+  } catch (const std::runtime_error& e) {
+    return absl::InternalError(e.what());
+  }
+}
+
+absl::StatusOr<QueryExecutor::QueryResult> QueryExecutor::Execute(
+    std::vector<uint32_t>* query_indices,
+    std::unique_ptr<KnnStream>* stream) const {
   if (!status_.ok()) {
     return status_;
   }
@@ -184,15 +1218,6 @@ absl::StatusOr<QueryExecutor::QueryResult> QueryExecutor::Execute() const {
     const KnnParam* knn_param = vector_constraint_->knn_param();
     VECTORLITE_ASSERT(knn_param != nullptr);
 
-    if (space_.dimension() != knn_param->query_vector.dim()) {
-      std::string error = absl::StrFormat(
-          "query vector's dimension(%d) doesn't match %s's dimension: %d",
-          knn_param->query_vector.dim(), space_.vector_name,
-          space_.dimension());
-      return absl::InvalidArgumentError(error);
-    }
-
-    auto rowid_filter = MakeRowidFilter(rowid_constraint_);
     // setEf mutates shared state on the index. Restore it afterwards so a query
     // that overrides ef does not leak that value into subsequent queries (and
     // to avoid a data race on concurrent reads).
@@ -203,79 +1228,142 @@ absl::StatusOr<QueryExecutor::QueryResult> QueryExecutor::Execute() const {
     if (knn_param->ef_search.has_value()) {
       index_.setEf(*knn_param->ef_search);
     }
-    try {
-      if (space_.vector_type == VectorType::Float32) {
-        if (!space_.normalize) {
-          return index_.searchKnnCloserFirst(
-              knn_param->query_vector.data().data(), knn_param->k,
-              rowid_filter.get());
-        }
-
-        VECTORLITE_ASSERT(space_.normalize);
-        // Copy the query vector and normalize it.
-        Vector normalized_vector = Vector::Normalize(knn_param->query_vector);
-
-        auto result = index_.searchKnnCloserFirst(
-            normalized_vector.data().data(), knn_param->k, rowid_filter.get());
-        return result;
-      } else if (space_.vector_type == VectorType::BFloat16) {
-        BF16Vector quantized_vector = Quantize(knn_param->query_vector);
 
-        if (!space_.normalize) {
-          return index_.searchKnnCloserFirst(quantized_vector.data().data(),
-                                             knn_param->k, rowid_filter.get());
-        }
-
-        VECTORLITE_ASSERT(space_.normalize);
-        BF16Vector normalized_vector = quantized_vector.Normalize();
+    std::optional<RowidSet> rowid_set = ToRowidSet(rowid_constraint_);
+    if (knn_param->rowid_bitmap) {
+      if (rowid_set) {
+        return absl::InvalidArgumentError(
+            "a rowid bitmap passed to knn_param() can't be combined with "
+            "rowid = or rowid IN (...)");
+      }
+      rowid_set = &*knn_param->rowid_bitmap;
+    }
+    const RowidRange range(rowid_comparisons_);
+    auto rowid_filter = MakeRowidFilter(rowid_set, range);
+    // Rowid constraints that leave few candidates are scored exactly instead
+    // of searching the graph. ef must be set, as the choice depends on it.
+    const auto candidates =
+        GetCandidateRowids(rowid_set, range, index_, knn_param->k);
+    // Like ef, the distance function is swapped once for all queries and
+    // restored afterwards, so that queries of a batch can search concurrently.
+    const hnswlib::DISTFUNC<float> original_func = index_.fstdistfunc_;
+    absl::Cleanup restore_func = [this, original_func] {
+      index_.fstdistfunc_ = original_func;
+    };
+    if (hnswlib::DISTFUNC<float> query_func = QueryDistanceFunc();
+        query_func != nullptr) {
+      index_.fstdistfunc_ = query_func;
+    }
 
-        auto result = index_.searchKnnCloserFirst(
-            normalized_vector.data().data(), knn_param->k, rowid_filter.get());
+    // Exact scans and reranking score every row they return, so rows out of
+    // the limit are dropped afterwards.
+    const DistanceLimit limit(knn_param, distance_comparisons_);
+    if (!knn_param->batch) {
+      const bool lazy = knn_param->stream && stream != nullptr;
+      std::string graph_query;
+      auto result = Search(knn_param->query_blob, rowid_filter.get(),
+                           candidates, limit, lazy ? &graph_query : nullptr);
+      if (!result.ok()) {
         return result;
-      } else if (space_.vector_type == VectorType::Float16) {
-        F16Vector quantized_vector = QuantizeToF16(knn_param->query_vector);
+      }
+      if (!graph_query.empty()) {
+        // Graph search is left to the stream, which is why ef and the
+        // installed distance function are handed over.
+        *stream = std::make_unique<GraphKnnStream>(
+            index_, std::move(graph_query), index_.fstdistfunc_, index_.ef_,
+            knn_param->k, limit, rowid_set, range);
+        return QueryResult();
+      }
+      limit.Apply(*result);
+      return result;
+    }
 
-        if (!space_.normalize) {
-          return index_.searchKnnCloserFirst(quantized_vector.data().data(),
-                                             knn_param->k, rowid_filter.get());
+    const std::string& queries = knn_param->query_blob;
+    // Both native encodings take 2 bytes per element.
+    const size_t query_size =
+        space_.dimension() * (native_input_ ? 2 : sizeof(float));
+    if (queries.empty() || queries.size() % query_size != 0) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "queries of knn_batch_param() must be %d-dimensional %s vectors "
+          "back to back, but got %d bytes",
+          space_.dimension(), native_input_ ? "native" : "float32",
+          queries.size()));
+    }
+    const size_t num_queries = queries.size() / query_size;
+    std::vector<absl::StatusOr<QueryResult>> results(num_queries);
+    auto search_query = [&](size_t i) {
+      std::string_view query(queries.data() + i * query_size, query_size);
+      // Exceptions that escape Search, e.g. std::bad_alloc, must not leave
+      // the worker thread.
+      try {
+        results[i] = Search(query, rowid_filter.get(), candidates, limit);
+        if (results[i].ok()) {
+          limit.Apply(*results[i]);
         }
-
-        VECTORLITE_ASSERT(space_.normalize);
-        F16Vector normalized_vector = quantized_vector.Normalize();
-
-        auto result = index_.searchKnnCloserFirst(
-            normalized_vector.data().data(), knn_param->k, rowid_filter.get());
-        return result;
-      } else {
-        return absl::InternalError(
-            absl::StrFormat("Unknown vector type: %d", space_.vector_type));
+      } catch (const std::exception& e) {
+        results[i] = absl::InternalError(e.what());
+      } catch (...) {
+        results[i] =
+            absl::InternalError("Unknown error while searching the index");
       }
+    };
+    if (worker_pool_ != nullptr) {
+      worker_pool_->ParallelFor(num_queries, search_query);
+    } else {
+      for (size_t i = 0; i < num_queries; ++i) {
+        search_query(i);
+      }
+    }
 
-    } catch (const std::runtime_error& e) {
-      return absl::InternalError(e.what());
+    QueryResult result;
+    result.reserve(num_queries * knn_param->k);
+    if (query_indices != nullptr) {
+      query_indices->clear();
+      query_indices->reserve(num_queries * knn_param->k);
     }
+    for (size_t i = 0; i < num_queries; ++i) {
+      if (!results[i].ok()) {
+        return results[i].status();
+      }
+      result.insert(result.end(), results[i]->begin(), results[i]->end());
+      if (query_indices != nullptr) {
+        query_indices->insert(query_indices->end(), results[i]->size(),
+                              static_cast<uint32_t>(i));
+      }
+    }
+    return result;
 
   } else {
+    // we are doing a rowid search without using hnsw index
     QueryExecutor::QueryResult result;
+    // Rows have a distance of 0 without knn_search.
+    if (!DistanceLimit(nullptr, distance_comparisons_).Contains(0.0f)) {
+      return result;
+    }
+    const RowidRange range(rowid_comparisons_);
+    auto add_row = [&result, &range](hnswlib::labeltype rowid, const char*) {
+      if (range.Contains(rowid)) {
+        result.emplace_back(0.0f, rowid);
+      }
+    };
     if (rowid_constraint_) {
-      // we are doing a rowid search without using hnsw index
       absl::visit(absl::Overload(
-                      [&result, this](const RowIdIn* rowid_in) {
-                        for (const auto& rowid : rowid_in->get_rowids()) {
-                          // TODO: IsRowidInIndex takes a lock on
-                          // index.label_lookup_ on each invoke, Lock once in
-                          // the future.
-                          if (IsRowidInIndex(index_, rowid)) {
-                            result.emplace_back(0.0f, rowid);
-                          }
-                        }
+                      [&](const RowIdIn* rowid_in) {
+                        const auto& rowids = rowid_in->get_rowids();
+                        result.reserve(rowids.size());
+                        ForEachLabelInIndex(index_, rowids, add_row);
                       },
-                      [&result, this](const RowIdEquals* rowid_equals) {
+                      [&](const RowIdEquals* rowid_equals) {
                         if (IsRowidInIndex(index_, rowid_equals->rowid())) {
-                          result.emplace_back(0.0f, rowid_equals->rowid());
+                          add_row(rowid_equals->rowid(), nullptr);
                         }
                       }),
                   *rowid_constraint_);
+    } else if (range.span() <= index_.cur_element_count) {
+      ForEachLabelInIndex(index_, range.Enumerate(), add_row);
+    } else {
+      // The range spans more rowids than there are rows, so check every row.
+      ForEachLabelInIndex(index_, add_row);
     }
 
     return result;
@@ -307,6 +1395,27 @@ ParseConstraintsFromShortNames(std::string_view constraint_str) {
       constraints.push_back(std::make_unique<RowIdEquals>());
     } else if (short_name == KnnSearchConstraint::kShortName) {
       constraints.push_back(std::make_unique<KnnSearchConstraint>());
+    } else if (short_name == RowIdCompare::kGreaterThanShortName) {
+      constraints.push_back(
+          std::make_unique<RowIdCompare>(RowIdCompare::Op::kGreaterThan));
+    } else if (short_name == RowIdCompare::kGreaterEqualShortName) {
+      constraints.push_back(
+          std::make_unique<RowIdCompare>(RowIdCompare::Op::kGreaterEqual));
+    } else if (short_name == RowIdCompare::kLessThanShortName) {
+      constraints.push_back(
+          std::make_unique<RowIdCompare>(RowIdCompare::Op::kLessThan));
+    } else if (short_name == RowIdCompare::kLessEqualShortName) {
+      constraints.push_back(
+          std::make_unique<RowIdCompare>(RowIdCompare::Op::kLessEqual));
+    } else if (short_name == RowIdCompare::kNotEqualShortName) {
+      constraints.push_back(
+          std::make_unique<RowIdCompare>(RowIdCompare::Op::kNotEqual));
+    } else if (short_name == DistanceCompare::kLessThanShortName) {
+      constraints.push_back(
+          std::make_unique<DistanceCompare>(DistanceCompare::Op::kLessThan));
+    } else if (short_name == DistanceCompare::kLessEqualShortName) {
+      constraints.push_back(
+          std::make_unique<DistanceCompare>(DistanceCompare::Op::kLessEqual));
     } else {
       return absl::InvalidArgumentError(
           absl::StrFormat("unknown constraint short name: %s", short_name));
@@ -2,16 +2,20 @@
 
 #include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
-#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "absl/types/variant.h"
 #include "hnswlib/hnswlib.h"
 #include "macros.h"
+#include "rowid_bitmap.h"
 #include "sqlite3.h"
+#include "util.h"
 #include "vector.h"
 #include "vector_space.h"
 #include "vector_view.h"
@@ -19,12 +23,31 @@
 namespace vectorlite {
 
 struct KnnParam {
-  // Owns the query vector. It used to be a non-owning view into the sqlite3
-  // blob argument, which dangles if that argument is a temporary (e.g.
+  // Owns a copy of the query blob. It used to be a non-owning view into the
+  // sqlite3 blob argument, which dangles if that argument is a temporary (e.g.
   // knn_param(vector_from_json('...'), k)).
-  Vector query_vector;
+  // The blob holds float32 values, or elements in the table's own bfloat16 or
+  // float16 encoding if the table has native_input set, see
+  // IndexOptions::native_input. The table isn't known yet, so QueryExecutor
+  // interprets the blob.
+  std::string query_blob;
   uint32_t k;
   std::optional<uint32_t> ef_search;
+  // Set by knn_batch_param(). query_blob then holds any number of queries back
+  // to back, each of which is searched for its own k neighbors. Queries are
+  // encoded like a single query_blob, i.e. 2 bytes per element under
+  // native_input and float32 otherwise.
+  bool batch = false;
+  // Set by knn_stream_param(). Rows are then searched lazily, as SQLite asks
+  // for them, and k only caps their number. See KnnStream.
+  bool stream = false;
+  // Set if a rowid_bitmap() blob is passed to knn_param(). Only these rowids
+  // are searched, like with rowid IN (...), but the set is decoded from the
+  // blob instead of being built one rowid at a time.
+  std::optional<RowidBitmap> rowid_bitmap;
+  // Set by passing a number after k and ef to knn_param(). Only neighbors
+  // whose distance is at most max_distance are returned, at most k of them.
+  std::optional<double> max_distance;
 };
 
 // Used to identify pointer type for sqlite_result_pointer/sqlite_value_pointer
@@ -33,6 +56,9 @@ constexpr std::string_view kKnnParamType = "vectorlite_knn_param";
 class KnnSearchConstraint;
 class RowIdIn;
 class RowIdEquals;
+class RowIdCompare;
+class DistanceCompare;
+class DistanceLimit;
 
 class ConstraintVisitor {
  public:
@@ -41,23 +67,57 @@ class ConstraintVisitor {
   virtual void Visit(const KnnSearchConstraint& constraint) = 0;
   virtual void Visit(const RowIdIn& constraint) = 0;
   virtual void Visit(const RowIdEquals& constraint) = 0;
+  virtual void Visit(const RowIdCompare& constraint) = 0;
+  virtual void Visit(const DistanceCompare& constraint) = 0;
+};
+
+// The rows of a knn_stream_param() search, produced one at a time roughly in
+// order of distance. Each call to Next() resumes the graph search where the
+// previous one left off and expands it only as far as needed to settle the
+// next row, so the work done is proportional to the rows consumed rather than
+// to k.
+class KnnStream {
+ public:
+  virtual ~KnnStream() = default;
+
+  // Returns the next row, or std::nullopt once there are no more.
+  virtual std::optional<std::pair<float, hnswlib::labeltype>> Next() = 0;
 };
 
 class QueryExecutor : public ConstraintVisitor {
  public:
   using QueryResult = std::vector<std::pair<float, hnswlib::labeltype>>;
 
+  // If `native_input` is set, queries are in the bfloat16 or float16 encoding
+  // of the table instead of float32, see IndexOptions::native_input. Queries
+  // of a batch are searched on `worker_pool` if set, otherwise one after
+  // another on the calling thread.
   QueryExecutor(hnswlib::HierarchicalNSW<float>& index,
-                const NamedVectorSpace& space)
-      : index_(index), space_(space) {}
+                const NamedVectorSpace& space, bool native_input = false,
+                WorkerPool* worker_pool = nullptr)
+      : index_(index),
+        space_(space),
+        native_input_(native_input),
+        worker_pool_(worker_pool) {}
   virtual ~QueryExecutor() = default;
 
   // Should only be called iff IsOk() returns true.
-  absl::StatusOr<QueryResult> Execute() const;
+  // If the knn_search is a batch, see KnnParam::batch, the results of all
+  // queries are concatenated in query order and `query_indices` receives the
+  // index of the query each result row belongs to.
+  // If the knn_search is a stream, see KnnParam::stream, and is answered by
+  // graph search, `stream` receives a KnnStream of the rows instead and the
+  // returned result is empty. Otherwise, e.g. when only a few rowids are
+  // allowed and are scored exactly, all rows are returned at once.
+  absl::StatusOr<QueryResult> Execute(
+      std::vector<uint32_t>* query_indices = nullptr,
+      std::unique_ptr<KnnStream>* stream = nullptr) const;
 
   void Visit(const KnnSearchConstraint& constraint) override;
   void Visit(const RowIdIn& constraint) override;
   void Visit(const RowIdEquals& constraint) override;
+  void Visit(const RowIdCompare& constraint) override;
+  void Visit(const DistanceCompare& constraint) override;
 
   bool ok() const { return status_.ok(); }
 
@@ -69,10 +129,37 @@ class QueryExecutor : public ConstraintVisitor {
   }
 
  private:
+  // Returns the distance function that graph search must use in place of the
+  // index's own one for a query, or nullptr if there is none.
+  hnswlib::DISTFUNC<float> QueryDistanceFunc() const;
+
+  // Searches the k nearest neighbors of a single query. The function returned
+  // by QueryDistanceFunc() must already be installed in the index.
+  // `candidates`, if set, are scored exactly instead of searching the graph.
+  // Graph search stops expanding candidates out of `limit`, but results may
+  // still include some, see DistanceLimit::Apply. If `graph_query` is set and
+  // the query would be answered by graph search, the query is copied into it
+  // instead of searching, in the format the installed distance function
+  // expects. Safe to call concurrently.
+  absl::StatusOr<QueryResult> Search(
+      std::string_view query_blob, hnswlib::BaseFilterFunctor* rowid_filter,
+      const std::optional<std::vector<hnswlib::labeltype>>& candidates,
+      const DistanceLimit& limit, std::string* graph_query = nullptr) const;
+
+  // Graph search of the k nearest neighbors of `query`, which is in the format
+  // fstdistfunc_ of the index expects and is `query_size` bytes long. See
+  // Search() for `graph_query`.
+  QueryResult SearchGraph(const void* query, size_t query_size, size_t k,
+                          hnswlib::BaseFilterFunctor* rowid_filter,
+                          const DistanceLimit& limit,
+                          std::string* graph_query) const;
+
   // setting ef when querying the index is allowed. So index_ cannot be marked
   // as const.
   hnswlib::HierarchicalNSW<float>& index_;
   const NamedVectorSpace& space_;
+  const bool native_input_;
+  WorkerPool* worker_pool_;  // not owned, may be nullptr
   absl::Status status_;
 
   // there can at most one KnnParam constraint
@@ -81,6 +168,13 @@ class QueryExecutor : public ConstraintVisitor {
   // there can be at most one vector constraint
   std::optional<absl::variant<const RowIdIn*, const RowIdEquals*>>
       rowid_constraint_;
+
+  // Any number of comparisons, which all must hold. e.g. BETWEEN is passed as
+  // a pair of >= and <=.
+  std::vector<const RowIdCompare*> rowid_comparisons_;
+
+  // distance < and <= constraints, which all must hold.
+  std::vector<const DistanceCompare*> distance_comparisons_;
 };
 
 class Constraint {
@@ -129,8 +223,8 @@ class KnnSearchConstraint : public Constraint {
 
   std::string ToDebugString() const override {
     if (materialized()) {
-      return absl::StrFormat("knn_parm(vector of dim %d, %d)",
-                             knn_param_->query_vector.dim(), knn_param_->k);
+      return absl::StrFormat("knn_parm(vector of %d bytes, %d)",
+                             knn_param_->query_blob.size(), knn_param_->k);
     }
 
     return absl::StrFormat("knn_param(?)");
@@ -152,9 +246,7 @@ class RowIdIn : public Constraint {
 
   void Accept(ConstraintVisitor* visitor) override { visitor->Visit(*this); }
 
-  const absl::flat_hash_set<hnswlib::labeltype>& get_rowids() const {
-    return rowids_;
-  }
+  const RowidBitmap& get_rowids() const { return rowids_; }
 
  private:
   virtual absl::Status DoMaterialize(const sqlite3_api_routines* sqlite3_api,
@@ -167,7 +259,7 @@ class RowIdIn : public Constraint {
 
     return absl::StrFormat("rowid in (?)");
   }
-  absl::flat_hash_set<hnswlib::labeltype> rowids_;
+  RowidBitmap rowids_;
 };
 
 class RowIdEquals : public Constraint {
@@ -197,6 +289,93 @@ class RowIdEquals : public Constraint {
   hnswlib::labeltype rowid_;
 };
 
+// rowid >, >=, <, <= or != a value. Unlike rowid IN (...), these are tested
+// in O(1) per rowid without materializing a set of rowids.
+class RowIdCompare : public Constraint {
+ public:
+  enum class Op {
+    kGreaterThan,
+    kGreaterEqual,
+    kLessThan,
+    kLessEqual,
+    kNotEqual,
+  };
+
+  // Names used in idxStr that is created in xBestIndex and then passed to
+  // xFilter, one per Op.
+  constexpr static std::string_view kGreaterThanShortName = "gt";
+  constexpr static std::string_view kGreaterEqualShortName = "ge";
+  constexpr static std::string_view kLessThanShortName = "lt";
+  constexpr static std::string_view kLessEqualShortName = "le";
+  constexpr static std::string_view kNotEqualShortName = "ne";
+
+  explicit RowIdCompare(Op op) : op_(op), value_(0), null_value_(false) {}
+
+  // Returns the Op of a SQLITE_INDEX_CONSTRAINT_* operator, std::nullopt if
+  // it is not one of them.
+  static std::optional<Op> FromSqliteOp(unsigned char op);
+  static std::string_view ShortName(Op op);
+
+  void Accept(ConstraintVisitor* visitor) override { visitor->Visit(*this); }
+
+  Op op() const { return op_; }
+  // A REAL value is rounded to the integer that makes the comparison match
+  // the same rowids.
+  int64_t value() const { return value_; }
+  // Comparing with NULL never matches any rowid.
+  bool null_value() const { return null_value_; }
+
+ private:
+  virtual absl::Status DoMaterialize(const sqlite3_api_routines* sqlite3_api,
+                                     sqlite3_value* arg) override;
+
+  std::string ToDebugString() const override;
+
+  Op op_;
+  int64_t value_;
+  bool null_value_;
+};
+
+// distance < or <= a value, where distance is the hidden column of knn_search
+// results. Graph search stops expanding candidates beyond the value, see
+// DistanceLimit, instead of computing k results for SQLite to discard.
+class DistanceCompare : public Constraint {
+ public:
+  enum class Op {
+    kLessThan,
+    kLessEqual,
+  };
+
+  // Names used in idxStr that is created in xBestIndex and then passed to
+  // xFilter, one per Op.
+  constexpr static std::string_view kLessThanShortName = "dl";
+  constexpr static std::string_view kLessEqualShortName = "dm";
+
+  explicit DistanceCompare(Op op) : op_(op), value_(0), null_value_(false) {}
+
+  // Returns the Op of a SQLITE_INDEX_CONSTRAINT_* operator, std::nullopt if
+  // it is not one of them.
+  static std::optional<Op> FromSqliteOp(unsigned char op);
+  static std::string_view ShortName(Op op);
+
+  void Accept(ConstraintVisitor* visitor) override { visitor->Visit(*this); }
+
+  Op op() const { return op_; }
+  double value() const { return value_; }
+  // Comparing with NULL never matches any row.
+  bool null_value() const { return null_value_; }
+
+ private:
+  virtual absl::Status DoMaterialize(const sqlite3_api_routines* sqlite3_api,
+                                     sqlite3_value* arg) override;
+
+  std::string ToDebugString() const override;
+
+  Op op_;
+  double value_;
+  bool null_value_;
+};
+
 std::string ConstraintsToDebugString(
     const std::vector<std::unique_ptr<Constraint>>& constraints);
 
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
 #include "hnswlib/hnswlib.h"
 #include "hwy/base.h"
 #include "macros.h"
 #include "ops/ops.h"
+#include "product_quantizer.h"
+#include "quantization.h"
+#include "rerank_store.h"
+#include "space_interface.h"
 
 // This file implements hnswlib::SpaceInterface<float> using vectorlite
 // implemented SIMD distance functions, which uses google's Highway SIMD
@@ -11,11 +19,17 @@
 // PC(i5-12600KF with AVX2 support)
 namespace vectorlite {
 
-template <class T, VECTORLITE_IF_FLOAT_SUPPORTED(T)>
-class GenericInnerProductSpace : public hnswlib::SpaceInterface<float> {
+template <class T, VECTORLITE_IF_SPACE_SUPPORTED(T)>
+class GenericInnerProductSpace : public SpaceInterface {
  public:
+  // The distance function is resolved to the best SIMD target here, so that
+  // hnswlib calls it without going through Highway's dynamic dispatch.
   explicit GenericInnerProductSpace(size_t dim)
-      : dim_(dim), func_(GenericInnerProductSpace::InnerProductDistanceFunc) {}
+      : dim_(dim), func_(ops::GetInnerProductDistanceFunc<T>(dim)) {
+    if constexpr (hwy::IsSpecialFloat<T>() || ops::IsFloat8<T>()) {
+      f32_query_func_ = ops::GetMixedInnerProductDistanceFunc<T>(dim);
+    }
+  }
 
   size_t get_data_size() override { return dim_ * sizeof(T); }
 
@@ -23,27 +37,60 @@ class GenericInnerProductSpace : public hnswlib::SpaceInterface<float> {
 
   hnswlib::DISTFUNC<float> get_dist_func() override { return func_; }
 
+  hnswlib::DISTFUNC<float> get_f32_query_dist_func() override {
+    return f32_query_func_;
+  }
+
+  bool set_dist_func(hnswlib::DISTFUNC<float> func) override {
+    func_ = func;
+    return true;
+  }
+
+  bool set_f32_query_dist_func(hnswlib::DISTFUNC<float> func) override {
+    if (f32_query_func_ == nullptr) {
+      return false;
+    }
+    f32_query_func_ = func;
+    return true;
+  }
+
+  void BatchDistance(const void* query, const void* const* vectors,
+                     size_t num_vectors, float* out) override {
+    ops::InnerProductDistanceBatch(static_cast<const T*>(query),
+                                   reinterpret_cast<const T* const*>(vectors),
+                                   num_vectors, dim_, out);
+  }
+
+  void BatchF32QueryDistance(const float* query, const void* const* vectors,
+                             size_t num_vectors, float* out) override {
+    ops::InnerProductDistanceBatch(query,
+                                   reinterpret_cast<const T* const*>(vectors),
+                                   num_vectors, dim_, out);
+  }
+
  private:
   size_t dim_;
   hnswlib::DISTFUNC<float> func_;
-
-  static float InnerProductDistanceFunc(const void* v1, const void* v2,
-                                        const void* dim) {
-    return ops::InnerProductDistance(static_cast<const T*>(v1),
-                                     static_cast<const T*>(v2),
-                                     *reinterpret_cast<const size_t*>(dim));
-  }
+  // Only set for half precision and float8 spaces.
+  hnswlib::DISTFUNC<float> f32_query_func_ = nullptr;
 };
 
 using InnerProductSpace = GenericInnerProductSpace<float>;
 using InnerProductSpaceBF16 = GenericInnerProductSpace<hwy::bfloat16_t>;
 using InnerProductSpaceF16 = GenericInnerProductSpace<hwy::float16_t>;
+using InnerProductSpaceF8E4M3 = GenericInnerProductSpace<ops::float8_e4m3_t>;
+using InnerProductSpaceF8E5M2 = GenericInnerProductSpace<ops::float8_e5m2_t>;
 
-template <class T, VECTORLITE_IF_FLOAT_SUPPORTED(T)>
-class GenericL2Space : public hnswlib::SpaceInterface<float> {
+template <class T, VECTORLITE_IF_SPACE_SUPPORTED(T)>
+class GenericL2Space : public SpaceInterface {
  public:
+  // See GenericInnerProductSpace.
   explicit GenericL2Space(size_t dim)
-      : dim_(dim), func_(GenericL2Space::L2DistanceSquaredFunc) {}
+      : dim_(dim), func_(ops::GetL2DistanceSquaredFunc<T>(dim)) {
+    if constexpr (hwy::IsSpecialFloat<T>() || ops::IsFloat8<T>()) {
+      f32_query_func_ = ops::GetMixedL2DistanceSquaredFunc<T>(dim);
+    }
+  }
 
   size_t get_data_size() override { return dim_ * sizeof(T); }
 
@@ -51,20 +98,289 @@ class GenericL2Space : public hnswlib::SpaceInterface<float> {
 
   hnswlib::DISTFUNC<float> get_dist_func() override { return func_; }
 
+  hnswlib::DISTFUNC<float> get_f32_query_dist_func() override {
+    return f32_query_func_;
+  }
+
+  bool set_dist_func(hnswlib::DISTFUNC<float> func) override {
+    func_ = func;
+    return true;
+  }
+
+  bool set_f32_query_dist_func(hnswlib::DISTFUNC<float> func) override {
+    if (f32_query_func_ == nullptr) {
+      return false;
+    }
+    f32_query_func_ = func;
+    return true;
+  }
+
+  void BatchDistance(const void* query, const void* const* vectors,
+                     size_t num_vectors, float* out) override {
+    ops::L2DistanceSquaredBatch(static_cast<const T*>(query),
+                                reinterpret_cast<const T* const*>(vectors),
+                                num_vectors, dim_, out);
+  }
+
+  void BatchF32QueryDistance(const float* query, const void* const* vectors,
+                             size_t num_vectors, float* out) override {
+    ops::L2DistanceSquaredBatch(query,
+                                reinterpret_cast<const T* const*>(vectors),
+                                num_vectors, dim_, out);
+  }
+
  private:
   size_t dim_;
   hnswlib::DISTFUNC<float> func_;
-
-  static float L2DistanceSquaredFunc(const void* v1, const void* v2,
-                                     const void* dim) {
-    return ops::L2DistanceSquared(static_cast<const T*>(v1),
-                                  static_cast<const T*>(v2),
-                                  *reinterpret_cast<const size_t*>(dim));
-  }
+  // Only set for half precision and float8 spaces.
+  hnswlib::DISTFUNC<float> f32_query_func_ = nullptr;
 };
 
 using L2Space = GenericL2Space<float>;
 using L2SpaceBF16 = GenericL2Space<hwy::bfloat16_t>;
 using L2SpaceF16 = GenericL2Space<hwy::float16_t>;
+using L2SpaceF8E4M3 = GenericL2Space<ops::float8_e4m3_t>;
+using L2SpaceF8E5M2 = GenericL2Space<ops::float8_e5m2_t>;
+
+// Distance function param of int8 spaces. `dim` must be the first member
+// because VectorSpace::dimension() reads the param as a size_t.
+struct Int8SpaceParam {
+  size_t dim;
+  Int8Calibration calibration;
+  // Integer kernel resolved to the best SIMD target once, see
+  // GenericInnerProductSpace.
+  ops::Int8DistanceFunc int8_func;
+  // The calibration is derived once this many vectors are pending.
+  size_t calibration_size = 1;
+};
+
+// Computes the int32 distances of `vectors` to `query` with
+// `batch(query, vectors, num_vectors, dim, int32_out)`, a batch kernel of ops,
+// and writes `to_float(int32_distance)` to `out`. Vectors are scored a stack
+// buffer at a time, so that BatchDistance does not allocate.
+template <class BatchFunc, class ToFloat>
+void Int8BatchDistance(const void* query, const void* const* vectors,
+                       size_t num_vectors, size_t dim, BatchFunc&& batch,
+                       ToFloat&& to_float, float* out) {
+  constexpr size_t kChunkSize = 64;
+  int32_t distances[kChunkSize];
+  for (size_t start = 0; start < num_vectors; start += kChunkSize) {
+    const size_t count = std::min(kChunkSize, num_vectors - start);
+    batch(static_cast<const int8_t*>(query),
+          reinterpret_cast<const int8_t* const*>(vectors + start), count, dim,
+          distances);
+    for (size_t i = 0; i < count; ++i) {
+      out[start + i] = to_float(distances[i]);
+    }
+  }
+}
+
+// Inner product space over int8 vectors. The calibration is symmetric(offset
+// is 0), so x.y ≈ scale^2 * (qx.qy) and the integer dot product can be used
+// directly.
+template <>
+class GenericInnerProductSpace<int8_t> : public SpaceInterface {
+ public:
+  explicit GenericInnerProductSpace(size_t dim)
+      : param_{dim, {}, ops::GetInt8InnerProductFunc()},
+        func_(GenericInnerProductSpace::InnerProductDistanceFunc) {}
+
+  size_t get_data_size() override { return param_.dim * sizeof(int8_t); }
+
+  void* get_dist_func_param() override { return &param_; }
+
+  hnswlib::DISTFUNC<float> get_dist_func() override { return func_; }
+
+  void BatchDistance(const void* query, const void* const* vectors,
+                     size_t num_vectors, float* out) override {
+    const float scale = param_.calibration.scale;
+    Int8BatchDistance(
+        query, vectors, num_vectors, param_.dim,
+        [](const int8_t* q, const int8_t* const* v, size_t n, size_t dim,
+           int32_t* ip) { ops::InnerProductBatch(q, v, n, dim, ip); },
+        [scale](int32_t ip) {
+          return 1.0f - scale * scale * static_cast<float>(ip);
+        },
+        out);
+  }
+
+ private:
+  Int8SpaceParam param_;
+  hnswlib::DISTFUNC<float> func_;
+
+  static float InnerProductDistanceFunc(const void* v1, const void* v2,
+                                        const void* param) {
+    const auto* p = static_cast<const Int8SpaceParam*>(param);
+    const float scale = p->calibration.scale;
+    const int32_t ip = p->int8_func(static_cast<const int8_t*>(v1),
+                                    static_cast<const int8_t*>(v2), p->dim);
+    return 1.0f - scale * scale * static_cast<float>(ip);
+  }
+};
+
+// L2 space over int8 vectors. The offset cancels out in the difference, so
+// |x-y|^2 ≈ scale^2 * |qx-qy|^2.
+template <>
+class GenericL2Space<int8_t> : public SpaceInterface {
+ public:
+  explicit GenericL2Space(size_t dim)
+      : param_{dim, {}, ops::GetInt8L2DistanceSquaredFunc()},
+        func_(GenericL2Space::L2DistanceSquaredFunc) {}
+
+  size_t get_data_size() override { return param_.dim * sizeof(int8_t); }
+
+  void* get_dist_func_param() override { return &param_; }
+
+  hnswlib::DISTFUNC<float> get_dist_func() override { return func_; }
+
+  void BatchDistance(const void* query, const void* const* vectors,
+                     size_t num_vectors, float* out) override {
+    const float scale = param_.calibration.scale;
+    Int8BatchDistance(
+        query, vectors, num_vectors, param_.dim,
+        [](const int8_t* q, const int8_t* const* v, size_t n, size_t dim,
+           int32_t* l2) { ops::L2DistanceSquaredBatch(q, v, n, dim, l2); },
+        [scale](int32_t l2) { return scale * scale * static_cast<float>(l2); },
+        out);
+  }
+
+ private:
+  Int8SpaceParam param_;
+  hnswlib::DISTFUNC<float> func_;
+
+  static float L2DistanceSquaredFunc(const void* v1, const void* v2,
+                                     const void* param) {
+    const auto* p = static_cast<const Int8SpaceParam*>(param);
+    const float scale = p->calibration.scale;
+    const int32_t l2 = p->int8_func(static_cast<const int8_t*>(v1),
+                                    static_cast<const int8_t*>(v2), p->dim);
+    return scale * scale * static_cast<float>(l2);
+  }
+};
+
+using InnerProductSpaceI8 = GenericInnerProductSpace<int8_t>;
+using L2SpaceI8 = GenericL2Space<int8_t>;
+
+// Distance function param of binary spaces. `dim` must be the first member,
+// see Int8SpaceParam.
+struct BinarySpaceParam {
+  size_t dim;
+  // If non-zero, float32 vectors are kept in `rerank_store` and knn queries
+  // rescore rerank_factor * k candidates at full precision.
+  size_t rerank_factor;
+  // Resolved once, see GenericInnerProductSpace.
+  ops::HammingDistanceFunc hamming_func;
+  // Callers keep it in sync with the rows of the index, see
+  // ProductQuantizer::pending(). Empty if rerank_factor is 0.
+  RerankStore rerank_store;
+
+  size_t code_size() const { return ops::BinaryCodeSize(dim); }
+};
+
+// Space over binary(1-bit) quantized vectors, compared by Hamming distance.
+// Sign bits approximate the angle between vectors, so this works for every
+// distance type. Stored elements only hold the binary code, float32 vectors
+// for reranking are kept out of the index.
+class BinarySpace : public SpaceInterface {
+ public:
+  explicit BinarySpace(size_t dim)
+      : param_{dim, 0, ops::GetHammingDistanceFunc(), RerankStore(dim)},
+        func_(BinarySpace::HammingDistanceFunc) {}
+
+  size_t get_data_size() override { return param_.code_size(); }
+
+  void* get_dist_func_param() override { return &param_; }
+
+  hnswlib::DISTFUNC<float> get_dist_func() override { return func_; }
+
+  // Scores a chunk of vectors at a time through a stack buffer, see
+  // Int8BatchDistance.
+  void BatchDistance(const void* query, const void* const* vectors,
+                     size_t num_vectors, float* out) override {
+    constexpr size_t kChunkSize = 64;
+    uint64_t distances[kChunkSize];
+    for (size_t start = 0; start < num_vectors; start += kChunkSize) {
+      const size_t count = std::min(kChunkSize, num_vectors - start);
+      ops::HammingDistanceBatch(
+          static_cast<const uint8_t*>(query),
+          reinterpret_cast<const uint8_t* const*>(vectors + start), count,
+          param_.code_size(), distances);
+      for (size_t i = 0; i < count; ++i) {
+        out[start + i] = static_cast<float>(distances[i]);
+      }
+    }
+  }
+
+ private:
+  BinarySpaceParam param_;
+  hnswlib::DISTFUNC<float> func_;
+
+  static float HammingDistanceFunc(const void* v1, const void* v2,
+                                   const void* param) {
+    const auto* p = static_cast<const BinarySpaceParam*>(param);
+    return static_cast<float>(p->hamming_func(static_cast<const uint8_t*>(v1),
+                                              static_cast<const uint8_t*>(v2),
+                                              p->code_size()));
+  }
+};
+
+// Distance function param of product quantized spaces. `dim` must be the first
+// member, see Int8SpaceParam.
+struct PQSpaceParam {
+  size_t dim;
+  // Codebooks are trained once this many vectors are pending.
+  size_t train_size;
+  ProductQuantizer quantizer;
+};
+
+// Space over product quantized vectors, see ProductQuantizer. Stored elements
+// are codes and are compared with symmetric distances. Queries are compared
+// with asymmetric distances instead: the query is passed as a distance table
+// from ProductQuantizer::ComputeDistanceTable, with TableDistanceFunc swapped
+// in as hnswlib's distance function.
+class PQSpace : public SpaceInterface {
+ public:
+  PQSpace(size_t dim, size_t num_subquantizers, size_t train_size,
+          bool inner_product)
+      : param_{dim, train_size,
+               ProductQuantizer(dim, num_subquantizers, inner_product)},
+        func_(PQSpace::SymmetricDistanceFunc) {}
+
+  size_t get_data_size() override { return param_.quantizer.code_size(); }
+
+  void* get_dist_func_param() override { return &param_; }
+
+  hnswlib::DISTFUNC<float> get_dist_func() override { return func_; }
+
+  // Symmetric distances between the code `query` and `vectors`, see
+  // ProductQuantizer::SymmetricDistanceBatch. Exact scans of knn queries don't
+  // come here: they score codes against the query's distance table with
+  // ProductQuantizer::FastScan.
+  void BatchDistance(const void* query, const void* const* vectors,
+                     size_t num_vectors, float* out) override {
+    param_.quantizer.SymmetricDistanceBatch(
+        static_cast<const uint8_t*>(query),
+        reinterpret_cast<const uint8_t* const*>(vectors), num_vectors, out);
+  }
+
+  // `table` is a distance table of the query, `code` a stored element.
+  static float TableDistanceFunc(const void* table, const void* code,
+                                 const void* param) {
+    const auto* p = static_cast<const PQSpaceParam*>(param);
+    return p->quantizer.AsymmetricDistance(static_cast<const float*>(table),
+                                           static_cast<const uint8_t*>(code));
+  }
+
+ private:
+  PQSpaceParam param_;
+  hnswlib::DISTFUNC<float> func_;
+
+  static float SymmetricDistanceFunc(const void* v1, const void* v2,
+                                     const void* param) {
+    const auto* p = static_cast<const PQSpaceParam*>(param);
+    return p->quantizer.SymmetricDistance(static_cast<const uint8_t*>(v1),
+                                          static_cast<const uint8_t*>(v2));
+  }
+};
 
-}  // namespace vectorlite
\ No newline at end of file
+}  // namespace vectorlite
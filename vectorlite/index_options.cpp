@@ -70,6 +70,40 @@ absl::StatusOr<IndexOptions> IndexOptions::FromString(
             absl::StrFormat("Cannot parse allow_replace_deleted: %s", value);
         return absl::InvalidArgumentError(error);
       }
+    } else if (key == "rerank") {
+      if (!absl::SimpleAtoi<size_t>(value, &options.rerank)) {
+        std::string error = absl::StrFormat("Cannot parse rerank: %s", value);
+        return absl::InvalidArgumentError(error);
+      }
+    } else if (key == "pq") {
+      if (!absl::SimpleAtoi<size_t>(value, &options.pq)) {
+        std::string error = absl::StrFormat("Cannot parse pq: %s", value);
+        return absl::InvalidArgumentError(error);
+      }
+    } else if (key == "pq_train") {
+      if (!absl::SimpleAtoi<size_t>(value, &options.pq_train)) {
+        std::string error =
+            absl::StrFormat("Cannot parse pq_train: %s", value);
+        return absl::InvalidArgumentError(error);
+      }
+    } else if (key == "int8_calibration") {
+      if (!absl::SimpleAtoi<size_t>(value, &options.int8_calibration)) {
+        std::string error =
+            absl::StrFormat("Cannot parse int8_calibration: %s", value);
+        return absl::InvalidArgumentError(error);
+      }
+    } else if (key == "native_input") {
+      if (!absl::SimpleAtob(value, &options.native_input)) {
+        std::string error =
+            absl::StrFormat("Cannot parse native_input: %s", value);
+        return absl::InvalidArgumentError(error);
+      }
+    } else if (key == "native_output") {
+      if (!absl::SimpleAtob(value, &options.native_output)) {
+        std::string error =
+            absl::StrFormat("Cannot parse native_output: %s", value);
+        return absl::InvalidArgumentError(error);
+      }
     } else {
       std::string error = absl::StrFormat("Invalid index option: %s", key);
       return absl::InvalidArgumentError(error);
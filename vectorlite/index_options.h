@@ -12,12 +12,31 @@ struct IndexOptions {
   size_t ef_construction = 200;
   size_t random_seed = 100;
   bool allow_replace_deleted = true;
+  // Only valid for binary vectors. If non-zero, the float32 vectors are kept
+  // and knn queries rescore rerank * k binary candidates at full precision.
+  size_t rerank = 0;
+  // Only valid for float32 vectors. If non-zero, vectors are stored as product
+  // quantized codes with `pq` subquantizers, see ProductQuantizer.
+  size_t pq = 0;
+  // Number of vectors that codebooks are trained on.
+  size_t pq_train = 1024;
+  // Only used by int8 vectors. Number of vectors that the int8 calibration is
+  // derived from, see Int8Calibration.
+  size_t int8_calibration = 256;
+  // Only valid for bfloat16 and float16 vectors. If true, vectors of inserts,
+  // updates and knn_param() are taken in the table's own encoding, 2 bytes per
+  // element, instead of as float32.
+  bool native_input = false;
+  // Only valid for bfloat16 and float16 vectors. If true, the vector column
+  // returns the stored elements as they are instead of converting them to
+  // float32.
+  bool native_output = false;
 
   // Parses a string into IndexOptions.
   // This input is usually from the CREATE VIRTUAL TABLE statement.
   // e.g. CREATE VIRTUAL TABLE my_vectors using vectorlite(my_vector(384,
   // "l2"),
-  // "hnsw(max_elements=1000,M=16,ef_construction=200,random_seed=100,allow_replace_deleted=false)")
+  // "hnsw(max_elements=1000,M=16,ef_construction=200,random_seed=100,allow_replace_deleted=false,rerank=4)")
   // The second parameter to vectorlite() is the index options string.
   // All parameters except max_elemnts are optional, default values are used
   // if not specified.
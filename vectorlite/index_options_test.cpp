@@ -25,6 +25,84 @@ TEST(ParseIndexOptions, ShouldWorkWithOnlyMaxElements) {
   EXPECT_EQ(200, options->ef_construction);
   EXPECT_EQ(100, options->random_seed);
   EXPECT_EQ(true, options->allow_replace_deleted);
+  EXPECT_EQ(0, options->rerank);
+  EXPECT_EQ(0, options->pq);
+  EXPECT_EQ(1024, options->pq_train);
+  EXPECT_EQ(256, options->int8_calibration);
+}
+
+TEST(ParseIndexOptions, ShouldParseProductQuantization) {
+  auto options = vectorlite::IndexOptions::FromString(
+      "hnsw(max_elements=1000,pq=16,pq_train=500)");
+  EXPECT_TRUE(options.ok());
+  EXPECT_EQ(16, options->pq);
+  EXPECT_EQ(500, options->pq_train);
+
+  options =
+      vectorlite::IndexOptions::FromString("hnsw(max_elements=1000,pq=abc)");
+  EXPECT_FALSE(options.ok());
+  EXPECT_TRUE(absl::StrContains(options.status().message(), "Cannot parse pq"));
+}
+
+TEST(ParseIndexOptions, ShouldParseInt8Calibration) {
+  auto options = vectorlite::IndexOptions::FromString(
+      "hnsw(max_elements=1000,int8_calibration=10)");
+  EXPECT_TRUE(options.ok());
+  EXPECT_EQ(10, options->int8_calibration);
+
+  options = vectorlite::IndexOptions::FromString(
+      "hnsw(max_elements=1000,int8_calibration=abc)");
+  EXPECT_FALSE(options.ok());
+  EXPECT_TRUE(absl::StrContains(options.status().message(),
+                                "Cannot parse int8_calibration"));
+}
+
+TEST(ParseIndexOptions, ShouldParseRerank) {
+  auto options =
+      vectorlite::IndexOptions::FromString("hnsw(max_elements=1000,rerank=4)");
+  EXPECT_TRUE(options.ok());
+  EXPECT_EQ(4, options->rerank);
+
+  options = vectorlite::IndexOptions::FromString(
+      "hnsw(max_elements=1000,rerank=abc)");
+  EXPECT_FALSE(options.ok());
+  EXPECT_TRUE(
+      absl::StrContains(options.status().message(), "Cannot parse rerank"));
+}
+
+TEST(ParseIndexOptions, ShouldParseNativeOutput) {
+  auto options = vectorlite::IndexOptions::FromString(
+      "hnsw(max_elements=1000,native_output=true)");
+  EXPECT_TRUE(options.ok());
+  EXPECT_TRUE(options->native_output);
+
+  options = vectorlite::IndexOptions::FromString("hnsw(max_elements=1000)");
+  EXPECT_TRUE(options.ok());
+  EXPECT_FALSE(options->native_output);
+
+  options = vectorlite::IndexOptions::FromString(
+      "hnsw(max_elements=1000,native_output=abc)");
+  EXPECT_FALSE(options.ok());
+  EXPECT_TRUE(absl::StrContains(options.status().message(),
+                                "Cannot parse native_output"));
+}
+
+TEST(ParseIndexOptions, ShouldParseNativeInput) {
+  auto options = vectorlite::IndexOptions::FromString(
+      "hnsw(max_elements=1000,native_input=true)");
+  EXPECT_TRUE(options.ok());
+  EXPECT_TRUE(options->native_input);
+  EXPECT_FALSE(options->native_output);
+
+  options = vectorlite::IndexOptions::FromString("hnsw(max_elements=1000)");
+  EXPECT_TRUE(options.ok());
+  EXPECT_FALSE(options->native_input);
+
+  options = vectorlite::IndexOptions::FromString(
+      "hnsw(max_elements=1000,native_input=abc)");
+  EXPECT_FALSE(options.ok());
+  EXPECT_TRUE(absl::StrContains(options.status().message(),
+                                "Cannot parse native_input"));
 }
 
 TEST(ParseIndexOptions, ShouldFailWithoutMaxElements) {
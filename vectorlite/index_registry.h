@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include "hnswlib/hnswlib.h"
+#include "util.h"
 #include "vector_space.h"
 
 namespace vectorlite {
@@ -23,15 +26,28 @@ struct IndexHandle {
   // table-name collision on xConnect.
   std::string vector_space_str;
   std::string index_options_str;
+  // Name of the distance function installed by vectorlite_autotune(), empty
+  // if the table uses the default one.
+  std::string tuned_distance_func;
+  // See IndexOptions::native_input.
+  bool native_input = false;
+  // See IndexOptions::native_output.
+  bool native_output = false;
+  // Bumped whenever `index` is replaced by another one, which frees the old
+  // one. A cursor that reads the index lazily checks it between rows.
+  uint64_t index_generation = 0;
 };
 
 // (schema_name, table_name) uniquely identifies a table within a connection.
 using RegistryKey = std::pair<std::string, std::string>;
 
-// A per-connection map of live in-memory indexes. Not thread-safe; SQLite
+// A per-connection map of live in-memory indexes, along with the worker threads
+// that search the queries of a batch knn_search. Not thread-safe; SQLite
 // serializes access to a single connection.
 class IndexRegistry {
  public:
+  IndexRegistry() : worker_pool_(std::thread::hardware_concurrency()) {}
+
   // Returns the handle for `key`, or nullptr if absent.
   IndexHandle* Find(const RegistryKey& key);
 
@@ -47,8 +63,21 @@ class IndexRegistry {
   // `new_key` is replaced. No-op if `old_key` is absent or equals `new_key`.
   void Rename(const RegistryKey& old_key, const RegistryKey& new_key);
 
+  // Started on the first batch query and joined when the registry is
+  // destroyed, i.e. when the connection is closed.
+  WorkerPool& worker_pool() { return worker_pool_; }
+
+  // Calls `f(key, handle)` for every entry in key order.
+  template <typename F>
+  void ForEach(F&& f) {
+    for (auto& [key, handle] : handles_) {
+      f(key, *handle);
+    }
+  }
+
  private:
   std::map<RegistryKey, std::unique_ptr<IndexHandle>> handles_;
+  WorkerPool worker_pool_;
 };
 
 }  // namespace vectorlite
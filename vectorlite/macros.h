@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <type_traits>
 
 #include "hwy/base.h"
@@ -25,3 +26,13 @@
   std::enable_if_t<std::is_same_v<T, float> ||    \
                    std::is_same_v<T, hwy::bfloat16_t> || \
                    std::is_same_v<T, hwy::float16_t>>*
+
+// Element types that can be stored in an hnswlib index, which additionally
+// include int8 scalar-quantized vectors and float8 vectors. Requires
+// ops/ops.h.
+#define VECTORLITE_IF_SPACE_SUPPORTED(T)                 \
+  std::enable_if_t<std::is_same_v<T, float> ||           \
+                   std::is_same_v<T, hwy::bfloat16_t> || \
+                   std::is_same_v<T, hwy::float16_t> ||  \
+                   std::is_same_v<T, int8_t> ||          \
+                   vectorlite::ops::IsFloat8<T>()>* = nullptr
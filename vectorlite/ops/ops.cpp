@@ -2,7 +2,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "hwy/base.h"
@@ -36,6 +39,16 @@
 #include "hwy/highway.h"
 #include "hwy/targets.h"
 
+// Dimensions with fixed-dimension kernels, see GetFixedDimInnerProductDistance.
+// All of them are multiples of 64. Keep in sync with ops.h.
+#define VECTORLITE_FOR_EACH_FIXED_DIM(X) \
+  X(128) X(256) X(384) X(512) X(768) X(1024) X(1536) X(3072)
+
+// float8 formats as (function name suffix, element type).
+#define VECTORLITE_FOR_EACH_FLOAT8(X)     \
+  X(E4M3, vectorlite::ops::float8_e4m3_t) \
+  X(E5M2, vectorlite::ops::float8_e5m2_t)
+
 // Optional, can instead add HWY_ATTR to all functions.
 HWY_BEFORE_NAMESPACE();
 
@@ -240,8 +253,56 @@ static float InnerProductImplVectorized(const D d, const hwy::float16_t* v1,
 }
 #endif  // !HWY_HAVE_FLOAT16
 
-template <class D, typename T = hn::TFromD<D>>
-static float InnerProductImpl(const D d, const T* v1, const T* v2,
+// Mixed precision inner product: v1 is float32 and v2 is bf16/f16, which is
+// promoted to float32 on the fly. Used to search half precision vectors with
+// a float32 query without quantizing the query.
+template <class D, typename H, HWY_IF_F32_D(D), HWY_IF_SPECIAL_FLOAT(H)>
+static float InnerProductImplVectorized(const D df,
+                                        const float* HWY_RESTRICT v1,
+                                        const H* HWY_RESTRICT v2,
+                                        size_t num_elements) {
+  const hn::Rebind<H, D> dh;
+  using VF = hn::Vec<D>;
+  const size_t NF = hn::Lanes(df);
+  HWY_DASSERT(num_elements >= NF && num_elements % NF == 0);
+
+  VF sum0 = hn::Zero(df);
+  VF sum1 = hn::Zero(df);
+  VF sum2 = hn::Zero(df);
+  VF sum3 = hn::Zero(df);
+
+  size_t i = 0;
+  // Main loop: unrolled
+  for (; i + 4 * NF <= num_elements; /* i += 4 * NF */) {  // incr in loop
+    sum0 = hn::MulAdd(hn::LoadU(df, v1 + i),
+                      hn::PromoteTo(df, hn::LoadU(dh, v2 + i)), sum0);
+    i += NF;
+    sum1 = hn::MulAdd(hn::LoadU(df, v1 + i),
+                      hn::PromoteTo(df, hn::LoadU(dh, v2 + i)), sum1);
+    i += NF;
+    sum2 = hn::MulAdd(hn::LoadU(df, v1 + i),
+                      hn::PromoteTo(df, hn::LoadU(dh, v2 + i)), sum2);
+    i += NF;
+    sum3 = hn::MulAdd(hn::LoadU(df, v1 + i),
+                      hn::PromoteTo(df, hn::LoadU(dh, v2 + i)), sum3);
+    i += NF;
+  }
+
+  // Up to 3 iterations of whole vectors
+  for (; i + NF <= num_elements; i += NF) {
+    sum0 = hn::MulAdd(hn::LoadU(df, v1 + i),
+                      hn::PromoteTo(df, hn::LoadU(dh, v2 + i)), sum0);
+  }
+
+  // Reduction tree: sum of all accumulators by pairs, then across lanes.
+  sum0 = hn::Add(sum0, sum1);
+  sum2 = hn::Add(sum2, sum3);
+  sum0 = hn::Add(sum0, sum2);
+  return hn::ReduceSum(df, sum0);
+}
+
+template <class D, typename T1 = hn::TFromD<D>, typename T2 = T1>
+static float InnerProductImpl(const D d, const T1* v1, const T2* v2,
                               size_t num_elements) {
   const size_t N = hn::Lanes(d);
 
@@ -275,8 +336,10 @@ static float InnerProductImpl(const D d, const T* v1, const T* v2,
   }
 }
 
+// Promotes both halves of each bf16 vector to f32 before subtracting, so the
+// difference is exact.
 template <class D, HWY_IF_BF16_D(D)>
-static float L2DistanceSquaredImplVectorized(
+static float L2DistanceSquaredPromoteBF16(
     const D d, const hwy::bfloat16_t* HWY_RESTRICT v1,
     const hwy::bfloat16_t* HWY_RESTRICT v2, size_t num_elements) {
   const hn::Repartition<float, D> df32;
@@ -341,6 +404,84 @@ static float L2DistanceSquaredImplVectorized(
   return hwy::ConvertScalarTo<float>(hn::ReduceSum(df32, sum0));
 }
 
+#if HWY_NATIVE_DOT_BF16
+// Below this ratio of |a - b|^2 to a.a + b.b, the expanded form of
+// L2DistanceSquaredDotBF16 can lose more than a few bits to cancellation.
+static constexpr float kMinDotBF16L2ToNormsRatio = 1.0f / 64;
+
+// On targets with native bf16 dot instructions(AVX512-BF16, AVX10, SVE/NEON
+// BF16), |a - b|^2 = a.a + b.b - 2 * a.b costs 3 ReorderWidenMulAccumulate per
+// vector, versus 4 promotions, 2 Subs and 2 MulAdds for
+// L2DistanceSquaredPromoteBF16. The expansion cancels when a and b are close
+// relative to their norms, so those pairs fall back to the exact kernel and
+// cost both. As near neighbors dominate graph search, this is not the default:
+// it is only offered to the autotuner, see
+// GetDotL2DistanceSquaredBF16FuncVariants.
+template <class D, HWY_IF_BF16_D(D)>
+static float L2DistanceSquaredDotBF16(const D d,
+                                      const hwy::bfloat16_t* HWY_RESTRICT v1,
+                                      const hwy::bfloat16_t* HWY_RESTRICT v2,
+                                      size_t num_elements) {
+  const hn::Repartition<float, D> df32;
+
+  using V = decltype(hn::Zero(df32));
+  const size_t N = hn::Lanes(d);
+  HWY_DASSERT(num_elements >= N && num_elements % N == 0);
+
+  // ReorderWidenMulAccumulate needs a pair of sums per accumulator. Norms of
+  // both vectors share one accumulator.
+  V norms0 = hn::Zero(df32), norms1 = hn::Zero(df32);
+  V norms2 = hn::Zero(df32), norms3 = hn::Zero(df32);
+  V dot0 = hn::Zero(df32), dot1 = hn::Zero(df32);
+  V dot2 = hn::Zero(df32), dot3 = hn::Zero(df32);
+
+  size_t i = 0;
+  // Main loop: unrolled
+  for (; i + 2 * N <= num_elements; /* i += 2 * N */) {  // incr in loop
+    const auto a0 = hn::LoadU(d, v1 + i);
+    const auto b0 = hn::LoadU(d, v2 + i);
+    i += N;
+    norms0 = hn::ReorderWidenMulAccumulate(df32, a0, a0, norms0, norms1);
+    dot0 = hn::ReorderWidenMulAccumulate(df32, a0, b0, dot0, dot1);
+    const auto a1 = hn::LoadU(d, v1 + i);
+    const auto b1 = hn::LoadU(d, v2 + i);
+    i += N;
+    norms2 = hn::ReorderWidenMulAccumulate(df32, a1, a1, norms2, norms3);
+    dot2 = hn::ReorderWidenMulAccumulate(df32, a1, b1, dot2, dot3);
+    norms0 = hn::ReorderWidenMulAccumulate(df32, b0, b0, norms0, norms1);
+    norms2 = hn::ReorderWidenMulAccumulate(df32, b1, b1, norms2, norms3);
+  }
+
+  // Possibly one more iteration of whole vectors
+  if (i + N <= num_elements) {
+    const auto a0 = hn::LoadU(d, v1 + i);
+    const auto b0 = hn::LoadU(d, v2 + i);
+    i += N;
+    norms0 = hn::ReorderWidenMulAccumulate(df32, a0, a0, norms0, norms1);
+    norms2 = hn::ReorderWidenMulAccumulate(df32, b0, b0, norms2, norms3);
+    dot0 = hn::ReorderWidenMulAccumulate(df32, a0, b0, dot0, dot1);
+  }
+
+  // Reduction tree: sum of all accumulators by pairs, then across lanes.
+  const float norms = hn::ReduceSum(
+      df32, hn::Add(hn::Add(norms0, norms1), hn::Add(norms2, norms3)));
+  const float dot =
+      hn::ReduceSum(df32, hn::Add(hn::Add(dot0, dot1), hn::Add(dot2, dot3)));
+  const float result = norms - 2.0f * dot;
+  if (HWY_UNLIKELY(result < norms * kMinDotBF16L2ToNormsRatio)) {
+    return L2DistanceSquaredPromoteBF16(d, v1, v2, num_elements);
+  }
+  return result;
+}
+#endif  // HWY_NATIVE_DOT_BF16
+
+template <class D, HWY_IF_BF16_D(D)>
+static float L2DistanceSquaredImplVectorized(
+    const D d, const hwy::bfloat16_t* HWY_RESTRICT v1,
+    const hwy::bfloat16_t* HWY_RESTRICT v2, size_t num_elements) {
+  return L2DistanceSquaredPromoteBF16(d, v1, v2, num_elements);
+}
+
 // When float16 is not natively supported, we need to promote to f32 for
 // Sub/MulAdd. When HWY_HAVE_FLOAT16 is true, the generic
 // L2DistanceSquaredImplVectorized above (which uses Sub+MulAdd on float16_t
@@ -476,6 +617,59 @@ static float L2DistanceSquaredImplVectorized(
   return hwy::ConvertScalarTo<float>(hn::ReduceSum(df, sum0));
 }
 
+// Mixed precision squared L2 distance, see the mixed precision
+// InnerProductImplVectorized. The f32 x bf16 overload above is preferred for
+// bf16.
+template <class D, typename H, HWY_IF_F32_D(D), HWY_IF_SPECIAL_FLOAT(H)>
+static float L2DistanceSquaredImplVectorized(const D df,
+                                             const float* HWY_RESTRICT v1,
+                                             const H* HWY_RESTRICT v2,
+                                             size_t num_elements) {
+  const hn::Rebind<H, D> dh;
+  using VF = hn::Vec<D>;
+  const size_t NF = hn::Lanes(df);
+  HWY_DASSERT(num_elements >= NF && num_elements % NF == 0);
+
+  VF sum0 = hn::Zero(df);
+  VF sum1 = hn::Zero(df);
+  VF sum2 = hn::Zero(df);
+  VF sum3 = hn::Zero(df);
+
+  size_t i = 0;
+  // Main loop: unrolled
+  for (; i + 4 * NF <= num_elements; /* i += 4 * NF */) {  // incr in loop
+    const VF diff0 = hn::Sub(hn::LoadU(df, v1 + i),
+                             hn::PromoteTo(df, hn::LoadU(dh, v2 + i)));
+    i += NF;
+    sum0 = hn::MulAdd(diff0, diff0, sum0);
+    const VF diff1 = hn::Sub(hn::LoadU(df, v1 + i),
+                             hn::PromoteTo(df, hn::LoadU(dh, v2 + i)));
+    i += NF;
+    sum1 = hn::MulAdd(diff1, diff1, sum1);
+    const VF diff2 = hn::Sub(hn::LoadU(df, v1 + i),
+                             hn::PromoteTo(df, hn::LoadU(dh, v2 + i)));
+    i += NF;
+    sum2 = hn::MulAdd(diff2, diff2, sum2);
+    const VF diff3 = hn::Sub(hn::LoadU(df, v1 + i),
+                             hn::PromoteTo(df, hn::LoadU(dh, v2 + i)));
+    i += NF;
+    sum3 = hn::MulAdd(diff3, diff3, sum3);
+  }
+
+  // Up to 3 iterations of whole vectors
+  for (; i + NF <= num_elements; i += NF) {
+    const VF diff = hn::Sub(hn::LoadU(df, v1 + i),
+                            hn::PromoteTo(df, hn::LoadU(dh, v2 + i)));
+    sum0 = hn::MulAdd(diff, diff, sum0);
+  }
+  // Reduction tree: sum of all accumulators by pairs, then across lanes.
+  sum0 = hn::Add(sum0, sum1);
+  sum2 = hn::Add(sum2, sum3);
+  sum0 = hn::Add(sum0, sum2);
+
+  return hn::ReduceSum(df, sum0);
+}
+
 template <class D, typename T = hn::TFromD<D>>
 static float L2DistanceSquaredImplVectorized(const D d,
                                              const T* HWY_RESTRICT v1,
@@ -635,146 +829,1660 @@ static void NormalizeImpl(const D d, hwy::float16_t* HWY_RESTRICT inout,
 }
 #endif  // !HWY_HAVE_FLOAT16
 
-template <class HalfFloat, HWY_IF_SPECIAL_FLOAT(HalfFloat)>
-static void QuantizeF32ToHalf(const float* HWY_RESTRICT in,
-                              HalfFloat* HWY_RESTRICT out, size_t size) {
-  static_assert(sizeof(float) / sizeof(HalfFloat) == 2,
-                "HalfFloat must be 16-bit");
-  const hn::ScalableTag<float> df32;
-  // f16 here refers to the 16-bit floating point type, including float16_t and
-  // bfloat16_t
-  const hn::Repartition<HalfFloat, decltype(df32)> df16;
-  const size_t NF = hn::Lanes(df32);
-  using VF = hn::Vec<decltype(df32)>;
-  using VBF = hn::Vec<decltype(df16)>;
-  const hn::Half<decltype(df16)> df16h;
-  constexpr bool is_bfloat16 = std::is_same<HalfFloat, hwy::bfloat16_t>::value;
+// int8 kernels widen each half of an int8 vector to int16 and let
+// WidenMulPairwiseAdd (pmaddwd on x86, smull+sadalp on arm) multiply and
+// accumulate adjacent pairs into int32 lanes. Quantized values are clamped to
+// [-127, 127], so neither the int16 products nor the int16 differences can
+// overflow.
+template <class D, HWY_IF_I8_D(D)>
+static int32_t InnerProductImplVectorized(const D d, const int8_t* v1,
+                                          const int8_t* v2,
+                                          size_t num_elements) {
+  const hn::RepartitionToWide<D> di16;
+  const hn::RepartitionToWide<decltype(di16)> di32;
+  using V = hn::Vec<decltype(di32)>;
+  const size_t N = hn::Lanes(d);
+  HWY_DASSERT(num_elements >= N && num_elements % N == 0);
+
+  V sum0 = hn::Zero(di32);
+  V sum1 = hn::Zero(di32);
+  V sum2 = hn::Zero(di32);
+  V sum3 = hn::Zero(di32);
 
   size_t i = 0;
-  if (size >= 2 * NF) {
-    for (; i <= size - 2 * NF; i += 2 * NF) {
-      const VF v0 = hn::LoadU(df32, in + i);
-      const VF v1 = hn::LoadU(df32, in + i + NF);
-      if constexpr (is_bfloat16) {
-        const VBF bf = hn::OrderedDemote2To(df16, v0, v1);
-        hn::StoreU(bf, df16, out + i);
-      } else {
-        static_assert(std::is_same<HalfFloat, hwy::float16_t>::value,
-                      "Unsupported HalfFloat type");
-        // todo: use OrderedDemote2To once it's implemented for float16_t
-        const VBF bf =
-            hn::Combine(df16, hn::DemoteTo(df16h, v1), hn::DemoteTo(df16h, v0));
-        hn::StoreU(bf, df16, out + i);
-      }
-    }
+  // Main loop: unrolled
+  for (; i + 2 * N <= num_elements; /* i += 2 * N */) {  // incr in loop
+    const auto a0 = hn::LoadU(d, v1 + i);
+    const auto b0 = hn::LoadU(d, v2 + i);
+    i += N;
+    sum0 = hn::Add(sum0, hn::WidenMulPairwiseAdd(
+                             di32, hn::PromoteLowerTo(di16, a0),
+                             hn::PromoteLowerTo(di16, b0)));
+    sum1 = hn::Add(sum1, hn::WidenMulPairwiseAdd(
+                             di32, hn::PromoteUpperTo(di16, a0),
+                             hn::PromoteUpperTo(di16, b0)));
+    const auto a1 = hn::LoadU(d, v1 + i);
+    const auto b1 = hn::LoadU(d, v2 + i);
+    i += N;
+    sum2 = hn::Add(sum2, hn::WidenMulPairwiseAdd(
+                             di32, hn::PromoteLowerTo(di16, a1),
+                             hn::PromoteLowerTo(di16, b1)));
+    sum3 = hn::Add(sum3, hn::WidenMulPairwiseAdd(
+                             di32, hn::PromoteUpperTo(di16, a1),
+                             hn::PromoteUpperTo(di16, b1)));
   }
-  if (size - i >= NF) {
-    const VF v0 = hn::LoadU(df32, in + i);
-    const hn::Vec<decltype(df16h)> bfh = hn::DemoteTo(df16h, v0);
-    hn::StoreU(bfh, df16h, out + i);
-    i += NF;
+
+  // Possibly one more iteration of whole vectors
+  if (i + N <= num_elements) {
+    const auto a0 = hn::LoadU(d, v1 + i);
+    const auto b0 = hn::LoadU(d, v2 + i);
+    i += N;
+    sum0 = hn::Add(sum0, hn::WidenMulPairwiseAdd(
+                             di32, hn::PromoteLowerTo(di16, a0),
+                             hn::PromoteLowerTo(di16, b0)));
+    sum1 = hn::Add(sum1, hn::WidenMulPairwiseAdd(
+                             di32, hn::PromoteUpperTo(di16, a0),
+                             hn::PromoteUpperTo(di16, b0)));
   }
 
-  if (i != size) {
-    const size_t remaining = size - i;
-    const VF v0 = hn::LoadN(df32, in + i, remaining);
-    const hn::Vec<decltype(df16h)> bfh = hn::DemoteTo(df16h, v0);
-    hn::StoreN(bfh, df16h, out + i, remaining);
+  // Reduction tree: sum of all accumulators by pairs, then across lanes.
+  sum0 = hn::Add(sum0, sum1);
+  sum2 = hn::Add(sum2, sum3);
+  sum0 = hn::Add(sum0, sum2);
+  return hn::ReduceSum(di32, sum0);
+}
+
+template <class D, HWY_IF_I8_D(D)>
+static int32_t InnerProductImpl(const D d, const int8_t* v1, const int8_t* v2,
+                                size_t num_elements) {
+  const size_t N = hn::Lanes(d);
+  const size_t leftover = num_elements % N;
+
+  int32_t result = 0;
+  if (num_elements >= N) {
+    result = InnerProductImplVectorized(d, v1, v2, num_elements - leftover);
+  }
+
+  for (size_t i = num_elements - leftover; i < num_elements; ++i) {
+    result += static_cast<int32_t>(v1[i]) * static_cast<int32_t>(v2[i]);
   }
+  return result;
 }
 
-template <class HalfFloat, HWY_IF_SPECIAL_FLOAT(HalfFloat)>
-static void HalfFloatToF32(const HalfFloat* HWY_RESTRICT in,
-                           float* HWY_RESTRICT out, size_t size) {
-  static_assert(sizeof(float) / sizeof(HalfFloat) == 2,
-                "HalfFloat must be 16-bit");
-  const hn::ScalableTag<float> df32;
-  // f16 here refers to the 16-bit floating point type, including float16_t and
-  // bfloat16_t
-  const hn::Repartition<HalfFloat, decltype(df32)> df16;
-  const size_t NF = hn::Lanes(df32);
-  using VF = hn::Vec<decltype(df32)>;
-  using VBF = hn::Vec<decltype(df16)>;
-  const hn::Half<decltype(df16)> df16h;
+template <class D, HWY_IF_I8_D(D)>
+static int32_t L2DistanceSquaredImplVectorized(const D d, const int8_t* v1,
+                                               const int8_t* v2,
+                                               size_t num_elements) {
+  const hn::RepartitionToWide<D> di16;
+  const hn::RepartitionToWide<decltype(di16)> di32;
+  using V = hn::Vec<decltype(di32)>;
+  const size_t N = hn::Lanes(d);
+  HWY_DASSERT(num_elements >= N && num_elements % N == 0);
+
+  V sum0 = hn::Zero(di32);
+  V sum1 = hn::Zero(di32);
+  V sum2 = hn::Zero(di32);
+  V sum3 = hn::Zero(di32);
 
   size_t i = 0;
-  if (size >= 2 * NF) {
-    for (; i <= size - 2 * NF; i += 2 * NF) {
-      const auto v0 = hn::LoadU(df16h, in + i);
-      const auto v1 = hn::LoadU(df16h, in + i + NF);
-      hn::StoreU(hn::PromoteTo(df32, v0), df32, out + i);
-      hn::StoreU(hn::PromoteTo(df32, v1), df32, out + i + NF);
-    }
-  }
-  if (size - i >= NF) {
-    const auto v = hn::LoadU(df16h, in + i);
-    hn::StoreU(hn::PromoteTo(df32, v), df32, out + i);
-    i += NF;
+  // Main loop: unrolled
+  for (; i + 2 * N <= num_elements; /* i += 2 * N */) {  // incr in loop
+    const auto a0 = hn::LoadU(d, v1 + i);
+    const auto b0 = hn::LoadU(d, v2 + i);
+    i += N;
+    const auto diff0_lower =
+        hn::Sub(hn::PromoteLowerTo(di16, a0), hn::PromoteLowerTo(di16, b0));
+    const auto diff0_upper =
+        hn::Sub(hn::PromoteUpperTo(di16, a0), hn::PromoteUpperTo(di16, b0));
+    sum0 = hn::Add(sum0, hn::WidenMulPairwiseAdd(di32, diff0_lower,
+                                                 diff0_lower));
+    sum1 = hn::Add(sum1, hn::WidenMulPairwiseAdd(di32, diff0_upper,
+                                                 diff0_upper));
+    const auto a1 = hn::LoadU(d, v1 + i);
+    const auto b1 = hn::LoadU(d, v2 + i);
+    i += N;
+    const auto diff1_lower =
+        hn::Sub(hn::PromoteLowerTo(di16, a1), hn::PromoteLowerTo(di16, b1));
+    const auto diff1_upper =
+        hn::Sub(hn::PromoteUpperTo(di16, a1), hn::PromoteUpperTo(di16, b1));
+    sum2 = hn::Add(sum2, hn::WidenMulPairwiseAdd(di32, diff1_lower,
+                                                 diff1_lower));
+    sum3 = hn::Add(sum3, hn::WidenMulPairwiseAdd(di32, diff1_upper,
+                                                 diff1_upper));
   }
 
-  if (i != size) {
-    const size_t remaining = size - i;
-    const auto v = hn::LoadN(df16h, in + i, remaining);
-    hn::StoreN(hn::PromoteTo(df32, v), df32, out + i, remaining);
+  // Possibly one more iteration of whole vectors
+  if (i + N <= num_elements) {
+    const auto a0 = hn::LoadU(d, v1 + i);
+    const auto b0 = hn::LoadU(d, v2 + i);
+    i += N;
+    const auto diff0_lower =
+        hn::Sub(hn::PromoteLowerTo(di16, a0), hn::PromoteLowerTo(di16, b0));
+    const auto diff0_upper =
+        hn::Sub(hn::PromoteUpperTo(di16, a0), hn::PromoteUpperTo(di16, b0));
+    sum0 = hn::Add(sum0, hn::WidenMulPairwiseAdd(di32, diff0_lower,
+                                                 diff0_lower));
+    sum1 = hn::Add(sum1, hn::WidenMulPairwiseAdd(di32, diff0_upper,
+                                                 diff0_upper));
   }
-}
 
-static void QuantizeF32ToBF16Impl(const float* HWY_RESTRICT in,
-                                  hwy::bfloat16_t* HWY_RESTRICT out,
-                                  size_t size) {
-  QuantizeF32ToHalf(in, out, size);
+  // Reduction tree: sum of all accumulators by pairs, then across lanes.
+  sum0 = hn::Add(sum0, sum1);
+  sum2 = hn::Add(sum2, sum3);
+  sum0 = hn::Add(sum0, sum2);
+  return hn::ReduceSum(di32, sum0);
 }
 
-static void QuantizeF32ToF16Impl(const float* HWY_RESTRICT in,
-                                 hwy::float16_t* HWY_RESTRICT out,
-                                 size_t size) {
-  QuantizeF32ToHalf(in, out, size);
-}
+template <class D, HWY_IF_I8_D(D)>
+static int32_t L2DistanceSquaredImpl(const D d, const int8_t* v1,
+                                     const int8_t* v2, size_t num_elements) {
+  const size_t N = hn::Lanes(d);
+  const size_t leftover = num_elements % N;
 
-static float InnerProductImplF32(const float* v1, const float* v2,
-                                 size_t num_elements) {
-  return InnerProductImpl(hn::ScalableTag<float>(), v1, v2, num_elements);
-}
+  int32_t result = 0;
+  if (num_elements >= N) {
+    result =
+        L2DistanceSquaredImplVectorized(d, v1, v2, num_elements - leftover);
+  }
 
-static float InnerProductImplBF16(const hwy::bfloat16_t* v1,
-                                  const hwy::bfloat16_t* v2,
-                                  size_t num_elements) {
-  return InnerProductImpl(hn::ScalableTag<hwy::bfloat16_t>(), v1, v2,
-                          num_elements);
+  for (size_t i = num_elements - leftover; i < num_elements; ++i) {
+    const int32_t diff =
+        static_cast<int32_t>(v1[i]) - static_cast<int32_t>(v2[i]);
+    result += diff * diff;
+  }
+  return result;
 }
 
-static float InnerProductImplF16(const hwy::float16_t* v1,
-                                 const hwy::float16_t* v2,
-                                 size_t num_elements) {
-  return InnerProductImpl(hn::ScalableTag<hwy::float16_t>(), v1, v2,
-                          num_elements);
+// Row accessors for the batch kernels below.
+template <typename T>
+struct ContiguousRows {
+  const T* vectors;
+  size_t num_elements;
+  const T* operator()(size_t j) const { return vectors + j * num_elements; }
+};
+
+template <typename T>
+struct PointerRows {
+  const T* const* vectors;
+  const T* operator()(size_t j) const { return vectors[j]; }
+};
+
+// Batch kernels score one query against many rows with a single dynamic
+// dispatch. `row_at(j)` returns a pointer to the j-th row, see ContiguousRows
+// and PointerRows.
+template <class D, typename T, class RowAt, typename R>
+static void InnerProductBatchImpl(const D d, const T* query, RowAt row_at,
+                                  size_t num_vectors, size_t num_elements,
+                                  R* HWY_RESTRICT out) {
+  for (size_t j = 0; j < num_vectors; ++j) {
+    out[j] = InnerProductImpl(d, query, row_at(j), num_elements);
+  }
 }
 
-static float L2DistanceSquaredImplF32(const float* v1, const float* v2,
-                                      size_t num_elements) {
-  return L2DistanceSquaredImpl(hn::ScalableTag<float>(), v1, v2, num_elements);
+template <class D, typename T, class RowAt, typename R>
+static void L2DistanceSquaredBatchImpl(const D d, const T* query, RowAt row_at,
+                                       size_t num_vectors, size_t num_elements,
+                                       R* HWY_RESTRICT out) {
+  for (size_t j = 0; j < num_vectors; ++j) {
+    const T* row = row_at(j);
+    out[j] = HWY_UNLIKELY(row == query)
+                 ? R{0}
+                 : L2DistanceSquaredImpl(d, query, row, num_elements);
+  }
 }
 
-static float L2DistanceSquaredImplBF16(const hwy::bfloat16_t* v1,
-                                       const hwy::bfloat16_t* v2,
-                                       size_t num_elements) {
-  return L2DistanceSquaredImpl(hn::ScalableTag<hwy::bfloat16_t>(), v1, v2,
+// For f32, rows are scored 4 at a time so that each chunk of the query is
+// loaded once and reused from a register for all 4 rows.
+template <class D, class RowAt, HWY_IF_F32_D(D)>
+static void InnerProductBatchImpl(const D d, const float* query, RowAt row_at,
+                                  size_t num_vectors, size_t num_elements,
+                                  float* HWY_RESTRICT out) {
+  using V = hn::Vec<D>;
+  const size_t N = hn::Lanes(d);
+
+  size_t j = 0;
+  for (; j + 4 <= num_vectors; j += 4) {
+    const float* r0 = row_at(j);
+    const float* r1 = row_at(j + 1);
+    const float* r2 = row_at(j + 2);
+    const float* r3 = row_at(j + 3);
+    V sum0 = hn::Zero(d);
+    V sum1 = hn::Zero(d);
+    V sum2 = hn::Zero(d);
+    V sum3 = hn::Zero(d);
+
+    size_t i = 0;
+    for (; i + N <= num_elements; i += N) {
+      const V q = hn::LoadU(d, query + i);
+      sum0 = hn::MulAdd(q, hn::LoadU(d, r0 + i), sum0);
+      sum1 = hn::MulAdd(q, hn::LoadU(d, r1 + i), sum1);
+      sum2 = hn::MulAdd(q, hn::LoadU(d, r2 + i), sum2);
+      sum3 = hn::MulAdd(q, hn::LoadU(d, r3 + i), sum3);
+    }
+
+    // LoadN zeroes the lanes past `remaining`, which contribute nothing.
+    if (i != num_elements) {
+      const size_t remaining = num_elements - i;
+      const V q = hn::LoadN(d, query + i, remaining);
+      sum0 = hn::MulAdd(q, hn::LoadN(d, r0 + i, remaining), sum0);
+      sum1 = hn::MulAdd(q, hn::LoadN(d, r1 + i, remaining), sum1);
+      sum2 = hn::MulAdd(q, hn::LoadN(d, r2 + i, remaining), sum2);
+      sum3 = hn::MulAdd(q, hn::LoadN(d, r3 + i, remaining), sum3);
+    }
+
+    out[j] = hn::ReduceSum(d, sum0);
+    out[j + 1] = hn::ReduceSum(d, sum1);
+    out[j + 2] = hn::ReduceSum(d, sum2);
+    out[j + 3] = hn::ReduceSum(d, sum3);
+  }
+
+  for (; j < num_vectors; ++j) {
+    out[j] = InnerProductImpl(d, query, row_at(j), num_elements);
+  }
+}
+
+template <class D, class RowAt, HWY_IF_F32_D(D)>
+static void L2DistanceSquaredBatchImpl(const D d, const float* query,
+                                       RowAt row_at, size_t num_vectors,
+                                       size_t num_elements,
+                                       float* HWY_RESTRICT out) {
+  using V = hn::Vec<D>;
+  const size_t N = hn::Lanes(d);
+
+  size_t j = 0;
+  for (; j + 4 <= num_vectors; j += 4) {
+    const float* r0 = row_at(j);
+    const float* r1 = row_at(j + 1);
+    const float* r2 = row_at(j + 2);
+    const float* r3 = row_at(j + 3);
+    V sum0 = hn::Zero(d);
+    V sum1 = hn::Zero(d);
+    V sum2 = hn::Zero(d);
+    V sum3 = hn::Zero(d);
+
+    size_t i = 0;
+    for (; i + N <= num_elements; i += N) {
+      const V q = hn::LoadU(d, query + i);
+      const V diff0 = hn::Sub(q, hn::LoadU(d, r0 + i));
+      sum0 = hn::MulAdd(diff0, diff0, sum0);
+      const V diff1 = hn::Sub(q, hn::LoadU(d, r1 + i));
+      sum1 = hn::MulAdd(diff1, diff1, sum1);
+      const V diff2 = hn::Sub(q, hn::LoadU(d, r2 + i));
+      sum2 = hn::MulAdd(diff2, diff2, sum2);
+      const V diff3 = hn::Sub(q, hn::LoadU(d, r3 + i));
+      sum3 = hn::MulAdd(diff3, diff3, sum3);
+    }
+
+    // LoadN zeroes the lanes past `remaining`, so their differences are 0.
+    if (i != num_elements) {
+      const size_t remaining = num_elements - i;
+      const V q = hn::LoadN(d, query + i, remaining);
+      const V diff0 = hn::Sub(q, hn::LoadN(d, r0 + i, remaining));
+      sum0 = hn::MulAdd(diff0, diff0, sum0);
+      const V diff1 = hn::Sub(q, hn::LoadN(d, r1 + i, remaining));
+      sum1 = hn::MulAdd(diff1, diff1, sum1);
+      const V diff2 = hn::Sub(q, hn::LoadN(d, r2 + i, remaining));
+      sum2 = hn::MulAdd(diff2, diff2, sum2);
+      const V diff3 = hn::Sub(q, hn::LoadN(d, r3 + i, remaining));
+      sum3 = hn::MulAdd(diff3, diff3, sum3);
+    }
+
+    out[j] = hn::ReduceSum(d, sum0);
+    out[j + 1] = hn::ReduceSum(d, sum1);
+    out[j + 2] = hn::ReduceSum(d, sum2);
+    out[j + 3] = hn::ReduceSum(d, sum3);
+  }
+
+  for (; j < num_vectors; ++j) {
+    const float* row = row_at(j);
+    out[j] = HWY_UNLIKELY(row == query)
+                 ? 0.0f
+                 : L2DistanceSquaredImpl(d, query, row, num_elements);
+  }
+}
+
+// Scores 4 consecutive queries against 2 consecutive vectors. Every chunk
+// loaded from the 6 rows feeds 2 or 4 of the 8 accumulators, versus 1 load per
+// multiply-add for a single pair. out[r * out_stride + c] receives the inner
+// product of query r and vector c.
+template <class D, HWY_IF_F32_D(D)>
+static HWY_INLINE void InnerProductTile4x2(const D d,
+                                           const float* HWY_RESTRICT queries,
+                                           const float* HWY_RESTRICT vectors,
+                                           size_t num_elements,
+                                           float* HWY_RESTRICT out,
+                                           size_t out_stride) {
+  using V = hn::Vec<D>;
+  const size_t N = hn::Lanes(d);
+  const float* q0 = queries;
+  const float* q1 = queries + num_elements;
+  const float* q2 = queries + 2 * num_elements;
+  const float* q3 = queries + 3 * num_elements;
+  const float* v0 = vectors;
+  const float* v1 = vectors + num_elements;
+  V sum00 = hn::Zero(d), sum01 = hn::Zero(d);
+  V sum10 = hn::Zero(d), sum11 = hn::Zero(d);
+  V sum20 = hn::Zero(d), sum21 = hn::Zero(d);
+  V sum30 = hn::Zero(d), sum31 = hn::Zero(d);
+
+  // Chunks of the 2 vectors come first, then chunks of the 4 queries.
+  auto accumulate = [&](const V c0, const V c1, const V r0, const V r1,
+                        const V r2, const V r3) HWY_ATTR {
+    sum00 = hn::MulAdd(r0, c0, sum00);
+    sum01 = hn::MulAdd(r0, c1, sum01);
+    sum10 = hn::MulAdd(r1, c0, sum10);
+    sum11 = hn::MulAdd(r1, c1, sum11);
+    sum20 = hn::MulAdd(r2, c0, sum20);
+    sum21 = hn::MulAdd(r2, c1, sum21);
+    sum30 = hn::MulAdd(r3, c0, sum30);
+    sum31 = hn::MulAdd(r3, c1, sum31);
+  };
+
+  size_t i = 0;
+  for (; i + N <= num_elements; i += N) {
+    accumulate(hn::LoadU(d, v0 + i), hn::LoadU(d, v1 + i),
+               hn::LoadU(d, q0 + i), hn::LoadU(d, q1 + i),
+               hn::LoadU(d, q2 + i), hn::LoadU(d, q3 + i));
+  }
+
+  // LoadN zeroes the lanes past `remaining`, which contribute nothing.
+  if (i != num_elements) {
+    const size_t remaining = num_elements - i;
+    accumulate(hn::LoadN(d, v0 + i, remaining), hn::LoadN(d, v1 + i, remaining),
+               hn::LoadN(d, q0 + i, remaining), hn::LoadN(d, q1 + i, remaining),
+               hn::LoadN(d, q2 + i, remaining),
+               hn::LoadN(d, q3 + i, remaining));
+  }
+
+  out[0] = hn::ReduceSum(d, sum00);
+  out[1] = hn::ReduceSum(d, sum01);
+  out[out_stride] = hn::ReduceSum(d, sum10);
+  out[out_stride + 1] = hn::ReduceSum(d, sum11);
+  out[2 * out_stride] = hn::ReduceSum(d, sum20);
+  out[2 * out_stride + 1] = hn::ReduceSum(d, sum21);
+  out[3 * out_stride] = hn::ReduceSum(d, sum30);
+  out[3 * out_stride + 1] = hn::ReduceSum(d, sum31);
+}
+
+// Vectors are scored in blocks of about this size, so that a block stays in
+// cache while every query tile is scored against it.
+static constexpr size_t kDistanceMatrixBlockBytes = 256 * 1024;
+
+// out[i * num_vectors + j] receives the inner product of the i-th query and the
+// j-th vector. Queries and vectors are stored contiguously.
+template <class D, HWY_IF_F32_D(D)>
+static void InnerProductMatrixImpl(const D d, const float* queries,
+                                   size_t num_queries, const float* vectors,
+                                   size_t num_vectors, size_t num_elements,
+                                   float* HWY_RESTRICT out) {
+  const size_t row_bytes = std::max<size_t>(num_elements, 1) * sizeof(float);
+  const size_t block_size =
+      std::max<size_t>(kDistanceMatrixBlockBytes / row_bytes / 2 * 2, 2);
+
+  for (size_t block = 0; block < num_vectors; block += block_size) {
+    const size_t block_end = std::min(num_vectors, block + block_size);
+    size_t i = 0;
+    for (; i + 4 <= num_queries; i += 4) {
+      const float* query = queries + i * num_elements;
+      float* out_row = out + i * num_vectors;
+      size_t j = block;
+      for (; j + 2 <= block_end; j += 2) {
+        InnerProductTile4x2(d, query, vectors + j * num_elements, num_elements,
+                            out_row + j, num_vectors);
+      }
+      for (; j < block_end; ++j) {
+        for (size_t r = 0; r < 4; ++r) {
+          out_row[r * num_vectors + j] =
+              InnerProductImpl(d, query + r * num_elements,
+                               vectors + j * num_elements, num_elements);
+        }
+      }
+    }
+
+    // Fewer than 4 queries are left, score them 1x4 with the batch kernel.
+    for (; i < num_queries; ++i) {
+      InnerProductBatchImpl(
+          d, queries + i * num_elements,
+          ContiguousRows<float>{vectors + block * num_elements, num_elements},
+          block_end - block, num_elements, out + i * num_vectors + block);
+    }
+  }
+}
+
+// Kernels for a compile-time number of elements. Lanes are capped at 16, so 4
+// accumulators consume at most 64 elements per iteration and every fixed
+// dimension is a whole number of iterations: no remainder handling is needed
+// and the trip count is known to the compiler.
+template <size_t kNumElements>
+static float InnerProductFixedDimImplF32(const float* v1, const float* v2) {
+  static_assert(kNumElements % 64 == 0,
+                "fixed dimensions must be multiples of 64");
+  const hn::CappedTag<float, 16> d;
+  using V = hn::Vec<decltype(d)>;
+  const size_t N = hn::Lanes(d);
+
+  V sum0 = hn::Zero(d);
+  V sum1 = hn::Zero(d);
+  V sum2 = hn::Zero(d);
+  V sum3 = hn::Zero(d);
+  for (size_t i = 0; i < kNumElements; i += 4 * N) {
+    sum0 = hn::MulAdd(hn::LoadU(d, v1 + i), hn::LoadU(d, v2 + i), sum0);
+    sum1 = hn::MulAdd(hn::LoadU(d, v1 + i + N), hn::LoadU(d, v2 + i + N),
+                      sum1);
+    sum2 = hn::MulAdd(hn::LoadU(d, v1 + i + 2 * N),
+                      hn::LoadU(d, v2 + i + 2 * N), sum2);
+    sum3 = hn::MulAdd(hn::LoadU(d, v1 + i + 3 * N),
+                      hn::LoadU(d, v2 + i + 3 * N), sum3);
+  }
+
+  sum0 = hn::Add(sum0, sum1);
+  sum2 = hn::Add(sum2, sum3);
+  return hn::ReduceSum(d, hn::Add(sum0, sum2));
+}
+
+template <size_t kNumElements>
+static float L2DistanceSquaredFixedDimImplF32(const float* v1,
+                                              const float* v2) {
+  static_assert(kNumElements % 64 == 0,
+                "fixed dimensions must be multiples of 64");
+  const hn::CappedTag<float, 16> d;
+  using V = hn::Vec<decltype(d)>;
+  const size_t N = hn::Lanes(d);
+
+  V sum0 = hn::Zero(d);
+  V sum1 = hn::Zero(d);
+  V sum2 = hn::Zero(d);
+  V sum3 = hn::Zero(d);
+  for (size_t i = 0; i < kNumElements; i += 4 * N) {
+    const V diff0 = hn::Sub(hn::LoadU(d, v1 + i), hn::LoadU(d, v2 + i));
+    sum0 = hn::MulAdd(diff0, diff0, sum0);
+    const V diff1 =
+        hn::Sub(hn::LoadU(d, v1 + i + N), hn::LoadU(d, v2 + i + N));
+    sum1 = hn::MulAdd(diff1, diff1, sum1);
+    const V diff2 =
+        hn::Sub(hn::LoadU(d, v1 + i + 2 * N), hn::LoadU(d, v2 + i + 2 * N));
+    sum2 = hn::MulAdd(diff2, diff2, sum2);
+    const V diff3 =
+        hn::Sub(hn::LoadU(d, v1 + i + 3 * N), hn::LoadU(d, v2 + i + 3 * N));
+    sum3 = hn::MulAdd(diff3, diff3, sum3);
+  }
+
+  sum0 = hn::Add(sum0, sum1);
+  sum2 = hn::Add(sum2, sum3);
+  return hn::ReduceSum(d, hn::Add(sum0, sum2));
+}
+
+static void QuantizeF32ToI8Impl(const float* HWY_RESTRICT in,
+                                int8_t* HWY_RESTRICT out, size_t size,
+                                float scale, float offset) {
+  const hn::ScalableTag<float> df32;
+  const hn::RebindToSigned<decltype(df32)> di32;
+  const hn::Rebind<int8_t, decltype(df32)> di8;
+  const size_t NF = hn::Lanes(df32);
+
+  const auto inv_scale = hn::Set(df32, 1.0f / scale);
+  const auto offset_vec = hn::Set(df32, offset);
+  const auto max_vec = hn::Set(di32, vectorlite::ops::kInt8Max);
+  const auto min_vec = hn::Set(di32, -vectorlite::ops::kInt8Max);
+  auto quantize = [&](hn::Vec<decltype(df32)> v) HWY_ATTR {
+    const auto q = hn::NearestInt(hn::Mul(hn::Sub(v, offset_vec), inv_scale));
+    return hn::DemoteTo(di8, hn::Min(hn::Max(q, min_vec), max_vec));
+  };
+
+  size_t i = 0;
+  for (; i + NF <= size; i += NF) {
+    hn::StoreU(quantize(hn::LoadU(df32, in + i)), di8, out + i);
+  }
+
+  if (i != size) {
+    const size_t remaining = size - i;
+    hn::StoreN(quantize(hn::LoadN(df32, in + i, remaining)), di8, out + i,
+               remaining);
+  }
+}
+
+static void I8ToF32Impl(const int8_t* HWY_RESTRICT in, float* HWY_RESTRICT out,
+                        size_t size, float scale, float offset) {
+  const hn::ScalableTag<float> df32;
+  const hn::RebindToSigned<decltype(df32)> di32;
+  const hn::Rebind<int8_t, decltype(df32)> di8;
+  const size_t NF = hn::Lanes(df32);
+
+  const auto scale_vec = hn::Set(df32, scale);
+  const auto offset_vec = hn::Set(df32, offset);
+  auto dequantize = [&](hn::Vec<decltype(di8)> v) HWY_ATTR {
+    const auto f = hn::ConvertTo(df32, hn::PromoteTo(di32, v));
+    return hn::MulAdd(f, scale_vec, offset_vec);
+  };
+
+  size_t i = 0;
+  for (; i + NF <= size; i += NF) {
+    hn::StoreU(dequantize(hn::LoadU(di8, in + i)), df32, out + i);
+  }
+
+  if (i != size) {
+    const size_t remaining = size - i;
+    hn::StoreN(dequantize(hn::LoadN(di8, in + i, remaining)), df32, out + i,
+               remaining);
+  }
+}
+
+// Number of differing bits between two bit vectors: popcount(v1 ^ v2).
+// Per-byte popcounts are widened with SumsOf8 into u64 accumulators, which
+// can't overflow.
+static uint64_t HammingDistanceImpl(const uint8_t* v1, const uint8_t* v2,
+                                    size_t num_bytes) {
+  const hn::ScalableTag<uint8_t> d;
+  const hn::Repartition<uint64_t, decltype(d)> d64;
+  const size_t N = hn::Lanes(d);
+
+  auto sum0 = hn::Zero(d64);
+  auto sum1 = hn::Zero(d64);
+
+  size_t i = 0;
+  for (; i + 2 * N <= num_bytes; i += 2 * N) {
+    const auto x0 = hn::Xor(hn::LoadU(d, v1 + i), hn::LoadU(d, v2 + i));
+    sum0 = hn::Add(sum0, hn::SumsOf8(hn::PopulationCount(x0)));
+    const auto x1 =
+        hn::Xor(hn::LoadU(d, v1 + i + N), hn::LoadU(d, v2 + i + N));
+    sum1 = hn::Add(sum1, hn::SumsOf8(hn::PopulationCount(x1)));
+  }
+
+  // LoadN zeroes the lanes past `remaining`, whose xor is 0.
+  for (; i < num_bytes; i += N) {
+    const size_t remaining = HWY_MIN(N, num_bytes - i);
+    const auto x = hn::Xor(hn::LoadN(d, v1 + i, remaining),
+                           hn::LoadN(d, v2 + i, remaining));
+    sum0 = hn::Add(sum0, hn::SumsOf8(hn::PopulationCount(x)));
+  }
+
+  return hn::ReduceSum(d64, hn::Add(sum0, sum1));
+}
+
+// HammingDistanceImpl of `query` and each of `vectors`. Like the f32 batch
+// kernels, rows are scored 4 at a time so that each chunk of the query is
+// loaded once and reused from a register for all 4 rows.
+static void HammingDistanceBatchImpl(const uint8_t* query,
+                                     const uint8_t* const* vectors,
+                                     size_t num_vectors, size_t num_bytes,
+                                     uint64_t* HWY_RESTRICT out) {
+  const hn::ScalableTag<uint8_t> d;
+  const hn::Repartition<uint64_t, decltype(d)> d64;
+  const size_t N = hn::Lanes(d);
+
+  size_t j = 0;
+  for (; j + 4 <= num_vectors; j += 4) {
+    const uint8_t* r0 = vectors[j];
+    const uint8_t* r1 = vectors[j + 1];
+    const uint8_t* r2 = vectors[j + 2];
+    const uint8_t* r3 = vectors[j + 3];
+    auto sum0 = hn::Zero(d64);
+    auto sum1 = hn::Zero(d64);
+    auto sum2 = hn::Zero(d64);
+    auto sum3 = hn::Zero(d64);
+
+    // LoadN zeroes the lanes past `remaining`, whose xor is 0.
+    for (size_t i = 0; i < num_bytes; i += N) {
+      const size_t remaining = HWY_MIN(N, num_bytes - i);
+      const auto q = hn::LoadN(d, query + i, remaining);
+      sum0 = hn::Add(sum0, hn::SumsOf8(hn::PopulationCount(hn::Xor(
+                               q, hn::LoadN(d, r0 + i, remaining)))));
+      sum1 = hn::Add(sum1, hn::SumsOf8(hn::PopulationCount(hn::Xor(
+                               q, hn::LoadN(d, r1 + i, remaining)))));
+      sum2 = hn::Add(sum2, hn::SumsOf8(hn::PopulationCount(hn::Xor(
+                               q, hn::LoadN(d, r2 + i, remaining)))));
+      sum3 = hn::Add(sum3, hn::SumsOf8(hn::PopulationCount(hn::Xor(
+                               q, hn::LoadN(d, r3 + i, remaining)))));
+    }
+
+    out[j] = hn::ReduceSum(d64, sum0);
+    out[j + 1] = hn::ReduceSum(d64, sum1);
+    out[j + 2] = hn::ReduceSum(d64, sum2);
+    out[j + 3] = hn::ReduceSum(d64, sum3);
+  }
+
+  for (; j < num_vectors; ++j) {
+    out[j] = HammingDistanceImpl(query, vectors[j], num_bytes);
+  }
+}
+
+// Product quantization fast-scan: sums the uint8 lookup table entries selected
+// by the 4-bit codes of kPQFastScanBlockSize vectors at once. Each 16-entry
+// table fits in one 128-bit block, so a byte shuffle looks up all vectors'
+// codes for a subquantizer in one instruction. Sums are widened to u16, which
+// can't overflow for up to 257 subquantizers.
+static void PQFastScanBlockImpl(const uint8_t* HWY_RESTRICT lut,
+                                const uint8_t* HWY_RESTRICT codes,
+                                size_t num_subquantizers,
+                                uint16_t* HWY_RESTRICT out) {
+  constexpr size_t kBlock = vectorlite::ops::kPQFastScanBlockSize;
+  const hn::CappedTag<uint8_t, kBlock> d8;
+  if (hn::Lanes(d8) != kBlock) {
+    // Targets narrower than 128 bits(e.g. HWY_SCALAR).
+    std::fill(out, out + kBlock, 0);
+    for (size_t j = 0; j < num_subquantizers; ++j) {
+      for (size_t i = 0; i < kBlock; ++i) {
+        out[i] += lut[j * 16 + codes[j * kBlock + i]];
+      }
+    }
+    return;
+  }
+
+  const hn::Half<decltype(d8)> d8h;
+  const hn::Rebind<uint16_t, decltype(d8h)> d16;
+  auto sum_lower = hn::Zero(d16);
+  auto sum_upper = hn::Zero(d16);
+  for (size_t j = 0; j < num_subquantizers; ++j) {
+    const auto table = hn::LoadU(d8, lut + j * 16);
+    const auto indices = hn::LoadU(d8, codes + j * kBlock);
+    const auto values = hn::TableLookupBytes(table, indices);
+    sum_lower =
+        hn::Add(sum_lower, hn::PromoteTo(d16, hn::LowerHalf(d8h, values)));
+    sum_upper =
+        hn::Add(sum_upper, hn::PromoteTo(d16, hn::UpperHalf(d8h, values)));
+  }
+  hn::StoreU(sum_lower, d16, out);
+  hn::StoreU(sum_upper, d16, out + hn::Lanes(d16));
+}
+
+// Top-k selection over a distance array. Instead of a heap, candidates go into
+// an unsorted buffer of 2k entries; when it fills up, nth_element keeps the k
+// best and their worst distance becomes the threshold. Whole vectors of
+// distances that are not below the threshold are rejected with one compare,
+// which is almost every vector once the threshold has settled.
+static size_t SelectTopKImpl(const float* HWY_RESTRICT distances, size_t num,
+                             size_t k, uint32_t* HWY_RESTRICT out) {
+  // Ordered by distance, then by index, so that ties are deterministic.
+  using Entry = std::pair<float, uint32_t>;
+  std::vector<Entry> buffer;
+  buffer.reserve(2 * HWY_MIN(k, num));
+
+  // Accept the first k comparable distances unconditionally.
+  size_t i = 0;
+  for (; i < num && buffer.size() < k; ++i) {
+    if (!std::isnan(distances[i])) {
+      buffer.emplace_back(distances[i], static_cast<uint32_t>(i));
+    }
+  }
+  if (i < num) {
+    float threshold = std::max_element(buffer.begin(), buffer.end())->first;
+    // Entries with a distance equal to the threshold have a larger index than
+    // every buffered one, so only strictly smaller distances can make it.
+    auto push = [&](size_t j) HWY_ATTR {
+      if (!(distances[j] < threshold)) {
+        return;
+      }
+      buffer.emplace_back(distances[j], static_cast<uint32_t>(j));
+      if (buffer.size() == 2 * k) {
+        std::nth_element(buffer.begin(), buffer.begin() + (k - 1),
+                         buffer.end());
+        buffer.resize(k);
+        threshold = buffer[k - 1].first;
+      }
+    };
+
+    const hn::ScalableTag<float> d;
+    const size_t N = hn::Lanes(d);
+    for (; i + N <= num; i += N) {
+      const auto v = hn::LoadU(d, distances + i);
+      if (hn::AllFalse(d, hn::Lt(v, hn::Set(d, threshold)))) {
+        continue;
+      }
+      for (size_t j = i; j < i + N; ++j) {
+        push(j);
+      }
+    }
+    for (; i < num; ++i) {
+      push(i);
+    }
+  }
+
+  const size_t num_selected = HWY_MIN(k, buffer.size());
+  std::partial_sort(buffer.begin(), buffer.begin() + num_selected,
+                    buffer.end());
+  for (size_t j = 0; j < num_selected; ++j) {
+    out[j] = buffer[j].second;
+  }
+  return num_selected;
+}
+
+// Inverse of the L2 norm of `in`, computed the same way as NormalizeImpl.
+static float InverseNormF32(const float* HWY_RESTRICT in, size_t size) {
+  const float squared_sum =
+      InnerProductImpl(hn::ScalableTag<float>(), in, in, size);
+  return 1.0f / (sqrtf(squared_sum) + 1e-30f);
+}
+
+// If kScaled is true, every element is multiplied by `multiplier` before being
+// demoted, which lets normalization and quantization share one pass.
+template <bool kScaled = false, class HalfFloat,
+          HWY_IF_SPECIAL_FLOAT(HalfFloat)>
+static void QuantizeF32ToHalf(const float* HWY_RESTRICT in,
+                              HalfFloat* HWY_RESTRICT out, size_t size,
+                              float multiplier = 1.0f) {
+  static_assert(sizeof(float) / sizeof(HalfFloat) == 2,
+                "HalfFloat must be 16-bit");
+  const hn::ScalableTag<float> df32;
+  // f16 here refers to the 16-bit floating point type, including float16_t and
+  // bfloat16_t
+  const hn::Repartition<HalfFloat, decltype(df32)> df16;
+  const size_t NF = hn::Lanes(df32);
+  using VF = hn::Vec<decltype(df32)>;
+  using VBF = hn::Vec<decltype(df16)>;
+  const hn::Half<decltype(df16)> df16h;
+  constexpr bool is_bfloat16 = std::is_same<HalfFloat, hwy::bfloat16_t>::value;
+
+  const VF multiplier_vec = hn::Set(df32, multiplier);
+  auto scale = [&](VF v) HWY_ATTR {
+    if constexpr (kScaled) {
+      return hn::Mul(v, multiplier_vec);
+    } else {
+      return v;
+    }
+  };
+
+  size_t i = 0;
+  if (size >= 2 * NF) {
+    for (; i <= size - 2 * NF; i += 2 * NF) {
+      const VF v0 = scale(hn::LoadU(df32, in + i));
+      const VF v1 = scale(hn::LoadU(df32, in + i + NF));
+      if constexpr (is_bfloat16) {
+        const VBF bf = hn::OrderedDemote2To(df16, v0, v1);
+        hn::StoreU(bf, df16, out + i);
+      } else {
+        static_assert(std::is_same<HalfFloat, hwy::float16_t>::value,
+                      "Unsupported HalfFloat type");
+        // todo: use OrderedDemote2To once it's implemented for float16_t
+        const VBF bf =
+            hn::Combine(df16, hn::DemoteTo(df16h, v1), hn::DemoteTo(df16h, v0));
+        hn::StoreU(bf, df16, out + i);
+      }
+    }
+  }
+  if (size - i >= NF) {
+    const VF v0 = scale(hn::LoadU(df32, in + i));
+    const hn::Vec<decltype(df16h)> bfh = hn::DemoteTo(df16h, v0);
+    hn::StoreU(bfh, df16h, out + i);
+    i += NF;
+  }
+
+  if (i != size) {
+    const size_t remaining = size - i;
+    const VF v0 = scale(hn::LoadN(df32, in + i, remaining));
+    const hn::Vec<decltype(df16h)> bfh = hn::DemoteTo(df16h, v0);
+    hn::StoreN(bfh, df16h, out + i, remaining);
+  }
+}
+
+template <class HalfFloat, HWY_IF_SPECIAL_FLOAT(HalfFloat)>
+static void HalfFloatToF32(const HalfFloat* HWY_RESTRICT in,
+                           float* HWY_RESTRICT out, size_t size) {
+  static_assert(sizeof(float) / sizeof(HalfFloat) == 2,
+                "HalfFloat must be 16-bit");
+  const hn::ScalableTag<float> df32;
+  // f16 here refers to the 16-bit floating point type, including float16_t and
+  // bfloat16_t
+  const hn::Repartition<HalfFloat, decltype(df32)> df16;
+  const size_t NF = hn::Lanes(df32);
+  using VF = hn::Vec<decltype(df32)>;
+  using VBF = hn::Vec<decltype(df16)>;
+  const hn::Half<decltype(df16)> df16h;
+
+  size_t i = 0;
+  if (size >= 2 * NF) {
+    for (; i <= size - 2 * NF; i += 2 * NF) {
+      const auto v0 = hn::LoadU(df16h, in + i);
+      const auto v1 = hn::LoadU(df16h, in + i + NF);
+      hn::StoreU(hn::PromoteTo(df32, v0), df32, out + i);
+      hn::StoreU(hn::PromoteTo(df32, v1), df32, out + i + NF);
+    }
+  }
+  if (size - i >= NF) {
+    const auto v = hn::LoadU(df16h, in + i);
+    hn::StoreU(hn::PromoteTo(df32, v), df32, out + i);
+    i += NF;
+  }
+
+  if (i != size) {
+    const size_t remaining = size - i;
+    const auto v = hn::LoadN(df16h, in + i, remaining);
+    hn::StoreN(hn::PromoteTo(df32, v), df32, out + i, remaining);
+  }
+}
+
+// float8 values are decoded through f16, which covers the exponent range and
+// mantissa bits of both formats: E5M2 bits are the upper byte of an f16, and
+// E4M3 bits shifted into an f16 encode the value scaled by 2^-8. Kernels
+// work on these unscaled values and multiply by F8DecodeScale where needed.
+template <class Float8>
+static constexpr float F8DecodeScale() {
+  return std::is_same_v<Float8, vectorlite::ops::float8_e4m3_t> ? 256.0f
+                                                                 : 1.0f;
+}
+
+template <class Float8, class DF, HWY_IF_F32_D(DF)>
+static HWY_INLINE hn::Vec<DF> PromoteF8ToF32Unscaled(
+    const DF df, hn::Vec<hn::Rebind<uint8_t, DF>> bytes) {
+  const hn::Rebind<uint16_t, DF> du16;
+  const hn::Rebind<hwy::float16_t, DF> df16;
+  const auto wide = hn::PromoteTo(du16, bytes);
+  if constexpr (std::is_same_v<Float8, vectorlite::ops::float8_e5m2_t>) {
+    return hn::PromoteTo(df, hn::BitCast(df16, hn::ShiftLeft<8>(wide)));
+  } else {
+    const auto sign = hn::ShiftLeft<8>(hn::And(wide, hn::Set(du16, 0x80)));
+    const auto magnitude =
+        hn::ShiftLeft<7>(hn::And(wide, hn::Set(du16, 0x7F)));
+    return hn::PromoteTo(df, hn::BitCast(df16, hn::Or(sign, magnitude)));
+  }
+}
+
+// Loads float32 lanes from float32 or(unscaled) float8 arrays. LoadN variants
+// zero the lanes past `n`, which decode to 0.
+template <class DF>
+static HWY_INLINE hn::Vec<DF> LoadF32Lanes(const DF df, const float* p) {
+  return hn::LoadU(df, p);
+}
+
+template <class DF>
+static HWY_INLINE hn::Vec<DF> LoadNF32Lanes(const DF df, const float* p,
+                                            size_t n) {
+  return hn::LoadN(df, p, n);
+}
+
+template <class DF, class Float8,
+          std::enable_if_t<vectorlite::ops::IsFloat8<Float8>()>* = nullptr>
+static HWY_INLINE hn::Vec<DF> LoadF32Lanes(const DF df, const Float8* p) {
+  const hn::Rebind<uint8_t, DF> du8;
+  return PromoteF8ToF32Unscaled<Float8>(
+      df, hn::LoadU(du8, reinterpret_cast<const uint8_t*>(p)));
+}
+
+template <class DF, class Float8,
+          std::enable_if_t<vectorlite::ops::IsFloat8<Float8>()>* = nullptr>
+static HWY_INLINE hn::Vec<DF> LoadNF32Lanes(const DF df, const Float8* p,
+                                            size_t n) {
+  const hn::Rebind<uint8_t, DF> du8;
+  return PromoteF8ToF32Unscaled<Float8>(
+      df, hn::LoadN(du8, reinterpret_cast<const uint8_t*>(p), n));
+}
+
+// Reduces accumulate(a, b, sum) over v1 and v2 with float32 accumulators,
+// where a and b are float32 lanes loaded by LoadF32Lanes. Zeroed tail lanes
+// must not change the sum.
+template <class DF, typename T1, typename T2, class Accumulate>
+static HWY_INLINE float AccumulateF32Lanes(const DF df, const T1* v1,
+                                           const T2* v2, size_t num_elements,
+                                           Accumulate accumulate) {
+  const size_t NF = hn::Lanes(df);
+  hn::Vec<DF> sum0 = hn::Zero(df);
+  hn::Vec<DF> sum1 = hn::Zero(df);
+
+  size_t i = 0;
+  for (; i + 2 * NF <= num_elements; i += 2 * NF) {
+    sum0 = accumulate(LoadF32Lanes(df, v1 + i), LoadF32Lanes(df, v2 + i),
+                      sum0);
+    sum1 = accumulate(LoadF32Lanes(df, v1 + i + NF),
+                      LoadF32Lanes(df, v2 + i + NF), sum1);
+  }
+  if (i + NF <= num_elements) {
+    sum0 = accumulate(LoadF32Lanes(df, v1 + i), LoadF32Lanes(df, v2 + i),
+                      sum0);
+    i += NF;
+  }
+  if (i != num_elements) {
+    const size_t remaining = num_elements - i;
+    sum1 = accumulate(LoadNF32Lanes(df, v1 + i, remaining),
+                      LoadNF32Lanes(df, v2 + i, remaining), sum1);
+  }
+  return hn::ReduceSum(df, hn::Add(sum0, sum1));
+}
+
+// float8 x float8 and float32 x float8 kernels. Decoding is exact, so only
+// the float32 accumulation rounds.
+template <class Float8>
+static float InnerProductF8Impl(const Float8* v1, const Float8* v2,
+                                size_t num_elements) {
+  constexpr float kScale = F8DecodeScale<Float8>();
+  const hn::ScalableTag<float> df;
+  return kScale * kScale *
+         AccumulateF32Lanes(df, v1, v2, num_elements,
+                            [](auto a, auto b, auto sum) HWY_ATTR {
+                              return hn::MulAdd(a, b, sum);
+                            });
+}
+
+template <class Float8>
+static float InnerProductF32F8Impl(const float* HWY_RESTRICT v1,
+                                   const Float8* HWY_RESTRICT v2,
+                                   size_t num_elements) {
+  const hn::ScalableTag<float> df;
+  return F8DecodeScale<Float8>() *
+         AccumulateF32Lanes(df, v1, v2, num_elements,
+                            [](auto a, auto b, auto sum) HWY_ATTR {
+                              return hn::MulAdd(a, b, sum);
+                            });
+}
+
+template <class Float8>
+static float L2DistanceSquaredF8Impl(const Float8* v1, const Float8* v2,
+                                     size_t num_elements) {
+  constexpr float kScale = F8DecodeScale<Float8>();
+  const hn::ScalableTag<float> df;
+  return kScale * kScale *
+         AccumulateF32Lanes(df, v1, v2, num_elements,
+                            [](auto a, auto b, auto sum) HWY_ATTR {
+                              const auto diff = hn::Sub(a, b);
+                              return hn::MulAdd(diff, diff, sum);
+                            });
+}
+
+// The query isn't scaled, so v2 is scaled before subtracting, which fuses
+// into a single NegMulAdd.
+template <class Float8>
+static float L2DistanceSquaredF32F8Impl(const float* HWY_RESTRICT v1,
+                                        const Float8* HWY_RESTRICT v2,
+                                        size_t num_elements) {
+  const hn::ScalableTag<float> df;
+  const auto scale = hn::Set(df, F8DecodeScale<Float8>());
+  return AccumulateF32Lanes(df, v1, v2, num_elements,
+                            [scale](auto a, auto b, auto sum) HWY_ATTR {
+                              const auto diff = hn::NegMulAdd(b, scale, a);
+                              return hn::MulAdd(diff, diff, sum);
+                            });
+}
+
+// Rounds to nearest, ties to even, see QuantizeF32ToF8 in ops.h. Normal
+// values are rounded on their float32 bits, where a carry out of the mantissa
+// correctly bumps the exponent. Subnormal values are multiples of the
+// smallest subnormal and are rounded with NearestInt.
+template <class Float8>
+static void QuantizeF32ToF8Impl(const float* HWY_RESTRICT in,
+                                Float8* HWY_RESTRICT out, size_t size) {
+  constexpr bool kE4M3 =
+      std::is_same_v<Float8, vectorlite::ops::float8_e4m3_t>;
+  constexpr int kExponentBias = kE4M3 ? 7 : 15;
+  constexpr int kMantissaBits = kE4M3 ? 3 : 2;
+  constexpr int kShift = 23 - kMantissaBits;
+  constexpr float kMax = kE4M3 ? 448.0f : 57344.0f;
+  constexpr float kMinNormal = 1.0f / (1 << (kExponentBias - 1));
+  constexpr float kInvMinSubnormal =
+      static_cast<float>(1 << (kExponentBias + kMantissaBits - 1));
+
+  const hn::ScalableTag<float> df32;
+  const hn::RebindToSigned<decltype(df32)> di32;
+  const hn::Rebind<uint8_t, decltype(df32)> du8;
+  const size_t NF = hn::Lanes(df32);
+  auto* HWY_RESTRICT bytes = reinterpret_cast<uint8_t*>(out);
+
+  const auto max_vec = hn::Set(df32, kMax);
+  const auto min_normal = hn::Set(df32, kMinNormal);
+  const auto inv_min_subnormal = hn::Set(df32, kInvMinSubnormal);
+  const auto round_bias = hn::Set(di32, (1 << (kShift - 1)) - 1);
+  const auto one = hn::Set(di32, 1);
+  const auto exponent_rebias =
+      hn::Set(di32, (127 - kExponentBias) << kMantissaBits);
+  const auto sign_bit = hn::Set(di32, 0x80);
+  auto quantize = [&](hn::Vec<decltype(df32)> v) HWY_ATTR {
+    auto a = hn::IfThenZeroElse(hn::IsNaN(v), hn::Min(hn::Abs(v), max_vec));
+    const auto a_bits = hn::BitCast(di32, a);
+    const auto odd = hn::And(hn::ShiftRight<kShift>(a_bits), one);
+    const auto normal = hn::Sub(
+        hn::ShiftRight<kShift>(hn::Add(a_bits, hn::Add(round_bias, odd))),
+        exponent_rebias);
+    const auto subnormal = hn::NearestInt(hn::Mul(a, inv_min_subnormal));
+    auto code = hn::IfThenElse(hn::RebindMask(di32, hn::Lt(a, min_normal)),
+                               subnormal, normal);
+    code = hn::Or(code,
+                  hn::And(hn::ShiftRight<24>(hn::BitCast(di32, v)), sign_bit));
+    return hn::DemoteTo(du8, code);
+  };
+
+  size_t i = 0;
+  for (; i + NF <= size; i += NF) {
+    hn::StoreU(quantize(hn::LoadU(df32, in + i)), du8, bytes + i);
+  }
+
+  if (i != size) {
+    const size_t remaining = size - i;
+    hn::StoreN(quantize(hn::LoadN(df32, in + i, remaining)), du8, bytes + i,
+               remaining);
+  }
+}
+
+template <class Float8>
+static void F8ToF32Impl(const Float8* HWY_RESTRICT in, float* HWY_RESTRICT out,
+                        size_t size) {
+  const hn::ScalableTag<float> df32;
+  const size_t NF = hn::Lanes(df32);
+  const auto scale = hn::Set(df32, F8DecodeScale<Float8>());
+
+  size_t i = 0;
+  for (; i + NF <= size; i += NF) {
+    hn::StoreU(hn::Mul(LoadF32Lanes(df32, in + i), scale), df32, out + i);
+  }
+
+  if (i != size) {
+    const size_t remaining = size - i;
+    hn::StoreN(hn::Mul(LoadNF32Lanes(df32, in + i, remaining), scale), df32,
+               out + i, remaining);
+  }
+}
+
+static void QuantizeF32ToBF16Impl(const float* HWY_RESTRICT in,
+                                  hwy::bfloat16_t* HWY_RESTRICT out,
+                                  size_t size) {
+  QuantizeF32ToHalf(in, out, size);
+}
+
+static void QuantizeF32ToF16Impl(const float* HWY_RESTRICT in,
+                                 hwy::float16_t* HWY_RESTRICT out,
+                                 size_t size) {
+  QuantizeF32ToHalf(in, out, size);
+}
+
+static void NormalizeAndQuantizeF32ToBF16Impl(const float* HWY_RESTRICT in,
+                                              hwy::bfloat16_t* HWY_RESTRICT out,
+                                              size_t size) {
+  QuantizeF32ToHalf</*kScaled=*/true>(in, out, size, InverseNormF32(in, size));
+}
+
+static void NormalizeAndQuantizeF32ToF16Impl(const float* HWY_RESTRICT in,
+                                             hwy::float16_t* HWY_RESTRICT out,
+                                             size_t size) {
+  QuantizeF32ToHalf</*kScaled=*/true>(in, out, size, InverseNormF32(in, size));
+}
+
+static void NormalizeToImplF32(const float* HWY_RESTRICT in,
+                               float* HWY_RESTRICT out, size_t size) {
+  const hn::ScalableTag<float> d;
+  const size_t N = hn::Lanes(d);
+  const auto norm_vec = hn::Set(d, InverseNormF32(in, size));
+
+  size_t i = 0;
+  for (; i + N <= size; i += N) {
+    hn::StoreU(hn::Mul(hn::LoadU(d, in + i), norm_vec), d, out + i);
+  }
+
+  if (i != size) {
+    const size_t remaining = size - i;
+    hn::StoreN(hn::Mul(hn::LoadN(d, in + i, remaining), norm_vec), d, out + i,
+               remaining);
+  }
+}
+
+static float InnerProductImplF32(const float* v1, const float* v2,
+                                 size_t num_elements) {
+  return InnerProductImpl(hn::ScalableTag<float>(), v1, v2, num_elements);
+}
+
+// Accumulates the inner product and both squared norms in the same pass, two
+// vectors at a time so that there are 6 independent FMA chains.
+static float CosineDistanceImplF32(const float* v1, const float* v2,
+                                   size_t num_elements) {
+  const hn::ScalableTag<float> d;
+  using V = hn::Vec<decltype(d)>;
+  const size_t N = hn::Lanes(d);
+
+  V dot0 = hn::Zero(d);
+  V dot1 = hn::Zero(d);
+  V norm1_0 = hn::Zero(d);
+  V norm1_1 = hn::Zero(d);
+  V norm2_0 = hn::Zero(d);
+  V norm2_1 = hn::Zero(d);
+
+  size_t i = 0;
+  for (; i + 2 * N <= num_elements; i += 2 * N) {
+    const V a0 = hn::LoadU(d, v1 + i);
+    const V b0 = hn::LoadU(d, v2 + i);
+    const V a1 = hn::LoadU(d, v1 + i + N);
+    const V b1 = hn::LoadU(d, v2 + i + N);
+    dot0 = hn::MulAdd(a0, b0, dot0);
+    dot1 = hn::MulAdd(a1, b1, dot1);
+    norm1_0 = hn::MulAdd(a0, a0, norm1_0);
+    norm1_1 = hn::MulAdd(a1, a1, norm1_1);
+    norm2_0 = hn::MulAdd(b0, b0, norm2_0);
+    norm2_1 = hn::MulAdd(b1, b1, norm2_1);
+  }
+
+  // Up to 2 remaining partial or whole vectors. LoadN zeroes the lanes past
+  // the end, which add nothing to the sums.
+  for (; i < num_elements; i += N) {
+    const size_t count = HWY_MIN(N, num_elements - i);
+    const V a = hn::LoadN(d, v1 + i, count);
+    const V b = hn::LoadN(d, v2 + i, count);
+    dot0 = hn::MulAdd(a, b, dot0);
+    norm1_0 = hn::MulAdd(a, a, norm1_0);
+    norm2_0 = hn::MulAdd(b, b, norm2_0);
+  }
+
+  const float dot = hn::ReduceSum(d, hn::Add(dot0, dot1));
+  const float norm1 = hn::ReduceSum(d, hn::Add(norm1_0, norm1_1));
+  const float norm2 = hn::ReduceSum(d, hn::Add(norm2_0, norm2_1));
+  // Scaled like NormalizeImpl, so that zero vectors are at distance 1.
+  return 1.0f - dot * (1.0f / (sqrtf(norm1) + 1e-30f)) *
+                    (1.0f / (sqrtf(norm2) + 1e-30f));
+}
+
+static float InnerProductImplBF16(const hwy::bfloat16_t* v1,
+                                  const hwy::bfloat16_t* v2,
+                                  size_t num_elements) {
+  return InnerProductImpl(hn::ScalableTag<hwy::bfloat16_t>(), v1, v2,
+                          num_elements);
+}
+
+static float InnerProductImplF16(const hwy::float16_t* v1,
+                                 const hwy::float16_t* v2,
+                                 size_t num_elements) {
+  return InnerProductImpl(hn::ScalableTag<hwy::float16_t>(), v1, v2,
+                          num_elements);
+}
+
+static float L2DistanceSquaredImplF32(const float* v1, const float* v2,
+                                      size_t num_elements) {
+  return L2DistanceSquaredImpl(hn::ScalableTag<float>(), v1, v2, num_elements);
+}
+
+static float L2DistanceSquaredImplBF16(const hwy::bfloat16_t* v1,
+                                       const hwy::bfloat16_t* v2,
+                                       size_t num_elements) {
+  return L2DistanceSquaredImpl(hn::ScalableTag<hwy::bfloat16_t>(), v1, v2,
+                               num_elements);
+}
+
+static float L2DistanceSquaredImplF16(const hwy::float16_t* v1,
+                                      const hwy::float16_t* v2,
+                                      size_t num_elements) {
+  return L2DistanceSquaredImpl(hn::ScalableTag<hwy::float16_t>(), v1, v2,
+                               num_elements);
+}
+
+#if HWY_NATIVE_DOT_BF16
+// Like L2DistanceSquaredImplBF16, with L2DistanceSquaredDotBF16 for whole
+// vectors.
+static float L2DistanceSquaredImplDotBF16(const hwy::bfloat16_t* v1,
+                                          const hwy::bfloat16_t* v2,
+                                          size_t num_elements) {
+  const hn::ScalableTag<hwy::bfloat16_t> d;
+  const size_t N = hn::Lanes(d);
+  const size_t leftover = num_elements % N;
+  const size_t vectorized = num_elements - leftover;
+  float result = 0;
+  if (vectorized > 0) {
+    result = L2DistanceSquaredDotBF16(d, v1, v2, vectorized);
+  }
+  if (leftover > 0) {
+    // Fewer than N elements, which L2DistanceSquaredImplBF16 does in scalar.
+    result +=
+        L2DistanceSquaredImplBF16(v1 + vectorized, v2 + vectorized, leftover);
+  }
+  return result;
+}
+#endif  // HWY_NATIVE_DOT_BF16
+
+static float L2DistanceSquaredImplF32BF16(const float* v1,
+                                          const hwy::bfloat16_t* v2,
+                                          size_t num_elements) {
+  return L2DistanceSquaredImpl(hn::ScalableTag<float>(), v1, v2, num_elements);
+}
+
+static float L2DistanceSquaredImplF32F16(const float* v1,
+                                         const hwy::float16_t* v2,
+                                         size_t num_elements) {
+  return L2DistanceSquaredImpl(hn::ScalableTag<float>(), v1, v2, num_elements);
+}
+
+static float InnerProductImplF32BF16(const float* v1,
+                                     const hwy::bfloat16_t* v2,
+                                     size_t num_elements) {
+  return InnerProductImpl(hn::ScalableTag<float>(), v1, v2, num_elements);
+}
+
+static float InnerProductImplF32F16(const float* v1, const hwy::float16_t* v2,
+                                    size_t num_elements) {
+  return InnerProductImpl(hn::ScalableTag<float>(), v1, v2, num_elements);
+}
+
+static int32_t InnerProductImplI8(const int8_t* v1, const int8_t* v2,
+                                  size_t num_elements) {
+  return InnerProductImpl(hn::ScalableTag<int8_t>(), v1, v2, num_elements);
+}
+
+static int32_t L2DistanceSquaredImplI8(const int8_t* v1, const int8_t* v2,
+                                       size_t num_elements) {
+  return L2DistanceSquaredImpl(hn::ScalableTag<int8_t>(), v1, v2,
                                num_elements);
 }
 
-static float L2DistanceSquaredImplF16(const hwy::float16_t* v1,
-                                      const hwy::float16_t* v2,
-                                      size_t num_elements) {
-  return L2DistanceSquaredImpl(hn::ScalableTag<hwy::float16_t>(), v1, v2,
-                               num_elements);
+static void InnerProductDistanceMatrixImplF32(
+    const float* queries, size_t num_queries, const float* vectors,
+    size_t num_vectors, size_t num_elements, float* HWY_RESTRICT out) {
+  InnerProductMatrixImpl(hn::ScalableTag<float>(), queries, num_queries,
+                         vectors, num_vectors, num_elements, out);
+  for (size_t i = 0; i < num_queries * num_vectors; ++i) {
+    out[i] = 1.0f - out[i];
+  }
+}
+
+// Uses |q - v|^2 = |q|^2 + |v|^2 - 2 * q.v so that L2 shares the inner
+// product tiles.
+static void L2DistanceSquaredMatrixImplF32(
+    const float* queries, size_t num_queries, const float* vectors,
+    size_t num_vectors, size_t num_elements, float* HWY_RESTRICT out) {
+  const hn::ScalableTag<float> d;
+  InnerProductMatrixImpl(d, queries, num_queries, vectors, num_vectors,
+                         num_elements, out);
+
+  std::vector<float> vector_norms(num_vectors);
+  for (size_t j = 0; j < num_vectors; ++j) {
+    const float* v = vectors + j * num_elements;
+    vector_norms[j] = InnerProductImpl(d, v, v, num_elements);
+  }
+  for (size_t i = 0; i < num_queries; ++i) {
+    const float* q = queries + i * num_elements;
+    const float query_norm = InnerProductImpl(d, q, q, num_elements);
+    float* out_row = out + i * num_vectors;
+    for (size_t j = 0; j < num_vectors; ++j) {
+      // Rounding can make the distance of nearly identical vectors negative.
+      out_row[j] =
+          std::max(query_norm + vector_norms[j] - 2.0f * out_row[j], 0.0f);
+    }
+  }
+}
+
+static void InnerProductBatchImplF32(const float* query, const float* vectors,
+                                     size_t num_vectors, size_t num_elements,
+                                     float* HWY_RESTRICT out) {
+  InnerProductBatchImpl(hn::ScalableTag<float>(), query,
+                        ContiguousRows<float>{vectors, num_elements},
+                        num_vectors, num_elements, out);
+}
+
+static void InnerProductBatchPtrImplF32(const float* query,
+                                        const float* const* vectors,
+                                        size_t num_vectors, size_t num_elements,
+                                        float* HWY_RESTRICT out) {
+  InnerProductBatchImpl(hn::ScalableTag<float>(), query,
+                        PointerRows<float>{vectors}, num_vectors, num_elements,
+                        out);
+}
+
+static void InnerProductBatchImplBF16(const hwy::bfloat16_t* query,
+                                      const hwy::bfloat16_t* vectors,
+                                      size_t num_vectors, size_t num_elements,
+                                      float* HWY_RESTRICT out) {
+  InnerProductBatchImpl(hn::ScalableTag<hwy::bfloat16_t>(), query,
+                        ContiguousRows<hwy::bfloat16_t>{vectors, num_elements},
+                        num_vectors, num_elements, out);
+}
+
+static void InnerProductBatchPtrImplBF16(const hwy::bfloat16_t* query,
+                                         const hwy::bfloat16_t* const* vectors,
+                                         size_t num_vectors,
+                                         size_t num_elements,
+                                         float* HWY_RESTRICT out) {
+  InnerProductBatchImpl(hn::ScalableTag<hwy::bfloat16_t>(), query,
+                        PointerRows<hwy::bfloat16_t>{vectors}, num_vectors,
+                        num_elements, out);
+}
+
+static void InnerProductBatchImplF16(const hwy::float16_t* query,
+                                     const hwy::float16_t* vectors,
+                                     size_t num_vectors, size_t num_elements,
+                                     float* HWY_RESTRICT out) {
+  InnerProductBatchImpl(hn::ScalableTag<hwy::float16_t>(), query,
+                        ContiguousRows<hwy::float16_t>{vectors, num_elements},
+                        num_vectors, num_elements, out);
+}
+
+static void InnerProductBatchPtrImplF16(const hwy::float16_t* query,
+                                        const hwy::float16_t* const* vectors,
+                                        size_t num_vectors, size_t num_elements,
+                                        float* HWY_RESTRICT out) {
+  InnerProductBatchImpl(hn::ScalableTag<hwy::float16_t>(), query,
+                        PointerRows<hwy::float16_t>{vectors}, num_vectors,
+                        num_elements, out);
+}
+
+static void InnerProductBatchImplI8(const int8_t* query, const int8_t* vectors,
+                                    size_t num_vectors, size_t num_elements,
+                                    int32_t* HWY_RESTRICT out) {
+  InnerProductBatchImpl(hn::ScalableTag<int8_t>(), query,
+                        ContiguousRows<int8_t>{vectors, num_elements},
+                        num_vectors, num_elements, out);
+}
+
+static void InnerProductBatchPtrImplI8(const int8_t* query,
+                                       const int8_t* const* vectors,
+                                       size_t num_vectors, size_t num_elements,
+                                       int32_t* HWY_RESTRICT out) {
+  InnerProductBatchImpl(hn::ScalableTag<int8_t>(), query,
+                        PointerRows<int8_t>{vectors}, num_vectors, num_elements,
+                        out);
+}
+
+static void L2DistanceSquaredBatchImplF32(const float* query,
+                                          const float* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements,
+                                          float* HWY_RESTRICT out) {
+  L2DistanceSquaredBatchImpl(hn::ScalableTag<float>(), query,
+                             ContiguousRows<float>{vectors, num_elements},
+                             num_vectors, num_elements, out);
+}
+
+static void L2DistanceSquaredBatchPtrImplF32(const float* query,
+                                             const float* const* vectors,
+                                             size_t num_vectors,
+                                             size_t num_elements,
+                                             float* HWY_RESTRICT out) {
+  L2DistanceSquaredBatchImpl(hn::ScalableTag<float>(), query,
+                             PointerRows<float>{vectors}, num_vectors,
+                             num_elements, out);
 }
 
-static float L2DistanceSquaredImplF32BF16(const float* v1,
-                                          const hwy::bfloat16_t* v2,
-                                          size_t num_elements) {
-  return L2DistanceSquaredImpl(hn::ScalableTag<float>(), v1, v2, num_elements);
+static void L2DistanceSquaredBatchImplBF16(const hwy::bfloat16_t* query,
+                                           const hwy::bfloat16_t* vectors,
+                                           size_t num_vectors,
+                                           size_t num_elements,
+                                           float* HWY_RESTRICT out) {
+  L2DistanceSquaredBatchImpl(
+      hn::ScalableTag<hwy::bfloat16_t>(), query,
+      ContiguousRows<hwy::bfloat16_t>{vectors, num_elements}, num_vectors,
+      num_elements, out);
+}
+
+static void L2DistanceSquaredBatchPtrImplBF16(
+    const hwy::bfloat16_t* query, const hwy::bfloat16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* HWY_RESTRICT out) {
+  L2DistanceSquaredBatchImpl(hn::ScalableTag<hwy::bfloat16_t>(), query,
+                             PointerRows<hwy::bfloat16_t>{vectors}, num_vectors,
+                             num_elements, out);
+}
+
+static void L2DistanceSquaredBatchImplF16(const hwy::float16_t* query,
+                                          const hwy::float16_t* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements,
+                                          float* HWY_RESTRICT out) {
+  L2DistanceSquaredBatchImpl(
+      hn::ScalableTag<hwy::float16_t>(), query,
+      ContiguousRows<hwy::float16_t>{vectors, num_elements}, num_vectors,
+      num_elements, out);
+}
+
+static void L2DistanceSquaredBatchPtrImplF16(
+    const hwy::float16_t* query, const hwy::float16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* HWY_RESTRICT out) {
+  L2DistanceSquaredBatchImpl(hn::ScalableTag<hwy::float16_t>(), query,
+                             PointerRows<hwy::float16_t>{vectors}, num_vectors,
+                             num_elements, out);
+}
+
+static void L2DistanceSquaredBatchImplI8(const int8_t* query,
+                                         const int8_t* vectors,
+                                         size_t num_vectors,
+                                         size_t num_elements,
+                                         int32_t* HWY_RESTRICT out) {
+  L2DistanceSquaredBatchImpl(hn::ScalableTag<int8_t>(), query,
+                             ContiguousRows<int8_t>{vectors, num_elements},
+                             num_vectors, num_elements, out);
+}
+
+static void L2DistanceSquaredBatchPtrImplI8(const int8_t* query,
+                                            const int8_t* const* vectors,
+                                            size_t num_vectors,
+                                            size_t num_elements,
+                                            int32_t* HWY_RESTRICT out) {
+  L2DistanceSquaredBatchImpl(hn::ScalableTag<int8_t>(), query,
+                             PointerRows<int8_t>{vectors}, num_vectors,
+                             num_elements, out);
+}
+
+// Batch kernels of a float32 query against half precision vectors, for
+// searching half precision indexes without quantizing the query.
+static void InnerProductBatchPtrImplF32BF16(
+    const float* query, const hwy::bfloat16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* HWY_RESTRICT out) {
+  for (size_t j = 0; j < num_vectors; ++j) {
+    out[j] = InnerProductImplF32BF16(query, vectors[j], num_elements);
+  }
+}
+
+static void InnerProductBatchPtrImplF32F16(
+    const float* query, const hwy::float16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* HWY_RESTRICT out) {
+  for (size_t j = 0; j < num_vectors; ++j) {
+    out[j] = InnerProductImplF32F16(query, vectors[j], num_elements);
+  }
+}
+
+static void L2DistanceSquaredBatchPtrImplF32BF16(
+    const float* query, const hwy::bfloat16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* HWY_RESTRICT out) {
+  for (size_t j = 0; j < num_vectors; ++j) {
+    out[j] = L2DistanceSquaredImplF32BF16(query, vectors[j], num_elements);
+  }
+}
+
+static void L2DistanceSquaredBatchPtrImplF32F16(
+    const float* query, const hwy::float16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* HWY_RESTRICT out) {
+  for (size_t j = 0; j < num_vectors; ++j) {
+    out[j] = L2DistanceSquaredImplF32F16(query, vectors[j], num_elements);
+  }
+}
+
+// Below functions have the signature of hnswlib::DISTFUNC<float>. Vector spaces
+// resolve them once via HWY_DYNAMIC_POINTER and hand them to hnswlib, so
+// there is no dynamic dispatch per distance call. `num_elements` points to a
+// size_t.
+static float InnerProductDistanceFuncF32(const void* v1, const void* v2,
+                                         const void* num_elements) {
+  return 1.0f - InnerProductImplF32(static_cast<const float*>(v1),
+                                    static_cast<const float*>(v2),
+                                    *static_cast<const size_t*>(num_elements));
+}
+
+static float InnerProductDistanceFuncBF16(const void* v1, const void* v2,
+                                          const void* num_elements) {
+  return 1.0f -
+         InnerProductImplBF16(static_cast<const hwy::bfloat16_t*>(v1),
+                              static_cast<const hwy::bfloat16_t*>(v2),
+                              *static_cast<const size_t*>(num_elements));
+}
+
+static float InnerProductDistanceFuncF16(const void* v1, const void* v2,
+                                         const void* num_elements) {
+  return 1.0f - InnerProductImplF16(static_cast<const hwy::float16_t*>(v1),
+                                    static_cast<const hwy::float16_t*>(v2),
+                                    *static_cast<const size_t*>(num_elements));
+}
+
+static float L2DistanceSquaredFuncF32(const void* v1, const void* v2,
+                                      const void* num_elements) {
+  if (HWY_UNLIKELY(v1 == v2)) {
+    return 0.0f;
+  }
+  return L2DistanceSquaredImplF32(static_cast<const float*>(v1),
+                                  static_cast<const float*>(v2),
+                                  *static_cast<const size_t*>(num_elements));
+}
+
+static float L2DistanceSquaredFuncBF16(const void* v1, const void* v2,
+                                       const void* num_elements) {
+  if (HWY_UNLIKELY(v1 == v2)) {
+    return 0.0f;
+  }
+  return L2DistanceSquaredImplBF16(static_cast<const hwy::bfloat16_t*>(v1),
+                                   static_cast<const hwy::bfloat16_t*>(v2),
+                                   *static_cast<const size_t*>(num_elements));
+}
+
+static float L2DistanceSquaredFuncF16(const void* v1, const void* v2,
+                                      const void* num_elements) {
+  if (HWY_UNLIKELY(v1 == v2)) {
+    return 0.0f;
+  }
+  return L2DistanceSquaredImplF16(static_cast<const hwy::float16_t*>(v1),
+                                  static_cast<const hwy::float16_t*>(v2),
+                                  *static_cast<const size_t*>(num_elements));
+}
+
+#if HWY_NATIVE_DOT_BF16
+static float L2DistanceSquaredFuncDotBF16(const void* v1, const void* v2,
+                                          const void* num_elements) {
+  if (HWY_UNLIKELY(v1 == v2)) {
+    return 0.0f;
+  }
+  return L2DistanceSquaredImplDotBF16(
+      static_cast<const hwy::bfloat16_t*>(v1),
+      static_cast<const hwy::bfloat16_t*>(v2),
+      *static_cast<const size_t*>(num_elements));
+}
+#endif  // HWY_NATIVE_DOT_BF16
+
+// Mixed precision versions take a float32 vector as the first argument.
+static float InnerProductDistanceFuncF32BF16(const void* v1, const void* v2,
+                                             const void* num_elements) {
+  return 1.0f -
+         InnerProductImplF32BF16(static_cast<const float*>(v1),
+                                 static_cast<const hwy::bfloat16_t*>(v2),
+                                 *static_cast<const size_t*>(num_elements));
+}
+
+static float InnerProductDistanceFuncF32F16(const void* v1, const void* v2,
+                                            const void* num_elements) {
+  return 1.0f -
+         InnerProductImplF32F16(static_cast<const float*>(v1),
+                                static_cast<const hwy::float16_t*>(v2),
+                                *static_cast<const size_t*>(num_elements));
+}
+
+static float L2DistanceSquaredFuncF32BF16(const void* v1, const void* v2,
+                                          const void* num_elements) {
+  return L2DistanceSquaredImplF32BF16(
+      static_cast<const float*>(v1), static_cast<const hwy::bfloat16_t*>(v2),
+      *static_cast<const size_t*>(num_elements));
+}
+
+static float L2DistanceSquaredFuncF32F16(const void* v1, const void* v2,
+                                         const void* num_elements) {
+  return L2DistanceSquaredImplF32F16(
+      static_cast<const float*>(v1), static_cast<const hwy::float16_t*>(v2),
+      *static_cast<const size_t*>(num_elements));
 }
 
+// Fixed-dimension versions ignore the third argument.
+#define VECTORLITE_DEFINE_FIXED_DIM_FUNCS(dim)                              \
+  static float InnerProductDistanceFuncF32Dim##dim(                          \
+      const void* v1, const void* v2, const void* /*unused*/) {              \
+    return 1.0f -                                                            \
+           InnerProductFixedDimImplF32<dim>(static_cast<const float*>(v1),   \
+                                            static_cast<const float*>(v2));  \
+  }                                                                          \
+  static float L2DistanceSquaredFuncF32Dim##dim(                             \
+      const void* v1, const void* v2, const void* /*unused*/) {              \
+    if (HWY_UNLIKELY(v1 == v2)) {                                            \
+      return 0.0f;                                                           \
+    }                                                                        \
+    return L2DistanceSquaredFixedDimImplF32<dim>(                            \
+        static_cast<const float*>(v1), static_cast<const float*>(v2));       \
+  }
+VECTORLITE_FOR_EACH_FIXED_DIM(VECTORLITE_DEFINE_FIXED_DIM_FUNCS)
+#undef VECTORLITE_DEFINE_FIXED_DIM_FUNCS
+
+// Named float8 entry points for HWY_EXPORT, following the float and half
+// precision ones above.
+#define VECTORLITE_DEFINE_FLOAT8_FUNCS(name, T)                               \
+  static float InnerProductImplF8##name(const T* v1, const T* v2,             \
+                                        size_t num_elements) {                \
+    return InnerProductF8Impl(v1, v2, num_elements);                          \
+  }                                                                           \
+  static float InnerProductImplF32F8##name(const float* v1, const T* v2,      \
+                                           size_t num_elements) {             \
+    return InnerProductF32F8Impl(v1, v2, num_elements);                       \
+  }                                                                           \
+  static float L2DistanceSquaredImplF8##name(const T* v1, const T* v2,        \
+                                             size_t num_elements) {           \
+    return L2DistanceSquaredF8Impl(v1, v2, num_elements);                     \
+  }                                                                           \
+  static float L2DistanceSquaredImplF32F8##name(const float* v1, const T* v2, \
+                                                size_t num_elements) {        \
+    return L2DistanceSquaredF32F8Impl(v1, v2, num_elements);                  \
+  }                                                                           \
+  static float InnerProductDistanceFuncF8##name(                              \
+      const void* v1, const void* v2, const void* num_elements) {             \
+    return 1.0f -                                                             \
+           InnerProductF8Impl(static_cast<const T*>(v1),                      \
+                              static_cast<const T*>(v2),                      \
+                              *static_cast<const size_t*>(num_elements));     \
+  }                                                                           \
+  static float InnerProductDistanceFuncF32F8##name(                           \
+      const void* v1, const void* v2, const void* num_elements) {             \
+    return 1.0f -                                                             \
+           InnerProductF32F8Impl(static_cast<const float*>(v1),               \
+                                 static_cast<const T*>(v2),                   \
+                                 *static_cast<const size_t*>(num_elements));  \
+  }                                                                           \
+  static float L2DistanceSquaredFuncF8##name(const void* v1, const void* v2,  \
+                                             const void* num_elements) {      \
+    if (HWY_UNLIKELY(v1 == v2)) {                                             \
+      return 0.0f;                                                            \
+    }                                                                         \
+    return L2DistanceSquaredF8Impl(                                           \
+        static_cast<const T*>(v1), static_cast<const T*>(v2),                 \
+        *static_cast<const size_t*>(num_elements));                           \
+  }                                                                           \
+  static float L2DistanceSquaredFuncF32F8##name(                              \
+      const void* v1, const void* v2, const void* num_elements) {             \
+    return L2DistanceSquaredF32F8Impl(                                        \
+        static_cast<const float*>(v1), static_cast<const T*>(v2),             \
+        *static_cast<const size_t*>(num_elements));                           \
+  }                                                                           \
+  static void InnerProductBatchPtrImplF8##name(                               \
+      const T* query, const T* const* vectors, size_t num_vectors,            \
+      size_t num_elements, float* HWY_RESTRICT out) {                         \
+    for (size_t j = 0; j < num_vectors; ++j) {                                \
+      out[j] = InnerProductF8Impl(query, vectors[j], num_elements);           \
+    }                                                                         \
+  }                                                                           \
+  static void L2DistanceSquaredBatchPtrImplF8##name(                          \
+      const T* query, const T* const* vectors, size_t num_vectors,            \
+      size_t num_elements, float* HWY_RESTRICT out) {                         \
+    for (size_t j = 0; j < num_vectors; ++j) {                                \
+      out[j] = HWY_UNLIKELY(vectors[j] == query)                              \
+                   ? 0.0f                                                     \
+                   : L2DistanceSquaredF8Impl(query, vectors[j],               \
+                                             num_elements);                   \
+    }                                                                         \
+  }                                                                           \
+  static void InnerProductBatchPtrImplF32F8##name(                            \
+      const float* query, const T* const* vectors, size_t num_vectors,        \
+      size_t num_elements, float* HWY_RESTRICT out) {                         \
+    for (size_t j = 0; j < num_vectors; ++j) {                                \
+      out[j] = InnerProductF32F8Impl(query, vectors[j], num_elements);        \
+    }                                                                         \
+  }                                                                           \
+  static void L2DistanceSquaredBatchPtrImplF32F8##name(                       \
+      const float* query, const T* const* vectors, size_t num_vectors,        \
+      size_t num_elements, float* HWY_RESTRICT out) {                         \
+    for (size_t j = 0; j < num_vectors; ++j) {                                \
+      out[j] = L2DistanceSquaredF32F8Impl(query, vectors[j], num_elements);   \
+    }                                                                         \
+  }                                                                           \
+  static void QuantizeF32ToF8##name##Impl(const float* HWY_RESTRICT in,       \
+                                          T* HWY_RESTRICT out,                \
+                                          size_t num_elements) {              \
+    QuantizeF32ToF8Impl(in, out, num_elements);                               \
+  }                                                                           \
+  static void F8##name##ToF32Impl(const T* HWY_RESTRICT in,                   \
+                                  float* HWY_RESTRICT out,                    \
+                                  size_t num_elements) {                      \
+    F8ToF32Impl(in, out, num_elements);                                       \
+  }
+VECTORLITE_FOR_EACH_FLOAT8(VECTORLITE_DEFINE_FLOAT8_FUNCS)
+#undef VECTORLITE_DEFINE_FLOAT8_FUNCS
+
 static void NormalizeImplF32(float* HWY_RESTRICT inout, size_t num_elements) {
   return NormalizeImpl(hn::ScalableTag<float>(), inout, num_elements);
 }
@@ -798,6 +2506,98 @@ static void BF16ToF32Impl(const hwy::bfloat16_t* HWY_RESTRICT in,
   HalfFloatToF32(in, out, num_elements);
 }
 
+// This target's counterparts of the Resolve* functions below HWY_EXPORT, which
+// return the chosen target's function. ResolveForEachTarget calls them for
+// every target, so that comparing targets never changes the chosen one.
+struct TargetDistanceFuncs {
+  template <typename T>
+  static vectorlite::ops::DistanceFunc InnerProduct(size_t num_elements) {
+    if constexpr (std::is_same_v<T, float>) {
+#define VECTORLITE_FIXED_DIM_CASE(dim) \
+  case dim:                            \
+    return &InnerProductDistanceFuncF32Dim##dim;
+      switch (num_elements) {
+        VECTORLITE_FOR_EACH_FIXED_DIM(VECTORLITE_FIXED_DIM_CASE)
+        default:
+          return &InnerProductDistanceFuncF32;
+      }
+#undef VECTORLITE_FIXED_DIM_CASE
+    } else if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+      return &InnerProductDistanceFuncBF16;
+    } else if constexpr (std::is_same_v<T, vectorlite::ops::float8_e4m3_t>) {
+      return &InnerProductDistanceFuncF8E4M3;
+    } else if constexpr (std::is_same_v<T, vectorlite::ops::float8_e5m2_t>) {
+      return &InnerProductDistanceFuncF8E5M2;
+    } else {
+      static_assert(std::is_same_v<T, hwy::float16_t>, "Unsupported type");
+      return &InnerProductDistanceFuncF16;
+    }
+  }
+
+  template <typename T>
+  static vectorlite::ops::DistanceFunc L2DistanceSquared(size_t num_elements) {
+    if constexpr (std::is_same_v<T, float>) {
+#define VECTORLITE_FIXED_DIM_CASE(dim) \
+  case dim:                            \
+    return &L2DistanceSquaredFuncF32Dim##dim;
+      switch (num_elements) {
+        VECTORLITE_FOR_EACH_FIXED_DIM(VECTORLITE_FIXED_DIM_CASE)
+        default:
+          return &L2DistanceSquaredFuncF32;
+      }
+#undef VECTORLITE_FIXED_DIM_CASE
+    } else if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+      return &L2DistanceSquaredFuncBF16;
+    } else if constexpr (std::is_same_v<T, vectorlite::ops::float8_e4m3_t>) {
+      return &L2DistanceSquaredFuncF8E4M3;
+    } else if constexpr (std::is_same_v<T, vectorlite::ops::float8_e5m2_t>) {
+      return &L2DistanceSquaredFuncF8E5M2;
+    } else {
+      static_assert(std::is_same_v<T, hwy::float16_t>, "Unsupported type");
+      return &L2DistanceSquaredFuncF16;
+    }
+  }
+
+  template <typename T>
+  static vectorlite::ops::DistanceFunc MixedInnerProduct() {
+    if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+      return &InnerProductDistanceFuncF32BF16;
+    } else if constexpr (std::is_same_v<T, hwy::float16_t>) {
+      return &InnerProductDistanceFuncF32F16;
+    } else if constexpr (std::is_same_v<T, vectorlite::ops::float8_e4m3_t>) {
+      return &InnerProductDistanceFuncF32F8E4M3;
+    } else {
+      static_assert(std::is_same_v<T, vectorlite::ops::float8_e5m2_t>,
+                    "Unsupported type");
+      return &InnerProductDistanceFuncF32F8E5M2;
+    }
+  }
+
+  template <typename T>
+  static vectorlite::ops::DistanceFunc MixedL2DistanceSquared() {
+    if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+      return &L2DistanceSquaredFuncF32BF16;
+    } else if constexpr (std::is_same_v<T, hwy::float16_t>) {
+      return &L2DistanceSquaredFuncF32F16;
+    } else if constexpr (std::is_same_v<T, vectorlite::ops::float8_e4m3_t>) {
+      return &L2DistanceSquaredFuncF32F8E4M3;
+    } else {
+      static_assert(std::is_same_v<T, vectorlite::ops::float8_e5m2_t>,
+                    "Unsupported type");
+      return &L2DistanceSquaredFuncF32F8E5M2;
+    }
+  }
+
+  // nullptr if the target has no native bf16 dot instructions.
+  static vectorlite::ops::DistanceFunc DotL2DistanceSquaredBF16() {
+#if HWY_NATIVE_DOT_BF16
+    return &L2DistanceSquaredFuncDotBF16;
+#else
+    return nullptr;
+#endif
+  }
+};
+
 }  // namespace HWY_NAMESPACE
 
 HWY_AFTER_NAMESPACE();
@@ -812,20 +2612,89 @@ namespace ops {
 
 // This macro declares a static array used for dynamic dispatch.
 HWY_EXPORT(InnerProductImplF32);
+HWY_EXPORT(CosineDistanceImplF32);
 HWY_EXPORT(InnerProductImplBF16);
 HWY_EXPORT(InnerProductImplF16);
 HWY_EXPORT(L2DistanceSquaredImplF32);
 HWY_EXPORT(L2DistanceSquaredImplBF16);
 HWY_EXPORT(L2DistanceSquaredImplF16);
 HWY_EXPORT(L2DistanceSquaredImplF32BF16);
+HWY_EXPORT(L2DistanceSquaredImplF32F16);
+HWY_EXPORT(InnerProductImplF32BF16);
+HWY_EXPORT(InnerProductImplF32F16);
+HWY_EXPORT(InnerProductImplI8);
+HWY_EXPORT(L2DistanceSquaredImplI8);
+HWY_EXPORT(QuantizeF32ToI8Impl);
+HWY_EXPORT(I8ToF32Impl);
+HWY_EXPORT(HammingDistanceImpl);
+HWY_EXPORT(HammingDistanceBatchImpl);
+HWY_EXPORT(PQFastScanBlockImpl);
+HWY_EXPORT(SelectTopKImpl);
+HWY_EXPORT(InnerProductDistanceMatrixImplF32);
+HWY_EXPORT(L2DistanceSquaredMatrixImplF32);
+HWY_EXPORT(InnerProductBatchImplF32);
+HWY_EXPORT(InnerProductBatchPtrImplF32);
+HWY_EXPORT(InnerProductBatchImplBF16);
+HWY_EXPORT(InnerProductBatchPtrImplBF16);
+HWY_EXPORT(InnerProductBatchImplF16);
+HWY_EXPORT(InnerProductBatchPtrImplF16);
+HWY_EXPORT(InnerProductBatchImplI8);
+HWY_EXPORT(InnerProductBatchPtrImplI8);
+HWY_EXPORT(L2DistanceSquaredBatchImplF32);
+HWY_EXPORT(L2DistanceSquaredBatchPtrImplF32);
+HWY_EXPORT(L2DistanceSquaredBatchImplBF16);
+HWY_EXPORT(L2DistanceSquaredBatchPtrImplBF16);
+HWY_EXPORT(L2DistanceSquaredBatchImplF16);
+HWY_EXPORT(L2DistanceSquaredBatchPtrImplF16);
+HWY_EXPORT(L2DistanceSquaredBatchImplI8);
+HWY_EXPORT(L2DistanceSquaredBatchPtrImplI8);
+HWY_EXPORT(InnerProductBatchPtrImplF32BF16);
+HWY_EXPORT(InnerProductBatchPtrImplF32F16);
+HWY_EXPORT(L2DistanceSquaredBatchPtrImplF32BF16);
+HWY_EXPORT(L2DistanceSquaredBatchPtrImplF32F16);
+HWY_EXPORT(InnerProductDistanceFuncF32);
+HWY_EXPORT(InnerProductDistanceFuncBF16);
+HWY_EXPORT(InnerProductDistanceFuncF16);
+HWY_EXPORT(L2DistanceSquaredFuncF32);
+HWY_EXPORT(L2DistanceSquaredFuncBF16);
+HWY_EXPORT(L2DistanceSquaredFuncF16);
+HWY_EXPORT(InnerProductDistanceFuncF32BF16);
+HWY_EXPORT(InnerProductDistanceFuncF32F16);
+HWY_EXPORT(L2DistanceSquaredFuncF32BF16);
+HWY_EXPORT(L2DistanceSquaredFuncF32F16);
+#define VECTORLITE_EXPORT_FIXED_DIM_FUNCS(dim)   \
+  HWY_EXPORT(InnerProductDistanceFuncF32Dim##dim); \
+  HWY_EXPORT(L2DistanceSquaredFuncF32Dim##dim);
+VECTORLITE_FOR_EACH_FIXED_DIM(VECTORLITE_EXPORT_FIXED_DIM_FUNCS)
+#undef VECTORLITE_EXPORT_FIXED_DIM_FUNCS
+#define VECTORLITE_EXPORT_FLOAT8_FUNCS(name, T)         \
+  HWY_EXPORT(InnerProductImplF8##name);                 \
+  HWY_EXPORT(InnerProductImplF32F8##name);              \
+  HWY_EXPORT(L2DistanceSquaredImplF8##name);            \
+  HWY_EXPORT(L2DistanceSquaredImplF32F8##name);         \
+  HWY_EXPORT(InnerProductDistanceFuncF8##name);         \
+  HWY_EXPORT(InnerProductDistanceFuncF32F8##name);      \
+  HWY_EXPORT(L2DistanceSquaredFuncF8##name);            \
+  HWY_EXPORT(L2DistanceSquaredFuncF32F8##name);         \
+  HWY_EXPORT(InnerProductBatchPtrImplF8##name);         \
+  HWY_EXPORT(L2DistanceSquaredBatchPtrImplF8##name);    \
+  HWY_EXPORT(InnerProductBatchPtrImplF32F8##name);      \
+  HWY_EXPORT(L2DistanceSquaredBatchPtrImplF32F8##name); \
+  HWY_EXPORT(QuantizeF32ToF8##name##Impl);              \
+  HWY_EXPORT(F8##name##ToF32Impl);
+VECTORLITE_FOR_EACH_FLOAT8(VECTORLITE_EXPORT_FLOAT8_FUNCS)
+#undef VECTORLITE_EXPORT_FLOAT8_FUNCS
 HWY_EXPORT(QuantizeF32ToF16Impl);
 HWY_EXPORT(QuantizeF32ToBF16Impl);
+HWY_EXPORT(NormalizeAndQuantizeF32ToF16Impl);
+HWY_EXPORT(NormalizeAndQuantizeF32ToBF16Impl);
 HWY_EXPORT(F16ToF32Impl);
 HWY_EXPORT(BF16ToF32Impl);
 
 HWY_EXPORT(NormalizeImplF32);
 HWY_EXPORT(NormalizeImplF16);
 HWY_EXPORT(NormalizeImplBF16);
+HWY_EXPORT(NormalizeToImplF32);
 
 HWY_DLLEXPORT float InnerProduct(const float* v1, const float* v2,
                                  size_t num_elements) {
@@ -849,6 +2718,11 @@ HWY_DLLEXPORT float InnerProductDistance(const float* v1, const float* v2,
   return 1.0f - InnerProduct(v1, v2, num_elements);
 }
 
+HWY_DLLEXPORT float CosineDistance(const float* v1, const float* v2,
+                                   size_t num_elements) {
+  return HWY_DYNAMIC_DISPATCH(CosineDistanceImplF32)(v1, v2, num_elements);
+}
+
 HWY_DLLEXPORT float InnerProductDistance(const hwy::bfloat16_t* v1,
                                          const hwy::bfloat16_t* v2,
                                          size_t num_elements) {
@@ -876,6 +2750,11 @@ HWY_DLLEXPORT void Normalize(hwy::bfloat16_t* HWY_RESTRICT inout, size_t size) {
   return;
 }
 
+HWY_DLLEXPORT void NormalizeTo(const float* HWY_RESTRICT in,
+                               float* HWY_RESTRICT out, size_t size) {
+  HWY_DYNAMIC_DISPATCH(NormalizeToImplF32)(in, out, size);
+}
+
 HWY_DLLEXPORT float L2DistanceSquared(const float* v1, const float* v2,
                                       size_t num_elements) {
   if (HWY_UNLIKELY(v1 == v2)) {
@@ -913,6 +2792,559 @@ HWY_DLLEXPORT float L2DistanceSquared(const float* v1,
                                                             num_elements);
 }
 
+HWY_DLLEXPORT float L2DistanceSquared(const float* v1,
+                                      const hwy::float16_t* v2,
+                                      size_t num_elements) {
+  return HWY_DYNAMIC_DISPATCH(L2DistanceSquaredImplF32F16)(v1, v2,
+                                                           num_elements);
+}
+
+HWY_DLLEXPORT float InnerProduct(const float* v1, const hwy::bfloat16_t* v2,
+                                 size_t num_elements) {
+  return HWY_DYNAMIC_DISPATCH(InnerProductImplF32BF16)(v1, v2, num_elements);
+}
+
+HWY_DLLEXPORT float InnerProduct(const float* v1, const hwy::float16_t* v2,
+                                 size_t num_elements) {
+  return HWY_DYNAMIC_DISPATCH(InnerProductImplF32F16)(v1, v2, num_elements);
+}
+
+HWY_DLLEXPORT float InnerProductDistance(const float* v1,
+                                         const hwy::bfloat16_t* v2,
+                                         size_t num_elements) {
+  return 1.0f - InnerProduct(v1, v2, num_elements);
+}
+
+HWY_DLLEXPORT float InnerProductDistance(const float* v1,
+                                         const hwy::float16_t* v2,
+                                         size_t num_elements) {
+  return 1.0f - InnerProduct(v1, v2, num_elements);
+}
+
+HWY_DLLEXPORT int32_t InnerProduct(const int8_t* v1, const int8_t* v2,
+                                   size_t num_elements) {
+  return HWY_DYNAMIC_DISPATCH(InnerProductImplI8)(v1, v2, num_elements);
+}
+
+HWY_DLLEXPORT int32_t L2DistanceSquared(const int8_t* v1, const int8_t* v2,
+                                        size_t num_elements) {
+  if (HWY_UNLIKELY(v1 == v2)) {
+    return 0;
+  }
+
+  return HWY_DYNAMIC_DISPATCH(L2DistanceSquaredImplI8)(v1, v2, num_elements);
+}
+
+// Turns inner products computed by the batch kernels into distances in place.
+static void InnerProductToDistance(float* inout, size_t num_vectors) {
+  for (size_t j = 0; j < num_vectors; ++j) {
+    inout[j] = 1.0f - inout[j];
+  }
+}
+
+#define VECTORLITE_DEFINE_FLOAT8_API(name, T)                                 \
+  HWY_DLLEXPORT float InnerProduct(const T* v1, const T* v2,                  \
+                                   size_t num_elements) {                     \
+    return HWY_DYNAMIC_DISPATCH(InnerProductImplF8##name)(v1, v2,             \
+                                                          num_elements);      \
+  }                                                                           \
+  HWY_DLLEXPORT float InnerProduct(const float* v1, const T* v2,              \
+                                   size_t num_elements) {                     \
+    return HWY_DYNAMIC_DISPATCH(InnerProductImplF32F8##name)(v1, v2,          \
+                                                             num_elements);   \
+  }                                                                           \
+  HWY_DLLEXPORT float InnerProductDistance(const T* v1, const T* v2,          \
+                                           size_t num_elements) {             \
+    return 1.0f - InnerProduct(v1, v2, num_elements);                         \
+  }                                                                           \
+  HWY_DLLEXPORT float InnerProductDistance(const float* v1, const T* v2,      \
+                                           size_t num_elements) {             \
+    return 1.0f - InnerProduct(v1, v2, num_elements);                         \
+  }                                                                           \
+  HWY_DLLEXPORT float L2DistanceSquared(const T* v1, const T* v2,             \
+                                        size_t num_elements) {                \
+    if (HWY_UNLIKELY(v1 == v2)) {                                             \
+      return 0.0f;                                                            \
+    }                                                                         \
+    return HWY_DYNAMIC_DISPATCH(L2DistanceSquaredImplF8##name)(v1, v2,        \
+                                                               num_elements); \
+  }                                                                           \
+  HWY_DLLEXPORT float L2DistanceSquared(const float* v1, const T* v2,         \
+                                        size_t num_elements) {                \
+    return HWY_DYNAMIC_DISPATCH(L2DistanceSquaredImplF32F8##name)(            \
+        v1, v2, num_elements);                                                \
+  }                                                                           \
+  HWY_DLLEXPORT void InnerProductDistanceBatch(                               \
+      const T* query, const T* const* vectors, size_t num_vectors,            \
+      size_t num_elements, float* out) {                                      \
+    HWY_DYNAMIC_DISPATCH(InnerProductBatchPtrImplF8##name)(                   \
+        query, vectors, num_vectors, num_elements, out);                      \
+    InnerProductToDistance(out, num_vectors);                                 \
+  }                                                                           \
+  HWY_DLLEXPORT void L2DistanceSquaredBatch(                                  \
+      const T* query, const T* const* vectors, size_t num_vectors,            \
+      size_t num_elements, float* out) {                                      \
+    HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchPtrImplF8##name)(              \
+        query, vectors, num_vectors, num_elements, out);                      \
+  }                                                                           \
+  HWY_DLLEXPORT void InnerProductDistanceBatch(                               \
+      const float* query, const T* const* vectors, size_t num_vectors,        \
+      size_t num_elements, float* out) {                                      \
+    HWY_DYNAMIC_DISPATCH(InnerProductBatchPtrImplF32F8##name)(                \
+        query, vectors, num_vectors, num_elements, out);                      \
+    InnerProductToDistance(out, num_vectors);                                 \
+  }                                                                           \
+  HWY_DLLEXPORT void L2DistanceSquaredBatch(                                  \
+      const float* query, const T* const* vectors, size_t num_vectors,        \
+      size_t num_elements, float* out) {                                      \
+    HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchPtrImplF32F8##name)(           \
+        query, vectors, num_vectors, num_elements, out);                      \
+  }                                                                           \
+  HWY_DLLEXPORT void QuantizeF32ToF8(const float* HWY_RESTRICT in,            \
+                                     T* HWY_RESTRICT out,                     \
+                                     size_t num_elements) {                   \
+    HWY_DYNAMIC_DISPATCH(QuantizeF32ToF8##name##Impl)(in, out, num_elements); \
+  }                                                                           \
+  HWY_DLLEXPORT void F8ToF32(const T* HWY_RESTRICT in,                        \
+                             float* HWY_RESTRICT out, size_t num_elements) {  \
+    HWY_DYNAMIC_DISPATCH(F8##name##ToF32Impl)(in, out, num_elements);         \
+  }
+VECTORLITE_FOR_EACH_FLOAT8(VECTORLITE_DEFINE_FLOAT8_API)
+#undef VECTORLITE_DEFINE_FLOAT8_API
+
+HWY_DLLEXPORT void InnerProductDistanceBatch(const float* query,
+                                             const float* vectors,
+                                             size_t num_vectors,
+                                             size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchImplF32)(query, vectors, num_vectors,
+                                                 num_elements, out);
+  InnerProductToDistance(out, num_vectors);
+}
+
+HWY_DLLEXPORT void InnerProductDistanceBatch(const float* query,
+                                             const float* const* vectors,
+                                             size_t num_vectors,
+                                             size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchPtrImplF32)(query, vectors, num_vectors,
+                                                    num_elements, out);
+  InnerProductToDistance(out, num_vectors);
+}
+
+HWY_DLLEXPORT void InnerProductDistanceBatch(const hwy::bfloat16_t* query,
+                                             const hwy::bfloat16_t* vectors,
+                                             size_t num_vectors,
+                                             size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchImplBF16)(query, vectors, num_vectors,
+                                                  num_elements, out);
+  InnerProductToDistance(out, num_vectors);
+}
+
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const hwy::bfloat16_t* query, const hwy::bfloat16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchPtrImplBF16)(query, vectors,
+                                                     num_vectors, num_elements,
+                                                     out);
+  InnerProductToDistance(out, num_vectors);
+}
+
+HWY_DLLEXPORT void InnerProductDistanceBatch(const hwy::float16_t* query,
+                                             const hwy::float16_t* vectors,
+                                             size_t num_vectors,
+                                             size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchImplF16)(query, vectors, num_vectors,
+                                                 num_elements, out);
+  InnerProductToDistance(out, num_vectors);
+}
+
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const hwy::float16_t* query, const hwy::float16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchPtrImplF16)(query, vectors, num_vectors,
+                                                    num_elements, out);
+  InnerProductToDistance(out, num_vectors);
+}
+
+HWY_DLLEXPORT void InnerProductDistanceMatrix(const float* queries,
+                                              size_t num_queries,
+                                              const float* vectors,
+                                              size_t num_vectors,
+                                              size_t num_elements,
+                                              float* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductDistanceMatrixImplF32)(
+      queries, num_queries, vectors, num_vectors, num_elements, out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredMatrix(const float* queries,
+                                           size_t num_queries,
+                                           const float* vectors,
+                                           size_t num_vectors,
+                                           size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredMatrixImplF32)(
+      queries, num_queries, vectors, num_vectors, num_elements, out);
+}
+
+HWY_DLLEXPORT void InnerProductBatch(const int8_t* query, const int8_t* vectors,
+                                     size_t num_vectors, size_t num_elements,
+                                     int32_t* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchImplI8)(query, vectors, num_vectors,
+                                                num_elements, out);
+}
+
+HWY_DLLEXPORT void InnerProductBatch(const int8_t* query,
+                                     const int8_t* const* vectors,
+                                     size_t num_vectors, size_t num_elements,
+                                     int32_t* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchPtrImplI8)(query, vectors, num_vectors,
+                                                   num_elements, out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const float* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchImplF32)(query, vectors,
+                                                      num_vectors, num_elements,
+                                                      out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const float* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchPtrImplF32)(query, vectors,
+                                                         num_vectors,
+                                                         num_elements, out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const hwy::bfloat16_t* query,
+                                          const hwy::bfloat16_t* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchImplBF16)(query, vectors,
+                                                       num_vectors,
+                                                       num_elements, out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const hwy::bfloat16_t* query,
+                                          const hwy::bfloat16_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchPtrImplBF16)(query, vectors,
+                                                          num_vectors,
+                                                          num_elements, out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const hwy::float16_t* query,
+                                          const hwy::float16_t* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchImplF16)(query, vectors,
+                                                      num_vectors, num_elements,
+                                                      out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const hwy::float16_t* query,
+                                          const hwy::float16_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchPtrImplF16)(query, vectors,
+                                                         num_vectors,
+                                                         num_elements, out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const int8_t* query,
+                                          const int8_t* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, int32_t* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchImplI8)(query, vectors,
+                                                     num_vectors, num_elements,
+                                                     out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const int8_t* query,
+                                          const int8_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, int32_t* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchPtrImplI8)(query, vectors,
+                                                        num_vectors,
+                                                        num_elements, out);
+}
+
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const float* query, const hwy::bfloat16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchPtrImplF32BF16)(
+      query, vectors, num_vectors, num_elements, out);
+  InnerProductToDistance(out, num_vectors);
+}
+
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const float* query, const hwy::float16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(InnerProductBatchPtrImplF32F16)(
+      query, vectors, num_vectors, num_elements, out);
+  InnerProductToDistance(out, num_vectors);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const hwy::bfloat16_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchPtrImplF32BF16)(
+      query, vectors, num_vectors, num_elements, out);
+}
+
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const hwy::float16_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out) {
+  HWY_DYNAMIC_DISPATCH(L2DistanceSquaredBatchPtrImplF32F16)(
+      query, vectors, num_vectors, num_elements, out);
+}
+
+// HWY_DYNAMIC_POINTER returns an initialization stub rather than the best
+// target's function until the chosen target is known, so make sure it is.
+static void UpdateChosenTarget() {
+  hwy::GetChosenTarget().Update(hwy::SupportedTargets());
+}
+
+// Resolve* functions below return the chosen target's function, and expect
+// the chosen target to be up to date.
+static DistanceFunc ResolveFixedDimInnerProductDistance(size_t num_elements) {
+#define VECTORLITE_FIXED_DIM_CASE(dim) \
+  case dim:                            \
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncF32Dim##dim);
+  switch (num_elements) {
+    VECTORLITE_FOR_EACH_FIXED_DIM(VECTORLITE_FIXED_DIM_CASE)
+    default:
+      return nullptr;
+  }
+#undef VECTORLITE_FIXED_DIM_CASE
+}
+
+static DistanceFunc ResolveFixedDimL2DistanceSquared(size_t num_elements) {
+#define VECTORLITE_FIXED_DIM_CASE(dim) \
+  case dim:                            \
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncF32Dim##dim);
+  switch (num_elements) {
+    VECTORLITE_FOR_EACH_FIXED_DIM(VECTORLITE_FIXED_DIM_CASE)
+    default:
+      return nullptr;
+  }
+#undef VECTORLITE_FIXED_DIM_CASE
+}
+
+template <typename T>
+static DistanceFunc ResolveInnerProductDistanceFunc(size_t num_elements) {
+  if constexpr (std::is_same_v<T, float>) {
+    if (DistanceFunc func = ResolveFixedDimInnerProductDistance(num_elements)) {
+      return func;
+    }
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncF32);
+  } else if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncBF16);
+  } else if constexpr (std::is_same_v<T, float8_e4m3_t>) {
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncF8E4M3);
+  } else if constexpr (std::is_same_v<T, float8_e5m2_t>) {
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncF8E5M2);
+  } else {
+    static_assert(std::is_same_v<T, hwy::float16_t>, "Unsupported type");
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncF16);
+  }
+}
+
+template <typename T>
+static DistanceFunc ResolveL2DistanceSquaredFunc(size_t num_elements) {
+  if constexpr (std::is_same_v<T, float>) {
+    if (DistanceFunc func = ResolveFixedDimL2DistanceSquared(num_elements)) {
+      return func;
+    }
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncF32);
+  } else if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncBF16);
+  } else if constexpr (std::is_same_v<T, float8_e4m3_t>) {
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncF8E4M3);
+  } else if constexpr (std::is_same_v<T, float8_e5m2_t>) {
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncF8E5M2);
+  } else {
+    static_assert(std::is_same_v<T, hwy::float16_t>, "Unsupported type");
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncF16);
+  }
+}
+
+// Calls `resolve` with the TargetDistanceFuncs of each target that is compiled
+// in and supported by the CPU, and returns the functions it resolves, best
+// target first. Functions are taken from each target's namespace directly, so
+// the chosen target, which every other dispatch goes by, is left alone.
+template <class Resolve>
+static std::vector<DistanceFuncVariant> ResolveForEachTarget(Resolve resolve) {
+  std::vector<std::pair<int64_t, DistanceFunc>> funcs;
+  const int64_t supported = hwy::SupportedTargets();
+#define VECTORLITE_RESOLVE_TARGET(TARGET, NAMESPACE)                       \
+  if ((supported & (TARGET)) != 0) {                                       \
+    funcs.emplace_back(TARGET, resolve(NAMESPACE::TargetDistanceFuncs())); \
+  }
+  HWY_VISIT_TARGETS(VECTORLITE_RESOLVE_TARGET)
+#undef VECTORLITE_RESOLVE_TARGET
+  // Highway ranks targets by their bit, the lowest being the best.
+  std::sort(funcs.begin(), funcs.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+  std::vector<DistanceFuncVariant> variants;
+  variants.reserve(funcs.size());
+  for (const auto& [target, func] : funcs) {
+    variants.push_back({hwy::TargetName(target), func});
+  }
+  return variants;
+}
+
+HWY_DLLEXPORT DistanceFunc
+GetFixedDimInnerProductDistance(size_t num_elements) {
+  UpdateChosenTarget();
+  return ResolveFixedDimInnerProductDistance(num_elements);
+}
+
+HWY_DLLEXPORT DistanceFunc GetFixedDimL2DistanceSquared(size_t num_elements) {
+  UpdateChosenTarget();
+  return ResolveFixedDimL2DistanceSquared(num_elements);
+}
+
+template <typename T>
+HWY_DLLEXPORT DistanceFunc GetInnerProductDistanceFunc(size_t num_elements) {
+  UpdateChosenTarget();
+  return ResolveInnerProductDistanceFunc<T>(num_elements);
+}
+
+template <typename T>
+HWY_DLLEXPORT DistanceFunc GetL2DistanceSquaredFunc(size_t num_elements) {
+  UpdateChosenTarget();
+  return ResolveL2DistanceSquaredFunc<T>(num_elements);
+}
+
+template <typename T>
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetInnerProductDistanceFuncVariants(size_t num_elements) {
+  return ResolveForEachTarget([num_elements](auto target_funcs) {
+    return decltype(target_funcs)::template InnerProduct<T>(num_elements);
+  });
+}
+
+template <typename T>
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetL2DistanceSquaredFuncVariants(size_t num_elements) {
+  return ResolveForEachTarget([num_elements](auto target_funcs) {
+    return decltype(target_funcs)::template L2DistanceSquared<T>(num_elements);
+  });
+}
+
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetDotL2DistanceSquaredBF16FuncVariants() {
+  std::vector<DistanceFuncVariant> variants =
+      ResolveForEachTarget([](auto target_funcs) {
+        return decltype(target_funcs)::DotL2DistanceSquaredBF16();
+      });
+  variants.erase(std::remove_if(variants.begin(), variants.end(),
+                                [](const DistanceFuncVariant& variant) {
+                                  return variant.func == nullptr;
+                                }),
+                 variants.end());
+  return variants;
+}
+
+#define VECTORLITE_INSTANTIATE_DISTANCE_FUNC_GETTERS(T)                 \
+  template DistanceFunc GetInnerProductDistanceFunc<T>(size_t);         \
+  template DistanceFunc GetL2DistanceSquaredFunc<T>(size_t);            \
+  template std::vector<DistanceFuncVariant>                             \
+  GetInnerProductDistanceFuncVariants<T>(size_t);                       \
+  template std::vector<DistanceFuncVariant>                             \
+  GetL2DistanceSquaredFuncVariants<T>(size_t);
+VECTORLITE_INSTANTIATE_DISTANCE_FUNC_GETTERS(float)
+VECTORLITE_INSTANTIATE_DISTANCE_FUNC_GETTERS(hwy::bfloat16_t)
+VECTORLITE_INSTANTIATE_DISTANCE_FUNC_GETTERS(hwy::float16_t)
+VECTORLITE_INSTANTIATE_DISTANCE_FUNC_GETTERS(float8_e4m3_t)
+VECTORLITE_INSTANTIATE_DISTANCE_FUNC_GETTERS(float8_e5m2_t)
+#undef VECTORLITE_INSTANTIATE_DISTANCE_FUNC_GETTERS
+
+template <typename T>
+static DistanceFunc ResolveMixedInnerProductDistanceFunc() {
+  if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncF32BF16);
+  } else if constexpr (std::is_same_v<T, hwy::float16_t>) {
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncF32F16);
+  } else if constexpr (std::is_same_v<T, float8_e4m3_t>) {
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncF32F8E4M3);
+  } else {
+    static_assert(std::is_same_v<T, float8_e5m2_t>, "Unsupported type");
+    return HWY_DYNAMIC_POINTER(InnerProductDistanceFuncF32F8E5M2);
+  }
+}
+
+template <typename T>
+static DistanceFunc ResolveMixedL2DistanceSquaredFunc() {
+  if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncF32BF16);
+  } else if constexpr (std::is_same_v<T, hwy::float16_t>) {
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncF32F16);
+  } else if constexpr (std::is_same_v<T, float8_e4m3_t>) {
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncF32F8E4M3);
+  } else {
+    static_assert(std::is_same_v<T, float8_e5m2_t>, "Unsupported type");
+    return HWY_DYNAMIC_POINTER(L2DistanceSquaredFuncF32F8E5M2);
+  }
+}
+
+template <typename T>
+HWY_DLLEXPORT DistanceFunc GetMixedInnerProductDistanceFunc(
+    size_t num_elements) {
+  UpdateChosenTarget();
+  return ResolveMixedInnerProductDistanceFunc<T>();
+}
+
+template <typename T>
+HWY_DLLEXPORT DistanceFunc GetMixedL2DistanceSquaredFunc(size_t num_elements) {
+  UpdateChosenTarget();
+  return ResolveMixedL2DistanceSquaredFunc<T>();
+}
+
+template <typename T>
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetMixedInnerProductDistanceFuncVariants(size_t num_elements) {
+  return ResolveForEachTarget([](auto target_funcs) {
+    return decltype(target_funcs)::template MixedInnerProduct<T>();
+  });
+}
+
+template <typename T>
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetMixedL2DistanceSquaredFuncVariants(size_t num_elements) {
+  return ResolveForEachTarget([](auto target_funcs) {
+    return decltype(target_funcs)::template MixedL2DistanceSquared<T>();
+  });
+}
+
+#define VECTORLITE_INSTANTIATE_MIXED_DISTANCE_FUNC_GETTERS(T)        \
+  template DistanceFunc GetMixedInnerProductDistanceFunc<T>(size_t); \
+  template DistanceFunc GetMixedL2DistanceSquaredFunc<T>(size_t);    \
+  template std::vector<DistanceFuncVariant>                          \
+  GetMixedInnerProductDistanceFuncVariants<T>(size_t);               \
+  template std::vector<DistanceFuncVariant>                          \
+  GetMixedL2DistanceSquaredFuncVariants<T>(size_t);
+VECTORLITE_INSTANTIATE_MIXED_DISTANCE_FUNC_GETTERS(hwy::bfloat16_t)
+VECTORLITE_INSTANTIATE_MIXED_DISTANCE_FUNC_GETTERS(hwy::float16_t)
+VECTORLITE_INSTANTIATE_MIXED_DISTANCE_FUNC_GETTERS(float8_e4m3_t)
+VECTORLITE_INSTANTIATE_MIXED_DISTANCE_FUNC_GETTERS(float8_e5m2_t)
+#undef VECTORLITE_INSTANTIATE_MIXED_DISTANCE_FUNC_GETTERS
+
+HWY_DLLEXPORT Int8DistanceFunc GetInt8InnerProductFunc() {
+  UpdateChosenTarget();
+  return HWY_DYNAMIC_POINTER(InnerProductImplI8);
+}
+
+HWY_DLLEXPORT Int8DistanceFunc GetInt8L2DistanceSquaredFunc() {
+  UpdateChosenTarget();
+  return HWY_DYNAMIC_POINTER(L2DistanceSquaredImplI8);
+}
+
 // Implementation follows
 // https://github.com/nmslib/hnswlib/blob/v0.8.0/python_bindings/bindings.cpp#L241
 // Not sure whether compiler will do auto-vectorization for this function.
@@ -985,6 +3417,89 @@ HWY_DLLEXPORT void QuantizeF32ToBF16(const float* HWY_RESTRICT in,
   HWY_DYNAMIC_DISPATCH(QuantizeF32ToBF16Impl)(in, out, num_elements);
 }
 
+HWY_DLLEXPORT void NormalizeAndQuantizeF32ToF16(
+    const float* HWY_RESTRICT in, hwy::float16_t* HWY_RESTRICT out,
+    size_t num_elements) {
+  HWY_DYNAMIC_DISPATCH(NormalizeAndQuantizeF32ToF16Impl)(in, out,
+                                                         num_elements);
+}
+
+HWY_DLLEXPORT void NormalizeAndQuantizeF32ToBF16(
+    const float* HWY_RESTRICT in, hwy::bfloat16_t* HWY_RESTRICT out,
+    size_t num_elements) {
+  HWY_DYNAMIC_DISPATCH(NormalizeAndQuantizeF32ToBF16Impl)(in, out,
+                                                          num_elements);
+}
+
+HWY_DLLEXPORT void QuantizeF32ToI8(const float* HWY_RESTRICT in,
+                                   int8_t* HWY_RESTRICT out,
+                                   size_t num_elements, float scale,
+                                   float offset) {
+  HWY_DYNAMIC_DISPATCH(QuantizeF32ToI8Impl)(in, out, num_elements, scale,
+                                            offset);
+}
+
+HWY_DLLEXPORT void I8ToF32(const int8_t* HWY_RESTRICT in,
+                           float* HWY_RESTRICT out, size_t num_elements,
+                           float scale, float offset) {
+  HWY_DYNAMIC_DISPATCH(I8ToF32Impl)(in, out, num_elements, scale, offset);
+}
+
+HWY_DLLEXPORT uint64_t HammingDistance(const uint8_t* v1, const uint8_t* v2,
+                                       size_t num_bytes) {
+  return HWY_DYNAMIC_DISPATCH(HammingDistanceImpl)(v1, v2, num_bytes);
+}
+
+HWY_DLLEXPORT void HammingDistanceBatch(const uint8_t* query,
+                                       const uint8_t* const* vectors,
+                                       size_t num_vectors, size_t num_bytes,
+                                       uint64_t* out) {
+  HWY_DYNAMIC_DISPATCH(HammingDistanceBatchImpl)(query, vectors, num_vectors,
+                                                 num_bytes, out);
+}
+
+HWY_DLLEXPORT HammingDistanceFunc GetHammingDistanceFunc() {
+  UpdateChosenTarget();
+  return HWY_DYNAMIC_POINTER(HammingDistanceImpl);
+}
+
+HWY_DLLEXPORT void PQFastScanBlock(const uint8_t* HWY_RESTRICT lut,
+                                   const uint8_t* HWY_RESTRICT codes,
+                                   size_t num_subquantizers,
+                                   uint16_t* HWY_RESTRICT out) {
+  HWY_DYNAMIC_DISPATCH(PQFastScanBlockImpl)(lut, codes, num_subquantizers,
+                                            out);
+}
+
+HWY_DLLEXPORT size_t SelectTopK(const float* HWY_RESTRICT distances,
+                                size_t num, size_t k,
+                                uint32_t* HWY_RESTRICT out) {
+  if (k == 0 || num == 0) {
+    return 0;
+  }
+  HWY_DASSERT(num <= std::numeric_limits<uint32_t>::max());
+  return HWY_DYNAMIC_DISPATCH(SelectTopKImpl)(distances, num, k, out);
+}
+
+// Runs once per inserted or query vector, so plain scalar code is enough.
+HWY_DLLEXPORT void QuantizeF32ToBinary(const float* HWY_RESTRICT in,
+                                       uint8_t* HWY_RESTRICT out,
+                                       size_t num_elements) {
+  std::fill(out, out + BinaryCodeSize(num_elements), 0);
+  for (size_t i = 0; i < num_elements; ++i) {
+    if (in[i] > 0.0f) {
+      out[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+    }
+  }
+}
+
+HWY_DLLEXPORT void BinaryToF32(const uint8_t* HWY_RESTRICT in,
+                               float* HWY_RESTRICT out, size_t num_elements) {
+  for (size_t i = 0; i < num_elements; ++i) {
+    out[i] = (in[i / 8] >> (i % 8)) & 1 ? 1.0f : -1.0f;
+  }
+}
+
 HWY_DLLEXPORT void F16ToF32(const hwy::float16_t* HWY_RESTRICT in,
                             float* HWY_RESTRICT out, size_t num_elements) {
   HWY_DYNAMIC_DISPATCH(F16ToF32Impl)(in, out, num_elements);
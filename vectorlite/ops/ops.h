@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+#include <type_traits>
 #include <vector>
 
 #include "hwy/base.h"
@@ -12,10 +15,28 @@
 // while HNSWLIB can't(HNSWLIB uses Multiply-Add for AVX512 though). Due to
 // using dynamic dispatch, the performance gain is not as good when dealing with
 // vectors with less than 256 elements. Because the overhead of dynamic dispatch
-// is not negligible.
+// is not negligible. Hot paths can avoid that overhead by resolving the
+// dispatch once with the Get*Func functions below.
 namespace vectorlite {
 namespace ops {
 
+// 8-bit floating point elements, stored as their raw bits. E4M3 has 4 exponent
+// bits and 3 mantissa bits(max 448, no infinities), E5M2 has 5 exponent bits
+// and 2 mantissa bits(max 57344). Both keep far more dynamic range than int8
+// without needing a per-table calibration. Kernels decode them to float32 and
+// accumulate in float32.
+struct float8_e4m3_t {
+  uint8_t bits;
+};
+struct float8_e5m2_t {
+  uint8_t bits;
+};
+
+template <typename T>
+constexpr bool IsFloat8() {
+  return std::is_same_v<T, float8_e4m3_t> || std::is_same_v<T, float8_e5m2_t>;
+}
+
 // v1 and v2 MUST not be nullptr but can point to the same array.
 HWY_DLLEXPORT float InnerProduct(const float* v1, const float* v2,
                                  size_t num_elements);
@@ -34,6 +55,13 @@ HWY_DLLEXPORT float InnerProductDistance(const hwy::float16_t* v1,
                                          const hwy::float16_t* v2,
                                          size_t num_elements);
 
+// Returns 1 - cos(v1, v2). Same as InnerProductDistance of the normalized
+// vectors, but computes the inner product and both norms in one pass without
+// writing normalized copies. v1 and v2 MUST not be nullptr but can point to
+// the same array.
+HWY_DLLEXPORT float CosineDistance(const float* v1, const float* v2,
+                                   size_t num_elements);
+
 // v1 and v2 MUST not be nullptr but can point to the same array.
 HWY_DLLEXPORT float L2DistanceSquared(const float* v1, const float* v2,
                                       size_t num_elements);
@@ -53,6 +81,291 @@ HWY_DLLEXPORT float L2DistanceSquared(const float* HWY_RESTRICT v1,
                                       const hwy::bfloat16_t* HWY_RESTRICT v2,
                                       size_t num_elements);
 
+// v1 and v2 MUST not be nullptr.
+HWY_DLLEXPORT float L2DistanceSquared(const float* HWY_RESTRICT v1,
+                                      const hwy::float16_t* HWY_RESTRICT v2,
+                                      size_t num_elements);
+
+// Mixed precision inner product(distance) of a float32 vector and a half
+// precision vector. v1 and v2 MUST not be nullptr.
+HWY_DLLEXPORT float InnerProduct(const float* HWY_RESTRICT v1,
+                                 const hwy::bfloat16_t* HWY_RESTRICT v2,
+                                 size_t num_elements);
+HWY_DLLEXPORT float InnerProduct(const float* HWY_RESTRICT v1,
+                                 const hwy::float16_t* HWY_RESTRICT v2,
+                                 size_t num_elements);
+HWY_DLLEXPORT float InnerProductDistance(const float* HWY_RESTRICT v1,
+                                         const hwy::bfloat16_t* HWY_RESTRICT v2,
+                                         size_t num_elements);
+HWY_DLLEXPORT float InnerProductDistance(const float* HWY_RESTRICT v1,
+                                         const hwy::float16_t* HWY_RESTRICT v2,
+                                         size_t num_elements);
+
+// float8 inner product(distance) and squared L2 distance, either between two
+// float8 vectors or between a float32 vector(v1) and a float8 vector(v2).
+// v1 and v2 MUST not be nullptr but can point to the same array.
+HWY_DLLEXPORT float InnerProduct(const float8_e4m3_t* v1,
+                                 const float8_e4m3_t* v2, size_t num_elements);
+HWY_DLLEXPORT float InnerProduct(const float8_e5m2_t* v1,
+                                 const float8_e5m2_t* v2, size_t num_elements);
+HWY_DLLEXPORT float InnerProduct(const float* v1, const float8_e4m3_t* v2,
+                                 size_t num_elements);
+HWY_DLLEXPORT float InnerProduct(const float* v1, const float8_e5m2_t* v2,
+                                 size_t num_elements);
+HWY_DLLEXPORT float InnerProductDistance(const float8_e4m3_t* v1,
+                                         const float8_e4m3_t* v2,
+                                         size_t num_elements);
+HWY_DLLEXPORT float InnerProductDistance(const float8_e5m2_t* v1,
+                                         const float8_e5m2_t* v2,
+                                         size_t num_elements);
+HWY_DLLEXPORT float InnerProductDistance(const float* v1,
+                                         const float8_e4m3_t* v2,
+                                         size_t num_elements);
+HWY_DLLEXPORT float InnerProductDistance(const float* v1,
+                                         const float8_e5m2_t* v2,
+                                         size_t num_elements);
+HWY_DLLEXPORT float L2DistanceSquared(const float8_e4m3_t* v1,
+                                      const float8_e4m3_t* v2,
+                                      size_t num_elements);
+HWY_DLLEXPORT float L2DistanceSquared(const float8_e5m2_t* v1,
+                                      const float8_e5m2_t* v2,
+                                      size_t num_elements);
+HWY_DLLEXPORT float L2DistanceSquared(const float* v1, const float8_e4m3_t* v2,
+                                      size_t num_elements);
+HWY_DLLEXPORT float L2DistanceSquared(const float* v1, const float8_e5m2_t* v2,
+                                      size_t num_elements);
+
+// Integer inner product of two int8 vectors, accumulated in int32.
+// v1 and v2 MUST not be nullptr but can point to the same array. Callers must
+// keep num_elements <= kMaxInt8Elements so that the accumulator can't
+// overflow.
+HWY_DLLEXPORT int32_t InnerProduct(const int8_t* v1, const int8_t* v2,
+                                   size_t num_elements);
+
+// Integer squared L2 distance of two int8 vectors, accumulated in int32.
+// v1 and v2 MUST not be nullptr but can point to the same array. Callers must
+// keep num_elements <= kMaxInt8Elements so that the accumulator can't
+// overflow.
+HWY_DLLEXPORT int32_t L2DistanceSquared(const int8_t* v1, const int8_t* v2,
+                                        size_t num_elements);
+
+// Quantized int8 values are clamped to [-kInt8Max, kInt8Max], so the largest
+// per-element contribution to L2DistanceSquared is (2 * kInt8Max)^2.
+constexpr int32_t kInt8Max = 127;
+constexpr size_t kMaxInt8Elements =
+    std::numeric_limits<int32_t>::max() / (4 * kInt8Max * kInt8Max);
+
+// Batch versions of the distance functions above that score one query against
+// `num_vectors` vectors with a single dynamic dispatch, which matters for small
+// dimensions. `vectors` either points to vectors stored contiguously(row-major,
+// `num_elements` per vector) or is an array of `num_vectors` pointers.
+// out[j] receives the distance between `query` and the j-th vector, and must
+// not overlap the inputs.
+HWY_DLLEXPORT void InnerProductDistanceBatch(const float* query,
+                                             const float* vectors,
+                                             size_t num_vectors,
+                                             size_t num_elements, float* out);
+HWY_DLLEXPORT void InnerProductDistanceBatch(const float* query,
+                                             const float* const* vectors,
+                                             size_t num_vectors,
+                                             size_t num_elements, float* out);
+HWY_DLLEXPORT void InnerProductDistanceBatch(const hwy::bfloat16_t* query,
+                                             const hwy::bfloat16_t* vectors,
+                                             size_t num_vectors,
+                                             size_t num_elements, float* out);
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const hwy::bfloat16_t* query, const hwy::bfloat16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out);
+HWY_DLLEXPORT void InnerProductDistanceBatch(const hwy::float16_t* query,
+                                             const hwy::float16_t* vectors,
+                                             size_t num_vectors,
+                                             size_t num_elements, float* out);
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const hwy::float16_t* query, const hwy::float16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const float* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const float* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const hwy::bfloat16_t* query,
+                                          const hwy::bfloat16_t* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const hwy::bfloat16_t* query,
+                                          const hwy::bfloat16_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const hwy::float16_t* query,
+                                          const hwy::float16_t* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const hwy::float16_t* query,
+                                          const hwy::float16_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const float8_e4m3_t* query, const float8_e4m3_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out);
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const float8_e5m2_t* query, const float8_e5m2_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float8_e4m3_t* query,
+                                          const float8_e4m3_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float8_e5m2_t* query,
+                                          const float8_e5m2_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+
+// Batch versions of the mixed precision distance functions above, which take a
+// float32 query and an array of `num_vectors` pointers to vectors of lower
+// precision.
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const float* query, const hwy::bfloat16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out);
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const float* query, const hwy::float16_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out);
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const float* query, const float8_e4m3_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out);
+HWY_DLLEXPORT void InnerProductDistanceBatch(
+    const float* query, const float8_e5m2_t* const* vectors,
+    size_t num_vectors, size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const hwy::bfloat16_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const hwy::float16_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const float8_e4m3_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const float* query,
+                                          const float8_e5m2_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, float* out);
+
+// Distances between every pair of `num_queries` queries and `num_vectors`
+// vectors, both stored contiguously(row-major, `num_elements` per vector).
+// out[i * num_vectors + j] receives the distance between the i-th query and
+// the j-th vector, and must not overlap the inputs. Pairs are scored in tiles
+// of 4 queries by 2 vectors, so each load feeds several multiply-adds.
+HWY_DLLEXPORT void InnerProductDistanceMatrix(const float* queries,
+                                              size_t num_queries,
+                                              const float* vectors,
+                                              size_t num_vectors,
+                                              size_t num_elements, float* out);
+// Computed as |q|^2 + |v|^2 - 2 * q.v, so it's less accurate than
+// L2DistanceSquared for nearly identical vectors. Results are clamped to 0.
+HWY_DLLEXPORT void L2DistanceSquaredMatrix(const float* queries,
+                                           size_t num_queries,
+                                           const float* vectors,
+                                           size_t num_vectors,
+                                           size_t num_elements, float* out);
+
+// int8 batch versions. Results are the raw integer inner products/squared L2
+// distances, see the single pair versions above.
+HWY_DLLEXPORT void InnerProductBatch(const int8_t* query, const int8_t* vectors,
+                                     size_t num_vectors, size_t num_elements,
+                                     int32_t* out);
+HWY_DLLEXPORT void InnerProductBatch(const int8_t* query,
+                                     const int8_t* const* vectors,
+                                     size_t num_vectors, size_t num_elements,
+                                     int32_t* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const int8_t* query,
+                                          const int8_t* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, int32_t* out);
+HWY_DLLEXPORT void L2DistanceSquaredBatch(const int8_t* query,
+                                          const int8_t* const* vectors,
+                                          size_t num_vectors,
+                                          size_t num_elements, int32_t* out);
+
+// Distance function with the signature of hnswlib::DISTFUNC<float>, so that
+// it can be handed to hnswlib directly. v1 and v2 point to vectors and `param`
+// points to their number of elements as size_t.
+using DistanceFunc = float (*)(const void* v1, const void* v2,
+                               const void* param);
+
+// Integer inner product/squared L2 distance of int8 vectors, see above.
+using Int8DistanceFunc = int32_t (*)(const int8_t* v1, const int8_t* v2,
+                                     size_t num_elements);
+
+// Below Get*Func functions resolve Highway's dynamic dispatch once and return
+// the best target's implementation. Calling the returned pointer skips the
+// dispatch overhead that InnerProductDistance/L2DistanceSquared pay on every
+// call, which matters for small vectors. T is float, hwy::bfloat16_t,
+// hwy::float16_t, float8_e4m3_t or float8_e5m2_t.
+template <typename T>
+HWY_DLLEXPORT DistanceFunc GetInnerProductDistanceFunc(size_t num_elements);
+template <typename T>
+HWY_DLLEXPORT DistanceFunc GetL2DistanceSquaredFunc(size_t num_elements);
+
+// A distance function compiled for one SIMD target.
+struct DistanceFuncVariant {
+  // hwy::TargetName of the target, e.g. "AVX2".
+  const char* target;
+  DistanceFunc func;
+};
+
+// Returns what GetInnerProductDistanceFunc/GetL2DistanceSquaredFunc would
+// return for every target that is compiled in and supported by the CPU, best
+// target first. The best target by Highway's ranking is not always the fastest
+// one for a given dimension, so callers can time the variants and pick.
+template <typename T>
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetInnerProductDistanceFuncVariants(size_t num_elements);
+template <typename T>
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetL2DistanceSquaredFuncVariants(size_t num_elements);
+// bf16 squared L2 distance computed as a.a + b.b - 2 * a.b with native bf16
+// dot instructions, for every target that has them(AVX512-BF16, AVX10,
+// SVE/NEON BF16) and is supported by the CPU, best target first. Pairs that
+// are close relative to their norms are recomputed with the default kernel, so
+// these are only faster on far apart vectors. They are never used by default;
+// callers can time them against GetL2DistanceSquaredFuncVariants' functions.
+// Empty if no such target is available.
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetDotL2DistanceSquaredBF16FuncVariants();
+// Mixed precision versions for searching T(hwy::bfloat16_t, hwy::float16_t,
+// float8_e4m3_t or float8_e5m2_t) vectors with a float32 query: the returned
+// function's first argument is a float32 vector and the second one is a T
+// vector.
+template <typename T>
+HWY_DLLEXPORT DistanceFunc GetMixedInnerProductDistanceFunc(
+    size_t num_elements);
+template <typename T>
+HWY_DLLEXPORT DistanceFunc GetMixedL2DistanceSquaredFunc(size_t num_elements);
+// Like GetInnerProductDistanceFuncVariants/GetL2DistanceSquaredFuncVariants,
+// for the mixed precision functions above.
+template <typename T>
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetMixedInnerProductDistanceFuncVariants(size_t num_elements);
+template <typename T>
+HWY_DLLEXPORT std::vector<DistanceFuncVariant>
+GetMixedL2DistanceSquaredFuncVariants(size_t num_elements);
+HWY_DLLEXPORT Int8DistanceFunc GetInt8InnerProductFunc();
+HWY_DLLEXPORT Int8DistanceFunc GetInt8L2DistanceSquaredFunc();
+
+// Returns a float kernel with a compile-time trip count and no remainder
+// handling if `num_elements` is one of the common embedding sizes 128, 256,
+// 384, 512, 768, 1024, 1536 or 3072. Otherwise returns nullptr. The returned
+// function ignores `param`. GetInnerProductDistanceFunc<float> and
+// GetL2DistanceSquaredFunc<float> already prefer these kernels.
+HWY_DLLEXPORT DistanceFunc
+GetFixedDimInnerProductDistance(size_t num_elements);
+HWY_DLLEXPORT DistanceFunc GetFixedDimL2DistanceSquared(size_t num_elements);
+
 // Nornalize the input vector in place.
 HWY_DLLEXPORT void Normalize(float* HWY_RESTRICT inout, size_t num_elements);
 HWY_DLLEXPORT void Normalize(hwy::float16_t* HWY_RESTRICT inout,
@@ -60,6 +373,11 @@ HWY_DLLEXPORT void Normalize(hwy::float16_t* HWY_RESTRICT inout,
 HWY_DLLEXPORT void Normalize(hwy::bfloat16_t* HWY_RESTRICT inout,
                              size_t num_elements);
 
+// Writes the normalized `in` to `out` in one pass, without modifying `in`.
+// `in` and `out` must not overlap.
+HWY_DLLEXPORT void NormalizeTo(const float* HWY_RESTRICT in,
+                               float* HWY_RESTRICT out, size_t num_elements);
+
 // Normalize the input vector in place. Implemented using non-SIMD code for
 // testing and benchmarking purposes.
 HWY_DLLEXPORT void Normalize_Scalar(float* HWY_RESTRICT inout,
@@ -89,6 +407,101 @@ HWY_DLLEXPORT void QuantizeF32ToBF16(const float* HWY_RESTRICT in,
                                      hwy::bfloat16_t* HWY_RESTRICT out,
                                      size_t num_elements);
 
+// Equivalent to NormalizeTo followed by QuantizeF32ToF16/BF16, but the
+// normalized floats are demoted as they are computed instead of being written
+// to a temporary buffer. The result is slightly more accurate than
+// quantizing first and normalizing the 16-bit vector.
+HWY_DLLEXPORT void NormalizeAndQuantizeF32ToF16(
+    const float* HWY_RESTRICT in, hwy::float16_t* HWY_RESTRICT out,
+    size_t num_elements);
+HWY_DLLEXPORT void NormalizeAndQuantizeF32ToBF16(
+    const float* HWY_RESTRICT in, hwy::bfloat16_t* HWY_RESTRICT out,
+    size_t num_elements);
+
+// Rounds to the nearest float8 value(ties to even). Values beyond the largest
+// finite float8 value saturate to it, and NaN becomes 0.
+HWY_DLLEXPORT void QuantizeF32ToF8(const float* HWY_RESTRICT in,
+                                   float8_e4m3_t* HWY_RESTRICT out,
+                                   size_t num_elements);
+HWY_DLLEXPORT void QuantizeF32ToF8(const float* HWY_RESTRICT in,
+                                   float8_e5m2_t* HWY_RESTRICT out,
+                                   size_t num_elements);
+// Exact, every float8 value is representable in float32.
+HWY_DLLEXPORT void F8ToF32(const float8_e4m3_t* HWY_RESTRICT in,
+                           float* HWY_RESTRICT out, size_t num_elements);
+HWY_DLLEXPORT void F8ToF32(const float8_e5m2_t* HWY_RESTRICT in,
+                           float* HWY_RESTRICT out, size_t num_elements);
+
+// Affine int8 quantization: out[i] = clamp(round((in[i] - offset) / scale),
+// -kInt8Max, kInt8Max). scale must be positive.
+HWY_DLLEXPORT void QuantizeF32ToI8(const float* HWY_RESTRICT in,
+                                   int8_t* HWY_RESTRICT out,
+                                   size_t num_elements, float scale,
+                                   float offset);
+
+// Inverse of QuantizeF32ToI8: out[i] = in[i] * scale + offset.
+HWY_DLLEXPORT void I8ToF32(const int8_t* HWY_RESTRICT in,
+                           float* HWY_RESTRICT out, size_t num_elements,
+                           float scale, float offset);
+
+// Binary(1-bit) quantization keeps only the sign of each element: bit i of
+// the code is set iff element i is positive. Bits are packed 8 per byte,
+// lowest bit first.
+constexpr size_t BinaryCodeSize(size_t num_elements) {
+  return (num_elements + 7) / 8;
+}
+
+// out must point to BinaryCodeSize(num_elements) bytes. Padding bits are 0.
+HWY_DLLEXPORT void QuantizeF32ToBinary(const float* HWY_RESTRICT in,
+                                       uint8_t* HWY_RESTRICT out,
+                                       size_t num_elements);
+
+// Inverse of QuantizeF32ToBinary as far as possible: set bits become 1.0 and
+// unset bits become -1.0.
+HWY_DLLEXPORT void BinaryToF32(const uint8_t* HWY_RESTRICT in,
+                               float* HWY_RESTRICT out, size_t num_elements);
+
+// Number of bits that differ between v1 and v2, each `num_bytes` long.
+// v1 and v2 MUST not be nullptr but can point to the same array.
+HWY_DLLEXPORT uint64_t HammingDistance(const uint8_t* v1, const uint8_t* v2,
+                                       size_t num_bytes);
+
+using HammingDistanceFunc = uint64_t (*)(const uint8_t* v1, const uint8_t* v2,
+                                         size_t num_bytes);
+
+// HammingDistance resolved to the best SIMD target, see Get*Func above.
+HWY_DLLEXPORT HammingDistanceFunc GetHammingDistanceFunc();
+
+// Writes HammingDistance(query, vectors[i], num_bytes) to out[i] for each of
+// the num_vectors vectors, with a single dynamic dispatch.
+HWY_DLLEXPORT void HammingDistanceBatch(const uint8_t* query,
+                                       const uint8_t* const* vectors,
+                                       size_t num_vectors, size_t num_bytes,
+                                       uint64_t* out);
+
+// Number of vectors PQFastScanBlock scores per call.
+constexpr size_t kPQFastScanBlockSize = 16;
+
+// Product quantization fast-scan over one block of kPQFastScanBlockSize
+// vectors with 4-bit codes. `lut` holds num_subquantizers tables of 16 uint8
+// entries. `codes` is transposed: byte j * kPQFastScanBlockSize + i is the
+// code(0-15) of vector i for subquantizer j. Writes
+// out[i] = sum_j lut[j * 16 + code(i, j)] for each vector i.
+// num_subquantizers MUST be at most 257 so that the u16 sums don't overflow.
+HWY_DLLEXPORT void PQFastScanBlock(const uint8_t* HWY_RESTRICT lut,
+                                   const uint8_t* HWY_RESTRICT codes,
+                                   size_t num_subquantizers,
+                                   uint16_t* HWY_RESTRICT out);
+
+// Finds the k smallest of `num` distances and writes their indices to `out`,
+// closest first. Equal distances are ordered by index. NaN distances are
+// never selected. Returns the number of indices written, which is
+// min(k, num) unless there are NaNs. `out` MUST have room for min(k, num)
+// indices and num MUST fit in uint32_t.
+HWY_DLLEXPORT size_t SelectTopK(const float* HWY_RESTRICT distances,
+                                size_t num, size_t k,
+                                uint32_t* HWY_RESTRICT out);
+
 // Convert fp16/bf16 to fp32, useful for json serde
 HWY_DLLEXPORT void F16ToF32(const hwy::float16_t* HWY_RESTRICT in,
                             float* HWY_RESTRICT out, size_t num_elements);
@@ -1,6 +1,15 @@
 #include <hwy/base.h>
+#include <hwy/targets.h>
+#include <hwy/timer.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <queue>
 #include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 #include "hnswlib/hnswlib.h"
@@ -233,6 +242,31 @@ static void BM_QuantizeF32ToBF16(benchmark::State& state) {
   }
 }
 
+// The insert path of a normalized bf16 table before fusing: quantize into a
+// new vector, then normalize it.
+static void BM_QuantizeThenNormalize_BF16(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+
+  for (auto _ : state) {
+    std::vector<hwy::bfloat16_t> out(dim);
+    vectorlite::ops::QuantizeF32ToBF16(v1.data(), out.data(), dim);
+    vectorlite::ops::Normalize(out.data(), dim);
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_NormalizeAndQuantizeF32ToBF16(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  std::vector<hwy::bfloat16_t> out(dim);
+
+  for (auto _ : state) {
+    vectorlite::ops::NormalizeAndQuantizeF32ToBF16(v1.data(), out.data(), dim);
+    benchmark::ClobberMemory();
+  }
+}
+
 static void BM_F16ToF32(benchmark::State& state) {
   size_t dim = state.range(0);
   auto v1 = GenerateOneRandomVector(dim);
@@ -259,6 +293,589 @@ static void BM_BF16ToF32(benchmark::State& state) {
   }
 }
 
+static void BM_CosineDistance_Vectorlite(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  auto v2 = GenerateOneRandomVector(dim);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        vectorlite::ops::CosineDistance(v1.data(), v2.data(), dim));
+    benchmark::ClobberMemory();
+  }
+}
+
+// What cosine distance used to cost: normalize copies of both vectors, then
+// take their inner product distance.
+static void BM_CosineDistance_NormalizeCopies(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  auto v2 = GenerateOneRandomVector(dim);
+
+  for (auto _ : state) {
+    std::vector<float> n1 = v1;
+    std::vector<float> n2 = v2;
+    vectorlite::ops::Normalize(n1.data(), dim);
+    vectorlite::ops::Normalize(n2.data(), dim);
+    benchmark::DoNotOptimize(
+        vectorlite::ops::InnerProductDistance(n1.data(), n2.data(), dim));
+    benchmark::ClobberMemory();
+  }
+}
+
+// Scores one query against 64 vectors. Compare with 64 calls to the single
+// pair version to see the saved dispatch overhead.
+static constexpr size_t kBatchSize = 64;
+
+static void BM_InnerProductDistanceBatch_Vectorlite(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto query = GenerateOneRandomVector(dim);
+  std::vector<float> vectors;
+  vectors.reserve(dim * kBatchSize);
+  for (size_t i = 0; i < kBatchSize; ++i) {
+    auto v = GenerateOneRandomVector(dim);
+    vectors.insert(vectors.end(), v.begin(), v.end());
+  }
+  std::vector<float> out(kBatchSize);
+
+  for (auto _ : state) {
+    vectorlite::ops::InnerProductDistanceBatch(query.data(), vectors.data(),
+                                               kBatchSize, dim, out.data());
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_InnerProductDistance_Vectorlite_Loop(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto query = GenerateOneRandomVector(dim);
+  std::vector<float> vectors;
+  vectors.reserve(dim * kBatchSize);
+  for (size_t i = 0; i < kBatchSize; ++i) {
+    auto v = GenerateOneRandomVector(dim);
+    vectors.insert(vectors.end(), v.begin(), v.end());
+  }
+  std::vector<float> out(kBatchSize);
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < kBatchSize; ++i) {
+      out[i] = vectorlite::ops::InnerProductDistance(
+          query.data(), vectors.data() + i * dim, dim);
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_L2DistanceSquaredBatch_Vectorlite(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto query = GenerateOneRandomVector(dim);
+  std::vector<float> vectors;
+  vectors.reserve(dim * kBatchSize);
+  for (size_t i = 0; i < kBatchSize; ++i) {
+    auto v = GenerateOneRandomVector(dim);
+    vectors.insert(vectors.end(), v.begin(), v.end());
+  }
+  std::vector<float> out(kBatchSize);
+
+  for (auto _ : state) {
+    vectorlite::ops::L2DistanceSquaredBatch(query.data(), vectors.data(),
+                                            kBatchSize, dim, out.data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// kBatchSize queries against kBatchSize vectors, scored one query at a time
+// with the batch kernel or all at once with the matrix kernel.
+static void BM_L2DistanceSquaredBatch_Vectorlite_PerQuery(
+    benchmark::State& state) {
+  size_t dim = state.range(0);
+  std::vector<float> vectors;
+  vectors.reserve(dim * kBatchSize);
+  for (size_t i = 0; i < kBatchSize; ++i) {
+    auto v = GenerateOneRandomVector(dim);
+    vectors.insert(vectors.end(), v.begin(), v.end());
+  }
+  std::vector<float> out(kBatchSize * kBatchSize);
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < kBatchSize; ++i) {
+      vectorlite::ops::L2DistanceSquaredBatch(vectors.data() + i * dim,
+                                              vectors.data(), kBatchSize, dim,
+                                              out.data() + i * kBatchSize);
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_L2DistanceSquaredMatrix_Vectorlite(benchmark::State& state) {
+  size_t dim = state.range(0);
+  std::vector<float> vectors;
+  vectors.reserve(dim * kBatchSize);
+  for (size_t i = 0; i < kBatchSize; ++i) {
+    auto v = GenerateOneRandomVector(dim);
+    vectors.insert(vectors.end(), v.begin(), v.end());
+  }
+  std::vector<float> out(kBatchSize * kBatchSize);
+
+  for (auto _ : state) {
+    vectorlite::ops::L2DistanceSquaredMatrix(vectors.data(), kBatchSize,
+                                             vectors.data(), kBatchSize, dim,
+                                             out.data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// Same kernel as BM_InnerProduct_Vectorlite, but with dynamic dispatch resolved
+// up front like vector spaces do.
+static void BM_InnerProduct_Vectorlite_Resolved(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  auto v2 = GenerateOneRandomVector(dim);
+  auto func = vectorlite::ops::GetInnerProductDistanceFunc<float>(dim);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(v1.data(), v2.data(), &dim));
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_L2DistanceSquared_Vectorlite_Resolved(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  auto v2 = GenerateOneRandomVector(dim);
+  auto func = vectorlite::ops::GetL2DistanceSquaredFunc<float>(dim);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(v1.data(), v2.data(), &dim));
+    benchmark::ClobberMemory();
+  }
+}
+
+// Generic and fixed-dimension kernels side by side. Both are benchmarked
+// through a function pointer, which is how hnswlib calls them.
+static void BM_InnerProduct_Vectorlite_GenericDim(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  auto v2 = GenerateOneRandomVector(dim);
+  float (*func)(const float*, const float*, size_t) =
+      vectorlite::ops::InnerProductDistance;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(v1.data(), v2.data(), dim));
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_InnerProduct_Vectorlite_FixedDim(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  auto v2 = GenerateOneRandomVector(dim);
+  auto func = vectorlite::ops::GetFixedDimInnerProductDistance(dim);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(v1.data(), v2.data(), nullptr));
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_L2DistanceSquared_Vectorlite_GenericDim(
+    benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  auto v2 = GenerateOneRandomVector(dim);
+  float (*func)(const float*, const float*, size_t) =
+      vectorlite::ops::L2DistanceSquared;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(v1.data(), v2.data(), dim));
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_L2DistanceSquared_Vectorlite_FixedDim(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  auto v2 = GenerateOneRandomVector(dim);
+  auto func = vectorlite::ops::GetFixedDimL2DistanceSquared(dim);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(v1.data(), v2.data(), nullptr));
+    benchmark::ClobberMemory();
+  }
+}
+
+// Compare with BM_InnerProduct_Vectorlite of the same dimension.
+static void BM_HammingDistance_Vectorlite(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateOneRandomVector(dim);
+  auto v2 = GenerateOneRandomVector(dim);
+  std::vector<uint8_t> b1(vectorlite::ops::BinaryCodeSize(dim));
+  std::vector<uint8_t> b2(vectorlite::ops::BinaryCodeSize(dim));
+  vectorlite::ops::QuantizeF32ToBinary(v1.data(), b1.data(), dim);
+  vectorlite::ops::QuantizeF32ToBinary(v2.data(), b2.data(), dim);
+  auto func = vectorlite::ops::GetHammingDistanceFunc();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(b1.data(), b2.data(), b1.size()));
+    benchmark::ClobberMemory();
+  }
+}
+
+// Scores kBatchSize binary codes of dimension state.range(0) against a query.
+static void BM_HammingDistanceBatch_Vectorlite(benchmark::State& state) {
+  size_t dim = state.range(0);
+  const size_t code_size = vectorlite::ops::BinaryCodeSize(dim);
+  std::vector<uint8_t> codes(code_size * (kBatchSize + 1));
+  for (size_t i = 0; i <= kBatchSize; ++i) {
+    auto v = GenerateOneRandomVector(dim);
+    vectorlite::ops::QuantizeF32ToBinary(v.data(), codes.data() + i * code_size,
+                                         dim);
+  }
+  const uint8_t* query = codes.data() + kBatchSize * code_size;
+  std::vector<const uint8_t*> code_ptrs;
+  for (size_t i = 0; i < kBatchSize; ++i) {
+    code_ptrs.push_back(codes.data() + i * code_size);
+  }
+  std::vector<uint64_t> out(kBatchSize);
+
+  for (auto _ : state) {
+    vectorlite::ops::HammingDistanceBatch(query, code_ptrs.data(), kBatchSize,
+                                          code_size, out.data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// Scores kPQFastScanBlockSize codes with state.range(0) subquantizers.
+static void BM_PQFastScanBlock_Vectorlite(benchmark::State& state) {
+  size_t num_subquantizers = state.range(0);
+  std::vector<uint8_t> lut(num_subquantizers * 16);
+  std::vector<uint8_t> codes(num_subquantizers *
+                             vectorlite::ops::kPQFastScanBlockSize);
+  for (size_t i = 0; i < lut.size(); ++i) {
+    lut[i] = static_cast<uint8_t>(i * 37);
+  }
+  for (size_t i = 0; i < codes.size(); ++i) {
+    codes[i] = static_cast<uint8_t>(i % 16);
+  }
+  uint16_t out[vectorlite::ops::kPQFastScanBlockSize];
+
+  for (auto _ : state) {
+    vectorlite::ops::PQFastScanBlock(lut.data(), codes.data(),
+                                     num_subquantizers, out);
+    benchmark::DoNotOptimize(out);
+    benchmark::ClobberMemory();
+  }
+}
+
+static std::vector<float> GenerateRandomDistances(size_t num) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dis(0.0f, 1000.0f);
+  std::vector<float> distances(num);
+  for (float& distance : distances) {
+    distance = dis(gen);
+  }
+  return distances;
+}
+
+// Baseline: a max-heap of the k best (distance, index) pairs, popped into
+// ascending order.
+static void BM_SelectTopK_PriorityQueue(benchmark::State& state) {
+  size_t num = state.range(0);
+  size_t k = state.range(1);
+  auto distances = GenerateRandomDistances(num);
+  std::vector<uint32_t> out(k);
+
+  for (auto _ : state) {
+    std::priority_queue<std::pair<float, uint32_t>> heap;
+    for (size_t i = 0; i < num; ++i) {
+      if (heap.size() < k) {
+        heap.emplace(distances[i], static_cast<uint32_t>(i));
+      } else if (distances[i] < heap.top().first) {
+        heap.pop();
+        heap.emplace(distances[i], static_cast<uint32_t>(i));
+      }
+    }
+    for (size_t i = heap.size(); i > 0; --i) {
+      out[i - 1] = heap.top().second;
+      heap.pop();
+    }
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * num);
+}
+
+static void BM_SelectTopK_Vectorlite(benchmark::State& state) {
+  size_t num = state.range(0);
+  size_t k = state.range(1);
+  auto distances = GenerateRandomDistances(num);
+  std::vector<uint32_t> out(k);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        vectorlite::ops::SelectTopK(distances.data(), num, k, out.data()));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * num);
+}
+
+// The benchmarks below measure kernels the way they run in practice rather
+// than on one pair of vectors that stays in L1. They report bytes_per_second
+// (GB/s) of vector data read and distances_per_second.
+
+// `num_elements` uniformly distributed random values converted to T.
+template <typename T>
+static std::vector<T> GenerateRandomData(size_t num_elements) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::vector<float> data(num_elements);
+  for (float& value : data) {
+    value = dis(gen);
+  }
+  if constexpr (std::is_same_v<T, float>) {
+    return data;
+  } else {
+    std::vector<T> converted(num_elements);
+    if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+      vectorlite::ops::QuantizeF32ToBF16(data.data(), converted.data(),
+                                         num_elements);
+    } else {
+      static_assert(std::is_same_v<T, hwy::float16_t>, "Unsupported type");
+      vectorlite::ops::QuantizeF32ToF16(data.data(), converted.data(),
+                                        num_elements);
+    }
+    return converted;
+  }
+}
+
+// Scores `query` against the vectors of `data` in `order` with `func` on every
+// iteration, reporting throughput counters.
+template <typename T>
+static void ScoreVectors(benchmark::State& state,
+                         vectorlite::ops::DistanceFunc func, const T* query,
+                         const std::vector<T>& data, size_t dim,
+                         const std::vector<uint32_t>& order) {
+  for (auto _ : state) {
+    float sum = 0.0f;
+    for (uint32_t i : order) {
+      sum += func(query, data.data() + i * dim, &dim);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * order.size() * dim *
+                          sizeof(T));
+  state.counters["distances_per_second"] = benchmark::Counter(
+      static_cast<double>(state.iterations() * order.size()),
+      benchmark::Counter::kIsRate);
+}
+
+// Scores a query against a data set of state.range(0) KiB of dim
+// state.range(1) vectors. If state.range(2) is 1, vectors are visited in a
+// random order, like HNSW traversal visits neighbors, which defeats hardware
+// prefetching. Data sets that exceed L1, L2 or L3 show how far the kernel
+// falls behind its in-cache speed once it becomes memory bound.
+template <typename T>
+static void BM_L2DistanceSquared_WorkingSet(benchmark::State& state) {
+  const size_t working_set_bytes = state.range(0) * 1024;
+  size_t dim = state.range(1);
+  const bool random_order = state.range(2);
+  const size_t num_vectors =
+      std::max<size_t>(1, working_set_bytes / (dim * sizeof(T)));
+  auto data = GenerateRandomData<T>(num_vectors * dim);
+  auto query = GenerateRandomData<T>(dim);
+  std::vector<uint32_t> order(num_vectors);
+  for (size_t i = 0; i < num_vectors; ++i) {
+    order[i] = static_cast<uint32_t>(i);
+  }
+  if (random_order) {
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+  }
+
+  ScoreVectors(state, vectorlite::ops::GetL2DistanceSquaredFunc<T>(dim),
+               query.data(), data, dim, order);
+}
+
+// Distance of one pair of in-cache vectors through Highway's dynamic dispatch,
+// through a function pointer resolved once, and with hnswlib's kernel. At
+// small dimensions the per-call overhead is a large share of the total.
+static void BM_SmallDim_L2DistanceSquared_Dispatched(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateRandomData<float>(dim);
+  auto v2 = GenerateRandomData<float>(2 * dim);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        vectorlite::ops::L2DistanceSquared(v1.data(), v2.data() + dim, dim));
+    benchmark::ClobberMemory();
+  }
+  state.counters["distances_per_second"] = benchmark::Counter(
+      static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+static void BM_SmallDim_L2DistanceSquared_Resolved(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateRandomData<float>(dim);
+  auto v2 = GenerateRandomData<float>(2 * dim);
+  auto func = vectorlite::ops::GetL2DistanceSquaredFunc<float>(dim);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(v1.data(), v2.data() + dim, &dim));
+    benchmark::ClobberMemory();
+  }
+  state.counters["distances_per_second"] = benchmark::Counter(
+      static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+static void BM_SmallDim_L2DistanceSquared_HNSWLIB(benchmark::State& state) {
+  size_t dim = state.range(0);
+  auto v1 = GenerateRandomData<float>(dim);
+  auto v2 = GenerateRandomData<float>(2 * dim);
+  hnswlib::L2Space space(dim);
+  auto func = space.get_dist_func();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(func(v1.data(), v2.data() + dim, &dim));
+    benchmark::ClobberMemory();
+  }
+  state.counters["distances_per_second"] = benchmark::Counter(
+      static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+// Converts state.range(0) elements from In to Out. Besides GB/s of data read
+// and written, reports bytes_per_cycle, measured with the CPU's invariant
+// timestamp counter, i.e. cycles at the nominal frequency.
+template <typename In, typename Out>
+static void BM_ConversionThroughput(benchmark::State& state) {
+  const size_t num_elements = state.range(0);
+  auto in = GenerateRandomData<In>(num_elements);
+  std::vector<Out> out(num_elements);
+
+  const hwy::timer::Ticks start = hwy::timer::Start();
+  for (auto _ : state) {
+    if constexpr (std::is_same_v<Out, hwy::bfloat16_t>) {
+      vectorlite::ops::QuantizeF32ToBF16(in.data(), out.data(), num_elements);
+    } else if constexpr (std::is_same_v<Out, hwy::float16_t>) {
+      vectorlite::ops::QuantizeF32ToF16(in.data(), out.data(), num_elements);
+    } else if constexpr (std::is_same_v<In, hwy::bfloat16_t>) {
+      vectorlite::ops::BF16ToF32(in.data(), out.data(), num_elements);
+    } else {
+      static_assert(std::is_same_v<In, hwy::float16_t>, "Unsupported types");
+      vectorlite::ops::F16ToF32(in.data(), out.data(), num_elements);
+    }
+    benchmark::ClobberMemory();
+  }
+  const hwy::timer::Ticks ticks = hwy::timer::Stop() - start;
+
+  const size_t bytes =
+      state.iterations() * num_elements * (sizeof(In) + sizeof(Out));
+  state.SetBytesProcessed(bytes);
+  state.counters["bytes_per_cycle"] =
+      static_cast<double>(bytes) / static_cast<double>(ticks);
+}
+
+// Per-target comparison: the same data set of 1024 vectors scored with the
+// kernel of every target that is compiled in and supported by the CPU. Each
+// target is registered as its own benchmark, e.g.
+// BM_L2DistanceSquared_PerTarget_F32/AVX2/768.
+template <typename T>
+static void BM_DistancePerTarget(benchmark::State& state,
+                                 vectorlite::ops::DistanceFunc func) {
+  constexpr size_t kNumVectors = 1024;
+  size_t dim = state.range(0);
+  auto data = GenerateRandomData<T>(kNumVectors * dim);
+  auto query = GenerateRandomData<T>(dim);
+  std::vector<uint32_t> order(kNumVectors);
+  for (size_t i = 0; i < kNumVectors; ++i) {
+    order[i] = static_cast<uint32_t>(i);
+  }
+  ScoreVectors(state, func, query.data(), data, dim, order);
+}
+
+// Like BM_DistancePerTarget<hwy::bfloat16_t>, but every vector is the query
+// plus 1% noise, as near neighbors are during graph search. The native bf16
+// dot kernels recompute such pairs with the promoting kernel.
+static void BM_L2DistanceSquaredNearNeighborsBF16(
+    benchmark::State& state, vectorlite::ops::DistanceFunc func) {
+  constexpr size_t kNumVectors = 1024;
+  size_t dim = state.range(0);
+  auto query = GenerateRandomData<float>(dim);
+  auto noise = GenerateRandomData<float>(kNumVectors * dim);
+  std::vector<float> floats(kNumVectors * dim);
+  for (size_t i = 0; i < floats.size(); ++i) {
+    floats[i] = query[i % dim] + 0.01f * noise[i];
+  }
+  std::vector<hwy::bfloat16_t> bf16_query(dim);
+  vectorlite::ops::QuantizeF32ToBF16(query.data(), bf16_query.data(), dim);
+  std::vector<hwy::bfloat16_t> data(floats.size());
+  vectorlite::ops::QuantizeF32ToBF16(floats.data(), data.data(),
+                                     floats.size());
+  std::vector<uint32_t> order(kNumVectors);
+  for (size_t i = 0; i < kNumVectors; ++i) {
+    order[i] = static_cast<uint32_t>(i);
+  }
+  ScoreVectors(state, func, bf16_query.data(), data, dim, order);
+}
+
+template <typename T>
+static void RegisterPerTargetBenchmarks(const std::string& type_name) {
+  // Variants are resolved per dimension, but only fixed-dimension kernels
+  // differ between dimensions, so resolve them for a generic dimension.
+  constexpr size_t kGenericDim = 1;
+  auto register_variants =
+      [&](const std::string& name,
+          const std::vector<vectorlite::ops::DistanceFuncVariant>& variants) {
+        for (const auto& variant : variants) {
+          benchmark::RegisterBenchmark(
+              (name + "_" + type_name + "/" + variant.target).c_str(),
+              BM_DistancePerTarget<T>, variant.func)
+              ->RangeMultiplier(4)
+              ->Range(16, 4096);
+        }
+      };
+  register_variants(
+      "BM_L2DistanceSquared_PerTarget",
+      vectorlite::ops::GetL2DistanceSquaredFuncVariants<T>(kGenericDim));
+  register_variants(
+      "BM_InnerProductDistance_PerTarget",
+      vectorlite::ops::GetInnerProductDistanceFuncVariants<T>(kGenericDim));
+}
+
+// Registered during static initialization like BENCHMARK(), as
+// benchmark_main provides main().
+static const bool kPerTargetBenchmarksRegistered = [] {
+  RegisterPerTargetBenchmarks<float>("F32");
+  RegisterPerTargetBenchmarks<hwy::bfloat16_t>("BF16");
+  RegisterPerTargetBenchmarks<hwy::float16_t>("F16");
+  // Native bf16 dot kernels next to BM_L2DistanceSquared_PerTarget_BF16 of
+  // the same target, which promotes to f32, on random vectors and on near
+  // neighbors. Only targets with bf16 dot instructions are compared.
+  auto register_near_neighbors = [](const std::string& name,
+                                    vectorlite::ops::DistanceFunc func) {
+    benchmark::RegisterBenchmark(
+        ("BM_L2DistanceSquared_NearNeighbors_" + name).c_str(),
+        BM_L2DistanceSquaredNearNeighborsBF16, func)
+        ->RangeMultiplier(4)
+        ->Range(16, 4096);
+  };
+  const auto promote_variants =
+      vectorlite::ops::GetL2DistanceSquaredFuncVariants<hwy::bfloat16_t>(1);
+  for (const auto& dot_variant :
+       vectorlite::ops::GetDotL2DistanceSquaredBF16FuncVariants()) {
+    const std::string target = dot_variant.target;
+    benchmark::RegisterBenchmark(
+        ("BM_L2DistanceSquared_PerTarget_BF16Dot/" + target).c_str(),
+        BM_DistancePerTarget<hwy::bfloat16_t>, dot_variant.func)
+        ->RangeMultiplier(4)
+        ->Range(16, 4096);
+    register_near_neighbors("BF16Dot/" + target, dot_variant.func);
+    for (const auto& variant : promote_variants) {
+      if (target == variant.target) {
+        register_near_neighbors("BF16/" + target, variant.func);
+      }
+    }
+  }
+  return true;
+}();
+
 BENCHMARK(BM_InnerProduct_Scalar)
     ->ArgsProduct({
         benchmark::CreateRange(128, 8 << 11, 2), {0, 1}  // self product
@@ -277,6 +894,10 @@ BENCHMARK(BM_InnerProduct_Vectorlite_BF16)
 BENCHMARK(BM_InnerProduct_Vectorlite_F16)
     ->RangeMultiplier(2)
     ->Range(128, 8 << 11);
+BENCHMARK(BM_CosineDistance_Vectorlite)->RangeMultiplier(2)->Range(16, 8 << 11);
+BENCHMARK(BM_CosineDistance_NormalizeCopies)
+    ->RangeMultiplier(2)
+    ->Range(16, 8 << 11);
 BENCHMARK(BM_Normalize_Vectorlite)->RangeMultiplier(2)->Range(128, 8 << 11);
 BENCHMARK(BM_Normalize_Vectorlite_BF16)->RangeMultiplier(2)->Range(128, 8 << 11);
 BENCHMARK(BM_Normalize_Vectorlite_F16)->RangeMultiplier(2)->Range(128, 8 << 11);
@@ -296,5 +917,84 @@ BENCHMARK(BM_L2DistanceSquared_HNSWLIB)
     ->Range(128, 8 << 11);
 BENCHMARK(BM_QuantizeF32ToF16)->RangeMultiplier(2)->Range(128, 8 << 11);
 BENCHMARK(BM_QuantizeF32ToBF16)->RangeMultiplier(2)->Range(128, 8 << 11);
+BENCHMARK(BM_QuantizeThenNormalize_BF16)
+    ->RangeMultiplier(2)
+    ->Range(128, 8 << 11);
+BENCHMARK(BM_NormalizeAndQuantizeF32ToBF16)
+    ->RangeMultiplier(2)
+    ->Range(128, 8 << 11);
 BENCHMARK(BM_F16ToF32)->RangeMultiplier(2)->Range(128, 8 << 11);
-BENCHMARK(BM_BF16ToF32)->RangeMultiplier(2)->Range(128, 8 << 11);
\ No newline at end of file
+BENCHMARK(BM_BF16ToF32)->RangeMultiplier(2)->Range(128, 8 << 11);
+BENCHMARK(BM_InnerProductDistanceBatch_Vectorlite)
+    ->RangeMultiplier(2)
+    ->Range(16, 8 << 11);
+BENCHMARK(BM_InnerProductDistance_Vectorlite_Loop)
+    ->RangeMultiplier(2)
+    ->Range(16, 8 << 11);
+BENCHMARK(BM_L2DistanceSquaredBatch_Vectorlite)
+    ->RangeMultiplier(2)
+    ->Range(16, 8 << 11);
+BENCHMARK(BM_L2DistanceSquaredBatch_Vectorlite_PerQuery)
+    ->RangeMultiplier(2)
+    ->Range(16, 8 << 11);
+BENCHMARK(BM_L2DistanceSquaredMatrix_Vectorlite)
+    ->RangeMultiplier(2)
+    ->Range(16, 8 << 11);
+// Dimensions with fixed-dimension kernels.
+static void FixedDims(benchmark::internal::Benchmark* b) {
+  for (int dim : {128, 256, 384, 512, 768, 1024, 1536, 3072}) {
+    b->Arg(dim);
+  }
+}
+BENCHMARK(BM_InnerProduct_Vectorlite_GenericDim)->Apply(FixedDims);
+BENCHMARK(BM_InnerProduct_Vectorlite_FixedDim)->Apply(FixedDims);
+BENCHMARK(BM_L2DistanceSquared_Vectorlite_GenericDim)->Apply(FixedDims);
+BENCHMARK(BM_L2DistanceSquared_Vectorlite_FixedDim)->Apply(FixedDims);
+BENCHMARK(BM_InnerProduct_Vectorlite_Resolved)
+    ->RangeMultiplier(2)
+    ->Range(16, 8 << 11);
+BENCHMARK(BM_L2DistanceSquared_Vectorlite_Resolved)
+    ->RangeMultiplier(2)
+    ->Range(16, 8 << 11);
+BENCHMARK(BM_HammingDistance_Vectorlite)
+    ->RangeMultiplier(2)
+    ->Range(128, 8 << 11);
+BENCHMARK(BM_HammingDistanceBatch_Vectorlite)
+    ->RangeMultiplier(2)
+    ->Range(128, 8 << 11);
+BENCHMARK(BM_PQFastScanBlock_Vectorlite)->RangeMultiplier(2)->Range(8, 256);
+BENCHMARK(BM_SelectTopK_PriorityQueue)
+    ->ArgsProduct({{1000, 10000, 50000}, {10, 100}});
+BENCHMARK(BM_SelectTopK_Vectorlite)
+    ->ArgsProduct({{1000, 10000, 50000}, {10, 100}});
+// Working sets of 16 KiB to 256 MiB, i.e. from L1-resident to DRAM-resident on
+// typical CPUs, visited in sequential and random order.
+static void WorkingSets(benchmark::internal::Benchmark* b) {
+  b->ArgsProduct({{16, 256, 4 << 10, 64 << 10, 256 << 10}, {128, 768}, {0, 1}});
+}
+BENCHMARK_TEMPLATE(BM_L2DistanceSquared_WorkingSet, float)->Apply(WorkingSets);
+BENCHMARK_TEMPLATE(BM_L2DistanceSquared_WorkingSet, hwy::bfloat16_t)
+    ->Apply(WorkingSets);
+BENCHMARK_TEMPLATE(BM_L2DistanceSquared_WorkingSet, hwy::float16_t)
+    ->Apply(WorkingSets);
+static void SmallDims(benchmark::internal::Benchmark* b) {
+  for (int dim : {16, 24, 32, 48, 64, 96, 128, 192, 256}) {
+    b->Arg(dim);
+  }
+}
+BENCHMARK(BM_SmallDim_L2DistanceSquared_Dispatched)->Apply(SmallDims);
+BENCHMARK(BM_SmallDim_L2DistanceSquared_Resolved)->Apply(SmallDims);
+BENCHMARK(BM_SmallDim_L2DistanceSquared_HNSWLIB)->Apply(SmallDims);
+// 1 Ki to 16 Mi elements.
+BENCHMARK_TEMPLATE(BM_ConversionThroughput, float, hwy::bfloat16_t)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 24);
+BENCHMARK_TEMPLATE(BM_ConversionThroughput, float, hwy::float16_t)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 24);
+BENCHMARK_TEMPLATE(BM_ConversionThroughput, hwy::bfloat16_t, float)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 24);
+BENCHMARK_TEMPLATE(BM_ConversionThroughput, hwy::float16_t, float)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 24);
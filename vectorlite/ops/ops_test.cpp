@@ -1,10 +1,21 @@
 #include "ops.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
 #include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "hnswlib/hnswlib.h"
 #include "hwy/base.h"
+#include "hwy/targets.h"
 
 static std::vector<std::vector<float>> GenerateRandomVectors(size_t num_vectors,
                                                              size_t dim) {
@@ -28,8 +39,42 @@ static std::vector<std::vector<float>> GenerateRandomVectors(size_t num_vectors,
   return data;
 }
 
+static std::vector<std::vector<int8_t>> GenerateRandomInt8Vectors(
+    size_t num_vectors, size_t dim) {
+  std::vector<std::vector<int8_t>> data;
+
+  data.reserve(num_vectors);
+
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<> dis(-vectorlite::ops::kInt8Max,
+                                      vectorlite::ops::kInt8Max);
+
+  for (int i = 0; i < num_vectors; ++i) {
+    std::vector<int8_t> vec;
+    vec.reserve(dim);
+    for (int j = 0; j < dim; ++j) {
+      vec.push_back(static_cast<int8_t>(dis(gen)));
+    }
+    data.push_back(vec);
+  }
+
+  return data;
+}
+
 static constexpr float kEpsilon = 1e-3;
 
+// Runs `test` once per SIMD target that is both compiled in and supported by
+// the CPU, so that target-specific kernels are all covered.
+static void ForEachTarget(const std::function<void()>& test) {
+  for (int64_t target : hwy::SupportedAndGeneratedTargets()) {
+    SCOPED_TRACE(hwy::TargetName(target));
+    hwy::SetSupportedTargetsForTest(target);
+    test();
+  }
+  hwy::SetSupportedTargetsForTest(0);
+}
+
 TEST(InnerProduct, ShouldReturnZeroForEmptyVectors) {
   // Fixes C2466: cannot allocate an array of constant size 0 on MSVC
   float v1[] = {1};
@@ -147,6 +192,48 @@ TEST(InnerProductDistance, ShouldReturnSimilarResultToHNSWLIB) {
   }
 }
 
+TEST(CosineDistance, ShouldMatchNormalizedInnerProductDistance) {
+  ForEachTarget([] {
+    for (size_t dim = 1; dim <= 300; dim++) {
+      auto vectors = GenerateRandomVectors(4, dim);
+      for (int i = 0; i < vectors.size(); ++i) {
+        for (int j = 0; j < vectors.size(); ++j) {
+          std::vector<float> v1 = vectors[i];
+          std::vector<float> v2 = vectors[j];
+          float result =
+              vectorlite::ops::CosineDistance(v1.data(), v2.data(), dim);
+          vectorlite::ops::Normalize_Scalar(v1.data(), dim);
+          vectorlite::ops::Normalize_Scalar(v2.data(), dim);
+          EXPECT_NEAR(result,
+                      vectorlite::ops::InnerProductDistance(v1.data(),
+                                                            v2.data(), dim),
+                      1e-5);
+        }
+      }
+    }
+  });
+}
+
+TEST(CosineDistance, ShouldHandleSpecialVectors) {
+  std::vector<float> v = {3, 0, -4, 0, 0};
+  std::vector<float> zero(v.size(), 0.0f);
+  std::vector<float> scaled = {300, 0, -400, 0, 0};
+  std::vector<float> negated = {-3, 0, 4, 0, 0};
+  EXPECT_NEAR(vectorlite::ops::CosineDistance(v.data(), v.data(), v.size()),
+              0.0f, 1e-6);
+  EXPECT_NEAR(
+      vectorlite::ops::CosineDistance(v.data(), scaled.data(), v.size()), 0.0f,
+      1e-6);
+  EXPECT_NEAR(
+      vectorlite::ops::CosineDistance(v.data(), negated.data(), v.size()),
+      2.0f, 1e-6);
+  // Like normalizing, a zero vector stays zero.
+  EXPECT_FLOAT_EQ(
+      vectorlite::ops::CosineDistance(v.data(), zero.data(), v.size()), 1.0f);
+  EXPECT_FLOAT_EQ(vectorlite::ops::CosineDistance(v.data(), v.data(), 0),
+                  1.0f);
+}
+
 TEST(L2DistanceSquared, ShouldReturnZeroForEmptyVectors) {
   // Fixes C2466: cannot allocate an array of constant size 0 on MSVC
   float v1[] = {1};
@@ -203,6 +290,77 @@ TEST(L2DistanceSquared_BF16, ShouldWorkWithRandomVectors) {
   }
 }
 
+static float L2DistanceSquaredBF16Exact(const hwy::bfloat16_t* v1,
+                                        const hwy::bfloat16_t* v2,
+                                        size_t dim) {
+  double sum = 0;
+  for (size_t k = 0; k < dim; ++k) {
+    double diff = hwy::F32FromBF16(v1[k]) - hwy::F32FromBF16(v2[k]);
+    sum += diff * diff;
+  }
+  return static_cast<float>(sum);
+}
+
+// Random bf16 vectors of `dim` elements, plus a copy of the first one with one
+// element 1 ulp larger.
+static std::vector<std::vector<hwy::bfloat16_t>> GenerateBF16VectorsAndNeighbor(
+    size_t dim) {
+  auto vectors = GenerateRandomVectors(5, dim);
+  std::vector<std::vector<hwy::bfloat16_t>> bf16_vectors;
+  for (const auto& v : vectors) {
+    std::vector<hwy::bfloat16_t> bf16(dim);
+    vectorlite::ops::QuantizeF32ToBF16(v.data(), bf16.data(), dim);
+    bf16_vectors.push_back(bf16);
+  }
+
+  std::vector<hwy::bfloat16_t> neighbor = bf16_vectors[0];
+  uint16_t bits;
+  std::memcpy(&bits, &neighbor[dim / 2], sizeof(bits));
+  ++bits;
+  std::memcpy(&neighbor[dim / 2], &bits, sizeof(bits));
+  bf16_vectors.push_back(neighbor);
+  return bf16_vectors;
+}
+
+TEST(L2DistanceSquared_BF16, ShouldBeAccurateOnEveryTarget) {
+  ForEachTarget([] {
+    for (size_t dim : {1, 7, 32, 100, 128, 768}) {
+      auto bf16_vectors = GenerateBF16VectorsAndNeighbor(dim);
+      for (const auto& v1 : bf16_vectors) {
+        for (const auto& v2 : bf16_vectors) {
+          const float expected =
+              L2DistanceSquaredBF16Exact(v1.data(), v2.data(), dim);
+          EXPECT_NEAR(
+              vectorlite::ops::L2DistanceSquared(v1.data(), v2.data(), dim),
+              expected, 1e-3 * expected + 1e-6)
+              << " dim = " << dim;
+        }
+      }
+    }
+  });
+}
+
+// The native bf16 dot kernels must stay accurate for nearly identical vectors
+// too. There are none on CPUs without bf16 dot instructions.
+TEST(L2DistanceSquared_BF16, DotKernelsShouldBeAccurate) {
+  for (const auto& variant :
+       vectorlite::ops::GetDotL2DistanceSquaredBF16FuncVariants()) {
+    SCOPED_TRACE(variant.target);
+    for (size_t dim : {1, 7, 32, 100, 128, 768}) {
+      auto bf16_vectors = GenerateBF16VectorsAndNeighbor(dim);
+      for (const auto& v1 : bf16_vectors) {
+        for (const auto& v2 : bf16_vectors) {
+          const float expected =
+              L2DistanceSquaredBF16Exact(v1.data(), v2.data(), dim);
+          EXPECT_NEAR(variant.func(v1.data(), v2.data(), &dim), expected,
+                      1e-3 * expected + 1e-6)
+              << " dim = " << dim;
+        }
+      }
+    }
+  }
+}
+
 TEST(L2DistanceSquared_F16, ShouldWorkWithRandomVectors) {
   for (size_t dim = 1; dim <= 128; dim++) {
     auto vectors = GenerateRandomVectors(10, dim);
@@ -253,6 +411,554 @@ TEST(L2DistanceSquared_F32_BF16, ShouldWorkWithRandomVectors) {
   }
 }
 
+TEST(L2DistanceSquared_F32_F16, ShouldWorkWithRandomVectors) {
+  for (size_t dim = 1; dim <= 128; dim++) {
+    auto vectors = GenerateRandomVectors(2, dim);
+    for (int i = 0; i < vectors.size(); ++i) {
+      for (int j = 0; j < vectors.size(); ++j) {
+        const auto& v1 = vectors[i];
+        const auto& v2 = vectors[j];
+
+        std::vector<hwy::float16_t> v2_f16(dim);
+        vectorlite::ops::QuantizeF32ToF16(v2.data(), v2_f16.data(), dim);
+
+        float result =
+            vectorlite::ops::L2DistanceSquared(v1.data(), v2_f16.data(), dim);
+        float expected = 0;
+        for (int k = 0; k < dim; ++k) {
+          float diff = v1[k] - hwy::F32FromF16(v2_f16[k]);
+          expected += diff * diff;
+        }
+        EXPECT_NEAR(result, expected, kEpsilon) << " dim = " << dim;
+      }
+    }
+  }
+}
+
+TEST(InnerProduct_F32_BF16_F16, ShouldWorkWithRandomVectors) {
+  for (size_t dim = 1; dim <= 128; dim++) {
+    auto vectors = GenerateRandomVectors(2, dim);
+    const auto& v1 = vectors[0];
+    const auto& v2 = vectors[1];
+
+    std::vector<hwy::bfloat16_t> v2_bf16(dim);
+    std::vector<hwy::float16_t> v2_f16(dim);
+    vectorlite::ops::QuantizeF32ToBF16(v2.data(), v2_bf16.data(), dim);
+    vectorlite::ops::QuantizeF32ToF16(v2.data(), v2_f16.data(), dim);
+
+    float expected_bf16 = 0;
+    float expected_f16 = 0;
+    for (int k = 0; k < dim; ++k) {
+      expected_bf16 += v1[k] * hwy::F32FromBF16(v2_bf16[k]);
+      expected_f16 += v1[k] * hwy::F32FromF16(v2_f16[k]);
+    }
+    EXPECT_NEAR(
+        vectorlite::ops::InnerProduct(v1.data(), v2_bf16.data(), dim),
+        expected_bf16, kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(vectorlite::ops::InnerProduct(v1.data(), v2_f16.data(), dim),
+                expected_f16, kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(
+        vectorlite::ops::InnerProductDistance(v1.data(), v2_bf16.data(), dim),
+        1.0f - expected_bf16, kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(
+        vectorlite::ops::InnerProductDistance(v1.data(), v2_f16.data(), dim),
+        1.0f - expected_f16, kEpsilon)
+        << " dim = " << dim;
+
+    auto ip_bf16 =
+        vectorlite::ops::GetMixedInnerProductDistanceFunc<hwy::bfloat16_t>(dim);
+    auto ip_f16 =
+        vectorlite::ops::GetMixedInnerProductDistanceFunc<hwy::float16_t>(dim);
+    auto l2_bf16 =
+        vectorlite::ops::GetMixedL2DistanceSquaredFunc<hwy::bfloat16_t>(dim);
+    auto l2_f16 =
+        vectorlite::ops::GetMixedL2DistanceSquaredFunc<hwy::float16_t>(dim);
+    EXPECT_NEAR(ip_bf16(v1.data(), v2_bf16.data(), &dim), 1.0f - expected_bf16,
+                kEpsilon);
+    EXPECT_NEAR(ip_f16(v1.data(), v2_f16.data(), &dim), 1.0f - expected_f16,
+                kEpsilon);
+    EXPECT_NEAR(
+        l2_bf16(v1.data(), v2_bf16.data(), &dim),
+        vectorlite::ops::L2DistanceSquared(v1.data(), v2_bf16.data(), dim),
+        kEpsilon);
+    EXPECT_NEAR(
+        l2_f16(v1.data(), v2_f16.data(), &dim),
+        vectorlite::ops::L2DistanceSquared(v1.data(), v2_f16.data(), dim),
+        kEpsilon);
+  }
+}
+
+TEST(InnerProduct_I8, ShouldWorkWithRandomVectors) {
+  for (int dim = 0; dim <= 300; dim++) {
+    auto vectors = GenerateRandomInt8Vectors(10, dim);
+    for (int i = 0; i < vectors.size(); ++i) {
+      for (int j = 0; j < vectors.size(); ++j) {
+        const auto& v1 = vectors[i];
+        const auto& v2 = vectors[j];
+        int32_t expected = 0;
+        for (int k = 0; k < dim; ++k) {
+          expected += static_cast<int32_t>(v1[k]) * v2[k];
+        }
+        // Integer arithmetic is exact regardless of the accumulation order.
+        EXPECT_EQ(vectorlite::ops::InnerProduct(v1.data(), v2.data(), dim),
+                  expected)
+            << " dim = " << dim;
+      }
+    }
+  }
+}
+
+TEST(L2DistanceSquared_I8, ShouldWorkWithRandomVectors) {
+  for (int dim = 0; dim <= 300; dim++) {
+    auto vectors = GenerateRandomInt8Vectors(10, dim);
+    for (int i = 0; i < vectors.size(); ++i) {
+      for (int j = 0; j < vectors.size(); ++j) {
+        const auto& v1 = vectors[i];
+        const auto& v2 = vectors[j];
+        int32_t expected = 0;
+        for (int k = 0; k < dim; ++k) {
+          int32_t diff = static_cast<int32_t>(v1[k]) - v2[k];
+          expected += diff * diff;
+        }
+        EXPECT_EQ(
+            vectorlite::ops::L2DistanceSquared(v1.data(), v2.data(), dim),
+            expected)
+            << " dim = " << dim;
+      }
+    }
+  }
+}
+
+TEST(L2DistanceSquared_I8, ShouldNotOverflowAtMaxElements) {
+  const size_t dim = vectorlite::ops::kMaxInt8Elements;
+  std::vector<int8_t> v1(dim, vectorlite::ops::kInt8Max);
+  std::vector<int8_t> v2(dim, -vectorlite::ops::kInt8Max);
+  int64_t expected = static_cast<int64_t>(dim) * 4 * vectorlite::ops::kInt8Max *
+                     vectorlite::ops::kInt8Max;
+  EXPECT_EQ(vectorlite::ops::L2DistanceSquared(v1.data(), v2.data(), dim),
+            expected);
+}
+
+// Batch results must match the single pair functions. Dimensions and batch
+// sizes cover the 4-row blocked kernel, its remainder rows and SIMD tails.
+TEST(InnerProductDistanceBatch, ShouldMatchSinglePairResults) {
+  for (int dim = 1; dim <= 67; dim += 3) {
+    for (int num_vectors : {0, 1, 3, 4, 9}) {
+      auto query = GenerateRandomVectors(1, dim)[0];
+      auto vectors = GenerateRandomVectors(num_vectors, dim);
+      std::vector<float> contiguous;
+      std::vector<const float*> pointers;
+      for (const auto& v : vectors) {
+        contiguous.insert(contiguous.end(), v.begin(), v.end());
+        pointers.push_back(v.data());
+      }
+
+      std::vector<float> out(num_vectors);
+      std::vector<float> out_ptr(num_vectors);
+      vectorlite::ops::InnerProductDistanceBatch(
+          query.data(), contiguous.data(), num_vectors, dim, out.data());
+      vectorlite::ops::InnerProductDistanceBatch(
+          query.data(), pointers.data(), num_vectors, dim, out_ptr.data());
+      for (int i = 0; i < num_vectors; ++i) {
+        float expected = vectorlite::ops::InnerProductDistance(
+            query.data(), vectors[i].data(), dim);
+        EXPECT_NEAR(out[i], expected, kEpsilon) << " dim = " << dim;
+        EXPECT_NEAR(out_ptr[i], expected, kEpsilon) << " dim = " << dim;
+      }
+    }
+  }
+}
+
+TEST(InnerProductDistanceBatch_BF16_F16, ShouldMatchSinglePairResults) {
+  const int dim = 37;
+  const int num_vectors = 7;
+  auto query = GenerateRandomVectors(1, dim)[0];
+  auto vectors = GenerateRandomVectors(num_vectors, dim);
+
+  std::vector<hwy::bfloat16_t> query_bf16(dim);
+  std::vector<hwy::float16_t> query_f16(dim);
+  vectorlite::ops::QuantizeF32ToBF16(query.data(), query_bf16.data(), dim);
+  vectorlite::ops::QuantizeF32ToF16(query.data(), query_f16.data(), dim);
+  std::vector<hwy::bfloat16_t> contiguous_bf16(dim * num_vectors);
+  std::vector<hwy::float16_t> contiguous_f16(dim * num_vectors);
+  std::vector<const hwy::bfloat16_t*> pointers_bf16;
+  std::vector<const hwy::float16_t*> pointers_f16;
+  for (int i = 0; i < num_vectors; ++i) {
+    vectorlite::ops::QuantizeF32ToBF16(vectors[i].data(),
+                                       &contiguous_bf16[i * dim], dim);
+    vectorlite::ops::QuantizeF32ToF16(vectors[i].data(),
+                                      &contiguous_f16[i * dim], dim);
+    pointers_bf16.push_back(&contiguous_bf16[i * dim]);
+    pointers_f16.push_back(&contiguous_f16[i * dim]);
+  }
+
+  std::vector<float> out_bf16(num_vectors);
+  std::vector<float> out_bf16_ptr(num_vectors);
+  std::vector<float> out_f16(num_vectors);
+  std::vector<float> out_f16_ptr(num_vectors);
+  vectorlite::ops::InnerProductDistanceBatch(query_bf16.data(),
+                                             contiguous_bf16.data(),
+                                             num_vectors, dim, out_bf16.data());
+  vectorlite::ops::InnerProductDistanceBatch(
+      query_bf16.data(), pointers_bf16.data(), num_vectors, dim,
+      out_bf16_ptr.data());
+  vectorlite::ops::InnerProductDistanceBatch(query_f16.data(),
+                                             contiguous_f16.data(),
+                                             num_vectors, dim, out_f16.data());
+  vectorlite::ops::InnerProductDistanceBatch(query_f16.data(),
+                                             pointers_f16.data(), num_vectors,
+                                             dim, out_f16_ptr.data());
+  for (int i = 0; i < num_vectors; ++i) {
+    float expected_bf16 = vectorlite::ops::InnerProductDistance(
+        query_bf16.data(), pointers_bf16[i], dim);
+    float expected_f16 = vectorlite::ops::InnerProductDistance(
+        query_f16.data(), pointers_f16[i], dim);
+    EXPECT_NEAR(out_bf16[i], expected_bf16, kEpsilon);
+    EXPECT_NEAR(out_bf16_ptr[i], expected_bf16, kEpsilon);
+    EXPECT_NEAR(out_f16[i], expected_f16, kEpsilon);
+    EXPECT_NEAR(out_f16_ptr[i], expected_f16, kEpsilon);
+  }
+}
+
+TEST(L2DistanceSquaredBatch, ShouldMatchSinglePairResults) {
+  for (int dim = 1; dim <= 67; dim += 3) {
+    for (int num_vectors : {0, 1, 3, 4, 9}) {
+      auto query = GenerateRandomVectors(1, dim)[0];
+      auto vectors = GenerateRandomVectors(num_vectors, dim);
+      std::vector<float> contiguous;
+      std::vector<const float*> pointers;
+      for (const auto& v : vectors) {
+        contiguous.insert(contiguous.end(), v.begin(), v.end());
+        pointers.push_back(v.data());
+      }
+
+      std::vector<float> out(num_vectors);
+      std::vector<float> out_ptr(num_vectors);
+      vectorlite::ops::L2DistanceSquaredBatch(
+          query.data(), contiguous.data(), num_vectors, dim, out.data());
+      vectorlite::ops::L2DistanceSquaredBatch(
+          query.data(), pointers.data(), num_vectors, dim, out_ptr.data());
+      for (int i = 0; i < num_vectors; ++i) {
+        float expected = vectorlite::ops::L2DistanceSquared(
+            query.data(), vectors[i].data(), dim);
+        EXPECT_NEAR(out[i], expected, kEpsilon) << " dim = " << dim;
+        EXPECT_NEAR(out_ptr[i], expected, kEpsilon) << " dim = " << dim;
+      }
+    }
+  }
+}
+
+TEST(L2DistanceSquaredBatch, ShouldReturnZeroForQueryInBatch) {
+  auto vectors = GenerateRandomVectors(2, 16);
+  const float* pointers[] = {vectors[0].data(), vectors[1].data()};
+  float out[2];
+  vectorlite::ops::L2DistanceSquaredBatch(vectors[1].data(), pointers, 2, 16,
+                                          out);
+  EXPECT_GT(out[0], 0.0f);
+  EXPECT_EQ(out[1], 0.0f);
+}
+
+TEST(Batch_I8, ShouldMatchSinglePairResults) {
+  for (int dim = 0; dim <= 67; dim += 3) {
+    for (int num_vectors : {0, 1, 3, 4, 9}) {
+      auto query = GenerateRandomInt8Vectors(1, dim)[0];
+      auto vectors = GenerateRandomInt8Vectors(num_vectors, dim);
+      std::vector<int8_t> contiguous;
+      std::vector<const int8_t*> pointers;
+      for (const auto& v : vectors) {
+        contiguous.insert(contiguous.end(), v.begin(), v.end());
+        pointers.push_back(v.data());
+      }
+
+      std::vector<int32_t> ip(num_vectors);
+      std::vector<int32_t> ip_ptr(num_vectors);
+      std::vector<int32_t> l2(num_vectors);
+      std::vector<int32_t> l2_ptr(num_vectors);
+      vectorlite::ops::InnerProductBatch(query.data(), contiguous.data(),
+                                         num_vectors, dim, ip.data());
+      vectorlite::ops::InnerProductBatch(query.data(), pointers.data(),
+                                         num_vectors, dim, ip_ptr.data());
+      vectorlite::ops::L2DistanceSquaredBatch(query.data(), contiguous.data(),
+                                              num_vectors, dim, l2.data());
+      vectorlite::ops::L2DistanceSquaredBatch(query.data(), pointers.data(),
+                                              num_vectors, dim, l2_ptr.data());
+      for (int i = 0; i < num_vectors; ++i) {
+        int32_t expected_ip =
+            vectorlite::ops::InnerProduct(query.data(), vectors[i].data(), dim);
+        int32_t expected_l2 = vectorlite::ops::L2DistanceSquared(
+            query.data(), vectors[i].data(), dim);
+        EXPECT_EQ(ip[i], expected_ip) << " dim = " << dim;
+        EXPECT_EQ(ip_ptr[i], expected_ip) << " dim = " << dim;
+        EXPECT_EQ(l2[i], expected_l2) << " dim = " << dim;
+        EXPECT_EQ(l2_ptr[i], expected_l2) << " dim = " << dim;
+      }
+    }
+  }
+}
+
+// `quantize` converts float32 vectors to T, the storage format of the rows.
+template <typename T, typename Quantize>
+static void ExpectF32QueryBatchMatchesSinglePair(Quantize quantize) {
+  for (int dim = 1; dim <= 67; dim += 11) {
+    for (int num_vectors : {0, 1, 5}) {
+      auto query = GenerateRandomVectors(1, dim)[0];
+      auto vectors = GenerateRandomVectors(num_vectors, dim);
+      std::vector<std::vector<T>> quantized(num_vectors, std::vector<T>(dim));
+      std::vector<const T*> pointers;
+      for (int i = 0; i < num_vectors; ++i) {
+        quantize(vectors[i].data(), quantized[i].data(), dim);
+        pointers.push_back(quantized[i].data());
+      }
+
+      std::vector<float> ip(num_vectors);
+      std::vector<float> l2(num_vectors);
+      vectorlite::ops::InnerProductDistanceBatch(query.data(), pointers.data(),
+                                                 num_vectors, dim, ip.data());
+      vectorlite::ops::L2DistanceSquaredBatch(query.data(), pointers.data(),
+                                              num_vectors, dim, l2.data());
+      for (int i = 0; i < num_vectors; ++i) {
+        EXPECT_NEAR(ip[i],
+                    vectorlite::ops::InnerProductDistance(
+                        query.data(), pointers[i], dim),
+                    kEpsilon)
+            << " dim = " << dim;
+        EXPECT_NEAR(l2[i],
+                    vectorlite::ops::L2DistanceSquared(query.data(),
+                                                       pointers[i], dim),
+                    kEpsilon)
+            << " dim = " << dim;
+      }
+    }
+  }
+}
+
+TEST(Batch_F32Query, ShouldMatchSinglePairResults) {
+  ExpectF32QueryBatchMatchesSinglePair<hwy::bfloat16_t>(
+      [](const float* in, hwy::bfloat16_t* out, size_t n) {
+        vectorlite::ops::QuantizeF32ToBF16(in, out, n);
+      });
+  ExpectF32QueryBatchMatchesSinglePair<hwy::float16_t>(
+      [](const float* in, hwy::float16_t* out, size_t n) {
+        vectorlite::ops::QuantizeF32ToF16(in, out, n);
+      });
+  ExpectF32QueryBatchMatchesSinglePair<vectorlite::ops::float8_e4m3_t>(
+      [](const float* in, vectorlite::ops::float8_e4m3_t* out, size_t n) {
+        vectorlite::ops::QuantizeF32ToF8(in, out, n);
+      });
+  ExpectF32QueryBatchMatchesSinglePair<vectorlite::ops::float8_e5m2_t>(
+      [](const float* in, vectorlite::ops::float8_e5m2_t* out, size_t n) {
+        vectorlite::ops::QuantizeF32ToF8(in, out, n);
+      });
+}
+
+TEST(DistanceMatrix, ShouldMatchSinglePairResults) {
+  // Covers full 4x2 tiles as well as leftover queries and vectors.
+  for (size_t num_queries : {1, 3, 4, 9}) {
+    for (size_t num_vectors : {1, 2, 7}) {
+      for (size_t dim : {1, 5, 16, 131}) {
+        auto queries = GenerateRandomVectors(num_queries, dim);
+        auto vectors = GenerateRandomVectors(num_vectors, dim);
+        std::vector<float> query_data;
+        std::vector<float> vector_data;
+        for (const auto& q : queries) {
+          query_data.insert(query_data.end(), q.begin(), q.end());
+        }
+        for (const auto& v : vectors) {
+          vector_data.insert(vector_data.end(), v.begin(), v.end());
+        }
+
+        std::vector<float> ip(num_queries * num_vectors);
+        std::vector<float> l2(num_queries * num_vectors);
+        vectorlite::ops::InnerProductDistanceMatrix(
+            query_data.data(), num_queries, vector_data.data(), num_vectors,
+            dim, ip.data());
+        vectorlite::ops::L2DistanceSquaredMatrix(
+            query_data.data(), num_queries, vector_data.data(), num_vectors,
+            dim, l2.data());
+        for (size_t i = 0; i < num_queries; ++i) {
+          for (size_t j = 0; j < num_vectors; ++j) {
+            EXPECT_NEAR(ip[i * num_vectors + j],
+                        vectorlite::ops::InnerProductDistance(
+                            queries[i].data(), vectors[j].data(), dim),
+                        kEpsilon);
+            // The norm-based L2 loses precision as distances grow.
+            const float expected_l2 = vectorlite::ops::L2DistanceSquared(
+                queries[i].data(), vectors[j].data(), dim);
+            EXPECT_NEAR(l2[i * num_vectors + j], expected_l2,
+                        kEpsilon * std::max(1.0f, expected_l2));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(DistanceMatrix, ShouldReturnZeroL2ForIdenticalVectors) {
+  auto vectors = GenerateRandomVectors(1, 100);
+  std::vector<float> out(1);
+  vectorlite::ops::L2DistanceSquaredMatrix(vectors[0].data(), 1,
+                                           vectors[0].data(), 1, 100,
+                                           out.data());
+  EXPECT_GE(out[0], 0.0f);
+  EXPECT_NEAR(out[0], 0.0f, kEpsilon);
+}
+
+TEST(GetDistanceFunc, ShouldMatchDispatchingFunctions) {
+  for (size_t dim : {1, 3, 16, 100, 128, 300, 768}) {
+    auto vectors = GenerateRandomVectors(2, dim);
+    const float* v1 = vectors[0].data();
+    const float* v2 = vectors[1].data();
+    std::vector<hwy::bfloat16_t> v1_bf16(dim);
+    std::vector<hwy::bfloat16_t> v2_bf16(dim);
+    std::vector<hwy::float16_t> v1_f16(dim);
+    std::vector<hwy::float16_t> v2_f16(dim);
+    vectorlite::ops::QuantizeF32ToBF16(v1, v1_bf16.data(), dim);
+    vectorlite::ops::QuantizeF32ToBF16(v2, v2_bf16.data(), dim);
+    vectorlite::ops::QuantizeF32ToF16(v1, v1_f16.data(), dim);
+    vectorlite::ops::QuantizeF32ToF16(v2, v2_f16.data(), dim);
+
+    auto ip = vectorlite::ops::GetInnerProductDistanceFunc<float>(dim);
+    auto ip_bf16 =
+        vectorlite::ops::GetInnerProductDistanceFunc<hwy::bfloat16_t>(dim);
+    auto ip_f16 =
+        vectorlite::ops::GetInnerProductDistanceFunc<hwy::float16_t>(dim);
+    auto l2 = vectorlite::ops::GetL2DistanceSquaredFunc<float>(dim);
+    auto l2_bf16 =
+        vectorlite::ops::GetL2DistanceSquaredFunc<hwy::bfloat16_t>(dim);
+    auto l2_f16 =
+        vectorlite::ops::GetL2DistanceSquaredFunc<hwy::float16_t>(dim);
+
+    EXPECT_NEAR(ip(v1, v2, &dim),
+                vectorlite::ops::InnerProductDistance(v1, v2, dim), kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(ip_bf16(v1_bf16.data(), v2_bf16.data(), &dim),
+                vectorlite::ops::InnerProductDistance(v1_bf16.data(),
+                                                      v2_bf16.data(), dim),
+                kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(ip_f16(v1_f16.data(), v2_f16.data(), &dim),
+                vectorlite::ops::InnerProductDistance(v1_f16.data(),
+                                                      v2_f16.data(), dim),
+                kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(l2(v1, v2, &dim),
+                vectorlite::ops::L2DistanceSquared(v1, v2, dim), kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(l2_bf16(v1_bf16.data(), v2_bf16.data(), &dim),
+                vectorlite::ops::L2DistanceSquared(v1_bf16.data(),
+                                                   v2_bf16.data(), dim),
+                kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(l2_f16(v1_f16.data(), v2_f16.data(), &dim),
+                vectorlite::ops::L2DistanceSquared(v1_f16.data(),
+                                                   v2_f16.data(), dim),
+                kEpsilon)
+        << " dim = " << dim;
+    EXPECT_EQ(l2(v1, v1, &dim), 0.0f);
+    EXPECT_EQ(l2_bf16(v1_bf16.data(), v1_bf16.data(), &dim), 0.0f);
+    EXPECT_EQ(l2_f16(v1_f16.data(), v1_f16.data(), &dim), 0.0f);
+  }
+}
+
+TEST(GetDistanceFuncVariants, ShouldListEverySupportedTargetBestFirst) {
+  for (size_t dim : {3, 128, 300}) {
+    auto vectors = GenerateRandomVectors(2, dim);
+    const float* v1 = vectors[0].data();
+    const float* v2 = vectors[1].data();
+    auto ip_variants =
+        vectorlite::ops::GetInnerProductDistanceFuncVariants<float>(dim);
+    auto l2_variants =
+        vectorlite::ops::GetL2DistanceSquaredFuncVariants<float>(dim);
+    ASSERT_FALSE(ip_variants.empty());
+    ASSERT_EQ(ip_variants.size(), l2_variants.size());
+    // The first variant is the one dynamic dispatch resolves to.
+    EXPECT_STREQ(ip_variants[0].target, vectorlite::ops::GetBestTarget());
+    EXPECT_EQ(ip_variants[0].func,
+              vectorlite::ops::GetInnerProductDistanceFunc<float>(dim));
+    EXPECT_EQ(l2_variants[0].func,
+              vectorlite::ops::GetL2DistanceSquaredFunc<float>(dim));
+
+    for (const auto& variant : ip_variants) {
+      EXPECT_NEAR(variant.func(v1, v2, &dim),
+                  vectorlite::ops::InnerProductDistance(v1, v2, dim), kEpsilon)
+          << variant.target << " dim = " << dim;
+    }
+    for (const auto& variant : l2_variants) {
+      EXPECT_NEAR(variant.func(v1, v2, &dim),
+                  vectorlite::ops::L2DistanceSquared(v1, v2, dim),
+                  kEpsilon * std::max(1.0f, vectorlite::ops::L2DistanceSquared(
+                                                v1, v2, dim)))
+          << variant.target << " dim = " << dim;
+    }
+  }
+}
+
+TEST(GetDistanceFuncVariants, ShouldNotChangeTheChosenTarget) {
+  constexpr size_t kDim = 300;
+  const vectorlite::ops::DistanceFunc best =
+      vectorlite::ops::GetInnerProductDistanceFunc<float>(kDim);
+  std::atomic<bool> done = false;
+  std::thread lister([&done] {
+    for (int i = 0; i < 1000; ++i) {
+      vectorlite::ops::GetL2DistanceSquaredFuncVariants<float>(kDim);
+      vectorlite::ops::GetMixedInnerProductDistanceFuncVariants<
+          hwy::bfloat16_t>(kDim);
+    }
+    done = true;
+  });
+  // Tables created meanwhile must still get the best target's function.
+  size_t num_others = 0;
+  do {
+    if (vectorlite::ops::GetInnerProductDistanceFunc<float>(kDim) != best) {
+      ++num_others;
+    }
+  } while (!done);
+  lister.join();
+  EXPECT_EQ(num_others, 0);
+}
+
+TEST(GetInt8DistanceFunc, ShouldMatchDispatchingFunctions) {
+  auto ip = vectorlite::ops::GetInt8InnerProductFunc();
+  auto l2 = vectorlite::ops::GetInt8L2DistanceSquaredFunc();
+  for (size_t dim : {0, 1, 3, 16, 100, 300}) {
+    auto vectors = GenerateRandomInt8Vectors(2, dim);
+    const int8_t* v1 = vectors[0].data();
+    const int8_t* v2 = vectors[1].data();
+    EXPECT_EQ(ip(v1, v2, dim), vectorlite::ops::InnerProduct(v1, v2, dim));
+    EXPECT_EQ(l2(v1, v2, dim), vectorlite::ops::L2DistanceSquared(v1, v2, dim));
+  }
+}
+
+TEST(FixedDimDistance, ShouldMatchGenericKernels) {
+  for (size_t dim : {128, 256, 384, 512, 768, 1024, 1536, 3072}) {
+    auto ip = vectorlite::ops::GetFixedDimInnerProductDistance(dim);
+    auto l2 = vectorlite::ops::GetFixedDimL2DistanceSquared(dim);
+    ASSERT_NE(ip, nullptr) << " dim = " << dim;
+    ASSERT_NE(l2, nullptr) << " dim = " << dim;
+
+    auto vectors = GenerateRandomVectors(2, dim);
+    const float* v1 = vectors[0].data();
+    const float* v2 = vectors[1].data();
+    EXPECT_NEAR(ip(v1, v2, nullptr),
+                vectorlite::ops::InnerProductDistance(v1, v2, dim), kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(l2(v1, v2, nullptr),
+                vectorlite::ops::L2DistanceSquared(v1, v2, dim), kEpsilon)
+        << " dim = " << dim;
+    EXPECT_EQ(l2(v1, v1, nullptr), 0.0f) << " dim = " << dim;
+  }
+}
+
+TEST(FixedDimDistance, ShouldReturnNullptrForOtherDims) {
+  for (size_t dim : {0, 1, 3, 64, 100, 129, 4096}) {
+    EXPECT_EQ(vectorlite::ops::GetFixedDimInnerProductDistance(dim), nullptr);
+    EXPECT_EQ(vectorlite::ops::GetFixedDimL2DistanceSquared(dim), nullptr);
+  }
+}
+
 TEST(Normalize, ShouldReturnCorrectResult) {
   for (int dim = 1; dim <= 1000; dim++) {
     auto vectors = GenerateRandomVectors(10, dim);
@@ -330,6 +1036,55 @@ TEST(Normalize_F32ToF16, ShouldReturnCorrectResult) {
   }
 }
 
+TEST(NormalizeTo, ShouldMatchNormalize) {
+  for (int dim = 1; dim <= 1000; dim++) {
+    auto vectors = GenerateRandomVectors(1, dim);
+    std::vector<float> expected = vectors[0];
+    vectorlite::ops::Normalize(expected.data(), dim);
+
+    std::vector<float> out(dim);
+    vectorlite::ops::NormalizeTo(vectors[0].data(), out.data(), dim);
+    for (int j = 0; j < dim; ++j) {
+      EXPECT_NEAR(out[j], expected[j], 1e-6) << " dim = " << dim;
+    }
+  }
+}
+
+TEST(NormalizeAndQuantizeF32ToBF16, ShouldMatchNormalizeThenQuantize) {
+  for (int dim = 1; dim <= 1000; dim++) {
+    auto vectors = GenerateRandomVectors(1, dim);
+    std::vector<float> normalized = vectors[0];
+    vectorlite::ops::Normalize(normalized.data(), dim);
+
+    std::vector<hwy::bfloat16_t> out(dim);
+    vectorlite::ops::NormalizeAndQuantizeF32ToBF16(vectors[0].data(),
+                                                   out.data(), dim);
+    for (int j = 0; j < dim; ++j) {
+      float expected = hwy::F32FromBF16(hwy::BF16FromF32(normalized[j]));
+      EXPECT_NEAR(hwy::F32FromBF16(out[j]), expected,
+                  1e-2 * std::abs(expected) + 1e-6)
+          << " dim = " << dim;
+    }
+  }
+}
+
+TEST(NormalizeAndQuantizeF32ToF16, ShouldMatchNormalizeThenQuantize) {
+  for (int dim = 1; dim <= 1000; dim++) {
+    auto vectors = GenerateRandomVectors(1, dim);
+    std::vector<float> normalized = vectors[0];
+    vectorlite::ops::Normalize(normalized.data(), dim);
+
+    std::vector<hwy::float16_t> out(dim);
+    vectorlite::ops::NormalizeAndQuantizeF32ToF16(vectors[0].data(),
+                                                  out.data(), dim);
+    for (int j = 0; j < dim; ++j) {
+      float expected = hwy::F32FromF16(hwy::F16FromF32(normalized[j]));
+      EXPECT_NEAR(hwy::F32FromF16(out[j]), expected, 1e-3)
+          << " dim = " << dim;
+    }
+  }
+}
+
 TEST(QuantizeF32ToBF16, ShouldReturnCorrectResult) {
   for (int dim = 0; dim <= 100; dim++) {
     auto vectors = GenerateRandomVectors(10, dim);
@@ -406,4 +1161,374 @@ TEST(BF16ToF32, ShouldReturnCorrectResult) {
       }
     }
   }
-}
\ No newline at end of file
+}
+TEST(QuantizeF32ToI8, ShouldRoundAndClamp) {
+  const float scale = 0.5f;
+  const float offset = 1.0f;
+  for (int dim = 0; dim <= 100; dim++) {
+    auto vectors = GenerateRandomVectors(10, dim);
+    for (int i = 0; i < vectors.size(); ++i) {
+      std::vector<float> v = vectors[i];
+      // Make sure some values are out of range.
+      for (int j = 0; j < dim; j += 7) {
+        v[j] *= 1000;
+      }
+      std::vector<int8_t> out(dim);
+      vectorlite::ops::QuantizeF32ToI8(v.data(), out.data(), dim, scale,
+                                       offset);
+
+      for (int j = 0; j < dim; ++j) {
+        float expected = std::clamp(std::nearbyint((v[j] - offset) / scale),
+                                    -127.0f, 127.0f);
+        EXPECT_EQ(static_cast<int>(expected), out[j])
+            << "v[" << j << "] = " << v[j] << " dim = " << dim;
+      }
+    }
+  }
+}
+
+TEST(I8ToF32, ShouldReturnCorrectResult) {
+  const float scale = 0.01f;
+  const float offset = -0.5f;
+  for (int dim = 0; dim <= 100; dim++) {
+    auto vectors = GenerateRandomInt8Vectors(10, dim);
+    for (int i = 0; i < vectors.size(); ++i) {
+      const auto& v = vectors[i];
+      std::vector<float> out(dim);
+      vectorlite::ops::I8ToF32(v.data(), out.data(), dim, scale, offset);
+
+      for (int j = 0; j < dim; ++j) {
+        EXPECT_NEAR(v[j] * scale + offset, out[j], 1e-6)
+            << "v[" << j << "] = " << int(v[j]) << " dim = " << dim;
+      }
+    }
+  }
+}
+
+// Reference float8 decoder written from the format definition. Returns NaN
+// for codes that aren't finite numbers.
+template <typename Float8>
+static float DecodeFloat8Reference(uint8_t bits) {
+  constexpr bool kE4M3 = std::is_same_v<Float8, vectorlite::ops::float8_e4m3_t>;
+  constexpr int kMantissaBits = kE4M3 ? 3 : 2;
+  constexpr int kExponentBits = kE4M3 ? 4 : 5;
+  constexpr int kBias = (1 << (kExponentBits - 1)) - 1;
+  const int exponent = (bits >> kMantissaBits) & ((1 << kExponentBits) - 1);
+  const int mantissa = bits & ((1 << kMantissaBits) - 1);
+  if ((kE4M3 && (bits & 0x7F) == 0x7F) ||
+      (!kE4M3 && exponent == (1 << kExponentBits) - 1)) {
+    return std::numeric_limits<float>::quiet_NaN();
+  }
+  const float magnitude =
+      exponent == 0
+          ? std::ldexp(static_cast<float>(mantissa), 1 - kBias - kMantissaBits)
+          : std::ldexp(static_cast<float>(mantissa + (1 << kMantissaBits)),
+                       exponent - kBias - kMantissaBits);
+  return (bits & 0x80) ? -magnitude : magnitude;
+}
+
+template <typename Float8>
+static std::vector<Float8> QuantizeToF8(const std::vector<float>& v) {
+  std::vector<Float8> out(v.size());
+  vectorlite::ops::QuantizeF32ToF8(v.data(), out.data(), v.size());
+  return out;
+}
+
+template <typename Float8>
+static std::vector<float> F8ToF32(const std::vector<Float8>& v) {
+  std::vector<float> out(v.size());
+  vectorlite::ops::F8ToF32(v.data(), out.data(), v.size());
+  return out;
+}
+
+template <typename Float8>
+static void ExpectF8ConversionsMatchReference() {
+  // Every finite code decodes exactly and encodes back to itself.
+  std::vector<Float8> codes;
+  std::vector<float> decoded;
+  for (int bits = 0; bits < 256; ++bits) {
+    const float value = DecodeFloat8Reference<Float8>(bits);
+    if (!std::isnan(value)) {
+      codes.push_back({static_cast<uint8_t>(bits)});
+      decoded.push_back(value);
+    }
+  }
+  EXPECT_EQ(F8ToF32(codes), decoded);
+  auto encoded = QuantizeToF8<Float8>(decoded);
+  for (size_t i = 0; i < codes.size(); ++i) {
+    EXPECT_EQ(encoded[i].bits, codes[i].bits) << " value = " << decoded[i];
+  }
+
+  // Random values round to the nearest code, ties to the even code.
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> mantissa(-1.0f, 1.0f);
+  std::uniform_int_distribution<int> exponent(-24, 18);
+  std::vector<float> values(1001);
+  for (float& value : values) {
+    value = std::ldexp(mantissa(gen), exponent(gen));
+  }
+  // Midpoints between neighboring positive codes are ties.
+  for (size_t j = 0; j + 1 < codes.size() && codes[j + 1].bits < 0x80; ++j) {
+    values.push_back((decoded[j] + decoded[j + 1]) / 2);
+  }
+  const float max_value = *std::max_element(decoded.begin(), decoded.end());
+  encoded = QuantizeToF8<Float8>(values);
+  for (size_t i = 0; i < values.size(); ++i) {
+    const float target = std::copysign(
+        std::min(std::abs(values[i]), max_value), values[i]);
+    int best = -1;
+    for (size_t j = 0; j < codes.size(); ++j) {
+      if (std::signbit(decoded[j]) != std::signbit(target)) {
+        continue;
+      }
+      const float error = std::abs(decoded[j] - target);
+      const float best_error =
+          best < 0 ? std::numeric_limits<float>::infinity()
+                   : std::abs(decoded[best] - target);
+      if (error < best_error ||
+          (error == best_error && (codes[j].bits & 1) == 0)) {
+        best = static_cast<int>(j);
+      }
+    }
+    EXPECT_EQ(encoded[i].bits, codes[best].bits) << " value = " << values[i];
+  }
+
+  // Out of range values saturate and NaN becomes 0.
+  encoded = QuantizeToF8<Float8>(
+      {1e30f, -std::numeric_limits<float>::infinity(),
+       std::numeric_limits<float>::quiet_NaN()});
+  EXPECT_EQ(F8ToF32(encoded),
+            (std::vector<float>{max_value, -max_value, 0.0f}));
+}
+
+TEST(QuantizeF32ToF8, ShouldMatchReferenceOnEveryTarget) {
+  ForEachTarget([] {
+    ExpectF8ConversionsMatchReference<vectorlite::ops::float8_e4m3_t>();
+    ExpectF8ConversionsMatchReference<vectorlite::ops::float8_e5m2_t>();
+  });
+}
+
+template <typename Float8>
+static void ExpectF8DistancesMatchScalar() {
+  for (size_t dim = 1; dim <= 70; ++dim) {
+    auto vectors = GenerateRandomVectors(3, dim);
+    const std::vector<float>& query = vectors[0];
+    const auto v1 = QuantizeToF8<Float8>(vectors[1]);
+    const auto v2 = QuantizeToF8<Float8>(vectors[2]);
+    const auto d1 = F8ToF32(v1);
+    const auto d2 = F8ToF32(v2);
+    float ip = 0, l2 = 0, mixed_ip = 0, mixed_l2 = 0;
+    for (size_t k = 0; k < dim; ++k) {
+      ip += d1[k] * d2[k];
+      l2 += (d1[k] - d2[k]) * (d1[k] - d2[k]);
+      mixed_ip += query[k] * d2[k];
+      mixed_l2 += (query[k] - d2[k]) * (query[k] - d2[k]);
+    }
+    EXPECT_NEAR(vectorlite::ops::InnerProduct(v1.data(), v2.data(), dim), ip,
+                kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(vectorlite::ops::L2DistanceSquared(v1.data(), v2.data(), dim),
+                l2, kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(vectorlite::ops::InnerProduct(query.data(), v2.data(), dim),
+                mixed_ip, kEpsilon)
+        << " dim = " << dim;
+    EXPECT_NEAR(
+        vectorlite::ops::L2DistanceSquared(query.data(), v2.data(), dim),
+        mixed_l2, kEpsilon)
+        << " dim = " << dim;
+    EXPECT_EQ(vectorlite::ops::L2DistanceSquared(v1.data(), v1.data(), dim),
+              0.0f);
+
+    // Resolved functions and batches agree with the dispatching functions.
+    auto ip_func = vectorlite::ops::GetInnerProductDistanceFunc<Float8>(dim);
+    auto l2_func = vectorlite::ops::GetL2DistanceSquaredFunc<Float8>(dim);
+    auto mixed_ip_func =
+        vectorlite::ops::GetMixedInnerProductDistanceFunc<Float8>(dim);
+    auto mixed_l2_func =
+        vectorlite::ops::GetMixedL2DistanceSquaredFunc<Float8>(dim);
+    EXPECT_NEAR(ip_func(v1.data(), v2.data(), &dim), 1.0f - ip, kEpsilon);
+    EXPECT_NEAR(l2_func(v1.data(), v2.data(), &dim), l2, kEpsilon);
+    EXPECT_NEAR(mixed_ip_func(query.data(), v2.data(), &dim), 1.0f - mixed_ip,
+                kEpsilon);
+    EXPECT_NEAR(mixed_l2_func(query.data(), v2.data(), &dim), mixed_l2,
+                kEpsilon);
+
+    const Float8* rows[] = {v1.data(), v2.data()};
+    float batch[2];
+    vectorlite::ops::InnerProductDistanceBatch(v1.data(), rows, 2, dim, batch);
+    EXPECT_NEAR(batch[1], 1.0f - ip, kEpsilon);
+    vectorlite::ops::L2DistanceSquaredBatch(v1.data(), rows, 2, dim, batch);
+    EXPECT_EQ(batch[0], 0.0f);
+    EXPECT_NEAR(batch[1], l2, kEpsilon);
+  }
+}
+
+TEST(Float8Distance, ShouldMatchScalarOnEveryTarget) {
+  ForEachTarget([] {
+    ExpectF8DistancesMatchScalar<vectorlite::ops::float8_e4m3_t>();
+    ExpectF8DistancesMatchScalar<vectorlite::ops::float8_e5m2_t>();
+  });
+}
+
+TEST(QuantizeF32ToBinary, ShouldKeepSignBits) {
+  for (int dim = 0; dim <= 100; dim++) {
+    auto vectors = GenerateRandomVectors(10, dim);
+    for (int i = 0; i < vectors.size(); ++i) {
+      const auto& v = vectors[i];
+      // Fill with garbage to check that unused bits are cleared.
+      std::vector<uint8_t> out(vectorlite::ops::BinaryCodeSize(dim), 0xFF);
+      vectorlite::ops::QuantizeF32ToBinary(v.data(), out.data(), dim);
+
+      std::vector<float> restored(dim);
+      vectorlite::ops::BinaryToF32(out.data(), restored.data(), dim);
+      for (int j = 0; j < dim; ++j) {
+        bool bit = (out[j / 8] >> (j % 8)) & 1;
+        EXPECT_EQ(v[j] > 0, bit) << "v[" << j << "] = " << v[j];
+        EXPECT_EQ(v[j] > 0 ? 1.0f : -1.0f, restored[j]);
+      }
+      for (int j = dim; j < out.size() * 8; ++j) {
+        EXPECT_EQ(0, (out[j / 8] >> (j % 8)) & 1) << "dim = " << dim;
+      }
+    }
+  }
+}
+
+TEST(HammingDistance, ShouldMatchScalarImplementation) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dis(0, 255);
+  auto hamming = vectorlite::ops::GetHammingDistanceFunc();
+  for (size_t num_bytes = 0; num_bytes <= 200; num_bytes++) {
+    std::vector<uint8_t> v1(num_bytes);
+    std::vector<uint8_t> v2(num_bytes);
+    for (size_t i = 0; i < num_bytes; ++i) {
+      v1[i] = static_cast<uint8_t>(dis(gen));
+      v2[i] = static_cast<uint8_t>(dis(gen));
+    }
+
+    uint64_t expected = 0;
+    for (size_t i = 0; i < num_bytes; ++i) {
+      for (uint8_t x = v1[i] ^ v2[i]; x != 0; x &= x - 1) {
+        ++expected;
+      }
+    }
+    EXPECT_EQ(expected, vectorlite::ops::HammingDistance(v1.data(), v2.data(),
+                                                         num_bytes))
+        << "num_bytes = " << num_bytes;
+    EXPECT_EQ(expected, hamming(v1.data(), v2.data(), num_bytes));
+    EXPECT_EQ(0, hamming(v1.data(), v1.data(), num_bytes));
+  }
+}
+
+TEST(HammingDistanceBatch, ShouldMatchHammingDistance) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> dis(0, 255);
+  // Not a multiple of 4, so the remainder rows are scored too.
+  const size_t num_vectors = 11;
+  for (size_t num_bytes : {0, 1, 3, 16, 33, 128, 200}) {
+    std::vector<std::vector<uint8_t>> vectors(num_vectors,
+                                              std::vector<uint8_t>(num_bytes));
+    std::vector<const uint8_t*> vector_ptrs;
+    for (auto& v : vectors) {
+      for (auto& byte : v) {
+        byte = static_cast<uint8_t>(dis(gen));
+      }
+      vector_ptrs.push_back(v.data());
+    }
+    const uint8_t* query = vectors[2].data();
+
+    std::vector<uint64_t> out(num_vectors);
+    vectorlite::ops::HammingDistanceBatch(query, vector_ptrs.data(),
+                                          num_vectors, num_bytes, out.data());
+    for (size_t i = 0; i < num_vectors; ++i) {
+      EXPECT_EQ(out[i], vectorlite::ops::HammingDistance(
+                            query, vectors[i].data(), num_bytes))
+          << "num_bytes = " << num_bytes << ", i = " << i;
+    }
+    EXPECT_EQ(out[2], 0);
+  }
+}
+
+TEST(PQFastScanBlock, ShouldMatchScalarImplementation) {
+  constexpr size_t kBlock = vectorlite::ops::kPQFastScanBlockSize;
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<> byte(0, 255);
+  std::uniform_int_distribution<> nibble(0, 15);
+  for (size_t num_subquantizers : {0, 1, 3, 16, 64, 256}) {
+    std::vector<uint8_t> lut(num_subquantizers * 16);
+    std::vector<uint8_t> codes(num_subquantizers * kBlock);
+    for (auto& entry : lut) {
+      entry = static_cast<uint8_t>(byte(gen));
+    }
+    for (auto& code : codes) {
+      code = static_cast<uint8_t>(nibble(gen));
+    }
+
+    uint16_t out[kBlock];
+    vectorlite::ops::PQFastScanBlock(lut.data(), codes.data(),
+                                     num_subquantizers, out);
+    for (size_t i = 0; i < kBlock; ++i) {
+      uint32_t expected = 0;
+      for (size_t j = 0; j < num_subquantizers; ++j) {
+        expected += lut[j * 16 + codes[j * kBlock + i]];
+      }
+      EXPECT_EQ(expected, out[i])
+          << "i = " << i << " num_subquantizers = " << num_subquantizers;
+    }
+  }
+}
+
+TEST(SelectTopK, ShouldMatchSorting) {
+  std::mt19937 gen(11);
+  // Few distinct values, so that ties are common.
+  std::uniform_int_distribution<int> dis(0, 63);
+  for (size_t num : {0, 1, 7, 100, 1000, 5000}) {
+    for (size_t k : {1, 3, 16, 100, 2000}) {
+      std::vector<float> distances(num);
+      for (float& distance : distances) {
+        distance = static_cast<float>(dis(gen));
+      }
+      std::vector<uint32_t> expected(num);
+      for (size_t i = 0; i < num; ++i) {
+        expected[i] = static_cast<uint32_t>(i);
+      }
+      std::stable_sort(expected.begin(), expected.end(),
+                       [&](uint32_t a, uint32_t b) {
+                         return distances[a] < distances[b];
+                       });
+      expected.resize(std::min(k, num));
+
+      ForEachTarget([&] {
+        std::vector<uint32_t> out(std::min(k, num));
+        size_t num_selected = vectorlite::ops::SelectTopK(
+            distances.data(), num, k, out.data());
+        EXPECT_EQ(num_selected, expected.size());
+        EXPECT_EQ(out, expected) << "num = " << num << " k = " << k;
+      });
+    }
+  }
+}
+
+TEST(SelectTopK, ShouldSkipNaNAndKeepInfinity) {
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> distances = {nan, 3.0f, inf, nan, -1.0f, 2.0f,
+                                  nan, 5.0f, nan, 0.5f, inf};
+  std::vector<uint32_t> out(distances.size());
+  size_t num_selected = vectorlite::ops::SelectTopK(
+      distances.data(), distances.size(), distances.size(), out.data());
+  ASSERT_EQ(num_selected, 7);
+  out.resize(num_selected);
+  EXPECT_EQ(out, (std::vector<uint32_t>{4, 9, 5, 1, 7, 2, 10}));
+
+  num_selected =
+      vectorlite::ops::SelectTopK(distances.data(), distances.size(), 2,
+                                  out.data());
+  ASSERT_EQ(num_selected, 2);
+  EXPECT_EQ(out[0], 4);
+  EXPECT_EQ(out[1], 9);
+
+  EXPECT_EQ(vectorlite::ops::SelectTopK(distances.data(), distances.size(), 0,
+                                        out.data()),
+            0);
+}
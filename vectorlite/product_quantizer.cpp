@@ -0,0 +1,407 @@
+#include "product_quantizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "macros.h"
+#include "ops/ops.h"
+
+namespace vectorlite {
+
+// Lloyd iterations usually converge well before this on 16 centroids.
+static constexpr size_t kKMeansIterations = 25;
+
+// Returns the 4-bit code of `subquantizer`.
+static uint8_t CodeAt(const uint8_t* code, size_t subquantizer) {
+  return (code[subquantizer / 2] >> ((subquantizer % 2) * 4)) & 0xF;
+}
+
+// Returns the index of the smallest of kNumCentroids distances, the first one
+// on ties.
+static uint8_t Nearest(const float* distances) {
+  return static_cast<uint8_t>(
+      std::min_element(distances,
+                       distances + ProductQuantizer::kNumCentroids) -
+      distances);
+}
+
+ProductQuantizer::ProductQuantizer(size_t dim, size_t num_subquantizers,
+                                   bool inner_product)
+    : dim_(dim),
+      num_subquantizers_(num_subquantizers),
+      subvector_dim_(dim / num_subquantizers),
+      inner_product_(inner_product) {
+  VECTORLITE_ASSERT(Validate(dim, num_subquantizers).ok());
+}
+
+absl::Status ProductQuantizer::Validate(size_t dim, size_t num_subquantizers) {
+  if (num_subquantizers == 0 || num_subquantizers > kMaxSubquantizers) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("number of subquantizers must be in [1, %d], got %d",
+                        kMaxSubquantizers, num_subquantizers));
+  }
+  if (dim % num_subquantizers != 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "dimension(%d) must be a multiple of the number of subquantizers(%d)",
+        dim, num_subquantizers));
+  }
+  return absl::OkStatus();
+}
+
+void ProductQuantizer::Train(const float* data, size_t num_vectors,
+                             uint32_t seed) {
+  VECTORLITE_ASSERT(num_vectors > 0);
+  const size_t dsub = subvector_dim_;
+  centroids_.assign(num_subquantizers_ * kNumCentroids * dsub, 0.0f);
+
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<size_t> random_vector(0, num_vectors - 1);
+  std::vector<float> subvectors(num_vectors * dsub);
+  std::vector<uint8_t> assignments(num_vectors);
+  std::vector<float> sums(kNumCentroids * dsub);
+  std::vector<size_t> counts(kNumCentroids);
+  std::vector<size_t> order(num_vectors);
+
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    for (size_t i = 0; i < num_vectors; ++i) {
+      std::copy_n(data + i * dim_ + j * dsub, dsub,
+                  subvectors.data() + i * dsub);
+    }
+    float* centroids = centroids_.data() + j * kNumCentroids * dsub;
+
+    // Start from distinct random subvectors. If there are fewer than
+    // kNumCentroids distinct ones, some centroids are duplicates.
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), gen);
+    size_t num_initialized = 0;
+    for (size_t i = 0; i < num_vectors && num_initialized < kNumCentroids;
+         ++i) {
+      const float* subvector = subvectors.data() + order[i] * dsub;
+      bool duplicate = false;
+      for (size_t k = 0; k < num_initialized && !duplicate; ++k) {
+        duplicate = std::equal(subvector, subvector + dsub,
+                               centroids + k * dsub);
+      }
+      if (!duplicate) {
+        std::copy_n(subvector, dsub, centroids + num_initialized * dsub);
+        ++num_initialized;
+      }
+    }
+    for (size_t k = num_initialized; k < kNumCentroids; ++k) {
+      std::copy_n(centroids + (k % num_initialized) * dsub, dsub,
+                  centroids + k * dsub);
+    }
+
+    for (size_t iteration = 0; iteration < kKMeansIterations; ++iteration) {
+      bool changed = false;
+      for (size_t i = 0; i < num_vectors; ++i) {
+        float distances[kNumCentroids];
+        ops::L2DistanceSquaredBatch(subvectors.data() + i * dsub, centroids,
+                                    kNumCentroids, dsub, distances);
+        const uint8_t best = Nearest(distances);
+        changed |= iteration == 0 || assignments[i] != best;
+        assignments[i] = best;
+      }
+      if (!changed) {
+        break;
+      }
+
+      std::fill(sums.begin(), sums.end(), 0.0f);
+      std::fill(counts.begin(), counts.end(), 0);
+      for (size_t i = 0; i < num_vectors; ++i) {
+        const float* subvector = subvectors.data() + i * dsub;
+        float* sum = sums.data() + assignments[i] * dsub;
+        for (size_t d = 0; d < dsub; ++d) {
+          sum[d] += subvector[d];
+        }
+        ++counts[assignments[i]];
+      }
+      for (size_t k = 0; k < kNumCentroids; ++k) {
+        float* centroid = centroids + k * dsub;
+        if (counts[k] == 0) {
+          // Reseed an empty cluster so that all 16 codes stay useful.
+          std::copy_n(subvectors.data() + random_vector(gen) * dsub, dsub,
+                      centroid);
+          continue;
+        }
+        for (size_t d = 0; d < dsub; ++d) {
+          centroid[d] = sums[k * dsub + d] / counts[k];
+        }
+      }
+    }
+  }
+
+  trained_ = true;
+  UpdateSymmetricTables();
+}
+
+void ProductQuantizer::ScoreCentroids(const float* subvector,
+                                      size_t subquantizer, float* out) const {
+  const float* centroids = centroid(subquantizer, 0);
+  if (!inner_product_) {
+    ops::L2DistanceSquaredBatch(subvector, centroids, kNumCentroids,
+                                subvector_dim_, out);
+    return;
+  }
+  // The 1 of each 1 - x.y is added once per distance instead, see
+  // AsymmetricDistance.
+  ops::InnerProductDistanceBatch(subvector, centroids, kNumCentroids,
+                                 subvector_dim_, out);
+  for (size_t k = 0; k < kNumCentroids; ++k) {
+    out[k] -= 1.0f;
+  }
+}
+
+void ProductQuantizer::UpdateSymmetricTables() {
+  symmetric_tables_.resize(num_subquantizers_ * kNumCentroids * kNumCentroids);
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    for (size_t a = 0; a < kNumCentroids; ++a) {
+      ScoreCentroids(
+          centroid(j, a), j,
+          symmetric_tables_.data() + (j * kNumCentroids + a) * kNumCentroids);
+    }
+  }
+}
+
+void ProductQuantizer::Encode(const float* vector, uint8_t* code) const {
+  VECTORLITE_ASSERT(trained_);
+  std::fill(code, code + code_size(), 0);
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    float distances[kNumCentroids];
+    ops::L2DistanceSquaredBatch(vector + j * subvector_dim_, centroid(j, 0),
+                                kNumCentroids, subvector_dim_, distances);
+    const uint8_t best = Nearest(distances);
+    code[j / 2] |= static_cast<uint8_t>(best << ((j % 2) * 4));
+  }
+}
+
+void ProductQuantizer::Decode(const uint8_t* code, float* vector) const {
+  VECTORLITE_ASSERT(trained_);
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    std::copy_n(centroid(j, CodeAt(code, j)), subvector_dim_,
+                vector + j * subvector_dim_);
+  }
+}
+
+float ProductQuantizer::SymmetricDistance(const uint8_t* code1,
+                                          const uint8_t* code2) const {
+  float distance = inner_product_ ? 1.0f : 0.0f;
+  if (!trained_) {
+    // Placeholder codes of pending vectors, see VirtualTable.
+    return distance;
+  }
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    distance += symmetric_tables_[(j * kNumCentroids + CodeAt(code1, j)) *
+                                      kNumCentroids +
+                                  CodeAt(code2, j)];
+  }
+  return distance;
+}
+
+void ProductQuantizer::SymmetricDistanceBatch(const uint8_t* query,
+                                              const uint8_t* const* codes,
+                                              size_t num_codes,
+                                              float* out) const {
+  std::fill(out, out + num_codes, inner_product_ ? 1.0f : 0.0f);
+  if (!trained_) {
+    // Placeholder codes of pending vectors, see SymmetricDistance.
+    return;
+  }
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    const float* row =
+        symmetric_tables_.data() +
+        (j * kNumCentroids + CodeAt(query, j)) * kNumCentroids;
+    for (size_t i = 0; i < num_codes; ++i) {
+      out[i] += row[CodeAt(codes[i], j)];
+    }
+  }
+}
+
+void ProductQuantizer::ComputeDistanceTable(const float* query,
+                                            float* table) const {
+  VECTORLITE_ASSERT(trained_);
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    ScoreCentroids(query + j * subvector_dim_, j, table + j * kNumCentroids);
+  }
+}
+
+float ProductQuantizer::AsymmetricDistance(const float* table,
+                                           const uint8_t* code) const {
+  float distance = inner_product_ ? 1.0f : 0.0f;
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    distance += table[j * kNumCentroids + CodeAt(code, j)];
+  }
+  return distance;
+}
+
+void ProductQuantizer::FastScan(const float* table,
+                                const uint8_t* const* codes, size_t num_codes,
+                                size_t k, float* out) const {
+  constexpr size_t kBlock = ops::kPQFastScanBlockSize;
+  static_assert(kMaxSubquantizers <= 257, "u16 sums could overflow");
+  if (k == 0) {
+    std::fill(out, out + num_codes, std::numeric_limits<float>::infinity());
+    return;
+  }
+  if (num_codes <= k) {
+    for (size_t i = 0; i < num_codes; ++i) {
+      out[i] = AsymmetricDistance(table, codes[i]);
+    }
+    return;
+  }
+
+  // Each table row is shifted by its minimum, and all rows share one scale,
+  // so that quantized entries of different subquantizers add up. Dropping the
+  // shared bias doesn't change the ranking.
+  std::vector<uint8_t> lut(table_size());
+  float max_range = 0.0f;
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    const float* row = table + j * kNumCentroids;
+    auto [min_it, max_it] = std::minmax_element(row, row + kNumCentroids);
+    max_range = std::max(max_range, *max_it - *min_it);
+  }
+  const float scale = max_range > 0.0f ? max_range / 255.0f : 1.0f;
+  for (size_t j = 0; j < num_subquantizers_; ++j) {
+    const float* row = table + j * kNumCentroids;
+    const float row_min = *std::min_element(row, row + kNumCentroids);
+    for (size_t c = 0; c < kNumCentroids; ++c) {
+      lut[j * kNumCentroids + c] =
+          static_cast<uint8_t>(std::lround((row[c] - row_min) / scale));
+    }
+  }
+
+  std::vector<uint16_t> sums((num_codes + kBlock - 1) / kBlock * kBlock);
+  std::vector<uint8_t> block(num_subquantizers_ * kBlock);
+  for (size_t start = 0; start < num_codes; start += kBlock) {
+    const size_t count = std::min(kBlock, num_codes - start);
+    // Missing vectors of the last block use code 0 and are ignored.
+    if (count < kBlock) {
+      std::fill(block.begin(), block.end(), 0);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      for (size_t j = 0; j < num_subquantizers_; ++j) {
+        block[j * kBlock + i] = CodeAt(codes[start + i], j);
+      }
+    }
+    ops::PQFastScanBlock(lut.data(), block.data(), num_subquantizers_,
+                         sums.data() + start);
+  }
+
+  // Each lut entry is off by at most half a step, so a sum is within
+  // num_subquantizers / 2 steps of the exact distance. A code whose sum
+  // exceeds the k-th smallest one by more than twice that is farther than k
+  // others. One more step absorbs float rounding.
+  std::vector<uint16_t> sorted(sums.begin(), sums.begin() + num_codes);
+  std::nth_element(sorted.begin(), sorted.begin() + (k - 1), sorted.end());
+  const uint32_t threshold =
+      static_cast<uint32_t>(sorted[k - 1]) + num_subquantizers_ + 1;
+  for (size_t i = 0; i < num_codes; ++i) {
+    out[i] = sums[i] <= threshold ? AsymmetricDistance(table, codes[i])
+                                  : std::numeric_limits<float>::infinity();
+  }
+}
+
+std::string ProductQuantizer::SidecarPath(const std::string& index_path) {
+  return index_path + ".pq";
+}
+
+// File layout, all integers are uint64_t:
+// dim, num_subquantizers, trained, centroids(if trained), num_pending, then
+// (rowid, dim floats) for each pending vector.
+absl::Status ProductQuantizer::SaveTo(const std::string& path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    return absl::InternalError(
+        absl::StrFormat("failed to open %s for writing", path));
+  }
+  auto write_u64 = [&out](uint64_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  write_u64(dim_);
+  write_u64(num_subquantizers_);
+  write_u64(trained_);
+  if (trained_) {
+    out.write(reinterpret_cast<const char*>(centroids_.data()),
+              centroids_.size() * sizeof(float));
+  }
+  write_u64(pending_.size());
+  for (const auto& [rowid, vector] : pending_) {
+    write_u64(rowid);
+    out.write(reinterpret_cast<const char*>(vector.data()),
+              vector.size() * sizeof(float));
+  }
+  if (!out) {
+    return absl::InternalError(absl::StrFormat("failed to write %s", path));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ProductQuantizer::LoadFrom(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return absl::NotFoundError(absl::StrFormat(
+        "product quantizer file does not exist: %s", path));
+  }
+  auto read_u64 = [&in]() {
+    uint64_t value = 0;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+  };
+  auto corrupted = [&path]() {
+    return absl::DataLossError(
+        absl::StrFormat("corrupted product quantizer file: %s", path));
+  };
+
+  uint64_t dim = read_u64();
+  uint64_t num_subquantizers = read_u64();
+  uint64_t trained = read_u64();
+  if (!in || trained > 1) {
+    return corrupted();
+  }
+  if (dim != dim_ || num_subquantizers != num_subquantizers_) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "product quantizer mismatch: file has dim=%d, pq=%d, table expects "
+        "dim=%d, pq=%d",
+        dim, num_subquantizers, dim_, num_subquantizers_));
+  }
+
+  std::vector<float> centroids;
+  if (trained) {
+    centroids.resize(num_subquantizers_ * kNumCentroids * subvector_dim_);
+    in.read(reinterpret_cast<char*>(centroids.data()),
+            centroids.size() * sizeof(float));
+  }
+  uint64_t num_pending = read_u64();
+  if (!in) {
+    return corrupted();
+  }
+  std::unordered_map<uint64_t, std::vector<float>> pending;
+  for (uint64_t i = 0; i < num_pending; ++i) {
+    uint64_t rowid = read_u64();
+    std::vector<float> vector(dim_);
+    in.read(reinterpret_cast<char*>(vector.data()),
+            vector.size() * sizeof(float));
+    if (!in) {
+      return corrupted();
+    }
+    pending[rowid] = std::move(vector);
+  }
+
+  trained_ = trained;
+  centroids_ = std::move(centroids);
+  pending_ = std::move(pending);
+  if (trained_) {
+    UpdateSymmetricTables();
+  } else {
+    symmetric_tables_.clear();
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace vectorlite
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+namespace vectorlite {
+
+// Product quantizer with 4-bit codes. A vector is split into
+// num_subquantizers subvectors of equal length, and each subvector is
+// replaced by the index of its nearest centroid among 16. Two codes are packed
+// per byte(subquantizer j lives in byte j / 2, the low nibble if j is even),
+// so a float32 vector of dim elements shrinks by 8 * dim / num_subquantizers
+// times.
+//
+// Codebooks are trained with k-means over the first vectors inserted into a
+// table. Until then those vectors are kept in float32 as pending vectors.
+class ProductQuantizer {
+ public:
+  static constexpr size_t kNumCentroids = 16;
+  static constexpr size_t kMaxSubquantizers = 256;
+
+  // If `inner_product` is true, distances are 1 - x.y instead of |x-y|^2.
+  ProductQuantizer(size_t dim, size_t num_subquantizers, bool inner_product);
+
+  // Checks whether a quantizer with the given shape can be created.
+  static absl::Status Validate(size_t dim, size_t num_subquantizers);
+
+  size_t dim() const { return dim_; }
+  size_t num_subquantizers() const { return num_subquantizers_; }
+  size_t code_size() const { return (num_subquantizers_ + 1) / 2; }
+  // Number of floats in a distance table, see ComputeDistanceTable.
+  size_t table_size() const { return num_subquantizers_ * kNumCentroids; }
+  bool trained() const { return trained_; }
+
+  // Trains the codebooks with k-means over `num_vectors` vectors stored
+  // contiguously in `data`. num_vectors must be positive.
+  void Train(const float* data, size_t num_vectors, uint32_t seed);
+
+  // `code` must point to code_size() bytes. Requires trained().
+  void Encode(const float* vector, uint8_t* code) const;
+  // Reconstructs a vector from its centroids. Requires trained().
+  void Decode(const uint8_t* code, float* vector) const;
+
+  // Approximate distance between two encoded vectors. Used by hnswlib when
+  // inserting, as both sides are codes.
+  float SymmetricDistance(const uint8_t* code1, const uint8_t* code2) const;
+
+  // Writes SymmetricDistance(query, codes[i]) to out[i] for each of the
+  // num_codes codes. Each subquantizer's table row of `query` is looked up
+  // once and reused for all codes.
+  void SymmetricDistanceBatch(const uint8_t* query,
+                              const uint8_t* const* codes, size_t num_codes,
+                              float* out) const;
+
+  // Fills `table`(table_size() floats) with the distance between each
+  // subvector of `query` and each centroid, so that the distance between the
+  // query and a code is a sum of num_subquantizers table lookups.
+  void ComputeDistanceTable(const float* query, float* table) const;
+
+  // Distance between the query of `table` and a code.
+  float AsymmetricDistance(const float* table, const uint8_t* code) const;
+
+  // Writes AsymmetricDistance(table, codes[i]) to out[i] for every code that
+  // can be among the k closest, and +infinity for the others. All codes are
+  // first ranked with ops::PQFastScanBlock over a uint8 copy of `table`, so
+  // only the few that its bounded error can't rule out are scored exactly.
+  // The k closest thus get the same distances as through graph search.
+  void FastScan(const float* table, const uint8_t* const* codes,
+                size_t num_codes, size_t k, float* out) const;
+
+  // Vectors waiting for the codebooks to be trained, keyed by rowid. Callers
+  // keep it in sync with the rows of the index.
+  std::unordered_map<uint64_t, std::vector<float>>& pending() {
+    return pending_;
+  }
+  const std::unordered_map<uint64_t, std::vector<float>>& pending() const {
+    return pending_;
+  }
+
+  // Codebooks and pending vectors are persisted next to the index file, see
+  // Int8Calibration.
+  static std::string SidecarPath(const std::string& index_path);
+  absl::Status SaveTo(const std::string& path) const;
+  // Fails if the saved quantizer's shape doesn't match this one.
+  absl::Status LoadFrom(const std::string& path);
+
+ private:
+  // Precomputes symmetric_tables_ from the codebooks.
+  void UpdateSymmetricTables();
+
+  // Writes the distance between `subvector` and each of the kNumCentroids
+  // centroids of `subquantizer` to `out`, as a table entry: |x-y|^2 or -x.y.
+  // The centroids are contiguous, so they are scored with one batch call.
+  void ScoreCentroids(const float* subvector, size_t subquantizer,
+                      float* out) const;
+
+  const float* centroid(size_t subquantizer, size_t index) const {
+    return centroids_.data() +
+           (subquantizer * kNumCentroids + index) * subvector_dim_;
+  }
+
+  size_t dim_;
+  size_t num_subquantizers_;
+  size_t subvector_dim_;
+  bool inner_product_;
+  bool trained_ = false;
+  // num_subquantizers_ * kNumCentroids * subvector_dim_ floats.
+  std::vector<float> centroids_;
+  // Distance between every pair of centroids of each subquantizer.
+  std::vector<float> symmetric_tables_;
+  std::unordered_map<uint64_t, std::vector<float>> pending_;
+};
+
+}  // namespace vectorlite
@@ -0,0 +1,251 @@
+#include "product_quantizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// Every subvector of the returned vectors is one of 16 distinct values, so a
+// trained quantizer can represent them without error.
+static std::vector<float> GenerateClusteredVectors(size_t num_vectors,
+                                                   size_t dim,
+                                                   size_t subvector_dim) {
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::uniform_int_distribution<int> cluster(0, 15);
+  const size_t num_subvectors = dim / subvector_dim;
+  std::vector<float> centers(num_subvectors * 16 * subvector_dim);
+  for (float& value : centers) {
+    value = dis(gen);
+  }
+
+  std::vector<float> data(num_vectors * dim);
+  for (size_t i = 0; i < num_vectors; ++i) {
+    for (size_t j = 0; j < num_subvectors; ++j) {
+      const float* center =
+          centers.data() + (j * 16 + cluster(gen)) * subvector_dim;
+      std::copy_n(center, subvector_dim,
+                  data.data() + i * dim + j * subvector_dim);
+    }
+  }
+  return data;
+}
+
+static float L2DistanceSquared(const float* v1, const float* v2, size_t dim) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < dim; ++i) {
+    sum += (v1[i] - v2[i]) * (v1[i] - v2[i]);
+  }
+  return sum;
+}
+
+static float InnerProductDistance(const float* v1, const float* v2,
+                                  size_t dim) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < dim; ++i) {
+    sum += v1[i] * v2[i];
+  }
+  return 1.0f - sum;
+}
+
+TEST(ProductQuantizer, Validate) {
+  EXPECT_TRUE(vectorlite::ProductQuantizer::Validate(128, 16).ok());
+  EXPECT_TRUE(vectorlite::ProductQuantizer::Validate(15, 5).ok());
+  EXPECT_FALSE(vectorlite::ProductQuantizer::Validate(128, 0).ok());
+  EXPECT_FALSE(vectorlite::ProductQuantizer::Validate(128, 3).ok());
+  EXPECT_FALSE(vectorlite::ProductQuantizer::Validate(1024, 512).ok());
+}
+
+TEST(ProductQuantizer, CodeSize) {
+  EXPECT_EQ(vectorlite::ProductQuantizer(128, 16, false).code_size(), 8);
+  EXPECT_EQ(vectorlite::ProductQuantizer(15, 5, false).code_size(), 3);
+}
+
+TEST(ProductQuantizer, EncodeDecodeRoundTrip) {
+  const size_t dim = 32;
+  const size_t num_subquantizers = 8;
+  const size_t num_vectors = 500;
+  auto data = GenerateClusteredVectors(num_vectors, dim,
+                                       dim / num_subquantizers);
+  vectorlite::ProductQuantizer quantizer(dim, num_subquantizers, false);
+  EXPECT_FALSE(quantizer.trained());
+  quantizer.Train(data.data(), num_vectors, 42);
+  ASSERT_TRUE(quantizer.trained());
+
+  std::vector<uint8_t> code(quantizer.code_size());
+  std::vector<float> decoded(dim);
+  for (size_t i = 0; i < num_vectors; ++i) {
+    quantizer.Encode(data.data() + i * dim, code.data());
+    quantizer.Decode(code.data(), decoded.data());
+    for (size_t d = 0; d < dim; ++d) {
+      EXPECT_NEAR(decoded[d], data[i * dim + d], 1e-5);
+    }
+  }
+}
+
+TEST(ProductQuantizer, TrainWithFewerVectorsThanCentroids) {
+  const size_t dim = 8;
+  auto data = GenerateClusteredVectors(3, dim, 2);
+  vectorlite::ProductQuantizer quantizer(dim, 4, false);
+  quantizer.Train(data.data(), 3, 42);
+  ASSERT_TRUE(quantizer.trained());
+
+  std::vector<uint8_t> code(quantizer.code_size());
+  std::vector<float> decoded(dim);
+  for (size_t i = 0; i < 3; ++i) {
+    quantizer.Encode(data.data() + i * dim, code.data());
+    quantizer.Decode(code.data(), decoded.data());
+    for (size_t d = 0; d < dim; ++d) {
+      EXPECT_NEAR(decoded[d], data[i * dim + d], 1e-5);
+    }
+  }
+}
+
+TEST(ProductQuantizer, DistancesMatchDecodedVectors) {
+  const size_t dim = 48;
+  const size_t num_vectors = 300;
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::vector<float> data(num_vectors * dim);
+  for (float& value : data) {
+    value = dis(gen);
+  }
+  std::vector<float> query(dim);
+  for (float& value : query) {
+    value = dis(gen);
+  }
+
+  for (bool inner_product : {false, true}) {
+    auto distance = inner_product ? InnerProductDistance : L2DistanceSquared;
+    // With 3 subquantizers, the high half of the last code byte is unused.
+    for (size_t num_subquantizers : {3, 12, 48}) {
+      vectorlite::ProductQuantizer quantizer(dim, num_subquantizers,
+                                             inner_product);
+      quantizer.Train(data.data(), num_vectors, 1);
+      std::vector<float> table(quantizer.table_size());
+      quantizer.ComputeDistanceTable(query.data(), table.data());
+
+      std::vector<std::vector<uint8_t>> codes(
+          20, std::vector<uint8_t>(quantizer.code_size()));
+      std::vector<std::vector<float>> decoded(20, std::vector<float>(dim));
+      for (size_t i = 0; i < codes.size(); ++i) {
+        quantizer.Encode(data.data() + i * dim, codes[i].data());
+        quantizer.Decode(codes[i].data(), decoded[i].data());
+      }
+
+      for (size_t i = 0; i < codes.size(); ++i) {
+        float expected = distance(query.data(), decoded[i].data(), dim);
+        EXPECT_NEAR(quantizer.AsymmetricDistance(table.data(), codes[i].data()),
+                    expected, 1e-4);
+        EXPECT_NEAR(quantizer.SymmetricDistance(codes[0].data(),
+                                                codes[i].data()),
+                    distance(decoded[0].data(), decoded[i].data(), dim), 1e-4);
+      }
+
+      std::vector<const uint8_t*> code_ptrs;
+      for (const auto& code : codes) {
+        code_ptrs.push_back(code.data());
+      }
+      std::vector<float> symmetric(codes.size());
+      quantizer.SymmetricDistanceBatch(codes[0].data(), code_ptrs.data(),
+                                       code_ptrs.size(), symmetric.data());
+      for (size_t i = 0; i < codes.size(); ++i) {
+        EXPECT_FLOAT_EQ(symmetric[i], quantizer.SymmetricDistance(
+                                          codes[0].data(), codes[i].data()));
+      }
+    }
+  }
+}
+
+TEST(ProductQuantizer, FastScanKeepsTheExactTopK) {
+  const size_t dim = 32;
+  const size_t num_vectors = 500;
+  std::mt19937 gen(5);
+  std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+  std::vector<float> data(num_vectors * dim);
+  for (float& value : data) {
+    value = dis(gen);
+  }
+
+  for (bool inner_product : {false, true}) {
+    for (size_t num_subquantizers : {4, 16, 32}) {
+      vectorlite::ProductQuantizer quantizer(dim, num_subquantizers,
+                                             inner_product);
+      quantizer.Train(data.data(), num_vectors, 1);
+      std::vector<std::vector<uint8_t>> codes(
+          num_vectors, std::vector<uint8_t>(quantizer.code_size()));
+      std::vector<const uint8_t*> code_ptrs;
+      for (size_t i = 0; i < num_vectors; ++i) {
+        quantizer.Encode(data.data() + i * dim, codes[i].data());
+        code_ptrs.push_back(codes[i].data());
+      }
+      std::vector<float> table(quantizer.table_size());
+      quantizer.ComputeDistanceTable(data.data(), table.data());
+
+      std::vector<float> exact(num_vectors);
+      for (size_t i = 0; i < num_vectors; ++i) {
+        exact[i] = quantizer.AsymmetricDistance(table.data(), codes[i].data());
+      }
+      std::vector<float> sorted_exact = exact;
+      std::sort(sorted_exact.begin(), sorted_exact.end());
+
+      for (size_t k : {1, 10, 100, 500}) {
+        std::vector<float> out(num_vectors);
+        quantizer.FastScan(table.data(), code_ptrs.data(), num_vectors, k,
+                           out.data());
+        size_t num_scored = 0;
+        for (size_t i = 0; i < num_vectors; ++i) {
+          if (out[i] != std::numeric_limits<float>::infinity()) {
+            EXPECT_EQ(out[i], exact[i]);
+            ++num_scored;
+          }
+        }
+        ASSERT_GE(num_scored, k);
+        std::sort(out.begin(), out.end());
+        for (size_t i = 0; i < k; ++i) {
+          EXPECT_EQ(out[i], sorted_exact[i]);
+        }
+      }
+    }
+  }
+}
+
+TEST(ProductQuantizer, SaveAndLoad) {
+  auto path = (std::filesystem::temp_directory_path() /
+               "vectorlite_product_quantizer_test")
+                  .string();
+  const size_t dim = 16;
+  auto data = GenerateClusteredVectors(100, dim, 2);
+
+  vectorlite::ProductQuantizer untrained(dim, 8, false);
+  untrained.pending()[3] = std::vector<float>(data.begin(), data.begin() + dim);
+  ASSERT_TRUE(untrained.SaveTo(path).ok());
+  vectorlite::ProductQuantizer loaded(dim, 8, false);
+  ASSERT_TRUE(loaded.LoadFrom(path).ok());
+  EXPECT_FALSE(loaded.trained());
+  ASSERT_EQ(loaded.pending().size(), 1);
+  EXPECT_EQ(loaded.pending().at(3), untrained.pending().at(3));
+
+  vectorlite::ProductQuantizer trained(dim, 8, false);
+  trained.Train(data.data(), 100, 42);
+  ASSERT_TRUE(trained.SaveTo(path).ok());
+  ASSERT_TRUE(loaded.LoadFrom(path).ok());
+  EXPECT_TRUE(loaded.trained());
+  EXPECT_TRUE(loaded.pending().empty());
+  std::vector<uint8_t> code(trained.code_size());
+  std::vector<uint8_t> loaded_code(loaded.code_size());
+  for (size_t i = 0; i < 100; ++i) {
+    trained.Encode(data.data() + i * dim, code.data());
+    loaded.Encode(data.data() + i * dim, loaded_code.data());
+    EXPECT_EQ(code, loaded_code);
+  }
+
+  vectorlite::ProductQuantizer mismatch(dim, 4, false);
+  EXPECT_FALSE(mismatch.LoadFrom(path).ok());
+  std::filesystem::remove(path);
+  EXPECT_FALSE(loaded.LoadFrom(path).ok());
+}
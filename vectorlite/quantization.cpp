@@ -1,10 +1,17 @@
 #include "quantization.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
 #include <vector>
 
+#include "absl/strings/str_format.h"
 #include "hwy/base.h"
+#include "macros.h"
 #include "ops/ops.h"
 #include "vector.h"
+#include "vector_space.h"
 #include "vector_view.h"
 
 namespace vectorlite {
@@ -23,4 +30,170 @@ F16Vector QuantizeToF16(VectorView v) {
   return F16Vector(std::move(quantized));
 }
 
-}  // namespace vectorlite
\ No newline at end of file
+Vector Dequantize(BF16VectorView v) {
+  std::vector<float> dequantized(v.dim());
+  ops::BF16ToF32(v.data().data(), dequantized.data(), v.dim());
+
+  return Vector(std::move(dequantized));
+}
+
+Vector DequantizeF16(F16VectorView v) {
+  std::vector<float> dequantized(v.dim());
+  ops::F16ToF32(v.data().data(), dequantized.data(), v.dim());
+
+  return Vector(std::move(dequantized));
+}
+
+void QuantizeToF8(VectorView v, VectorType vector_type, uint8_t* out) {
+  if (vector_type == VectorType::Float8E4M3) {
+    ops::QuantizeF32ToF8(v.data().data(),
+                         reinterpret_cast<ops::float8_e4m3_t*>(out), v.dim());
+  } else {
+    VECTORLITE_ASSERT(vector_type == VectorType::Float8E5M2);
+    ops::QuantizeF32ToF8(v.data().data(),
+                         reinterpret_cast<ops::float8_e5m2_t*>(out), v.dim());
+  }
+}
+
+Vector DequantizeF8(const uint8_t* v, size_t dim, VectorType vector_type) {
+  std::vector<float> dequantized(dim);
+  if (vector_type == VectorType::Float8E4M3) {
+    ops::F8ToF32(reinterpret_cast<const ops::float8_e4m3_t*>(v),
+                 dequantized.data(), dim);
+  } else {
+    VECTORLITE_ASSERT(vector_type == VectorType::Float8E5M2);
+    ops::F8ToF32(reinterpret_cast<const ops::float8_e5m2_t*>(v),
+                 dequantized.data(), dim);
+  }
+  return Vector(std::move(dequantized));
+}
+
+// The vectors a table is calibrated on rarely span its whole value range, so
+// the int8 range is widened by this factor around them.
+static constexpr float kInt8CalibrationHeadroom = 1.5f;
+
+Int8Calibration Int8Calibration::FromVectors(const float* vectors,
+                                             size_t num_vectors, size_t dim,
+                                             bool symmetric) {
+  float min_value = 0.0f;
+  float max_value = 0.0f;
+  if (num_vectors > 0 && dim > 0) {
+    auto [min_it, max_it] =
+        std::minmax_element(vectors, vectors + num_vectors * dim);
+    min_value = *min_it;
+    max_value = *max_it;
+  }
+
+  Int8Calibration calibration;
+  float half_range = 0.0f;
+  if (symmetric) {
+    half_range = std::max(std::abs(min_value), std::abs(max_value));
+  } else {
+    calibration.offset = (min_value + max_value) / 2;
+    half_range = (max_value - min_value) / 2;
+  }
+
+  if (!std::isfinite(half_range) || half_range <= 0.0f) {
+    // Constant (e.g. all-zero) vectors say nothing about the range.
+    // Fall back to [-1, 1] around the offset.
+    half_range = 1.0f;
+  }
+  calibration.scale =
+      half_range * kInt8CalibrationHeadroom / static_cast<float>(ops::kInt8Max);
+  return calibration;
+}
+
+std::string Int8Calibration::SidecarPath(const std::string& index_path) {
+  return index_path + ".int8";
+}
+
+// File layout: scale and offset as floats, then the number of pending vectors
+// as uint64_t and (rowid as uint64_t, dim floats) for each of them. Files
+// written before vectors were kept pending end after the offset.
+absl::Status Int8Calibration::SaveTo(const std::string& path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    return absl::InternalError(
+        absl::StrFormat("failed to open %s for writing", path));
+  }
+  auto write_u64 = [&out](uint64_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  out.write(reinterpret_cast<const char*>(&scale), sizeof(scale));
+  out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  write_u64(pending.size());
+  for (const auto& [rowid, vector] : pending) {
+    write_u64(rowid);
+    out.write(reinterpret_cast<const char*>(vector.data()),
+              vector.size() * sizeof(float));
+  }
+  if (!out) {
+    return absl::InternalError(absl::StrFormat("failed to write %s", path));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Int8Calibration> Int8Calibration::LoadFrom(
+    const std::string& path, size_t dim) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return absl::NotFoundError(
+        absl::StrFormat("int8 calibration file does not exist: %s", path));
+  }
+  auto read_u64 = [&in]() {
+    uint64_t value = 0;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+  };
+  auto corrupted = [&path]() {
+    return absl::DataLossError(
+        absl::StrFormat("corrupted int8 calibration file: %s", path));
+  };
+
+  Int8Calibration calibration;
+  in.read(reinterpret_cast<char*>(&calibration.scale),
+          sizeof(calibration.scale));
+  in.read(reinterpret_cast<char*>(&calibration.offset),
+          sizeof(calibration.offset));
+  if (!in || !std::isfinite(calibration.scale) ||
+      !std::isfinite(calibration.offset) || calibration.scale < 0.0f) {
+    return corrupted();
+  }
+  if (in.peek() == std::ifstream::traits_type::eof()) {
+    return calibration;
+  }
+  uint64_t num_pending = read_u64();
+  if (!in) {
+    return corrupted();
+  }
+  for (uint64_t i = 0; i < num_pending; ++i) {
+    uint64_t rowid = read_u64();
+    std::vector<float> vector(dim);
+    in.read(reinterpret_cast<char*>(vector.data()),
+            vector.size() * sizeof(float));
+    if (!in) {
+      return corrupted();
+    }
+    calibration.pending[rowid] = std::move(vector);
+  }
+  return calibration;
+}
+
+std::vector<int8_t> QuantizeToInt8(VectorView v,
+                                   const Int8Calibration& calibration) {
+  VECTORLITE_ASSERT(calibration.calibrated());
+  std::vector<int8_t> quantized(v.dim());
+  ops::QuantizeF32ToI8(v.data().data(), quantized.data(), v.dim(),
+                       calibration.scale, calibration.offset);
+  return quantized;
+}
+
+Vector DequantizeInt8(const std::vector<int8_t>& v,
+                      const Int8Calibration& calibration) {
+  std::vector<float> dequantized(v.size());
+  ops::I8ToF32(v.data(), dequantized.data(), v.size(), calibration.scale,
+               calibration.offset);
+  return Vector(std::move(dequantized));
+}
+
+}  // namespace vectorlite
@@ -1,11 +1,69 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "vector.h"
+#include "vector_space.h"
 #include "vector_view.h"
 
 namespace vectorlite {
 
 BF16Vector Quantize(VectorView v);
 F16Vector QuantizeToF16(VectorView v);
+// Inverses of Quantize and QuantizeToF16, which are exact.
+Vector Dequantize(BF16VectorView v);
+Vector DequantizeF16(F16VectorView v);
+
+// Writes `v` as float8 elements of `vector_type`, which must be Float8E4M3 or
+// Float8E5M2, to `out`. `out` must have room for v.dim() bytes. Elements are
+// rounded to nearest and saturate at the format's largest finite value.
+void QuantizeToF8(VectorView v, VectorType vector_type, uint8_t* out);
+// Inverse of QuantizeToF8, which is exact.
+Vector DequantizeF8(const uint8_t* v, size_t dim, VectorType vector_type);
+
+// Per-table affine mapping between f32 values and int8 codes:
+// value ≈ code * scale + offset. A default constructed calibration is
+// uncalibrated; it gets derived from the first vectors inserted into the
+// table, which are kept in float32 as pending vectors until then.
+struct Int8Calibration {
+  float scale = 0.0f;
+  float offset = 0.0f;
+  // Vectors waiting for the calibration, keyed by rowid. Callers keep it in
+  // sync with the rows of the index, see ProductQuantizer::pending().
+  std::unordered_map<uint64_t, std::vector<float>> pending;
+
+  bool calibrated() const { return scale > 0.0f; }
+
+  // Derives a calibration whose int8 range covers the `num_vectors`
+  // `dim`-dimensional vectors stored back to back at `vectors`, with some
+  // headroom for vectors inserted later. Values that still fall outside are
+  // clamped. If `symmetric` is true, offset is fixed to 0 so that the inner
+  // product of two int8 vectors is proportional to that of the original
+  // vectors.
+  static Int8Calibration FromVectors(const float* vectors, size_t num_vectors,
+                                     size_t dim, bool symmetric);
+  static Int8Calibration FromVector(VectorView v, bool symmetric) {
+    return FromVectors(v.data().data(), 1, v.dim(), symmetric);
+  }
+
+  // The calibration and pending vectors are persisted next to the index file
+  // because hnswlib's file format has no room for user data.
+  static std::string SidecarPath(const std::string& index_path);
+  absl::Status SaveTo(const std::string& path) const;
+  // `dim` is the dimension of the pending vectors.
+  static absl::StatusOr<Int8Calibration> LoadFrom(const std::string& path,
+                                                  size_t dim);
+};
+
+// `calibration` must be calibrated.
+std::vector<int8_t> QuantizeToInt8(VectorView v,
+                                   const Int8Calibration& calibration);
+Vector DequantizeInt8(const std::vector<int8_t>& v,
+                      const Int8Calibration& calibration);
 
-}  // namespace vectorlite
\ No newline at end of file
+}  // namespace vectorlite
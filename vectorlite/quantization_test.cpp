@@ -0,0 +1,162 @@
+#include "quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "vector.h"
+#include "vector_space.h"
+#include "vector_view.h"
+
+TEST(Quantize, DequantizeIsExact) {
+  // Values with at most 8 significant bits are exact in both formats.
+  vectorlite::Vector v(
+      std::vector<float>{-3.0f, -0.375f, 0.0f, 0.125f, 2.0f, 5.5f, 1000.0f});
+
+  vectorlite::Vector bf16 = vectorlite::Dequantize(vectorlite::Quantize(v));
+  EXPECT_EQ(bf16.data(), v.data());
+
+  vectorlite::Vector f16 =
+      vectorlite::DequantizeF16(vectorlite::QuantizeToF16(v));
+  EXPECT_EQ(f16.data(), v.data());
+}
+
+TEST(QuantizeToF8, DequantizeRoundTrip) {
+  vectorlite::Vector v(
+      std::vector<float>{-3.0f, -0.3f, 0.0f, 0.1f, 2.0f, 5.5f, 1000.0f});
+  // Half the relative spacing of float8 values: 2^-4 for E4M3 and 2^-3 for
+  // E5M2.
+  for (auto [vector_type, max_value, relative_error] :
+       {std::tuple{vectorlite::VectorType::Float8E4M3, 448.0f, 0.0625f},
+        std::tuple{vectorlite::VectorType::Float8E5M2, 57344.0f, 0.125f}}) {
+    std::vector<uint8_t> quantized(v.dim());
+    vectorlite::QuantizeToF8(v, vector_type, quantized.data());
+    vectorlite::Vector dequantized =
+        vectorlite::DequantizeF8(quantized.data(), v.dim(), vector_type);
+    ASSERT_EQ(dequantized.dim(), v.dim());
+    for (size_t i = 0; i < v.dim(); ++i) {
+      const float expected = std::min(v.data()[i], max_value);
+      EXPECT_NEAR(dequantized.data()[i], expected,
+                  std::abs(expected) * relative_error);
+    }
+  }
+}
+
+TEST(Int8Calibration, DefaultConstructedIsNotCalibrated) {
+  vectorlite::Int8Calibration calibration;
+  EXPECT_FALSE(calibration.calibrated());
+}
+
+TEST(Int8Calibration, SymmetricFromVector) {
+  vectorlite::Vector v(std::vector<float>{-0.5f, 0.25f, 1.0f});
+  auto calibration = vectorlite::Int8Calibration::FromVector(v, true);
+  ASSERT_TRUE(calibration.calibrated());
+  EXPECT_FLOAT_EQ(calibration.offset, 0.0f);
+  // The largest magnitude must be representable without clamping.
+  EXPECT_GE(calibration.scale * 127, 1.0f);
+}
+
+TEST(Int8Calibration, AsymmetricFromVector) {
+  vectorlite::Vector v(std::vector<float>{10.0f, 12.0f, 14.0f});
+  auto calibration = vectorlite::Int8Calibration::FromVector(v, false);
+  ASSERT_TRUE(calibration.calibrated());
+  EXPECT_FLOAT_EQ(calibration.offset, 12.0f);
+  EXPECT_GE(calibration.scale * 127, 2.0f);
+}
+
+TEST(Int8Calibration, ConstantVectorStillCalibrates) {
+  vectorlite::Vector v(std::vector<float>{0.0f, 0.0f, 0.0f});
+  EXPECT_TRUE(vectorlite::Int8Calibration::FromVector(v, true).calibrated());
+  EXPECT_TRUE(vectorlite::Int8Calibration::FromVector(v, false).calibrated());
+}
+
+TEST(Int8Calibration, QuantizeDequantizeRoundTrip) {
+  vectorlite::Vector v(std::vector<float>{-3.0f, -1.0f, 0.0f, 2.0f, 5.0f});
+  for (bool symmetric : {true, false}) {
+    auto calibration = vectorlite::Int8Calibration::FromVector(v, symmetric);
+    std::vector<int8_t> quantized = vectorlite::QuantizeToInt8(v, calibration);
+    ASSERT_EQ(quantized.size(), v.dim());
+    vectorlite::Vector dequantized =
+        vectorlite::DequantizeInt8(quantized, calibration);
+    ASSERT_EQ(dequantized.dim(), v.dim());
+    for (size_t i = 0; i < v.dim(); ++i) {
+      // Rounding error is at most half a quantization step.
+      EXPECT_NEAR(dequantized.data()[i], v.data()[i],
+                  calibration.scale / 2 + 1e-6);
+    }
+  }
+}
+
+TEST(Int8Calibration, FromVectorsCoversEveryVector) {
+  // The largest magnitude is in the last vector.
+  std::vector<float> vectors = {0.5f, -0.25f, 0.1f, 0.2f, 0.3f, -4.0f};
+  auto calibration = vectorlite::Int8Calibration::FromVectors(
+      vectors.data(), 3, 2, /*symmetric=*/true);
+  ASSERT_TRUE(calibration.calibrated());
+  EXPECT_GE(calibration.scale * 127, 4.0f);
+
+  calibration = vectorlite::Int8Calibration::FromVectors(
+      vectors.data(), 3, 2, /*symmetric=*/false);
+  EXPECT_FLOAT_EQ(calibration.offset, (0.5f - 4.0f) / 2);
+  EXPECT_GE(calibration.scale * 127, 2.25f);
+}
+
+TEST(Int8Calibration, SaveAndLoad) {
+  auto path = (std::filesystem::temp_directory_path() /
+               "vectorlite_int8_calibration_test")
+                  .string();
+  vectorlite::Int8Calibration calibration{0.125f, -2.5f};
+  ASSERT_TRUE(calibration.SaveTo(path).ok());
+
+  auto loaded = vectorlite::Int8Calibration::LoadFrom(path, 2);
+  ASSERT_TRUE(loaded.ok());
+  EXPECT_EQ(loaded->scale, calibration.scale);
+  EXPECT_EQ(loaded->offset, calibration.offset);
+  EXPECT_TRUE(loaded->pending.empty());
+  std::filesystem::remove(path);
+
+  EXPECT_FALSE(vectorlite::Int8Calibration::LoadFrom(path, 2).ok());
+}
+
+TEST(Int8Calibration, SaveAndLoadPendingVectors) {
+  auto path = (std::filesystem::temp_directory_path() /
+               "vectorlite_int8_calibration_pending_test")
+                  .string();
+  vectorlite::Int8Calibration calibration;
+  calibration.pending[3] = {1.0f, 2.0f};
+  calibration.pending[7] = {-1.0f, 0.5f};
+  ASSERT_TRUE(calibration.SaveTo(path).ok());
+
+  auto loaded = vectorlite::Int8Calibration::LoadFrom(path, 2);
+  ASSERT_TRUE(loaded.ok());
+  EXPECT_FALSE(loaded->calibrated());
+  EXPECT_EQ(loaded->pending, calibration.pending);
+
+  // A file cut short within the pending vectors is corrupted.
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  EXPECT_FALSE(vectorlite::Int8Calibration::LoadFrom(path, 2).ok());
+  std::filesystem::remove(path);
+}
+
+TEST(Int8Calibration, LoadsFilesWithoutPendingVectors) {
+  // Files written before vectors were kept pending hold scale and offset only.
+  auto path = (std::filesystem::temp_directory_path() /
+               "vectorlite_int8_calibration_legacy_test")
+                  .string();
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    const float values[] = {0.25f, 1.0f};
+    out.write(reinterpret_cast<const char*>(values), sizeof(values));
+  }
+  auto loaded = vectorlite::Int8Calibration::LoadFrom(path, 2);
+  ASSERT_TRUE(loaded.ok());
+  EXPECT_EQ(loaded->scale, 0.25f);
+  EXPECT_EQ(loaded->offset, 1.0f);
+  EXPECT_TRUE(loaded->pending.empty());
+  std::filesystem::remove(path);
+}
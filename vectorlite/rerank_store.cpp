@@ -0,0 +1,111 @@
+#include "rerank_store.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "absl/strings/str_format.h"
+
+namespace vectorlite {
+
+void RerankStore::Put(uint64_t rowid, const float* vector) {
+  auto [it, inserted] = slots_.try_emplace(rowid, 0);
+  if (inserted) {
+    if (!free_slots_.empty()) {
+      it->second = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      it->second = vectors_.size() / dim_;
+      vectors_.resize(vectors_.size() + dim_);
+    }
+  }
+  std::copy(vector, vector + dim_, vectors_.begin() + it->second * dim_);
+}
+
+void RerankStore::Erase(uint64_t rowid) {
+  auto it = slots_.find(rowid);
+  if (it == slots_.end()) {
+    return;
+  }
+  free_slots_.push_back(it->second);
+  slots_.erase(it);
+}
+
+const float* RerankStore::Find(uint64_t rowid) const {
+  auto it = slots_.find(rowid);
+  if (it == slots_.end()) {
+    return nullptr;
+  }
+  return vectors_.data() + it->second * dim_;
+}
+
+std::string RerankStore::SidecarPath(const std::string& index_path) {
+  return index_path + ".rerank";
+}
+
+// File layout: dim and the number of vectors as uint64_t, then (rowid as
+// uint64_t, dim floats) for each vector.
+absl::Status RerankStore::SaveTo(const std::string& path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    return absl::InternalError(
+        absl::StrFormat("failed to open %s for writing", path));
+  }
+  auto write_u64 = [&out](uint64_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  write_u64(dim_);
+  write_u64(slots_.size());
+  for (const auto& [rowid, slot] : slots_) {
+    write_u64(rowid);
+    out.write(reinterpret_cast<const char*>(vectors_.data() + slot * dim_),
+              dim_ * sizeof(float));
+  }
+  if (!out) {
+    return absl::InternalError(absl::StrFormat("failed to write %s", path));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status RerankStore::LoadFrom(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return absl::NotFoundError(
+        absl::StrFormat("rerank vector file does not exist: %s", path));
+  }
+  auto read_u64 = [&in]() {
+    uint64_t value = 0;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+  };
+  auto corrupted = [&path]() {
+    return absl::DataLossError(
+        absl::StrFormat("corrupted rerank vector file: %s", path));
+  };
+
+  uint64_t dim = read_u64();
+  uint64_t num_vectors = read_u64();
+  if (!in) {
+    return corrupted();
+  }
+  if (dim != dim_) {
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "rerank vector dimension mismatch: file has %d, table expects %d", dim,
+        dim_));
+  }
+
+  RerankStore store(dim_);
+  std::vector<float> vector(dim_);
+  for (uint64_t i = 0; i < num_vectors; ++i) {
+    uint64_t rowid = read_u64();
+    in.read(reinterpret_cast<char*>(vector.data()),
+            vector.size() * sizeof(float));
+    if (!in) {
+      return corrupted();
+    }
+    store.Put(rowid, vector.data());
+  }
+  *this = std::move(store);
+  return absl::OkStatus();
+}
+
+}  // namespace vectorlite
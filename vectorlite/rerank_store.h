@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/status/status.h"
+
+namespace vectorlite {
+
+// Full precision copies of binary quantized vectors, keyed by rowid, which knn
+// queries rescore binary candidates with, see BinarySpaceParam. They are kept
+// out of the hnswlib index, so that its elements only hold binary codes and
+// graph search walks a small stride.
+//
+// Vectors are stored back to back in one array. The slot of a removed vector
+// is reused by the next one put.
+class RerankStore {
+ public:
+  explicit RerankStore(size_t dim) : dim_(dim) {}
+
+  size_t dim() const { return dim_; }
+  size_t size() const { return slots_.size(); }
+
+  // Inserts or replaces the vector of `rowid`, which has dim() elements.
+  void Put(uint64_t rowid, const float* vector);
+  // Removes the vector of `rowid`, if any.
+  void Erase(uint64_t rowid);
+  // Returns the vector of `rowid`, or nullptr if there is none. The pointer is
+  // invalidated by the next Put().
+  const float* Find(uint64_t rowid) const;
+
+  // Vectors are persisted next to the index file, see Int8Calibration.
+  static std::string SidecarPath(const std::string& index_path);
+  absl::Status SaveTo(const std::string& path) const;
+  // Replaces the vectors with those saved in `path`. Leaves them unchanged on
+  // failure.
+  absl::Status LoadFrom(const std::string& path);
+
+ private:
+  size_t dim_;
+  // Slot i holds elements [i * dim_, (i + 1) * dim_).
+  std::vector<float> vectors_;
+  std::unordered_map<uint64_t, size_t> slots_;
+  std::vector<size_t> free_slots_;
+};
+
+}  // namespace vectorlite
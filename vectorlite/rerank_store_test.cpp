@@ -0,0 +1,79 @@
+#include "rerank_store.h"
+
+#include <filesystem>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+static std::vector<float> Get(const vectorlite::RerankStore& store,
+                              uint64_t rowid) {
+  const float* vector = store.Find(rowid);
+  if (vector == nullptr) {
+    return {};
+  }
+  return std::vector<float>(vector, vector + store.dim());
+}
+
+TEST(RerankStore, PutFindAndErase) {
+  vectorlite::RerankStore store(2);
+  EXPECT_EQ(store.Find(1), nullptr);
+
+  const float v1[] = {1.0f, 2.0f};
+  const float v2[] = {-3.0f, 0.5f};
+  store.Put(1, v1);
+  store.Put(9, v2);
+  EXPECT_EQ(store.size(), 2);
+  EXPECT_EQ(Get(store, 1), std::vector<float>({1.0f, 2.0f}));
+  EXPECT_EQ(Get(store, 9), std::vector<float>({-3.0f, 0.5f}));
+
+  // Replacing a vector keeps its slot.
+  const float* slot = store.Find(1);
+  store.Put(1, v2);
+  EXPECT_EQ(store.Find(1), slot);
+  EXPECT_EQ(Get(store, 1), std::vector<float>({-3.0f, 0.5f}));
+
+  // The slot of an erased vector is reused.
+  store.Erase(1);
+  store.Erase(42);
+  EXPECT_EQ(store.size(), 1);
+  EXPECT_EQ(store.Find(1), nullptr);
+  store.Put(5, v1);
+  EXPECT_EQ(store.Find(5), slot);
+  EXPECT_EQ(Get(store, 5), std::vector<float>({1.0f, 2.0f}));
+  EXPECT_EQ(Get(store, 9), std::vector<float>({-3.0f, 0.5f}));
+}
+
+TEST(RerankStore, SaveAndLoad) {
+  auto path = (std::filesystem::temp_directory_path() /
+               "vectorlite_rerank_store_test")
+                  .string();
+  vectorlite::RerankStore store(2);
+  const float v1[] = {1.0f, 2.0f};
+  const float v2[] = {-3.0f, 0.5f};
+  store.Put(3, v1);
+  store.Put(7, v2);
+  store.Put(8, v1);
+  store.Erase(8);
+  ASSERT_TRUE(store.SaveTo(path).ok());
+
+  vectorlite::RerankStore loaded(2);
+  loaded.Put(100, v1);
+  ASSERT_TRUE(loaded.LoadFrom(path).ok());
+  EXPECT_EQ(loaded.size(), 2);
+  EXPECT_EQ(Get(loaded, 3), std::vector<float>({1.0f, 2.0f}));
+  EXPECT_EQ(Get(loaded, 7), std::vector<float>({-3.0f, 0.5f}));
+  EXPECT_EQ(loaded.Find(100), nullptr);
+
+  // Another dimension is rejected and leaves the store unchanged.
+  vectorlite::RerankStore other(3);
+  EXPECT_FALSE(other.LoadFrom(path).ok());
+  EXPECT_EQ(other.size(), 0);
+
+  // A file cut short within the vectors is corrupted.
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  EXPECT_FALSE(loaded.LoadFrom(path).ok());
+  EXPECT_EQ(loaded.size(), 2);
+  std::filesystem::remove(path);
+
+  EXPECT_FALSE(loaded.LoadFrom(path).ok());
+}
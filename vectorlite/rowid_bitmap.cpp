@@ -0,0 +1,259 @@
+#include "rowid_bitmap.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "absl/numeric/bits.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+
+namespace vectorlite {
+
+namespace {
+
+constexpr std::string_view kMagic = "VLRB";
+
+template <class T>
+void Append(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Reads values from a blob, failing instead of reading past its end.
+class BlobReader {
+ public:
+  explicit BlobReader(std::string_view blob) : blob_(blob) {}
+
+  template <class T>
+  bool Read(T* values, size_t count) {
+    const size_t size = sizeof(T) * count;
+    if (size / sizeof(T) != count || blob_.size() < size) {
+      return false;
+    }
+    std::memcpy(values, blob_.data(), size);
+    blob_.remove_prefix(size);
+    return true;
+  }
+
+  bool exhausted() const { return blob_.empty(); }
+
+ private:
+  std::string_view blob_;
+};
+
+}  // namespace
+
+bool RowidBitmap::Container::Contains(uint16_t low) const {
+  if (is_bitmap()) {
+    return (bitmap[low / 64] >> (low % 64)) & 1;
+  }
+  return std::binary_search(array.begin(), array.end(), low);
+}
+
+bool RowidBitmap::Container::Add(uint16_t low) {
+  if (is_bitmap()) {
+    uint64_t& word = bitmap[low / 64];
+    const uint64_t mask = uint64_t{1} << (low % 64);
+    if (word & mask) {
+      return false;
+    }
+    word |= mask;
+    ++cardinality;
+    return true;
+  }
+
+  if (array.empty() || array.back() < low) {
+    array.push_back(low);
+  } else {
+    auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (*it == low) {
+      return false;
+    }
+    array.insert(it, low);
+  }
+  ++cardinality;
+  if (cardinality > kMaxArraySize) {
+    // Past this size, a bitmap is smaller than the array.
+    bitmap.assign(kBitmapWords, 0);
+    for (uint16_t value : array) {
+      bitmap[value / 64] |= uint64_t{1} << (value % 64);
+    }
+    array = std::vector<uint16_t>();
+  }
+  return true;
+}
+
+uint32_t RowidBitmap::Container::NextSetBit(uint32_t bit) const {
+  size_t index = bit / 64;
+  if (index >= kBitmapWords) {
+    return 65536;
+  }
+  uint64_t word = bitmap[index] & (~uint64_t{0} << (bit % 64));
+  while (word == 0) {
+    if (++index == kBitmapWords) {
+      return 65536;
+    }
+    word = bitmap[index];
+  }
+  return static_cast<uint32_t>(index * 64 + absl::countr_zero(word));
+}
+
+const RowidBitmap::Container* RowidBitmap::FindContainer(uint64_t key) const {
+  auto it = std::lower_bound(
+      containers_.begin(), containers_.end(), key,
+      [](const Container& container, uint64_t key) {
+        return container.key < key;
+      });
+  if (it == containers_.end() || it->key != key) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+RowidBitmap::Container& RowidBitmap::FindOrAddContainer(uint64_t key) {
+  if (containers_.empty() || containers_.back().key < key) {
+    containers_.push_back(Container{key});
+    return containers_.back();
+  }
+  auto it = std::lower_bound(
+      containers_.begin(), containers_.end(), key,
+      [](const Container& container, uint64_t key) {
+        return container.key < key;
+      });
+  if (it->key != key) {
+    it = containers_.insert(it, Container{key});
+  }
+  return *it;
+}
+
+void RowidBitmap::Add(uint64_t rowid) {
+  if (FindOrAddContainer(rowid >> 16).Add(static_cast<uint16_t>(rowid))) {
+    ++size_;
+  }
+}
+
+bool RowidBitmap::Contains(uint64_t rowid) const {
+  const Container* container = FindContainer(rowid >> 16);
+  return container != nullptr &&
+         container->Contains(static_cast<uint16_t>(rowid));
+}
+
+RowidBitmap::const_iterator RowidBitmap::begin() const {
+  if (containers_.empty()) {
+    return end();
+  }
+  const Container& first = containers_.front();
+  return const_iterator(this, 0, first.is_bitmap() ? first.NextSetBit(0) : 0);
+}
+
+uint64_t RowidBitmap::const_iterator::operator*() const {
+  const Container& container = bitmap_->containers_[container_];
+  const uint16_t low = container.is_bitmap()
+                           ? static_cast<uint16_t>(position_)
+                           : container.array[position_];
+  return (container.key << 16) | low;
+}
+
+RowidBitmap::const_iterator& RowidBitmap::const_iterator::operator++() {
+  const Container& container = bitmap_->containers_[container_];
+  position_ = container.is_bitmap() ? container.NextSetBit(position_ + 1)
+                                    : position_ + 1;
+  const bool exhausted = container.is_bitmap()
+                             ? position_ == 65536
+                             : position_ == container.array.size();
+  if (exhausted) {
+    ++container_;
+    position_ = 0;
+    if (container_ < bitmap_->containers_.size()) {
+      const Container& next = bitmap_->containers_[container_];
+      if (next.is_bitmap()) {
+        position_ = next.NextSetBit(0);
+      }
+    }
+  }
+  return *this;
+}
+
+std::string RowidBitmap::ToBlob() const {
+  std::string blob(kMagic);
+  Append(blob, static_cast<uint32_t>(containers_.size()));
+  for (const Container& container : containers_) {
+    Append(blob, container.key);
+    Append(blob, container.cardinality);
+    if (container.is_bitmap()) {
+      blob.append(reinterpret_cast<const char*>(container.bitmap.data()),
+                  container.bitmap.size() * sizeof(uint64_t));
+    } else {
+      blob.append(reinterpret_cast<const char*>(container.array.data()),
+                  container.array.size() * sizeof(uint16_t));
+    }
+  }
+  return blob;
+}
+
+absl::StatusOr<RowidBitmap> RowidBitmap::FromBlob(std::string_view blob) {
+  auto invalid = [](std::string_view reason) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("invalid rowid bitmap: %s", reason));
+  };
+  if (blob.substr(0, kMagic.size()) != kMagic) {
+    return invalid("not created by rowid_bitmap()");
+  }
+  BlobReader reader(blob.substr(kMagic.size()));
+  uint32_t num_containers = 0;
+  if (!reader.Read(&num_containers, 1)) {
+    return invalid("truncated");
+  }
+
+  RowidBitmap result;
+  result.containers_.reserve(std::min<size_t>(num_containers, blob.size()));
+  for (uint32_t i = 0; i < num_containers; ++i) {
+    Container container;
+    if (!reader.Read(&container.key, 1) ||
+        !reader.Read(&container.cardinality, 1)) {
+      return invalid("truncated");
+    }
+    if (container.key > (~uint64_t{0} >> 16)) {
+      return invalid("bad container key");
+    }
+    if (!result.containers_.empty() &&
+        container.key <= result.containers_.back().key) {
+      return invalid("containers are not sorted");
+    }
+    if (container.cardinality == 0 || container.cardinality > 65536) {
+      return invalid("bad container size");
+    }
+
+    if (container.cardinality <= kMaxArraySize) {
+      container.array.resize(container.cardinality);
+      if (!reader.Read(container.array.data(), container.array.size())) {
+        return invalid("truncated");
+      }
+      if (std::adjacent_find(container.array.begin(), container.array.end(),
+                             std::greater_equal<uint16_t>()) !=
+          container.array.end()) {
+        return invalid("rowids are not sorted");
+      }
+    } else {
+      container.bitmap.resize(kBitmapWords);
+      if (!reader.Read(container.bitmap.data(), container.bitmap.size())) {
+        return invalid("truncated");
+      }
+      size_t cardinality = 0;
+      for (uint64_t word : container.bitmap) {
+        cardinality += absl::popcount(word);
+      }
+      if (cardinality != container.cardinality) {
+        return invalid("bad container size");
+      }
+    }
+    result.size_ += container.cardinality;
+    result.containers_.push_back(std::move(container));
+  }
+  if (!reader.exhausted()) {
+    return invalid("trailing bytes");
+  }
+  return result;
+}
+
+}  // namespace vectorlite
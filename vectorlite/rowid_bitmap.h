@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/statusor.h"
+
+namespace vectorlite {
+
+// A compressed set of rowids in the style of Roaring bitmaps. Rowids are
+// grouped by their upper 48 bits into containers of up to 65536 rowids. A
+// container stores the lower 16 bits of its rowids as a sorted array while it
+// has at most kMaxArraySize of them, and as a 65536-bit bitmap otherwise. So a
+// set takes at most 2 bytes per rowid, down to 1 bit per rowid when dense, and
+// a membership test is a binary search over containers followed by a bit test
+// or a binary search over at most 8 KiB.
+class RowidBitmap {
+ public:
+  static constexpr size_t kMaxArraySize = 4096;
+
+  // Iterates rowids in ascending order.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = uint64_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const uint64_t*;
+    using reference = uint64_t;
+
+    uint64_t operator*() const;
+    const_iterator& operator++();
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const const_iterator& other) const {
+      return container_ == other.container_ && position_ == other.position_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class RowidBitmap;
+    const_iterator(const RowidBitmap* bitmap, size_t container,
+                   uint32_t position)
+        : bitmap_(bitmap), container_(container), position_(position) {}
+
+    const RowidBitmap* bitmap_;
+    size_t container_;
+    // Index into the array, or the index of the current bit.
+    uint32_t position_;
+  };
+
+  // Adds `rowid` to the set. Adding rowids in ascending order is fastest, as
+  // they are then appended to the last container.
+  void Add(uint64_t rowid);
+  bool Contains(uint64_t rowid) const;
+
+  // Number of rowids in the set.
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const_iterator begin() const;
+  const_iterator end() const {
+    return const_iterator(this, containers_.size(), 0);
+  }
+
+  // Serializes the set into a blob that FromBlob() reads back, e.g. the result
+  // of the rowid_bitmap() SQL function. All integers are little endian:
+  //   "VLRB" | container count: u32 |
+  //   for each container in ascending key order:
+  //     key(rowid >> 16): u64 | cardinality: u32 |
+  //     cardinality u16s if cardinality <= kMaxArraySize,
+  //     otherwise 1024 u64 bitmap words
+  std::string ToBlob() const;
+  static absl::StatusOr<RowidBitmap> FromBlob(std::string_view blob);
+
+ private:
+  static constexpr size_t kBitmapWords = 65536 / 64;
+
+  struct Container {
+    uint64_t key;
+    // Exactly one of them is used, depending on cardinality.
+    std::vector<uint16_t> array;
+    std::vector<uint64_t> bitmap;
+    uint32_t cardinality = 0;
+
+    bool is_bitmap() const { return !bitmap.empty(); }
+    bool Contains(uint16_t low) const;
+    // Returns whether `low` was not in the container yet.
+    bool Add(uint16_t low);
+    // Index of the first set bit at or after `bit`, 65536 if there is none.
+    uint32_t NextSetBit(uint32_t bit) const;
+  };
+
+  const Container* FindContainer(uint64_t key) const;
+  Container& FindOrAddContainer(uint64_t key);
+
+  // Sorted by key.
+  std::vector<Container> containers_;
+  size_t size_ = 0;
+};
+
+}  // namespace vectorlite
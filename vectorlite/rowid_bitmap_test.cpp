@@ -0,0 +1,106 @@
+#include "rowid_bitmap.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(RowidBitmap, EmptySet) {
+  vectorlite::RowidBitmap bitmap;
+  EXPECT_TRUE(bitmap.empty());
+  EXPECT_EQ(bitmap.size(), 0);
+  EXPECT_FALSE(bitmap.Contains(0));
+  EXPECT_TRUE(bitmap.begin() == bitmap.end());
+
+  auto parsed = vectorlite::RowidBitmap::FromBlob(bitmap.ToBlob());
+  ASSERT_TRUE(parsed.ok()) << parsed.status();
+  EXPECT_TRUE(parsed->empty());
+}
+
+TEST(RowidBitmap, ShouldMatchStdSet) {
+  std::mt19937_64 gen(42);
+  // Sparse containers stay arrays while dense ones become bitmaps. Rowids are
+  // added out of order and with duplicates.
+  std::set<uint64_t> expected;
+  vectorlite::RowidBitmap bitmap;
+  std::uniform_int_distribution<uint64_t> sparse(0, uint64_t{1} << 40);
+  std::uniform_int_distribution<uint64_t> dense(65536, 3 * 65536);
+  for (int i = 0; i < 1000; ++i) {
+    uint64_t rowid = sparse(gen);
+    expected.insert(rowid);
+    bitmap.Add(rowid);
+  }
+  for (int i = 0; i < 50000; ++i) {
+    uint64_t rowid = dense(gen);
+    expected.insert(rowid);
+    bitmap.Add(rowid);
+  }
+  bitmap.Add(0);
+  bitmap.Add(UINT64_MAX);
+  expected.insert(0);
+  expected.insert(UINT64_MAX);
+
+  EXPECT_EQ(bitmap.size(), expected.size());
+  EXPECT_TRUE(std::equal(bitmap.begin(), bitmap.end(), expected.begin(),
+                         expected.end()));
+  for (uint64_t rowid : expected) {
+    EXPECT_TRUE(bitmap.Contains(rowid)) << rowid;
+  }
+  for (int i = 0; i < 10000; ++i) {
+    uint64_t rowid = i % 2 ? sparse(gen) : dense(gen);
+    EXPECT_EQ(bitmap.Contains(rowid), expected.count(rowid) > 0) << rowid;
+  }
+}
+
+TEST(RowidBitmap, ShouldSwitchToBitmapWhenDense) {
+  vectorlite::RowidBitmap bitmap;
+  for (uint64_t rowid = 0; rowid < 65536; rowid += 2) {
+    bitmap.Add(rowid);
+  }
+  EXPECT_EQ(bitmap.size(), 32768);
+  // One container of 8 KiB rather than 64 KiB of uint16s.
+  EXPECT_LT(bitmap.ToBlob().size(), 8300);
+  EXPECT_TRUE(bitmap.Contains(65534));
+  EXPECT_FALSE(bitmap.Contains(65535));
+  EXPECT_EQ(std::count_if(bitmap.begin(), bitmap.end(),
+                          [](uint64_t rowid) { return rowid % 2 == 0; }),
+            32768);
+}
+
+TEST(RowidBitmap, ShouldRoundTripThroughBlob) {
+  vectorlite::RowidBitmap bitmap;
+  for (uint64_t rowid = 0; rowid < 200000; rowid += 3) {
+    bitmap.Add(rowid);
+  }
+  bitmap.Add(uint64_t{1} << 50);
+
+  auto parsed = vectorlite::RowidBitmap::FromBlob(bitmap.ToBlob());
+  ASSERT_TRUE(parsed.ok()) << parsed.status();
+  EXPECT_EQ(parsed->size(), bitmap.size());
+  EXPECT_TRUE(std::equal(parsed->begin(), parsed->end(), bitmap.begin(),
+                         bitmap.end()));
+  EXPECT_EQ(parsed->ToBlob(), bitmap.ToBlob());
+}
+
+TEST(RowidBitmap, ShouldRejectInvalidBlobs) {
+  vectorlite::RowidBitmap bitmap;
+  bitmap.Add(1);
+  bitmap.Add(2);
+  const std::string blob = bitmap.ToBlob();
+
+  EXPECT_FALSE(vectorlite::RowidBitmap::FromBlob("").ok());
+  EXPECT_FALSE(vectorlite::RowidBitmap::FromBlob("abcdefgh").ok());
+  // Truncated or with trailing bytes.
+  EXPECT_FALSE(
+      vectorlite::RowidBitmap::FromBlob(blob.substr(0, blob.size() - 1)).ok());
+  EXPECT_FALSE(vectorlite::RowidBitmap::FromBlob(blob + "x").ok());
+
+  // The two uint16s at the end must be ascending.
+  std::string unsorted = blob;
+  std::swap(unsorted[unsorted.size() - 4], unsorted[unsorted.size() - 2]);
+  EXPECT_FALSE(vectorlite::RowidBitmap::FromBlob(unsorted).ok());
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+
+#include "hnswlib/hnswlib.h"
+
+namespace vectorlite {
+
+// hnswlib::SpaceInterface<float> extended with operations that vectorlite needs
+// outside of hnswlib's graph traversal. All vector spaces created by
+// VectorSpace::Create implement it.
+class SpaceInterface : public hnswlib::SpaceInterface<float> {
+ public:
+  // Computes the distance between `query` and each of `vectors` in one go,
+  // writing num_vectors results to `out`. Equivalent to calling get_dist_func()
+  // on every pair, but amortizes the dynamic dispatch. `query` and `vectors`
+  // must be in the space's storage format.
+  virtual void BatchDistance(const void* query, const void* const* vectors,
+                             size_t num_vectors, float* out) = 0;
+
+  // Returns a distance function that takes a float32 vector as its first
+  // argument and a vector in the space's storage format as its second, with
+  // get_dist_func_param() as the third. Used to search with a float32 query
+  // without quantizing it. Returns nullptr if the storage format is float32
+  // or there is no such function.
+  virtual hnswlib::DISTFUNC<float> get_f32_query_dist_func() { return nullptr; }
+
+  // BatchDistance with a float32 `query`, i.e. get_f32_query_dist_func() on
+  // every pair. Must only be called if get_f32_query_dist_func() isn't
+  // nullptr. Spaces that have a batch kernel for it override this loop.
+  virtual void BatchF32QueryDistance(const float* query,
+                                     const void* const* vectors,
+                                     size_t num_vectors, float* out) {
+    hnswlib::DISTFUNC<float> func = get_f32_query_dist_func();
+    void* param = get_dist_func_param();
+    for (size_t i = 0; i < num_vectors; ++i) {
+      out[i] = func(query, vectors[i], param);
+    }
+  }
+
+  // Replaces the function returned by get_dist_func() with `func`, which must
+  // compute the same distances over the same storage format, e.g. a variant
+  // found faster by AutotuneDistanceFunc. Returns false if the space's
+  // distance function can't be replaced.
+  virtual bool set_dist_func(hnswlib::DISTFUNC<float> func) { return false; }
+
+  // Like set_dist_func, for the function returned by
+  // get_f32_query_dist_func(). Returns false if there is none to replace.
+  virtual bool set_f32_query_dist_func(hnswlib::DISTFUNC<float> func) {
+    return false;
+  }
+};
+
+}  // namespace vectorlite
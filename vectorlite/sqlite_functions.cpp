@@ -1,12 +1,26 @@
 #include "sqlite_functions.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "absl/log/log.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "autotune.h"
+#include "index_registry.h"
 #include "ops/ops.h"
+#include "rowid_bitmap.h"
 #include "vector.h"
 #include "vector_space.h"
 #include "vectorlite/version.h"
@@ -16,16 +30,72 @@ extern const sqlite3_api_routines *sqlite3_api;
 
 namespace vectorlite {
 
+static std::string FormatTableName(const RegistryKey &key) {
+  return absl::StrFormat("%s.%s", key.first, key.second);
+}
+
 void ShowInfo(sqlite3_context *ctx, int, sqlite3_value **) {
   const char *best_target = vectorlite::ops::GetBestTarget();
   std::string info =
       absl::StrFormat("vectorlite extension version %s. "
                       "Best SIMD target in use: %s",
                       VECTORLITE_VERSION, best_target);
+  auto *registry = static_cast<IndexRegistry *>(sqlite3_user_data(ctx));
+  std::vector<std::string> tuned;
+  registry->ForEach([&](const RegistryKey &key, IndexHandle &handle) {
+    if (!handle.tuned_distance_func.empty()) {
+      tuned.push_back(absl::StrFormat("%s=%s", FormatTableName(key),
+                                      handle.tuned_distance_func));
+    }
+  });
+  if (!tuned.empty()) {
+    absl::StrAppend(&info, ". Autotuned distance functions: ",
+                    absl::StrJoin(tuned, ", "));
+  }
   DLOG(INFO) << "ShowInfo called: " << info;
   sqlite3_result_text(ctx, info.c_str(), -1, SQLITE_TRANSIENT);
 }
 
+void VectorliteAutotune(sqlite3_context *ctx, int, sqlite3_value **) {
+  auto *registry = static_cast<IndexRegistry *>(sqlite3_user_data(ctx));
+  std::vector<std::string> tuned;
+  registry->ForEach([&](const RegistryKey &key, IndexHandle &handle) {
+    auto name = AutotuneDistanceFunc(handle.space, *handle.index);
+    if (!name.ok()) {
+      DLOG(INFO) << "Skipped autotuning " << FormatTableName(key) << ": "
+                 << name.status();
+      return;
+    }
+    handle.tuned_distance_func = *name;
+    tuned.push_back(absl::StrFormat("%s=%s", FormatTableName(key), *name));
+  });
+  std::string result = absl::StrJoin(tuned, ", ");
+  sqlite3_result_text(ctx, result.c_str(), -1, SQLITE_TRANSIENT);
+}
+
+// Parses the distance type passed as argv[i], which must be TEXT. The argument
+// is usually a constant, so the result is cached as auxiliary data of the
+// argument and reused for the remaining rows of the statement.
+static std::optional<DistanceType> GetDistanceTypeArg(sqlite3_context *ctx,
+                                                      sqlite3_value **argv,
+                                                      int i) {
+  if (const auto *cached =
+          static_cast<const DistanceType *>(sqlite3_get_auxdata(ctx, i))) {
+    return *cached;
+  }
+
+  std::string_view space_type_str(
+      reinterpret_cast<const char *>(sqlite3_value_text(argv[i])),
+      sqlite3_value_bytes(argv[i]));
+  std::optional<DistanceType> distance_type = ParseDistanceType(space_type_str);
+  if (distance_type.has_value()) {
+    // SQLite may free the copy right away if it can't be cached.
+    sqlite3_set_auxdata(ctx, i, new DistanceType(*distance_type),
+                        [](void *p) { delete static_cast<DistanceType *>(p); });
+  }
+  return distance_type;
+}
+
 // VectorDistance takes two vectors and and space type, then outputs their
 // distance
 void VectorDistance(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
@@ -58,13 +128,11 @@ void VectorDistance(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
     return;
   }
 
-  std::string_view space_type_str(
-      reinterpret_cast<const char *>(sqlite3_value_text(argv[2])),
-      sqlite3_value_bytes(argv[2]));
-  auto distance_type = vectorlite::ParseDistanceType(space_type_str);
+  auto distance_type = GetDistanceTypeArg(ctx, argv, 2);
   if (!distance_type.has_value()) {
-    std::string err =
-        absl::StrFormat("Failed to parse space type: %s", space_type_str);
+    std::string err = absl::StrFormat(
+        "Failed to parse space type: %s",
+        reinterpret_cast<const char *>(sqlite3_value_text(argv[2])));
     sqlite3_result_error(ctx, err.c_str(), -1);
     return;
   }
@@ -101,6 +169,347 @@ void VectorDistance(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
   return;
 }
 
+// VectorDistanceMatrix takes a blob of queries, a blob of vectors, a space
+// type and optionally the dimension, then outputs a blob of num_queries *
+// num_vectors float32 distances, row i holding the distances of query i.
+void VectorDistanceMatrix(sqlite3_context *ctx, int argc,
+                          sqlite3_value **argv) {
+  if (argc != 3 && argc != 4) {
+    std::string err = absl::StrFormat(
+        "vector_distance_matrix expects 3 or 4 arguments but %d provided",
+        argc);
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return;
+  }
+
+  if (sqlite3_value_type(argv[0]) != SQLITE_BLOB ||
+      sqlite3_value_type(argv[1]) != SQLITE_BLOB) {
+    sqlite3_result_error(
+        ctx, "vector_distance_matrix expects vectors of type blob", -1);
+    return;
+  }
+
+  if (sqlite3_value_type(argv[2]) != SQLITE_TEXT) {
+    sqlite3_result_error(
+        ctx, "vector_distance_matrix expects space type of type text", -1);
+    return;
+  }
+
+  auto distance_type = GetDistanceTypeArg(ctx, argv, 2);
+  if (!distance_type.has_value()) {
+    std::string err = absl::StrFormat(
+        "Failed to parse space type: %s",
+        reinterpret_cast<const char *>(sqlite3_value_text(argv[2])));
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return;
+  }
+
+  const size_t queries_bytes = sqlite3_value_bytes(argv[0]);
+  const size_t vectors_bytes = sqlite3_value_bytes(argv[1]);
+  // Without an explicit dimension, the queries blob holds a single query.
+  size_t dim = queries_bytes / sizeof(float);
+  if (argc == 4) {
+    if (sqlite3_value_type(argv[3]) != SQLITE_INTEGER ||
+        sqlite3_value_int64(argv[3]) <= 0) {
+      sqlite3_result_error(
+          ctx, "vector_distance_matrix expects a positive integer dimension",
+          -1);
+      return;
+    }
+    dim = static_cast<size_t>(sqlite3_value_int64(argv[3]));
+  }
+
+  const size_t row_bytes = dim * sizeof(float);
+  if (dim == 0 || queries_bytes % row_bytes != 0 ||
+      vectors_bytes % row_bytes != 0) {
+    std::string err = absl::StrFormat(
+        "vector_distance_matrix expects blobs of %d-dimensional float32 "
+        "vectors, but got %d and %d bytes",
+        dim, queries_bytes, vectors_bytes);
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return;
+  }
+
+  const size_t num_queries = queries_bytes / row_bytes;
+  const size_t num_vectors = vectors_bytes / row_bytes;
+  const sqlite3_uint64 result_bytes =
+      static_cast<sqlite3_uint64>(num_queries) * num_vectors * sizeof(float);
+  if (result_bytes == 0) {
+    sqlite3_result_zeroblob(ctx, 0);
+    return;
+  }
+
+  const float *queries =
+      static_cast<const float *>(sqlite3_value_blob(argv[0]));
+  const float *vectors =
+      static_cast<const float *>(sqlite3_value_blob(argv[1]));
+
+  // Cosine distance is the inner product distance of normalized vectors.
+  std::vector<float> normalized_queries;
+  std::vector<float> normalized_vectors;
+  if (*distance_type == DistanceType::Cosine) {
+    normalized_queries.resize(num_queries * dim);
+    normalized_vectors.resize(num_vectors * dim);
+    for (size_t i = 0; i < num_queries; ++i) {
+      ops::NormalizeTo(queries + i * dim, normalized_queries.data() + i * dim,
+                       dim);
+    }
+    for (size_t j = 0; j < num_vectors; ++j) {
+      ops::NormalizeTo(vectors + j * dim, normalized_vectors.data() + j * dim,
+                       dim);
+    }
+    queries = normalized_queries.data();
+    vectors = normalized_vectors.data();
+  }
+
+  // The matrix can be large, so it's handed to sqlite without a copy.
+  float *result = static_cast<float *>(sqlite3_malloc64(result_bytes));
+  if (result == nullptr) {
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+
+  if (*distance_type == DistanceType::L2) {
+    ops::L2DistanceSquaredMatrix(queries, num_queries, vectors, num_vectors,
+                                 dim, result);
+  } else {
+    ops::InnerProductDistanceMatrix(queries, num_queries, vectors,
+                                    num_vectors, dim, result);
+  }
+  sqlite3_result_blob64(ctx, result, result_bytes, sqlite3_free);
+  return;
+}
+
+namespace {
+
+// State of one vector_topk aggregation. It lives on the heap and is pointed to
+// by the aggregate context, which SQLite only zero-initializes.
+struct TopKState {
+  Vector query;
+  size_t k = 0;
+  DistanceType distance_type = DistanceType::L2;
+  // Distances and rowids of the rows seen so far, in the order they were
+  // added, except that the k best come first after Compact().
+  std::vector<float> distances;
+  std::vector<int64_t> rowids;
+
+  void Add(float distance, int64_t rowid) {
+    distances.push_back(distance);
+    rowids.push_back(rowid);
+    // Bounds memory to O(k) while selecting in batches of at least k rows.
+    if (distances.size() >= std::max<size_t>(2 * k, 1024)) {
+      Compact();
+    }
+  }
+
+  // Keeps only the k best rows, closest first. Ties go to the earlier row.
+  void Compact() {
+    std::vector<uint32_t> indices(std::min(k, distances.size()));
+    const size_t num_selected =
+        ops::SelectTopK(distances.data(), distances.size(), k, indices.data());
+    std::vector<float> selected_distances(num_selected);
+    std::vector<int64_t> selected_rowids(num_selected);
+    for (size_t i = 0; i < num_selected; ++i) {
+      selected_distances[i] = distances[indices[i]];
+      selected_rowids[i] = rowids[indices[i]];
+    }
+    distances = std::move(selected_distances);
+    rowids = std::move(selected_rowids);
+  }
+};
+
+}  // namespace
+
+// Parses the arguments that stay the same for every row, which are read only
+// once per aggregation. Returns nullptr after reporting the error to `ctx`.
+static TopKState *CreateTopKState(sqlite3_context *ctx, sqlite3_value **argv) {
+  if (sqlite3_value_type(argv[2]) != SQLITE_BLOB) {
+    sqlite3_result_error(ctx, "vector_topk expects query of type blob", -1);
+    return nullptr;
+  }
+
+  std::string_view query_blob(
+      reinterpret_cast<const char *>(sqlite3_value_blob(argv[2])),
+      sqlite3_value_bytes(argv[2]));
+  auto query = Vector::FromBlob(query_blob);
+  if (!query.ok()) {
+    std::string err = absl::StrFormat("Failed to parse query due to: %s",
+                                      query.status().message());
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return nullptr;
+  }
+
+  if (sqlite3_value_type(argv[3]) != SQLITE_INTEGER ||
+      sqlite3_value_int64(argv[3]) <= 0) {
+    sqlite3_result_error(ctx, "vector_topk expects a positive integer k", -1);
+    return nullptr;
+  }
+
+  if (sqlite3_value_type(argv[4]) != SQLITE_TEXT) {
+    sqlite3_result_error(ctx, "vector_topk expects space type of type text",
+                         -1);
+    return nullptr;
+  }
+  // Auxiliary data is only available to scalar functions, so the distance type
+  // isn't read with GetDistanceTypeArg. It is parsed once per aggregation.
+  std::optional<DistanceType> distance_type =
+      ParseDistanceType(std::string_view(
+          reinterpret_cast<const char *>(sqlite3_value_text(argv[4])),
+          sqlite3_value_bytes(argv[4])));
+  if (!distance_type.has_value()) {
+    std::string err = absl::StrFormat(
+        "Failed to parse space type: %s",
+        reinterpret_cast<const char *>(sqlite3_value_text(argv[4])));
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return nullptr;
+  }
+
+  auto *state = new TopKState();
+  state->query = *std::move(query);
+  state->k = static_cast<size_t>(sqlite3_value_int64(argv[3]));
+  state->distance_type = *distance_type;
+  return state;
+}
+
+void VectorTopK(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+  if (argc != 5) {
+    std::string err = absl::StrFormat(
+        "vector_topk expects 5 arguments but %d provided", argc);
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return;
+  }
+
+  auto **slot = static_cast<TopKState **>(
+      sqlite3_aggregate_context(ctx, sizeof(TopKState *)));
+  if (slot == nullptr) {
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+  if (*slot == nullptr) {
+    *slot = CreateTopKState(ctx, argv);
+    if (*slot == nullptr) {
+      return;
+    }
+  }
+  TopKState &state = **slot;
+
+  if (sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+    return;
+  }
+  if (sqlite3_value_type(argv[0]) != SQLITE_INTEGER) {
+    sqlite3_result_error(ctx, "vector_topk expects rowid of type integer", -1);
+    return;
+  }
+  if (sqlite3_value_type(argv[1]) != SQLITE_BLOB) {
+    sqlite3_result_error(ctx, "vector_topk expects vector of type blob", -1);
+    return;
+  }
+
+  // The vector is read in place, without copying it out of the row.
+  std::string_view vector_blob(
+      reinterpret_cast<const char *>(sqlite3_value_blob(argv[1])),
+      sqlite3_value_bytes(argv[1]));
+  const size_t dim = state.query.dim();
+  if (vector_blob.size() != dim * sizeof(float)) {
+    std::string err = absl::StrFormat(
+        "vector_topk expects %d-dimensional float32 vectors, but got %d bytes",
+        dim, vector_blob.size());
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return;
+  }
+
+  const float *query = state.query.data().data();
+  const float *vector = reinterpret_cast<const float *>(vector_blob.data());
+  float distance = 0.0f;
+  switch (state.distance_type) {
+    case DistanceType::L2:
+      distance = ops::L2DistanceSquared(query, vector, dim);
+      break;
+    case DistanceType::InnerProduct:
+      distance = ops::InnerProductDistance(query, vector, dim);
+      break;
+    case DistanceType::Cosine:
+      distance = ops::CosineDistance(query, vector, dim);
+      break;
+  }
+  // A NaN distance can't be ranked against the others.
+  if (std::isnan(distance)) {
+    return;
+  }
+  state.Add(distance, sqlite3_value_int64(argv[0]));
+}
+
+void VectorTopKFinal(sqlite3_context *ctx) {
+  auto **slot = static_cast<TopKState **>(sqlite3_aggregate_context(ctx, 0));
+  if (slot == nullptr || *slot == nullptr) {
+    // No rows were aggregated.
+    sqlite3_result_text(ctx, "[]", -1, SQLITE_STATIC);
+    return;
+  }
+
+  std::unique_ptr<TopKState> state(*slot);
+  *slot = nullptr;
+  state->Compact();
+
+  std::string json = "[";
+  for (size_t i = 0; i < state->distances.size(); ++i) {
+    const float distance = state->distances[i];
+    const int64_t rowid = state->rowids[i];
+    absl::StrAppendFormat(&json, "%s{\"rowid\":%d,\"distance\":",
+                          i == 0 ? "" : ",", rowid);
+    // Like vector_to_json, infinite distances are written as null.
+    if (std::isfinite(distance)) {
+      absl::StrAppendFormat(&json, "%.9g}", distance);
+    } else {
+      json.append("null}");
+    }
+  }
+  json.push_back(']');
+  sqlite3_result_text(ctx, json.data(), json.size(), SQLITE_TRANSIENT);
+}
+
+void RowidBitmapStep(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+  if (argc != 1) {
+    std::string err = absl::StrFormat(
+        "rowid_bitmap expects 1 argument but %d provided", argc);
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return;
+  }
+
+  // Like TopKState, the bitmap lives on the heap and is pointed to by the
+  // aggregate context.
+  auto **slot = static_cast<RowidBitmap **>(
+      sqlite3_aggregate_context(ctx, sizeof(RowidBitmap *)));
+  if (slot == nullptr) {
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+  if (*slot == nullptr) {
+    *slot = new RowidBitmap();
+  }
+
+  if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+    return;
+  }
+  if (sqlite3_value_type(argv[0]) != SQLITE_INTEGER ||
+      sqlite3_value_int64(argv[0]) < 0) {
+    sqlite3_result_error(
+        ctx, "rowid_bitmap expects rowids of type non-negative integer", -1);
+    return;
+  }
+  (*slot)->Add(static_cast<uint64_t>(sqlite3_value_int64(argv[0])));
+}
+
+void RowidBitmapFinal(sqlite3_context *ctx) {
+  auto **slot = static_cast<RowidBitmap **>(sqlite3_aggregate_context(ctx, 0));
+  std::unique_ptr<RowidBitmap> bitmap(
+      slot == nullptr ? nullptr : std::exchange(*slot, nullptr));
+  // No rows gives an empty set, which matches no rowid.
+  std::string blob =
+      bitmap == nullptr ? RowidBitmap().ToBlob() : bitmap->ToBlob();
+  sqlite3_result_blob(ctx, blob.data(), blob.size(), SQLITE_TRANSIENT);
+}
+
 void VectorFromJson(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
   if (argc != 1) {
     std::string err = absl::StrFormat(
@@ -131,6 +540,61 @@ void VectorFromJson(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
   return;
 }
 
+// Shared by VectorToBF16 and VectorToF16. Elements are converted straight into
+// the result buffer, which SQLite takes ownership of.
+template <class T>
+static void VectorToHalfPrecision(sqlite3_context *ctx, int argc,
+                                  sqlite3_value **argv,
+                                  std::string_view function_name) {
+  if (argc != 1) {
+    std::string err = absl::StrFormat("%s expects 1 argument but %d provided",
+                                      function_name, argc);
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return;
+  }
+
+  if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
+    std::string err =
+        absl::StrFormat("%s expects vector of type blob", function_name);
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return;
+  }
+
+  std::string_view vector_blob(
+      reinterpret_cast<const char *>(sqlite3_value_blob(argv[0])),
+      sqlite3_value_bytes(argv[0]));
+  auto vector_view = vectorlite::VectorView::FromBlob(vector_blob);
+  if (!vector_view.ok()) {
+    std::string err = absl::StrFormat("Failed to parse vector due to: %s",
+                                      vector_view.status().message());
+    sqlite3_result_error(ctx, err.c_str(), -1);
+    return;
+  }
+
+  const size_t dim = vector_view->dim();
+  const sqlite3_uint64 result_bytes = dim * sizeof(T);
+  T *elements = static_cast<T *>(sqlite3_malloc64(result_bytes));
+  if (elements == nullptr && result_bytes > 0) {
+    sqlite3_result_error_nomem(ctx);
+    return;
+  }
+  if constexpr (std::is_same_v<T, hwy::bfloat16_t>) {
+    ops::QuantizeF32ToBF16(vector_view->data().data(), elements, dim);
+  } else {
+    static_assert(std::is_same_v<T, hwy::float16_t>);
+    ops::QuantizeF32ToF16(vector_view->data().data(), elements, dim);
+  }
+  sqlite3_result_blob64(ctx, elements, result_bytes, sqlite3_free);
+}
+
+void VectorToBF16(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+  VectorToHalfPrecision<hwy::bfloat16_t>(ctx, argc, argv, "vector_to_bf16");
+}
+
+void VectorToF16(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+  VectorToHalfPrecision<hwy::float16_t>(ctx, argc, argv, "vector_to_f16");
+}
+
 void VectorToJson(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
   if (argc != 1) {
     std::string err = absl::StrFormat(
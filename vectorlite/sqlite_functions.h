@@ -5,15 +5,51 @@
 namespace vectorlite {
 
 // Shows a human-readable string about version, what SIMD instruction is used at
-// build time.
+// build time. Also lists the tables tuned by vectorlite_autotune(). Expects
+// the connection's IndexRegistry as user data.
 void ShowInfo(sqlite3_context* ctx, int, sqlite3_value**);
 
+// VectorliteAutotune times every distance function that can serve each
+// vectorlite table of the connection, installs the fastest one and outputs
+// which was picked per table. Expects the connection's IndexRegistry as user
+// data.
+void VectorliteAutotune(sqlite3_context* ctx, int, sqlite3_value**);
+
 // VectorDistance takes two vectors and and space type, then outputs their
 // distance
 void VectorDistance(sqlite3_context* ctx, int argc, sqlite3_value** argv);
 
+// VectorDistanceMatrix takes a blob of queries, a blob of vectors, a space
+// type and optionally the dimension, then outputs a blob of float32 distances
+// between every query and every vector.
+void VectorDistanceMatrix(sqlite3_context* ctx, int argc,
+                          sqlite3_value** argv);
+
+// VectorTopK and VectorTopKFinal implement the aggregate
+// vector_topk(rowid, vector, query, k, space_type). It computes the distance
+// between `query` and the vector of every row, keeps the `k` closest rows and
+// outputs them as a JSON array of {"rowid": ..., "distance": ...} objects in
+// ascending order of distance, where ties go to the earlier row. `query`, `k`
+// and `space_type` are taken from the first row. Rows whose vector is NULL are
+// skipped.
+void VectorTopK(sqlite3_context* ctx, int argc, sqlite3_value** argv);
+void VectorTopKFinal(sqlite3_context* ctx);
+
+// RowidBitmapStep and RowidBitmapFinal implement the aggregate
+// rowid_bitmap(rowid). It collects non-NULL rowids into a RowidBitmap and
+// outputs it as a blob, which knn_param() takes to restrict a knn search to
+// those rowids.
+void RowidBitmapStep(sqlite3_context* ctx, int argc, sqlite3_value** argv);
+void RowidBitmapFinal(sqlite3_context* ctx);
+
 void VectorFromJson(sqlite3_context* ctx, int argc, sqlite3_value** argv);
 
 void VectorToJson(sqlite3_context* ctx, int argc, sqlite3_value** argv);
 
+// VectorToBF16 and VectorToF16 convert a float32 vector to a blob of bfloat16
+// or float16 elements. bfloat16/float16 tables take such blobs as they are,
+// halving the data sent to them.
+void VectorToBF16(sqlite3_context* ctx, int argc, sqlite3_value** argv);
+void VectorToF16(sqlite3_context* ctx, int argc, sqlite3_value** argv);
+
 }  // namespace vectorlite
\ No newline at end of file
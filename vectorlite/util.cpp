@@ -1,7 +1,14 @@
 #include "util.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
 #include <optional>
 #include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "hnswlib/hnswlib.h"
@@ -45,4 +52,123 @@ bool IsRowidInIndex(const hnswlib::HierarchicalNSW<float>& index,
   return true;
 }
 
-}  // end namespace vectorlite
\ No newline at end of file
+const uint8_t* FindRawDataByLabel(const hnswlib::HierarchicalNSW<float>& index,
+                                  hnswlib::labeltype rowid) {
+  std::unique_lock<std::mutex> lock_label(index.getLabelOpMutex(rowid));
+  std::unique_lock<std::mutex> lock_table(index.label_lookup_lock);
+  auto search = index.label_lookup_.find(rowid);
+  if (search == index.label_lookup_.end() ||
+      index.isMarkedDeleted(search->second)) {
+    return nullptr;
+  }
+  return reinterpret_cast<const uint8_t*>(
+      index.getDataByInternalId(search->second));
+}
+
+// One ParallelFor() call, shared by the calling thread and the workers.
+struct WorkerPool::Job {
+  Job(size_t n, const std::function<void(size_t)>& func) : n(n), func(func) {}
+
+  size_t n;
+  const std::function<void(size_t)>& func;
+  std::atomic<size_t> next{0};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  void Run() {
+    for (size_t i = next.fetch_add(1); i < n; i = next.fetch_add(1)) {
+      try {
+        func(i);
+      } catch (...) {
+        // Stop handing out indices, so that every thread returns soon.
+        next.store(n);
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+  }
+};
+
+WorkerPool::WorkerPool(size_t num_threads)
+    : num_threads_(std::max<size_t>(num_threads, 1)) {}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  job_posted_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void WorkerPool::StartWorkers() {
+  workers_started_ = true;
+  workers_.reserve(num_threads_ - 1);
+  for (size_t t = 1; t < num_threads_; ++t) {
+    try {
+      workers_.emplace_back([this] { RunWorker(); });
+    } catch (const std::system_error&) {
+      // Runs with the workers started so far, or on the calling thread alone.
+      break;
+    }
+  }
+}
+
+void WorkerPool::RunWorker() {
+  uint64_t last_job_id = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    job_posted_.wait(lock,
+                     [&] { return stopping_ || job_id_ != last_job_id; });
+    if (stopping_) {
+      return;
+    }
+    last_job_id = job_id_;
+    Job* job = job_;
+    if (job == nullptr) {
+      continue;
+    }
+    ++busy_workers_;
+    lock.unlock();
+    job->Run();
+    lock.lock();
+    if (--busy_workers_ == 0) {
+      job_finished_.notify_all();
+    }
+  }
+}
+
+void WorkerPool::ParallelFor(size_t n,
+                             const std::function<void(size_t)>& func) {
+  if (n == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  Job job(n, func);
+  if (n > 1 && num_threads_ > 1) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!workers_started_) {
+        StartWorkers();
+      }
+      job_ = &job;
+      ++job_id_;
+    }
+    job_posted_.notify_all();
+  }
+  job.Run();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = nullptr;
+    job_finished_.wait(lock, [this] { return busy_workers_ == 0; });
+  }
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+}  // end namespace vectorlite
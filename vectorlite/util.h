@@ -1,9 +1,16 @@
 #pragma once
 
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <string_view>
+#include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "hnswlib/hnswlib.h"
 
@@ -26,6 +33,93 @@ std::optional<std::string_view> DetectSIMD();
 bool IsRowidInIndex(const hnswlib::HierarchicalNSW<float>& index,
                     hnswlib::labeltype rowid);
 
+// Returns a pointer to the raw bytes(data_size_ of them) stored for `rowid`
+// inside the index, or nullptr if it is not in the index or is marked deleted.
+// The pointer stays valid until the element is overwritten or the index is
+// resized or destroyed.
+const uint8_t* FindRawDataByLabel(const hnswlib::HierarchicalNSW<float>& index,
+                                  hnswlib::labeltype rowid);
+
+// Calls `func(label, data)` for each of `labels` that is in `index` and not
+// marked deleted, where `data` points to its stored element. The label lookup
+// table is locked once for all labels rather than once per label. Like in
+// searchKnn, `data` itself is not protected by that lock. `labels` can be any
+// iterable container of hnswlib::labeltype.
+template <class Labels, class Func>
+void ForEachLabelInIndex(const hnswlib::HierarchicalNSW<float>& index,
+                         const Labels& labels, Func&& func) {
+  std::unique_lock<std::mutex> lock_table(index.label_lookup_lock);
+  for (hnswlib::labeltype label : labels) {
+    auto search = index.label_lookup_.find(label);
+    if (search == index.label_lookup_.end() ||
+        index.isMarkedDeleted(search->second)) {
+      continue;
+    }
+    func(label, index.getDataByInternalId(search->second));
+  }
+}
+
+// Like above, but for every label in `index` that is not marked deleted.
+template <class Func>
+void ForEachLabelInIndex(const hnswlib::HierarchicalNSW<float>& index,
+                         Func&& func) {
+  std::unique_lock<std::mutex> lock_table(index.label_lookup_lock);
+  for (const auto& [label, internal_id] : index.label_lookup_) {
+    if (!index.isMarkedDeleted(internal_id)) {
+      func(label, index.getDataByInternalId(internal_id));
+    }
+  }
+}
+
+// A fixed set of worker threads that ParallelFor() hands work to, so that
+// threads are not created and joined for every call. Workers are started by
+// the first call that needs them and joined when the pool is destroyed.
+class WorkerPool {
+ public:
+  // `num_threads` includes the thread calling ParallelFor(), so the pool
+  // starts num_threads - 1 workers. 0 is treated as 1.
+  explicit WorkerPool(size_t num_threads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  size_t num_threads() const { return num_threads_; }
+
+  // Calls `func(i)` for every i in [0, n) on the calling thread and the
+  // workers. Indices are handed out one at a time, so threads that get cheap
+  // ones pick up more. Returns once every call has returned. `func` must be
+  // safe to call concurrently. If it throws, the remaining indices are skipped
+  // and the first exception is rethrown once no worker runs `func` anymore.
+  // Concurrent calls are run one after another.
+  void ParallelFor(size_t n, const std::function<void(size_t)>& func);
+
+ private:
+  struct Job;
+
+  void StartWorkers();
+  void RunWorker();
+
+  const size_t num_threads_;
+  // Held for a whole ParallelFor() call, so that there is one job at a time.
+  std::mutex run_mutex_;
+
+  // Guards the members below.
+  std::mutex mutex_;
+  std::condition_variable job_posted_;
+  std::condition_variable job_finished_;
+  // The job being run, or nullptr once the calling thread has finished its
+  // part of it, so that workers woken late do not pick it up.
+  Job* job_ = nullptr;
+  // Bumped for every job, so that a worker runs each job at most once.
+  uint64_t job_id_ = 0;
+  // Number of workers currently running job_.
+  size_t busy_workers_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+  bool workers_started_ = false;
+};
+
 // Below *Base classes are taken from
 // https://github.com/abseil/abseil-cpp/blob/20240722.0/absl/status/internal/statusor_internal.h#L368
 // to allow implicitly deleted constructors and assignment
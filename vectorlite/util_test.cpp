@@ -1,5 +1,12 @@
 #include "util.h"
 
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <set>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 TEST(IsValidColumnNameTest, ValidColumnNames) {
@@ -16,4 +23,69 @@ TEST(IsValidColumnNameTest, InvalidColumnNames) {
   EXPECT_FALSE(vectorlite::IsValidColumnName("invalid column name"));
   EXPECT_FALSE(vectorlite::IsValidColumnName("SELECT"));
   EXPECT_FALSE(vectorlite::IsValidColumnName("valid_column_name "));
-}
\ No newline at end of file
+}
+
+TEST(WorkerPoolTest, CallsEveryIndexOnce) {
+  for (size_t num_threads : {0, 1, 3, 64}) {
+    vectorlite::WorkerPool pool(num_threads);
+    for (size_t n : {0, 1, 7, 1000}) {
+      std::vector<std::atomic<int>> calls(n);
+      pool.ParallelFor(n, [&](size_t i) { calls[i].fetch_add(1); });
+      for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(calls[i].load(), 1) << "n=" << n << ", i=" << i;
+      }
+    }
+  }
+}
+
+TEST(WorkerPoolTest, RethrowsExceptionsAfterJoining) {
+  for (size_t num_threads : {1, 4}) {
+    vectorlite::WorkerPool pool(num_threads);
+    std::atomic<int> calls{0};
+    auto func = [&](size_t i) {
+      calls.fetch_add(1);
+      if (i == 3) {
+        throw std::bad_alloc();
+      }
+    };
+    EXPECT_THROW(pool.ParallelFor(100, func), std::bad_alloc);
+    if (num_threads == 1) {
+      // Indices after the throwing one are skipped.
+      EXPECT_EQ(calls.load(), 4);
+    }
+    // The pool is still usable afterwards.
+    calls.store(0);
+    pool.ParallelFor(10, [&](size_t) { calls.fetch_add(1); });
+    EXPECT_EQ(calls.load(), 10);
+  }
+}
+
+TEST(WorkerPoolTest, ReusesItsThreads) {
+  vectorlite::WorkerPool pool(4);
+  std::mutex mutex;
+  std::set<std::thread::id> thread_ids;
+  for (int run = 0; run < 20; ++run) {
+    pool.ParallelFor(100, [&](size_t) {
+      std::lock_guard<std::mutex> lock(mutex);
+      thread_ids.insert(std::this_thread::get_id());
+    });
+  }
+  EXPECT_LE(thread_ids.size(), 4);
+}
+
+TEST(WorkerPoolTest, SerializesConcurrentCalls) {
+  vectorlite::WorkerPool pool(3);
+  std::atomic<int> calls{0};
+  std::vector<std::thread> callers;
+  for (int t = 0; t < 4; ++t) {
+    callers.emplace_back([&] {
+      for (int run = 0; run < 50; ++run) {
+        pool.ParallelFor(20, [&](size_t) { calls.fetch_add(1); });
+      }
+    });
+  }
+  for (auto& caller : callers) {
+    caller.join();
+  }
+  EXPECT_EQ(calls.load(), 4 * 50 * 20);
+}
@@ -2,15 +2,20 @@
 
 #include <hwy/base.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include "absl/status/statusor.h"
 #include "macros.h"
 #include "ops/ops.h"
-#include "rapidjson/document.h"
+#include "rapidjson/encodedstream.h"
 #include "rapidjson/error/en.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/reader.h"
 #include "util.h"
 #include "vector_space.h"
 #include "vector_view.h"
@@ -35,29 +40,31 @@ class GenericVector : private CopyAssignBase<T>,
   GenericVector& operator=(const GenericVector&) = default;
   GenericVector& operator=(GenericVector&&) = default;
 
+  // Parses a JSON array of numbers. The input is parsed in a single streaming
+  // pass straight into the result, without building a DOM.
   static absl::StatusOr<GenericVector<T>> FromJSON(std::string_view json) {
-    rapidjson::Document doc;
-    doc.Parse(json.data(), json.size());
-    auto err = doc.GetParseError();
-    if (err != rapidjson::ParseErrorCode::kParseErrorNone) {
-      return absl::InvalidArgumentError(rapidjson::GetParseError_En(err));
-    }
-
     GenericVector<T> result;
-
-    if (doc.IsArray()) {
-      for (auto& v : doc.GetArray()) {
-        if (v.IsNumber()) {
-          result.data_.push_back(hwy::ConvertScalarTo<T>(v.GetFloat()));
-        } else {
-          return absl::InvalidArgumentError(
-              "JSON array contains non-numeric value.");
-        }
-      }
-      return result;
+    // Each element but the last is followed by a comma, so counting commas
+    // (a vectorizable loop) sizes the result exactly for well formed input.
+    result.data_.reserve(std::count(json.begin(), json.end(), ',') + 1);
+
+    JSONArrayHandler handler(result.data_);
+    rapidjson::MemoryStream ms(json.data(), json.size());
+    rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream>
+        is(ms);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult parse_result = reader.Parse(is, handler);
+    if (!handler.status.ok()) {
+      return handler.status;
     }
-
-    return absl::InvalidArgumentError("Input JSON is not an array.");
+    if (parse_result.IsError()) {
+      return absl::InvalidArgumentError(
+          rapidjson::GetParseError_En(parse_result.Code()));
+    }
+    if (!handler.seen_array) {
+      return absl::InvalidArgumentError("Input JSON is not an array.");
+    }
+    return result;
   }
 
   static absl::StatusOr<GenericVector<T>> FromBlob(std::string_view blob) {
@@ -97,6 +104,58 @@ class GenericVector : private CopyAssignBase<T>,
   }
 
  private:
+  // SAX handler of rapidjson::Reader that accepts a flat array of numbers and
+  // appends its elements to `data`.
+  struct JSONArrayHandler
+      : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>,
+                                            JSONArrayHandler> {
+    explicit JSONArrayHandler(std::vector<T>& data) : data(data) {}
+
+    bool Int(int i) { return AddNumber(static_cast<float>(i)); }
+    bool Uint(unsigned u) { return AddNumber(static_cast<float>(u)); }
+    bool Int64(int64_t i) { return AddNumber(static_cast<float>(i)); }
+    bool Uint64(uint64_t u) { return AddNumber(static_cast<float>(u)); }
+    bool Double(double d) { return AddNumber(static_cast<float>(d)); }
+
+    bool StartArray() {
+      if (depth > 0) {
+        return Fail("JSON array contains non-numeric value.");
+      }
+      ++depth;
+      seen_array = true;
+      return true;
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+      --depth;
+      return true;
+    }
+
+    // Called for null, booleans, strings and objects.
+    bool Default() {
+      return Fail(depth > 0 ? "JSON array contains non-numeric value."
+                            : "Input JSON is not an array.");
+    }
+
+    bool AddNumber(float v) {
+      if (depth == 0) {
+        return Fail("Input JSON is not an array.");
+      }
+      data.push_back(hwy::ConvertScalarTo<T>(v));
+      return true;
+    }
+
+    bool Fail(std::string_view message) {
+      status = absl::InvalidArgumentError(message);
+      return false;
+    }
+
+    std::vector<T>& data;
+    int depth = 0;
+    bool seen_array = false;
+    absl::Status status;
+  };
+
   std::vector<T> data_;
 };
 
@@ -113,6 +172,13 @@ absl::StatusOr<float> Distance(GenericVectorView<T> v1, GenericVectorView<T> v2,
     return absl::InvalidArgumentError(err);
   }
 
+  if constexpr (std::is_same_v<T, float>) {
+    if (distance_type == DistanceType::Cosine) {
+      // Doesn't allocate normalized copies, unlike the generic path below.
+      return ops::CosineDistance(v1.data().data(), v2.data().data(), v1.dim());
+    }
+  }
+
   DistanceFunc<T> distance_func = nullptr;
 
   switch (distance_type) {
@@ -11,6 +11,9 @@
 #include "absl/strings/str_format.h"
 #include "distance.h"
 #include "macros.h"
+#include "ops/ops.h"
+#include "product_quantizer.h"
+#include "quantization.h"
 #include "re2/re2.h"
 #include "util.h"
 
@@ -40,10 +43,26 @@ std::optional<VectorType> ParseVectorType(std::string_view vector_type) {
     return VectorType::Float16;
   }
 
+  if (vector_type == "float8_e4m3") {
+    return VectorType::Float8E4M3;
+  }
+
+  if (vector_type == "float8_e5m2") {
+    return VectorType::Float8E5M2;
+  }
+
+  if (vector_type == "int8") {
+    return VectorType::Int8;
+  }
+
+  if (vector_type == "binary") {
+    return VectorType::Binary;
+  }
+
   return std::nullopt;
 }
 
-static std::unique_ptr<hnswlib::SpaceInterface<float>> CreateL2Space(
+static std::unique_ptr<SpaceInterface> CreateL2Space(
     size_t dim, VectorType vector_type) {
   switch (vector_type) {
     case VectorType::Float32:
@@ -52,6 +71,12 @@ static std::unique_ptr<hnswlib::SpaceInterface<float>> CreateL2Space(
       return std::make_unique<vectorlite::L2SpaceBF16>(dim);
     case VectorType::Float16:
       return std::make_unique<vectorlite::L2SpaceF16>(dim);
+    case VectorType::Float8E4M3:
+      return std::make_unique<vectorlite::L2SpaceF8E4M3>(dim);
+    case VectorType::Float8E5M2:
+      return std::make_unique<vectorlite::L2SpaceF8E5M2>(dim);
+    case VectorType::Int8:
+      return std::make_unique<vectorlite::L2SpaceI8>(dim);
     default:
       // This should never happen, but we include it for completeness
       ABSL_UNREACHABLE();
@@ -59,7 +84,7 @@ static std::unique_ptr<hnswlib::SpaceInterface<float>> CreateL2Space(
   }
 }
 
-static std::unique_ptr<hnswlib::SpaceInterface<float>> CreateInnerProductSpace(
+static std::unique_ptr<SpaceInterface> CreateInnerProductSpace(
     size_t dim, VectorType vector_type) {
   switch (vector_type) {
     case VectorType::Float32:
@@ -68,6 +93,12 @@ static std::unique_ptr<hnswlib::SpaceInterface<float>> CreateInnerProductSpace(
       return std::make_unique<vectorlite::InnerProductSpaceBF16>(dim);
     case VectorType::Float16:
       return std::make_unique<vectorlite::InnerProductSpaceF16>(dim);
+    case VectorType::Float8E4M3:
+      return std::make_unique<vectorlite::InnerProductSpaceF8E4M3>(dim);
+    case VectorType::Float8E5M2:
+      return std::make_unique<vectorlite::InnerProductSpaceF8E5M2>(dim);
+    case VectorType::Int8:
+      return std::make_unique<vectorlite::InnerProductSpaceI8>(dim);
     default:
       // This should never happen, but we include it for completeness
       ABSL_UNREACHABLE();
@@ -82,10 +113,20 @@ absl::StatusOr<VectorSpace> VectorSpace::Create(size_t dim,
     return absl::InvalidArgumentError("Dimension must be greater than 0");
   }
 
+  if (vector_type == VectorType::Int8 && dim > ops::kMaxInt8Elements) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Dimension of int8 vectors must not exceed %d", ops::kMaxInt8Elements));
+  }
+
   VectorSpace result;
   result.distance_type = distance_type;
   result.normalize = distance_type == DistanceType::Cosine;
   result.vector_type = vector_type;
+  if (vector_type == VectorType::Binary) {
+    // Hamming distance is used for every distance type.
+    result.space = std::make_unique<BinarySpace>(dim);
+    return result;
+  }
   switch (distance_type) {
     case DistanceType::L2:
       result.space = CreateL2Space(dim, vector_type);
@@ -166,4 +207,68 @@ size_t VectorSpace::dimension() const {
   return *reinterpret_cast<size_t*>(space->get_dist_func_param());
 }
 
+bool VectorSpace::has_native_encoding() const {
+  return vector_type == VectorType::BFloat16 ||
+         vector_type == VectorType::Float16;
+}
+
+absl::Status VectorSpace::CheckNativeBlob(std::string_view blob) const {
+  VECTORLITE_ASSERT(has_native_encoding());
+  // Both encodings take 2 bytes per element.
+  if (blob.size() != dimension() * 2) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "vector blob of %d bytes doesn't match dimension %d of 2-byte "
+        "elements",
+        blob.size(), dimension()));
+  }
+  return absl::OkStatus();
+}
+
+BinarySpaceParam* VectorSpace::binary_param() const {
+  if (vector_type != VectorType::Binary) {
+    return nullptr;
+  }
+  return static_cast<BinarySpaceParam*>(space->get_dist_func_param());
+}
+
+PQSpaceParam* VectorSpace::pq_param() const {
+  if (vector_type != VectorType::ProductQuantized) {
+    return nullptr;
+  }
+  return static_cast<PQSpaceParam*>(space->get_dist_func_param());
+}
+
+absl::Status VectorSpace::EnableProductQuantization(size_t num_subquantizers,
+                                                    size_t train_size) {
+  if (vector_type != VectorType::Float32) {
+    return absl::InvalidArgumentError(
+        "pq is only supported for float32 vectors");
+  }
+  if (train_size == 0) {
+    return absl::InvalidArgumentError("pq_train must be greater than 0");
+  }
+  size_t dim = dimension();
+  if (auto status = ProductQuantizer::Validate(dim, num_subquantizers);
+      !status.ok()) {
+    return status;
+  }
+  // Cosine vectors are normalized, so both cosine and ip use inner product.
+  space = std::make_unique<PQSpace>(dim, num_subquantizers, train_size,
+                                    distance_type != DistanceType::L2);
+  vector_type = VectorType::ProductQuantized;
+  return absl::OkStatus();
+}
+
+Int8Calibration* VectorSpace::int8_calibration() const {
+  Int8SpaceParam* param = int8_param();
+  return param != nullptr ? &param->calibration : nullptr;
+}
+
+Int8SpaceParam* VectorSpace::int8_param() const {
+  if (vector_type != VectorType::Int8) {
+    return nullptr;
+  }
+  return static_cast<Int8SpaceParam*>(space->get_dist_func_param());
+}
+
 }  // end namespace vectorlite
\ No newline at end of file
@@ -6,9 +6,15 @@
 
 #include "absl/status/statusor.h"
 #include "hnswlib/hnswlib.h"
+#include "space_interface.h"
 
 namespace vectorlite {
 
+struct Int8Calibration;
+struct Int8SpaceParam;
+struct BinarySpaceParam;
+struct PQSpaceParam;
+
 enum class DistanceType {
   L2,
   InnerProduct,
@@ -21,6 +27,19 @@ enum class VectorType {
   Float32,
   BFloat16,
   Float16,
+  // 8-bit floats(ops::float8_e4m3_t/float8_e5m2_t). Unlike int8, they need no
+  // calibration.
+  Float8E4M3,
+  Float8E5M2,
+  // Scalar quantized: each element is stored as an int8 code, see
+  // Int8Calibration.
+  Int8,
+  // Binary quantized: only the sign bit of each element is stored, see
+  // BinarySpace.
+  Binary,
+  // Product quantized float32 vectors, see PQSpace. Not a type name in the
+  // vector space string, but enabled by the `pq` index option.
+  ProductQuantized,
 };
 
 std::optional<VectorType> ParseVectorType(std::string_view vector_type);
@@ -28,11 +47,40 @@ std::optional<VectorType> ParseVectorType(std::string_view vector_type);
 struct VectorSpace {
   DistanceType distance_type;
   bool normalize;
-  std::unique_ptr<hnswlib::SpaceInterface<float>> space;
+  std::unique_ptr<SpaceInterface> space;
   VectorType vector_type;
 
   size_t dimension() const;
 
+  // Whether vectors can also be passed in and returned in the space's own
+  // element encoding, i.e. bfloat16 or float16, see IndexOptions::native_input
+  // and IndexOptions::native_output. A blob's encoding is never guessed from
+  // its contents or size, but set per table.
+  bool has_native_encoding() const;
+  // Checks that `blob` holds a vector of the space's dimension in its own
+  // encoding. Only valid if has_native_encoding() is true.
+  absl::Status CheckNativeBlob(std::string_view blob) const;
+
+  // Returns the table's int8 calibration, which lives in the distance function
+  // param so that distance functions can read it. Returns nullptr if
+  // vector_type is not Int8.
+  Int8Calibration* int8_calibration() const;
+
+  // Returns the int8 space's param, nullptr if vector_type is not Int8.
+  Int8SpaceParam* int8_param() const;
+
+  // Returns the binary space's param, nullptr if vector_type is not Binary.
+  BinarySpaceParam* binary_param() const;
+
+  // Returns the product quantized space's param, nullptr if vector_type is
+  // not ProductQuantized.
+  PQSpaceParam* pq_param() const;
+
+  // Switches a float32 space to product quantized storage with
+  // `num_subquantizers` 4-bit codes per vector, see ProductQuantizer.
+  absl::Status EnableProductQuantization(size_t num_subquantizers,
+                                         size_t train_size);
+
   static absl::StatusOr<VectorSpace> Create(size_t dim,
                                             DistanceType distance_type,
                                             VectorType vector_type);
@@ -48,7 +96,8 @@ struct NamedVectorSpace : public VectorSpace {
   // e.g. CREATE VIRTUAL TABLE my_vectors using vectorlite(my_vector
   // float32[384] l2, "hnsw(max_elements=1000)") The `my_vector float32[384] l2`
   // is the vector space string. Supported vector types are "float32",
-  // "bfloat16", "float16". Supported distance types are "l2", "cosine", "ip"
+  // "bfloat16", "float16", "float8_e4m3", "float8_e5m2", "int8", "binary".
+  // Supported distance types are "l2", "cosine", "ip"
   // (distance type is optional and defaults to "l2").
   static absl::StatusOr<NamedVectorSpace> FromString(
       std::string_view space_str);
@@ -1,7 +1,14 @@
 #include "vector_space.h"
 
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "absl/strings/str_format.h"
+#include "distance.h"
 #include "gtest/gtest.h"
+#include "ops/ops.h"
 
 TEST(ParseDistanceType, ShouldSupport_L2_InnerProduct_Cosine) {
   auto l2 = vectorlite::ParseDistanceType("l2");
@@ -44,10 +51,34 @@ TEST(ParseVectorType, ShouldSupportFloat16) {
   EXPECT_TRUE(*float16 == vectorlite::VectorType::Float16);
 }
 
+TEST(ParseVectorType, ShouldSupportFloat8) {
+  auto e4m3 = vectorlite::ParseVectorType("float8_e4m3");
+  ASSERT_TRUE(e4m3);
+  EXPECT_TRUE(*e4m3 == vectorlite::VectorType::Float8E4M3);
+  auto e5m2 = vectorlite::ParseVectorType("float8_e5m2");
+  ASSERT_TRUE(e5m2);
+  EXPECT_TRUE(*e5m2 == vectorlite::VectorType::Float8E5M2);
+  EXPECT_FALSE(vectorlite::ParseVectorType("float8"));
+}
+
+TEST(ParseVectorType, ShouldSupportInt8) {
+  auto int8 = vectorlite::ParseVectorType("int8");
+  ASSERT_TRUE(int8);
+  EXPECT_TRUE(*int8 == vectorlite::VectorType::Int8);
+}
+
+TEST(ParseVectorType, ShouldSupportBinary) {
+  auto binary = vectorlite::ParseVectorType("binary");
+  ASSERT_TRUE(binary);
+  EXPECT_TRUE(*binary == vectorlite::VectorType::Binary);
+}
+
 TEST(CreateVectorSpace, ShouldWorkWithValidInput) {
   for (auto vector_type :
        {vectorlite::VectorType::Float32, vectorlite::VectorType::BFloat16,
-        vectorlite::VectorType::Float16}) {
+        vectorlite::VectorType::Float16, vectorlite::VectorType::Float8E4M3,
+        vectorlite::VectorType::Float8E5M2, vectorlite::VectorType::Int8,
+        vectorlite::VectorType::Binary}) {
     auto l2 = vectorlite::CreateNamedVectorSpace(
         3, vectorlite::DistanceType::L2, "my_vector", vector_type);
     ASSERT_TRUE(l2.ok());
@@ -80,7 +111,9 @@ TEST(CreateVectorSpace, ShouldWorkWithValidInput) {
 TEST(CreateNamedVectorSpace, ShouldReturnErrorForDimOfZero) {
   for (auto vector_type :
        {vectorlite::VectorType::Float32, vectorlite::VectorType::BFloat16,
-        vectorlite::VectorType::Float16}) {
+        vectorlite::VectorType::Float16, vectorlite::VectorType::Float8E4M3,
+        vectorlite::VectorType::Float8E5M2, vectorlite::VectorType::Int8,
+        vectorlite::VectorType::Binary}) {
     auto l2 = vectorlite::CreateNamedVectorSpace(
         0, vectorlite::DistanceType::L2, "my_vector", vector_type);
     EXPECT_FALSE(l2.ok());
@@ -95,6 +128,237 @@ TEST(CreateNamedVectorSpace, ShouldReturnErrorForDimOfZero) {
   }
 }
 
+TEST(CreateNamedVectorSpace, ShouldLimitDimOfInt8) {
+  auto ok = vectorlite::CreateNamedVectorSpace(
+      vectorlite::ops::kMaxInt8Elements, vectorlite::DistanceType::L2,
+      "my_vector", vectorlite::VectorType::Int8);
+  EXPECT_TRUE(ok.ok());
+  EXPECT_NE(ok->int8_calibration(), nullptr);
+
+  auto too_large = vectorlite::CreateNamedVectorSpace(
+      vectorlite::ops::kMaxInt8Elements + 1, vectorlite::DistanceType::L2,
+      "my_vector", vectorlite::VectorType::Int8);
+  EXPECT_FALSE(too_large.ok());
+}
+
+TEST(CreateNamedVectorSpace, Int8BatchDistanceMatchesDistanceFunc) {
+  const size_t dim = 24;
+  // More vectors than BatchDistance scores at a time.
+  const size_t num_vectors = 150;
+  std::vector<std::vector<int8_t>> vectors(num_vectors,
+                                           std::vector<int8_t>(dim));
+  std::vector<const void*> vector_ptrs;
+  for (size_t i = 0; i < num_vectors; ++i) {
+    for (size_t d = 0; d < dim; ++d) {
+      vectors[i][d] = static_cast<int8_t>((i * 37 + d * 11) % 255 - 127);
+    }
+    vector_ptrs.push_back(vectors[i].data());
+  }
+  const std::vector<int8_t>& query = vectors[7];
+
+  for (auto distance_type :
+       {vectorlite::DistanceType::L2, vectorlite::DistanceType::Cosine}) {
+    auto space = vectorlite::CreateNamedVectorSpace(
+        dim, distance_type, "my_vector", vectorlite::VectorType::Int8);
+    ASSERT_TRUE(space.ok());
+    space->int8_calibration()->scale = 0.01f;
+    std::vector<float> distances(num_vectors);
+    space->space->BatchDistance(query.data(), vector_ptrs.data(), num_vectors,
+                                distances.data());
+    auto func = space->space->get_dist_func();
+    for (size_t i = 0; i < num_vectors; ++i) {
+      EXPECT_FLOAT_EQ(distances[i],
+                      func(query.data(), vectors[i].data(),
+                           space->space->get_dist_func_param()))
+          << "i=" << i;
+    }
+  }
+}
+
+TEST(CreateNamedVectorSpace, BinaryBatchDistanceMatchesDistanceFunc) {
+  const size_t dim = 200;
+  // More vectors than BatchDistance scores at a time.
+  const size_t num_vectors = 150;
+  auto space = vectorlite::CreateNamedVectorSpace(
+      dim, vectorlite::DistanceType::L2, "my_vector",
+      vectorlite::VectorType::Binary);
+  ASSERT_TRUE(space.ok());
+  const size_t code_size = space->space->get_data_size();
+  std::vector<std::vector<uint8_t>> codes(num_vectors,
+                                          std::vector<uint8_t>(code_size));
+  std::vector<const void*> code_ptrs;
+  for (size_t i = 0; i < num_vectors; ++i) {
+    for (size_t b = 0; b < code_size; ++b) {
+      codes[i][b] = static_cast<uint8_t>((i * 37 + b * 11) % 256);
+    }
+    code_ptrs.push_back(codes[i].data());
+  }
+  const std::vector<uint8_t>& query = codes[7];
+
+  std::vector<float> distances(num_vectors);
+  space->space->BatchDistance(query.data(), code_ptrs.data(), num_vectors,
+                              distances.data());
+  auto func = space->space->get_dist_func();
+  for (size_t i = 0; i < num_vectors; ++i) {
+    EXPECT_FLOAT_EQ(distances[i],
+                    func(query.data(), codes[i].data(),
+                         space->space->get_dist_func_param()))
+        << "i=" << i;
+  }
+}
+
+// Stores `in` in `out` in the format of `vector_type`, which must be a half
+// precision or float8 type.
+static void QuantizeForSpace(vectorlite::VectorType vector_type,
+                             const std::vector<float>& in, void* out) {
+  switch (vector_type) {
+    case vectorlite::VectorType::BFloat16:
+      vectorlite::ops::QuantizeF32ToBF16(
+          in.data(), static_cast<hwy::bfloat16_t*>(out), in.size());
+      break;
+    case vectorlite::VectorType::Float16:
+      vectorlite::ops::QuantizeF32ToF16(
+          in.data(), static_cast<hwy::float16_t*>(out), in.size());
+      break;
+    case vectorlite::VectorType::Float8E4M3:
+      vectorlite::ops::QuantizeF32ToF8(
+          in.data(), static_cast<vectorlite::ops::float8_e4m3_t*>(out),
+          in.size());
+      break;
+    default:
+      ASSERT_TRUE(vector_type == vectorlite::VectorType::Float8E5M2);
+      vectorlite::ops::QuantizeF32ToF8(
+          in.data(), static_cast<vectorlite::ops::float8_e5m2_t*>(out),
+          in.size());
+  }
+}
+
+TEST(CreateNamedVectorSpace, F32QueryBatchDistanceMatchesDistanceFunc) {
+  const size_t dim = 19;
+  const size_t num_vectors = 9;
+  std::vector<std::vector<float>> vectors(num_vectors, std::vector<float>(dim));
+  for (size_t i = 0; i < num_vectors; ++i) {
+    for (size_t d = 0; d < dim; ++d) {
+      vectors[i][d] = static_cast<float>((i * 37 + d * 11) % 17) / 8.0f - 1.0f;
+    }
+  }
+  const std::vector<float>& query = vectors[3];
+
+  for (auto vector_type :
+       {vectorlite::VectorType::BFloat16, vectorlite::VectorType::Float16,
+        vectorlite::VectorType::Float8E4M3,
+        vectorlite::VectorType::Float8E5M2}) {
+    for (auto distance_type :
+         {vectorlite::DistanceType::L2, vectorlite::DistanceType::Cosine}) {
+      auto space = vectorlite::CreateNamedVectorSpace(dim, distance_type,
+                                                      "my_vector", vector_type);
+      ASSERT_TRUE(space.ok());
+      const size_t data_size = space->space->get_data_size();
+      std::vector<uint8_t> storage(num_vectors * data_size);
+      std::vector<const void*> vector_ptrs;
+      for (size_t i = 0; i < num_vectors; ++i) {
+        QuantizeForSpace(vector_type, vectors[i], &storage[i * data_size]);
+        vector_ptrs.push_back(&storage[i * data_size]);
+      }
+
+      std::vector<float> distances(num_vectors);
+      space->space->BatchF32QueryDistance(query.data(), vector_ptrs.data(),
+                                          num_vectors, distances.data());
+      auto func = space->space->get_f32_query_dist_func();
+      ASSERT_NE(func, nullptr);
+      for (size_t i = 0; i < num_vectors; ++i) {
+        EXPECT_NEAR(distances[i],
+                    func(query.data(), vector_ptrs[i],
+                         space->space->get_dist_func_param()),
+                    1e-5)
+            << "i=" << i;
+      }
+    }
+  }
+}
+
+TEST(CreateNamedVectorSpace, Float8StoresOneBytePerElement) {
+  for (auto vector_type : {vectorlite::VectorType::Float8E4M3,
+                           vectorlite::VectorType::Float8E5M2}) {
+    for (auto distance_type :
+         {vectorlite::DistanceType::L2, vectorlite::DistanceType::Cosine}) {
+      auto space = vectorlite::CreateNamedVectorSpace(20, distance_type,
+                                                      "my_vector", vector_type);
+      ASSERT_TRUE(space.ok());
+      EXPECT_EQ(space->space->get_data_size(), 20);
+      // float8 spaces are searched with float32 queries.
+      EXPECT_NE(space->space->get_f32_query_dist_func(), nullptr);
+    }
+  }
+}
+
+TEST(CreateNamedVectorSpace, ShouldExposeBinaryParam) {
+  auto binary = vectorlite::CreateNamedVectorSpace(
+      20, vectorlite::DistanceType::Cosine, "my_vector",
+      vectorlite::VectorType::Binary);
+  ASSERT_TRUE(binary.ok());
+  ASSERT_NE(binary->binary_param(), nullptr);
+  EXPECT_EQ(binary->binary_param()->code_size(), 3);
+  // Only the binary code is stored, also with reranking.
+  EXPECT_EQ(binary->space->get_data_size(), 3);
+  binary->binary_param()->rerank_factor = 4;
+  EXPECT_EQ(binary->space->get_data_size(), 3);
+  EXPECT_EQ(binary->binary_param()->rerank_store.dim(), 20);
+
+  auto f32 = vectorlite::CreateNamedVectorSpace(
+      20, vectorlite::DistanceType::Cosine, "my_vector",
+      vectorlite::VectorType::Float32);
+  ASSERT_TRUE(f32.ok());
+  EXPECT_EQ(f32->binary_param(), nullptr);
+}
+
+TEST(VectorSpace, EnableProductQuantization) {
+  auto space = vectorlite::CreateNamedVectorSpace(
+      32, vectorlite::DistanceType::Cosine, "my_vector",
+      vectorlite::VectorType::Float32);
+  ASSERT_TRUE(space.ok());
+  EXPECT_EQ(space->pq_param(), nullptr);
+  EXPECT_FALSE(space->EnableProductQuantization(5, 100).ok());
+  EXPECT_FALSE(space->EnableProductQuantization(8, 0).ok());
+  ASSERT_TRUE(space->EnableProductQuantization(8, 100).ok());
+  EXPECT_EQ(space->vector_type, vectorlite::VectorType::ProductQuantized);
+  EXPECT_EQ(space->dimension(), 32);
+  EXPECT_TRUE(space->normalize);
+  ASSERT_NE(space->pq_param(), nullptr);
+  EXPECT_EQ(space->pq_param()->train_size, 100);
+  // 8 4-bit codes.
+  EXPECT_EQ(space->space->get_data_size(), 4);
+
+  auto bf16 = vectorlite::CreateNamedVectorSpace(
+      32, vectorlite::DistanceType::L2, "my_vector",
+      vectorlite::VectorType::BFloat16);
+  ASSERT_TRUE(bf16.ok());
+  EXPECT_FALSE(bf16->EnableProductQuantization(8, 100).ok());
+}
+
+TEST(VectorSpace, CheckNativeBlob) {
+  using vectorlite::VectorType;
+  for (VectorType vector_type :
+       {VectorType::Float32, VectorType::BFloat16, VectorType::Float16,
+        VectorType::Float8E4M3, VectorType::Int8, VectorType::Binary}) {
+    auto space = vectorlite::CreateNamedVectorSpace(
+        3, vectorlite::DistanceType::L2, "my_vector", vector_type);
+    ASSERT_TRUE(space.ok());
+    const bool native = vector_type == VectorType::BFloat16 ||
+                        vector_type == VectorType::Float16;
+    EXPECT_EQ(space->has_native_encoding(), native);
+    if (!native) {
+      continue;
+    }
+
+    EXPECT_TRUE(space->CheckNativeBlob(std::string(6, '\0')).ok());
+    // A float32 vector of the same dimension is too large.
+    EXPECT_FALSE(space->CheckNativeBlob(std::string(12, '\0')).ok());
+    EXPECT_FALSE(space->CheckNativeBlob(std::string(4, '\0')).ok());
+    EXPECT_FALSE(space->CheckNativeBlob(std::string()).ok());
+  }
+}
+
 static std::string VectorTypeToString(vectorlite::VectorType type) {
   switch (type) {
     case vectorlite::VectorType::Float32:
@@ -103,6 +367,14 @@ static std::string VectorTypeToString(vectorlite::VectorType type) {
       return "bfloat16";
     case vectorlite::VectorType::Float16:
       return "float16";
+    case vectorlite::VectorType::Float8E4M3:
+      return "float8_e4m3";
+    case vectorlite::VectorType::Float8E5M2:
+      return "float8_e5m2";
+    case vectorlite::VectorType::Int8:
+      return "int8";
+    case vectorlite::VectorType::Binary:
+      return "binary";
     default:
       return "unknown";
   }
@@ -111,7 +383,9 @@ static std::string VectorTypeToString(vectorlite::VectorType type) {
 TEST(NamedVectorSpace_FromString, ShouldWorkWithValidInput) {
   for (auto vector_type :
        {vectorlite::VectorType::Float32, vectorlite::VectorType::BFloat16,
-        vectorlite::VectorType::Float16}) {
+        vectorlite::VectorType::Float16, vectorlite::VectorType::Float8E4M3,
+        vectorlite::VectorType::Float8E5M2, vectorlite::VectorType::Int8,
+        vectorlite::VectorType::Binary}) {
     // If distance type is not specifed, it should default to L2
     std::string vector_type_str = VectorTypeToString(vector_type);
     auto space = vectorlite::NamedVectorSpace::FromString(
@@ -1,6 +1,8 @@
 #include "vector.h"
 
 #include <iostream>
+#include <limits>
+#include <string_view>
 
 #include "gtest/gtest.h"
 #include "vector_space.h"
@@ -33,6 +35,42 @@ TEST(VectorTest, FromJSON) {
   EXPECT_FALSE(result.ok());
 }
 
+TEST(VectorTest, FromJSONAcceptsAnyJSONNumber) {
+  auto result = vectorlite::Vector::FromJSON(
+      " \n[ -1 ,2.5e2,\t-3.25E-1 , 4294967296, 0.1 ]\n ");
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(result->data(),
+            std::vector<float>({-1.0f, 250.0f, -0.325f, 4294967296.0f, 0.1f}));
+
+  result = vectorlite::Vector::FromJSON("[]");
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(result->dim(), 0);
+
+  auto bf16 = vectorlite::BF16Vector::FromJSON("[1.5, -2]");
+  ASSERT_TRUE(bf16.ok()) << bf16.status();
+  ASSERT_EQ(bf16->dim(), 2);
+  EXPECT_EQ(hwy::ConvertScalarTo<float>(bf16->data()[0]), 1.5f);
+  EXPECT_EQ(hwy::ConvertScalarTo<float>(bf16->data()[1]), -2.0f);
+}
+
+TEST(VectorTest, FromJSONRejectsNonFlatArrays) {
+  for (std::string_view json :
+       {"1.0", "null", R"("[1]")", "[[1.0], 2.0]", "[1.0, [2.0]]",
+        "[1.0, null]", "[1.0, true]", R"([1.0, {"a": 1}])"}) {
+    EXPECT_TRUE(absl::IsInvalidArgument(
+        vectorlite::Vector::FromJSON(json).status()))
+        << json;
+  }
+
+  // Malformed JSON
+  for (std::string_view json :
+       {"", "[", "[1.0,", "[1.0,]", "[1.0 2.0]", "[1.0] [2.0]", "[1.0]x"}) {
+    EXPECT_TRUE(absl::IsInvalidArgument(
+        vectorlite::Vector::FromJSON(json).status()))
+        << json;
+  }
+}
+
 TEST(VectorTest, Reversible_ToJSON_FromJSON) {
   // Test empty vector
   vectorlite::Vector v;
@@ -49,6 +87,18 @@ TEST(VectorTest, Reversible_ToJSON_FromJSON) {
   EXPECT_FLOAT_EQ(parsed.data()[0], v1.data()[0]);
   EXPECT_FLOAT_EQ(parsed.data()[1], v1.data()[1]);
   EXPECT_FLOAT_EQ(parsed.data()[2], v1.data()[2]);
+
+  // Round trip is exact
+  std::vector<float> data;
+  for (int i = 0; i < 1000; i++) {
+    data.push_back((i - 500) * 0.0123f + 1e-7f * i);
+  }
+  data.push_back(std::numeric_limits<float>::max());
+  data.push_back(std::numeric_limits<float>::denorm_min());
+  vectorlite::Vector v2(data);
+  parse_result = vectorlite::Vector::FromJSON(v2.ToJSON());
+  ASSERT_TRUE(parse_result.ok()) << parse_result.status();
+  EXPECT_EQ(parse_result->data(), data);
 }
 
 TEST(VectorTest, Reversible_ToBinary_FromBinary) {
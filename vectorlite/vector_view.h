@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <string_view>
 
@@ -7,8 +10,6 @@
 #include "absl/types/span.h"
 #include "hwy/base.h"
 #include "macros.h"
-#include "rapidjson/document.h"
-#include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "util.h"
 
@@ -44,20 +45,31 @@ class GenericVectorView : private CopyAssignBase<T>,
         reinterpret_cast<const T*>(blob.data()), blob.size() / sizeof(T)));
   };
 
+  // Serializes the vector as a JSON array. Numbers are written straight into
+  // the returned string, which is reserved up front, without building a DOM.
   std::string ToJSON() const {
-    rapidjson::Document doc;
-    doc.SetArray();
-
-    auto& allocator = doc.GetAllocator();
+    // Elements are written with float precision, see WriteFloat, which rarely
+    // takes more than 12 bytes, plus one byte for the separating comma.
+    constexpr size_t kEstimatedBytesPerElement = 13;
+
+    std::string json;
+    json.reserve(2 + data_.size() * kEstimatedBytesPerElement);
+    StringOutputStream os{json};
+    rapidjson::Writer<StringOutputStream> writer(os);
+    writer.StartArray();
     for (T v : data_) {
-      doc.PushBack(hwy::ConvertScalarTo<float>(v), allocator);
+      float f = hwy::ConvertScalarTo<float>(v);
+      // JSON has no NaN or infinity. Like JSON.stringify, write them as null
+      // rather than leaving a malformed document behind.
+      if (std::isfinite(f)) {
+        WriteFloat(writer, f);
+      } else {
+        writer.Null();
+      }
     }
+    writer.EndArray();
 
-    rapidjson::StringBuffer buf;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buf);
-    doc.Accept(writer);
-
-    return buf.GetString();
+    return json;
   };
 
   std::string_view ToBlob() const {
@@ -70,6 +82,73 @@ class GenericVectorView : private CopyAssignBase<T>,
   absl::Span<const T> data() const { return data_; }
 
  private:
+  // Output stream of rapidjson::Writer that appends to a std::string.
+  struct StringOutputStream {
+    using Ch = char;
+
+    void Put(char c) { str.push_back(c); }
+    void Flush() {}
+
+    std::string& str;
+  };
+
+  // Writes finite `f` as a number that reads back as the same float, e.g. 0.1
+  // rather than the 0.10000000149011612 that writer.Double(f) would write for
+  // the widened double. This runs rapidjson's Grisu2, which Double uses, but
+  // with the rounding boundaries of the float instead of the double. Unlike
+  // printf, it ignores LC_NUMERIC, so a host application running under a
+  // comma decimal locale still gets valid JSON. Like Double, integers are
+  // written with a trailing ".0".
+  static void WriteFloat(rapidjson::Writer<StringOutputStream>& writer,
+                         float f) {
+    using rapidjson::internal::DiyFp;
+    constexpr uint32_t kHiddenBit = 0x00800000;
+    char buffer[32];
+    char* p = buffer;
+    if (std::signbit(f)) {
+      *p++ = '-';
+      f = -f;
+    }
+    if (f == 0.0f) {
+      std::memcpy(p, "0.0", 3);
+      p += 3;
+    } else {
+      uint32_t bits;
+      std::memcpy(&bits, &f, sizeof(f));
+      const int biased_exponent = static_cast<int>(bits >> 23);
+      uint64_t significand = bits & (kHiddenBit - 1);
+      int exponent = 1 - 150;  // subnormal
+      if (biased_exponent != 0) {
+        significand |= kHiddenBit;
+        exponent = biased_exponent - 150;
+      }
+      const DiyFp v = DiyFp(significand, exponent).Normalize();
+      const DiyFp plus =
+          DiyFp((significand << 1) + 1, exponent - 1).Normalize();
+      // The float below a power of two is closer than the one above it.
+      DiyFp minus = significand == kHiddenBit && biased_exponent > 1
+                        ? DiyFp((significand << 2) - 1, exponent - 2)
+                        : DiyFp((significand << 1) - 1, exponent - 1);
+      minus.f <<= minus.e - plus.e;
+      minus.e = plus.e;
+
+      int k = 0;
+      const DiyFp c_mk = rapidjson::internal::GetCachedPower(plus.e, &k);
+      const DiyFp w = v * c_mk;
+      DiyFp w_plus = plus * c_mk;
+      DiyFp w_minus = minus * c_mk;
+      w_minus.f++;
+      w_plus.f--;
+      int length = 0;
+      rapidjson::internal::DigitGen(w, w_plus, w_plus.f - w_minus.f, p,
+                                    &length, &k);
+      p = rapidjson::internal::Prettify(p, length, k,
+                                        /*maxDecimalPlaces=*/324);
+    }
+    writer.RawValue(buffer, static_cast<size_t>(p - buffer),
+                    rapidjson::kNumberType);
+  }
+
   absl::Span<const T> data_;
 };
 
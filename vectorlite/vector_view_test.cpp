@@ -1,6 +1,15 @@
 #include "vector_view.h"
 
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "vector.h"
@@ -38,3 +47,110 @@ TEST(VectorViewTest, ToJSON) {
     EXPECT_FLOAT_EQ(data[i], result->data()[i]);
   }
 }
+
+TEST(VectorViewTest, ToJSONWritesFloatPrecision) {
+  std::vector<float> data = {0.1f,  0.3f,      1.0f, -2.5f,
+                             1e-45f, 0.001234f, 3e21f, -0.0f};
+  vectorlite::VectorView v(data);
+
+  EXPECT_EQ(v.ToJSON(), "[0.1,0.3,1.0,-2.5,1e-45,0.001234,3e21,-0.0]");
+}
+
+TEST(VectorViewTest, ToJSONRoundTripsEveryExponent) {
+  std::vector<float> data;
+  for (uint32_t exponent = 0; exponent < 255; ++exponent) {
+    for (uint32_t mantissa : {0u, 1u, 0x2aaaaau, 0x7fffffu}) {
+      uint32_t bits = exponent << 23 | mantissa;
+      float f;
+      std::memcpy(&f, &bits, sizeof(f));
+      data.push_back(f);
+      data.push_back(-f);
+    }
+  }
+  vectorlite::VectorView v(data);
+
+  auto result = vectorlite::Vector::FromJSON(v.ToJSON());
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(result->data(), data);
+}
+
+TEST(VectorViewTest, ToJSONWritesElementsThatReadBackAsTheSameFloat) {
+  std::vector<float> data = {std::numeric_limits<float>::max(),
+                             std::numeric_limits<float>::min(),
+                             std::numeric_limits<float>::denorm_min(),
+                             16777216.0f, 16777215.0f, 0.0f};
+  // Every power of two, subnormals included.
+  for (int exponent = -149; exponent <= 127; ++exponent) {
+    data.push_back(std::ldexp(1.0f, exponent));
+  }
+  // Subnormals of every magnitude.
+  for (uint32_t bits = 1; bits < 0x00800000; bits = bits * 3 + 1) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    data.push_back(f);
+  }
+  // Random bit patterns.
+  std::mt19937 gen(15);
+  while (data.size() < 200000) {
+    uint32_t bits = gen();
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    if (std::isfinite(f)) {
+      data.push_back(f);
+    }
+  }
+  for (size_t i = 0, n = data.size(); i < n; ++i) {
+    data.push_back(-data[i]);
+  }
+  vectorlite::VectorView v(data);
+  std::string json = v.ToJSON();
+
+  ASSERT_EQ(json.front(), '[');
+  ASSERT_EQ(json.back(), ']');
+  const char* p = json.c_str() + 1;
+  for (float f : data) {
+    char* end = nullptr;
+    EXPECT_EQ(std::strtof(p, &end), f) << std::string_view(p, end - p);
+    // Fixed notation is used up to 21 integer digits, which with a sign and
+    // the trailing ".0" is the longest form.
+    EXPECT_LE(end - p, 24) << std::string_view(p, end - p);
+    ASSERT_TRUE(*end == ',' || *end == ']');
+    p = end + 1;
+  }
+}
+
+TEST(VectorViewTest, ToJSONIgnoresNumericLocale) {
+  const char* previous = std::setlocale(LC_NUMERIC, nullptr);
+  std::string saved = previous ? previous : "C";
+  bool found = false;
+  for (const char* name : {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8",
+                           "fr_FR.utf8", "fr_FR", "German_Germany.1252"}) {
+    if (std::setlocale(LC_NUMERIC, name) != nullptr) {
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    GTEST_SKIP() << "No comma decimal locale is installed";
+  }
+  std::string decimal_point = std::localeconv()->decimal_point;
+
+  std::vector<float> data = {0.1f, 1.0f, -2.5f, 3e21f};
+  vectorlite::VectorView v(data);
+  std::string json = v.ToJSON();
+  auto result = vectorlite::Vector::FromJSON(json);
+  std::setlocale(LC_NUMERIC, saved.c_str());
+
+  ASSERT_EQ(decimal_point, ",");
+  EXPECT_EQ(json, "[0.1,1.0,-2.5,3e21]");
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(result->data(), data);
+}
+
+TEST(VectorViewTest, ToJSONWritesNonFiniteAsNull) {
+  std::vector<float> data = {1.0f, std::numeric_limits<float>::quiet_NaN(),
+                             -std::numeric_limits<float>::infinity(), 2.5f};
+  vectorlite::VectorView v(data);
+
+  EXPECT_EQ(v.ToJSON(), "[1.0,null,null,2.5]");
+}
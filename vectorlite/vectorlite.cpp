@@ -53,6 +53,39 @@ VECTORLITE_EXPORT int sqlite3_extension_init(sqlite3 *db, char **pzErrMsg,
     return rc;
   }
 
+  // -1 lets the function take an optional dimension as the 4th argument.
+  rc = sqlite3_create_function(
+      db, "vector_distance_matrix", -1,
+      SQLITE_UTF8 | SQLITE_INNOCUOUS | SQLITE_DETERMINISTIC, nullptr,
+      vectorlite::VectorDistanceMatrix, nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    *pzErrMsg = sqlite3_mprintf(
+        "Failed to create function vector_distance_matrix: %s",
+        sqlite3_errstr(rc));
+    return rc;
+  }
+
+  // An aggregate, so it only has xStep and xFinal.
+  rc = sqlite3_create_function(
+      db, "vector_topk", 5,
+      SQLITE_UTF8 | SQLITE_INNOCUOUS | SQLITE_DETERMINISTIC, nullptr, nullptr,
+      vectorlite::VectorTopK, vectorlite::VectorTopKFinal);
+  if (rc != SQLITE_OK) {
+    *pzErrMsg = sqlite3_mprintf("Failed to create function vector_topk: %s",
+                                sqlite3_errstr(rc));
+    return rc;
+  }
+
+  rc = sqlite3_create_function(
+      db, "rowid_bitmap", 1,
+      SQLITE_UTF8 | SQLITE_INNOCUOUS | SQLITE_DETERMINISTIC, nullptr, nullptr,
+      vectorlite::RowidBitmapStep, vectorlite::RowidBitmapFinal);
+  if (rc != SQLITE_OK) {
+    *pzErrMsg = sqlite3_mprintf("Failed to create function rowid_bitmap: %s",
+                                sqlite3_errstr(rc));
+    return rc;
+  }
+
   rc = sqlite3_create_function(
       db, "vector_from_json", 1,
       SQLITE_UTF8 | SQLITE_INNOCUOUS | SQLITE_DETERMINISTIC, nullptr,
@@ -73,6 +106,26 @@ VECTORLITE_EXPORT int sqlite3_extension_init(sqlite3 *db, char **pzErrMsg,
     return rc;
   }
 
+  rc = sqlite3_create_function(
+      db, "vector_to_bf16", 1,
+      SQLITE_UTF8 | SQLITE_INNOCUOUS | SQLITE_DETERMINISTIC, nullptr,
+      vectorlite::VectorToBF16, nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    *pzErrMsg = sqlite3_mprintf("Failed to create function vector_to_bf16: %s",
+                                sqlite3_errstr(rc));
+    return rc;
+  }
+
+  rc = sqlite3_create_function(
+      db, "vector_to_f16", 1,
+      SQLITE_UTF8 | SQLITE_INNOCUOUS | SQLITE_DETERMINISTIC, nullptr,
+      vectorlite::VectorToF16, nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    *pzErrMsg = sqlite3_mprintf("Failed to create function vector_to_f16: %s",
+                                sqlite3_errstr(rc));
+    return rc;
+  }
+
   rc = sqlite3_create_function(db, "knn_search", 2, SQLITE_UTF8, nullptr,
                                vectorlite::KnnSearch, nullptr, nullptr);
   if (rc != SQLITE_OK) {
@@ -89,11 +142,20 @@ VECTORLITE_EXPORT int sqlite3_extension_init(sqlite3 *db, char **pzErrMsg,
     return rc;
   }
 
-  rc = sqlite3_create_function(db, "vectorlite_info", 0, SQLITE_UTF8, nullptr,
-                               vectorlite::ShowInfo, nullptr, nullptr);
+  rc = sqlite3_create_function(db, "knn_batch_param", -1, SQLITE_UTF8, nullptr,
+                               vectorlite::KnnBatchParamFunc, nullptr, nullptr);
   if (rc != SQLITE_OK) {
-    *pzErrMsg = sqlite3_mprintf("Failed to create vectorlite_info function: %s",
-                                sqlite3_errstr(rc));
+    *pzErrMsg = sqlite3_mprintf(
+        "Failed to create knn_batch_param function: %s", sqlite3_errstr(rc));
+    return rc;
+  }
+
+  rc = sqlite3_create_function(db, "knn_stream_param", -1, SQLITE_UTF8,
+                               nullptr, vectorlite::KnnStreamParamFunc,
+                               nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    *pzErrMsg = sqlite3_mprintf(
+        "Failed to create knn_stream_param function: %s", sqlite3_errstr(rc));
     return rc;
   }
 
@@ -107,6 +169,26 @@ VECTORLITE_EXPORT int sqlite3_extension_init(sqlite3 *db, char **pzErrMsg,
     return rc;
   }
 
+  // Both functions read the registry, which the module owns and frees when
+  // the connection closes.
+  rc = sqlite3_create_function(db, "vectorlite_info", 0, SQLITE_UTF8, registry,
+                               vectorlite::ShowInfo, nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    *pzErrMsg = sqlite3_mprintf("Failed to create vectorlite_info function: %s",
+                                sqlite3_errstr(rc));
+    return rc;
+  }
+
+  rc = sqlite3_create_function(db, "vectorlite_autotune", 0, SQLITE_UTF8,
+                               registry, vectorlite::VectorliteAutotune,
+                               nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    *pzErrMsg = sqlite3_mprintf(
+        "Failed to create vectorlite_autotune function: %s",
+        sqlite3_errstr(rc));
+    return rc;
+  }
+
   return rc;
 }
 
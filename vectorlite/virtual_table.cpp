@@ -2,10 +2,14 @@
 
 #include <sqlite3.h>
 
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
 #include <exception>
 #include <filesystem>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string_view>
 #include <vector>
@@ -16,13 +20,18 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
+#include "absl/types/span.h"
 #include "constraint.h"
+#include "distance.h"
 #include "hnswlib/hnswlib.h"
 #include "hwy/base.h"
 #include "index_options.h"
 #include "macros.h"
 #include "ops/ops.h"
+#include "product_quantizer.h"
 #include "quantization.h"
+#include "rerank_store.h"
+#include "rowid_bitmap.h"
 #include "sqlite3ext.h"
 #include "util.h"
 #include "vector.h"
@@ -38,6 +47,7 @@ enum ColumnIndexInTable {
   kColumnIndexDistance,
   kColumnIndexOperation,
   kColumnIndexPath,
+  kColumnIndexQueryIndex,
 };
 
 enum FunctionConstraint {
@@ -67,10 +77,13 @@ static IndexHandle MakeIndexHandle(NamedVectorSpace space,
       space.space.get(), options.max_elements, options.M,
       options.ef_construction, options.random_seed,
       options.allow_replace_deleted);
-  return IndexHandle{std::move(space), std::move(index),
+  IndexHandle handle{std::move(space), std::move(index),
                      options.allow_replace_deleted,
                      std::string(vector_space_str),
                      std::string(index_options_str)};
+  handle.native_input = options.native_input;
+  handle.native_output = options.native_output;
+  return handle;
 }
 
 // Shared by Create and Connect
@@ -127,9 +140,53 @@ static int InitVirtualTable(bool is_create, sqlite3* db, void* pAux, int argc,
     return SQLITE_ERROR;
   }
 
+  if (index_options->rerank > 0) {
+    BinarySpaceParam* binary_param = vector_space->binary_param();
+    if (binary_param == nullptr) {
+      *pzErr = sqlite3_mprintf(
+          "Invalid index_options %s. Reason: rerank is only supported for "
+          "binary vectors",
+          argv[1 + kModuleParamOffset]);
+      return SQLITE_ERROR;
+    }
+    // Must be set before the index is built, as it changes the element size.
+    binary_param->rerank_factor = index_options->rerank;
+  }
+
+  if (Int8SpaceParam* int8_param = vector_space->int8_param()) {
+    if (index_options->int8_calibration == 0) {
+      *pzErr = sqlite3_mprintf(
+          "Invalid index_options %s. Reason: int8_calibration must be greater "
+          "than 0",
+          argv[1 + kModuleParamOffset]);
+      return SQLITE_ERROR;
+    }
+    int8_param->calibration_size = index_options->int8_calibration;
+  }
+
+  if ((index_options->native_input || index_options->native_output) &&
+      !vector_space->has_native_encoding()) {
+    *pzErr = sqlite3_mprintf(
+        "Invalid index_options %s. Reason: native_input and native_output are "
+        "only supported for bfloat16 and float16 vectors",
+        argv[1 + kModuleParamOffset]);
+    return SQLITE_ERROR;
+  }
+
+  if (index_options->pq > 0) {
+    absl::Status status = vector_space->EnableProductQuantization(
+        index_options->pq, index_options->pq_train);
+    if (!status.ok()) {
+      *pzErr = sqlite3_mprintf("Invalid index_options %s. Reason: %s",
+                               argv[1 + kModuleParamOffset],
+                               absl::StatusMessageAsCStr(status));
+      return SQLITE_ERROR;
+    }
+  }
+
   std::string sql = absl::StrFormat(
       "CREATE TABLE X(%s, distance REAL hidden, operation TEXT hidden, path "
-      "TEXT hidden)",
+      "TEXT hidden, query_index INTEGER hidden)",
       vector_space->vector_name);
   rc = sqlite3_declare_vtab(db, sql.c_str());
   DLOG(INFO) << "vtab declared: " << sql.c_str() << ", rc=" << rc;
@@ -182,6 +239,16 @@ absl::Status VirtualTable::SaveTo(const std::string& path) {
   } catch (const std::exception& ex) {
     return absl::InternalError(ex.what());
   }
+  if (const Int8Calibration* calibration = space_.int8_calibration()) {
+    return calibration->SaveTo(Int8Calibration::SidecarPath(path));
+  }
+  if (const PQSpaceParam* pq_param = space_.pq_param()) {
+    return pq_param->quantizer.SaveTo(ProductQuantizer::SidecarPath(path));
+  }
+  if (const BinarySpaceParam* binary_param = space_.binary_param();
+      binary_param != nullptr && binary_param->rerank_factor > 0) {
+    return binary_param->rerank_store.SaveTo(RerankStore::SidecarPath(path));
+  }
   return absl::OkStatus();
 }
 
@@ -221,7 +288,39 @@ absl::Status VirtualTable::LoadFrom(const std::string& path) {
         file_data_size, space_.space->get_data_size()));
   }
 
+  if (Int8Calibration* calibration = space_.int8_calibration()) {
+    // int8 codes are meaningless without the calibration they were quantized
+    // with, so refuse to load an index whose calibration is missing.
+    // This also restores vectors that were pending calibration.
+    auto saved_calibration = Int8Calibration::LoadFrom(
+        Int8Calibration::SidecarPath(path), dimension());
+    if (!saved_calibration.ok()) {
+      return saved_calibration.status();
+    }
+    *calibration = *saved_calibration;
+  }
+
+  if (PQSpaceParam* pq_param = space_.pq_param()) {
+    // Same as above, including vectors that were pending training.
+    absl::Status status =
+        pq_param->quantizer.LoadFrom(ProductQuantizer::SidecarPath(path));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  if (BinarySpaceParam* binary_param = space_.binary_param();
+      binary_param != nullptr && binary_param->rerank_factor > 0) {
+    // Reranking needs the float32 vector of every row.
+    absl::Status status =
+        binary_param->rerank_store.LoadFrom(RerankStore::SidecarPath(path));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
   index_ = std::move(new_index);
+  ++handle_->index_generation;
   return absl::OkStatus();
 }
 
@@ -321,48 +420,119 @@ int VirtualTable::Next(sqlite3_vtab_cursor* pCur) {
   VECTORLITE_ASSERT(pCur != nullptr);
 
   Cursor* cursor = static_cast<Cursor*>(pCur);
-  if (cursor->current_row != cursor->result.cend()) {
+  if (cursor->stream != nullptr) {
+    VirtualTable* vtab = static_cast<VirtualTable*>(pCur->pVtab);
+    if (cursor->index_generation != vtab->handle_->index_generation) {
+      // The index the stream walks has been freed, e.g. by a load command
+      // issued while the query was running.
+      cursor->stream.reset();
+      cursor->result.clear();
+      cursor->current_row = cursor->result.cend();
+      SetZErrMsg(&vtab->zErrMsg,
+                 "the index was replaced during a knn_stream_param() search");
+      return SQLITE_ERROR;
+    }
+    cursor->NextFromStream();
+  } else if (cursor->current_row != cursor->result.cend()) {
     ++cursor->current_row;
   }
 
   return SQLITE_OK;
 }
 
-absl::StatusOr<Vector> VirtualTable::GetVectorByRowid(int64_t rowid) const {
-  try {
-    // TODO: handle cases where sizeof(rowid) != sizeof(hnswlib::labeltype)
-    auto label = static_cast<hnswlib::labeltype>(rowid);
-    // The element type stored in the index depends on the vector type. Reading
-    // it back with the wrong type would reinterpret (and over-read) the stored
-    // bytes, so dispatch on the actual stored type and dequantize back to f32.
-    switch (space_.vector_type) {
-      case VectorType::Float32: {
-        std::vector<float> vec = index_->getDataByLabel<float>(label);
-        VECTORLITE_ASSERT(vec.size() == dimension());
-        return Vector(std::move(vec));
-      }
-      case VectorType::BFloat16: {
-        std::vector<hwy::bfloat16_t> stored =
-            index_->getDataByLabel<hwy::bfloat16_t>(label);
-        VECTORLITE_ASSERT(stored.size() == dimension());
-        std::vector<float> vec(stored.size());
-        ops::BF16ToF32(stored.data(), vec.data(), stored.size());
-        return Vector(std::move(vec));
-      }
-      case VectorType::Float16: {
-        std::vector<hwy::float16_t> stored =
-            index_->getDataByLabel<hwy::float16_t>(label);
-        VECTORLITE_ASSERT(stored.size() == dimension());
-        std::vector<float> vec(stored.size());
-        ops::F16ToF32(stored.data(), vec.data(), stored.size());
-        return Vector(std::move(vec));
-      }
-      default:
-        return absl::InternalError("Unknown vector type");
+int VirtualTable::ResultVector(sqlite3_context* ctx,
+                               Cursor::Rowid rowid) const {
+  // TODO: handle cases where sizeof(rowid) != sizeof(hnswlib::labeltype)
+  auto label = static_cast<hnswlib::labeltype>(rowid);
+  const uint8_t* stored = FindRawDataByLabel(*index_, label);
+  if (stored == nullptr) {
+    std::string err = absl::StrFormat("Can't find vector with rowid %d", rowid);
+    sqlite3_result_text(ctx, err.c_str(), err.size(), SQLITE_TRANSIENT);
+    return SQLITE_ERROR;
+  }
+  if (handle_->native_output) {
+    // Stored elements are copied by SQLite as they are.
+    sqlite3_result_blob(ctx, stored, index_->data_size_, SQLITE_TRANSIENT);
+    return SQLITE_OK;
+  }
+
+  size_t size = dimension() * sizeof(float);
+
+  // Vectors stored as float32 are copied by SQLite straight from the index,
+  // without decoding. They can't be handed over in place: an update or a
+  // reused deleted slot rewrites the row, and a load frees the whole index,
+  // while the caller may still hold the value.
+  const uint8_t* f32_data = nullptr;
+  if (space_.vector_type == VectorType::Float32) {
+    f32_data = stored;
+  } else if (space_.vector_type == VectorType::Binary &&
+             space_.binary_param()->rerank_factor > 0) {
+    f32_data = reinterpret_cast<const uint8_t*>(
+        space_.binary_param()->rerank_store.Find(label));
+    VECTORLITE_ASSERT(f32_data != nullptr);
+  }
+  if (f32_data != nullptr) {
+    sqlite3_result_blob(ctx, f32_data, size, SQLITE_TRANSIENT);
+    return SQLITE_OK;
+  }
+
+  const std::unordered_map<uint64_t, std::vector<float>>* pending = nullptr;
+  if (space_.vector_type == VectorType::ProductQuantized &&
+      !space_.pq_param()->quantizer.trained()) {
+    pending = &space_.pq_param()->quantizer.pending();
+  } else if (space_.vector_type == VectorType::Int8 &&
+             !space_.int8_calibration()->calibrated()) {
+    pending = &space_.int8_calibration()->pending;
+  }
+  if (pending != nullptr) {
+    auto it = pending->find(label);
+    VECTORLITE_ASSERT(it != pending->end());
+    sqlite3_result_blob(ctx, it->second.data(), size, SQLITE_TRANSIENT);
+    return SQLITE_OK;
+  }
+
+  // Other element types are decoded straight into a buffer owned by SQLite.
+  float* out = static_cast<float*>(sqlite3_malloc64(size));
+  if (out == nullptr) {
+    sqlite3_result_error_nomem(ctx);
+    return SQLITE_NOMEM;
+  }
+  size_t dim = dimension();
+  switch (space_.vector_type) {
+    case VectorType::BFloat16:
+      ops::BF16ToF32(reinterpret_cast<const hwy::bfloat16_t*>(stored), out,
+                     dim);
+      break;
+    case VectorType::Float16:
+      ops::F16ToF32(reinterpret_cast<const hwy::float16_t*>(stored), out, dim);
+      break;
+    case VectorType::Float8E4M3:
+      ops::F8ToF32(reinterpret_cast<const ops::float8_e4m3_t*>(stored), out,
+                   dim);
+      break;
+    case VectorType::Float8E5M2:
+      ops::F8ToF32(reinterpret_cast<const ops::float8_e5m2_t*>(stored), out,
+                   dim);
+      break;
+    case VectorType::Int8: {
+      const Int8Calibration& calibration = *space_.int8_calibration();
+      ops::I8ToF32(reinterpret_cast<const int8_t*>(stored), out, dim,
+                   calibration.scale, calibration.offset);
+      break;
     }
-  } catch (const std::runtime_error& ex) {
-    return absl::Status(absl::StatusCode::kNotFound, ex.what());
+    case VectorType::Binary:
+      ops::BinaryToF32(stored, out, dim);
+      break;
+    case VectorType::ProductQuantized:
+      space_.pq_param()->quantizer.Decode(stored, out);
+      break;
+    default:
+      sqlite3_free(out);
+      sqlite3_result_error(ctx, "Unknown vector type", -1);
+      return SQLITE_ERROR;
   }
+  sqlite3_result_blob64(ctx, out, size, sqlite3_free);
+  return SQLITE_OK;
 }
 
 int VirtualTable::Column(sqlite3_vtab_cursor* pCur, sqlite3_context* pCtx,
@@ -383,21 +553,18 @@ int VirtualTable::Column(sqlite3_vtab_cursor* pCur, sqlite3_context* pCtx,
   } else if (kColumnIndexVector == N) {
     Cursor::Rowid rowid = cursor->current_row->second;
     VirtualTable* vtab = static_cast<VirtualTable*>(pCur->pVtab);
-    auto vector = vtab->GetVectorByRowid(rowid);
-    if (vector.ok()) {
-      std::string_view blob = vector->ToBlob();
-      sqlite3_result_blob(pCtx, blob.data(), blob.size(), SQLITE_TRANSIENT);
-      return SQLITE_OK;
-    } else {
-      std::string err =
-          absl::StrFormat("Can't find vector with rowid %d", rowid);
-      sqlite3_result_text(pCtx, err.c_str(), err.size(), SQLITE_TRANSIENT);
-      return SQLITE_ERROR;
-    }
+    return vtab->ResultVector(pCtx, rowid);
   } else if (kColumnIndexOperation == N || kColumnIndexPath == N) {
     // operation/path are a write-only command channel.
     sqlite3_result_null(pCtx);
     return SQLITE_OK;
+  } else if (kColumnIndexQueryIndex == N) {
+    // Rows of a single query belong to query 0.
+    size_t row = cursor->current_row - cursor->result.cbegin();
+    sqlite3_result_int64(pCtx, cursor->query_indices.empty()
+                                   ? 0
+                                   : cursor->query_indices[row]);
+    return SQLITE_OK;
   } else {
     std::string err = absl::StrFormat("Invalid column index: %d", N);
     sqlite3_result_text(pCtx, err.c_str(), err.size(), SQLITE_TRANSIENT);
@@ -429,6 +596,9 @@ int VirtualTable::BestIndex(sqlite3_vtab* vtab,
 
   std::vector<std::string_view> constraint_short_names;
   constraint_short_names.reserve(index_info->nConstraint);
+  size_t num_rowid_comparisons = 0;
+  // Index of each distance comparison in aConstraint.
+  std::vector<std::pair<int, DistanceCompare::Op>> distance_comparisons;
 
   DLOG(INFO) << "BestIndex called with " << index_info->nConstraint
              << " constraints";
@@ -476,7 +646,20 @@ int VirtualTable::BestIndex(sqlite3_vtab* vtab,
           constraint_short_names.push_back(RowIdEquals::kShortName);
           index_info->estimatedCost = 100;
         }
+      } else if (auto op = RowIdCompare::FromSqliteOp(constraint.op)) {
+        // Range and != comparisons are tested per rowid, so they are fully
+        // handled here too. BETWEEN arrives as a >= and a <=.
+        DLOG(INFO) << i << "-th constraint is a rowid comparison";
+        index_info->aConstraintUsage[i].argvIndex = ++argvIndex;
+        index_info->aConstraintUsage[i].omit = 1;
+        constraint_short_names.push_back(RowIdCompare::ShortName(*op));
+        num_rowid_comparisons++;
       }
+    } else if (auto op = DistanceCompare::FromSqliteOp(constraint.op);
+               op && column == kColumnIndexDistance) {
+      // The executor applies it exactly, and stops graph search at the bound.
+      DLOG(INFO) << i << "-th constraint is a distance comparison";
+      distance_comparisons.emplace_back(i, *op);
     } else {
       DLOG(INFO) << "Unknown constraint iColumn=" << column
                  << ", op=" << static_cast<int>(constraint.op);
@@ -485,11 +668,26 @@ int VirtualTable::BestIndex(sqlite3_vtab* vtab,
 
   DLOG(INFO) << "Picked " << constraint_short_names.size() << " constraints";
 
+  if (num_rowid_comparisons > 0 &&
+      num_rowid_comparisons == constraint_short_names.size()) {
+    // Without knn_search or rowid = / IN, rowids are looked up one by one or
+    // the whole index is scanned.
+    index_info->estimatedCost = 1000;
+  }
+
   if (constraint_short_names.empty()) {
     SetZErrMsg(&vtab->zErrMsg, "No valid constraint found in where clause");
     return SQLITE_CONSTRAINT;
   }
 
+  // A distance comparison alone doesn't restrict which rows are scanned, so
+  // it is only taken along with other constraints.
+  for (const auto& [i, op] : distance_comparisons) {
+    index_info->aConstraintUsage[i].argvIndex = ++argvIndex;
+    index_info->aConstraintUsage[i].omit = 1;
+    constraint_short_names.push_back(DistanceCompare::ShortName(op));
+  }
+
   std::string index_str = absl::StrJoin(constraint_short_names, "");
 
   char* p = sqlite3_mprintf("%s", index_str.c_str());
@@ -531,7 +729,9 @@ int VirtualTable::Filter(sqlite3_vtab_cursor* pCur, int idxNum,
   }
 
   DLOG(INFO) << "constraints: " << ConstraintsToDebugString(*constraints);
-  auto executor = QueryExecutor(*vtab->index_, vtab->space_);
+  auto executor =
+      QueryExecutor(*vtab->index_, vtab->space_, vtab->handle_->native_input,
+                    &vtab->registry_->worker_pool());
   int n = constraints->size();
   for (int i = 0; i < n; i++) {
     auto status = (*constraints)[i]->Materialize(sqlite3_api, argv[i]);
@@ -555,9 +755,16 @@ int VirtualTable::Filter(sqlite3_vtab_cursor* pCur, int idxNum,
     return SQLITE_ERROR;
   }
 
-  auto result = executor.Execute();
+  cursor->query_indices.clear();
+  cursor->stream.reset();
+  cursor->index_generation = vtab->handle_->index_generation;
+  auto result = executor.Execute(&cursor->query_indices, &cursor->stream);
 
   if (result.ok()) {
+    if (cursor->stream != nullptr) {
+      cursor->NextFromStream();
+      return SQLITE_OK;
+    }
     cursor->result = std::move(*result);
     cursor->current_row = cursor->result.cbegin();
     DLOG(INFO) << "Found " << cursor->result.size() << " rows";
@@ -577,42 +784,50 @@ void KnnParamDeleter(void* param) {
   delete p;
 }
 
-void KnnParamFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
-  if (argc != 2 && argc != 3) {
-    sqlite3_result_error(
-        ctx, "invalid number of paramters to knn_param(). 2 or 3 is expected",
-        -1);
+// The knn_param() flavors, see the fields of KnnParam they set.
+enum class KnnParamKind { kSingle, kBatch, kStream };
+
+// Shared by knn_param(), knn_batch_param() and knn_stream_param(), which only
+// differ in whether the blob holds one query or many and in how rows are
+// searched.
+static void MakeKnnParam(sqlite3_context* ctx, int argc, sqlite3_value** argv,
+                         std::string_view function_name, KnnParamKind kind) {
+  if (argc < 2 || argc > 5) {
+    std::string err = absl::StrFormat(
+        "invalid number of paramters to %s(). 2 to 5 is expected",
+        function_name);
+    sqlite3_result_error(ctx, err.c_str(), -1);
     return;
   }
 
   if (sqlite3_value_type(argv[0]) != SQLITE_BLOB) {
-    sqlite3_result_error(
-        ctx, "vector(1st param of knn_param) should be of type Blob", -1);
+    std::string err = absl::StrFormat(
+        "%s(1st param of %s) should be of type Blob",
+        kind == KnnParamKind::kBatch ? "queries" : "vector", function_name);
+    sqlite3_result_error(ctx, err.c_str(), -1);
     return;
   }
 
   if (sqlite3_value_type(argv[1]) != SQLITE_INTEGER) {
-    sqlite3_result_error(
-        ctx, "k(2nd param of knn_param) should be of type INTEGER", -1);
+    std::string err = absl::StrFormat(
+        "k(2nd param of %s) should be of type INTEGER", function_name);
+    sqlite3_result_error(ctx, err.c_str(), -1);
     return;
   }
 
-  if (argc == 3 && sqlite3_value_type(argv[2]) != SQLITE_INTEGER) {
-    sqlite3_result_error(
-        ctx, "ef(3rd param of knn_param) should be of type INTEGER", -1);
+  // ef can be NULL to keep the index's ef when more params follow.
+  const bool has_ef = argc >= 3 && sqlite3_value_type(argv[2]) != SQLITE_NULL;
+  if (has_ef && sqlite3_value_type(argv[2]) != SQLITE_INTEGER) {
+    std::string err = absl::StrFormat(
+        "ef(3rd param of %s) should be of type INTEGER", function_name);
+    sqlite3_result_error(ctx, err.c_str(), -1);
     return;
   }
 
+  // The blob is only parsed once the table is known, see KnnParam.
   std::string_view vector_blob(
       reinterpret_cast<const char*>(sqlite3_value_blob(argv[0])),
       sqlite3_value_bytes(argv[0]));
-  auto vec = VectorView::FromBlob(vector_blob);
-  if (!vec.ok()) {
-    std::string err = absl::StrFormat("Failed to parse vector due to: %s",
-                                      vec.status().message());
-    sqlite3_result_error(ctx, err.c_str(), -1);
-    return;
-  }
 
   int32_t k = sqlite3_value_int(argv[1]);
   if (k <= 0) {
@@ -621,7 +836,7 @@ void KnnParamFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
   }
 
   std::optional<uint32_t> ef_search;
-  if (argc == 3) {
+  if (has_ef) {
     int32_t ef = sqlite3_value_int(argv[2]);
     if (ef <= 0) {
       sqlite3_result_error(ctx, "ef should be greater than 0", -1);
@@ -630,15 +845,78 @@ void KnnParamFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
     ef_search = ef;
   }
 
+  // The optional params after ef, a rowid bitmap and a max distance, are told
+  // apart by type and can come in any order. NULL stands for neither.
+  std::optional<RowidBitmap> rowid_bitmap;
+  std::optional<double> max_distance;
+  for (int i = 3; i < argc; ++i) {
+    switch (sqlite3_value_type(argv[i])) {
+      case SQLITE_NULL:
+        break;
+      case SQLITE_BLOB: {
+        if (rowid_bitmap) {
+          std::string err = absl::StrFormat(
+              "%s() takes at most one rowid bitmap", function_name);
+          sqlite3_result_error(ctx, err.c_str(), -1);
+          return;
+        }
+        auto bitmap = RowidBitmap::FromBlob(std::string_view(
+            reinterpret_cast<const char*>(sqlite3_value_blob(argv[i])),
+            sqlite3_value_bytes(argv[i])));
+        if (!bitmap.ok()) {
+          sqlite3_result_error(
+              ctx, absl::StatusMessageAsCStr(bitmap.status()), -1);
+          return;
+        }
+        rowid_bitmap = *std::move(bitmap);
+        break;
+      }
+      case SQLITE_INTEGER:
+      case SQLITE_FLOAT:
+        if (max_distance) {
+          std::string err = absl::StrFormat(
+              "%s() takes at most one max distance", function_name);
+          sqlite3_result_error(ctx, err.c_str(), -1);
+          return;
+        }
+        max_distance = sqlite3_value_double(argv[i]);
+        break;
+      default: {
+        std::string err = absl::StrFormat(
+            "params after ef of %s should be a rowid bitmap(Blob returned by "
+            "rowid_bitmap()) or a max distance(INTEGER or REAL)",
+            function_name);
+        sqlite3_result_error(ctx, err.c_str(), -1);
+        return;
+      }
+    }
+  }
+
   KnnParam* param = new KnnParam();
-  param->query_vector = Vector(*vec);
+  param->query_blob = std::string(vector_blob);
   param->k = static_cast<uint32_t>(k);
   param->ef_search = std::move(ef_search);
+  param->batch = kind == KnnParamKind::kBatch;
+  param->stream = kind == KnnParamKind::kStream;
+  param->rowid_bitmap = std::move(rowid_bitmap);
+  param->max_distance = max_distance;
 
   sqlite3_result_pointer(ctx, param, kKnnParamType.data(), KnnParamDeleter);
   return;
 }
 
+void KnnParamFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  MakeKnnParam(ctx, argc, argv, "knn_param", KnnParamKind::kSingle);
+}
+
+void KnnBatchParamFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  MakeKnnParam(ctx, argc, argv, "knn_batch_param", KnnParamKind::kBatch);
+}
+
+void KnnStreamParamFunc(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+  MakeKnnParam(ctx, argc, argv, "knn_stream_param", KnnParamKind::kStream);
+}
+
 int VirtualTable::FindFunction(sqlite3_vtab* pVtab, int nArg, const char* zName,
                                void (**pxFunc)(sqlite3_context*, int,
                                                sqlite3_value**),
@@ -673,35 +951,100 @@ constexpr bool IsRowidOutOfRange(sqlite3_int64 rowid) {
 
 int VirtualTable::InsertOrUpdateVector(VectorView vector, Cursor::Rowid rowid) {
   try {
-    if (space_.vector_type == vectorlite::VectorType::Float32) {
-      if (!space_.normalize) {
-        index_->addPoint(vector.data().data(), rowid,
-                         index_->allow_replace_deleted_);
-      } else {
-        Vector normalized_vector = Vector::Normalize(vector);
-        index_->addPoint(normalized_vector.data().data(), rowid,
-                         index_->allow_replace_deleted_);
+    // Elements are written to per-table scratch buffers that only grow, so
+    // that inserting doesn't allocate once the buffers are warm. hnswlib copies
+    // the element into its own storage in addPoint.
+    const size_t dim = vector.dim();
+    const float* input = vector.data().data();
+    if (space_.normalize &&
+        (space_.vector_type == vectorlite::VectorType::Float32 ||
+         space_.vector_type == vectorlite::VectorType::Float8E4M3 ||
+         space_.vector_type == vectorlite::VectorType::Float8E5M2 ||
+         space_.vector_type == vectorlite::VectorType::Int8 ||
+         space_.vector_type == vectorlite::VectorType::Binary ||
+         space_.vector_type == vectorlite::VectorType::ProductQuantized)) {
+      // Normalize before quantizing, codes can't be normalized.
+      if (normalized_scratch_.size() < dim) {
+        normalized_scratch_.resize(dim);
       }
+      ops::NormalizeTo(input, normalized_scratch_.data(), dim);
+      input = normalized_scratch_.data();
+    }
+    if (element_scratch_.size() < index_->data_size_) {
+      element_scratch_.resize(index_->data_size_);
+    }
+    uint8_t* element = element_scratch_.data();
+
+    if (space_.vector_type == vectorlite::VectorType::Float32) {
+      index_->addPoint(input, rowid, index_->allow_replace_deleted_);
     } else if (space_.vector_type == vectorlite::VectorType::BFloat16) {
-      BF16Vector bf16_vector = Quantize(vector);
+      auto* out = reinterpret_cast<hwy::bfloat16_t*>(element);
       if (!space_.normalize) {
-        index_->addPoint(bf16_vector.data().data(), rowid,
-                         index_->allow_replace_deleted_);
+        ops::QuantizeF32ToBF16(input, out, dim);
       } else {
-        BF16Vector normalized_vector = bf16_vector.Normalize();
-        index_->addPoint(normalized_vector.data().data(), rowid,
-                         index_->allow_replace_deleted_);
+        ops::NormalizeAndQuantizeF32ToBF16(input, out, dim);
       }
+      index_->addPoint(element, rowid, index_->allow_replace_deleted_);
 
     } else if (space_.vector_type == vectorlite::VectorType::Float16) {
-      F16Vector f16_vector = QuantizeToF16(vector);
+      auto* out = reinterpret_cast<hwy::float16_t*>(element);
       if (!space_.normalize) {
-        index_->addPoint(f16_vector.data().data(), rowid,
-                         index_->allow_replace_deleted_);
+        ops::QuantizeF32ToF16(input, out, dim);
       } else {
-        F16Vector normalized_vector = f16_vector.Normalize();
-        index_->addPoint(normalized_vector.data().data(), rowid,
-                         index_->allow_replace_deleted_);
+        ops::NormalizeAndQuantizeF32ToF16(input, out, dim);
+      }
+      index_->addPoint(element, rowid, index_->allow_replace_deleted_);
+
+    } else if (space_.vector_type == vectorlite::VectorType::Float8E4M3 ||
+               space_.vector_type == vectorlite::VectorType::Float8E5M2) {
+      QuantizeToF8(VectorView(absl::MakeConstSpan(input, dim)),
+                   space_.vector_type, element);
+      index_->addPoint(element, rowid, index_->allow_replace_deleted_);
+
+    } else if (space_.vector_type == vectorlite::VectorType::Int8) {
+      Int8SpaceParam* param = space_.int8_param();
+      Int8Calibration& calibration = param->calibration;
+      if (calibration.calibrated()) {
+        ops::QuantizeF32ToI8(input, reinterpret_cast<int8_t*>(element), dim,
+                             calibration.scale, calibration.offset);
+        index_->addPoint(element, rowid, index_->allow_replace_deleted_);
+      } else {
+        // Like product quantized vectors before training, vectors are kept in
+        // float32 behind an all-zero placeholder code until there are enough
+        // of them to derive the calibration from.
+        std::memset(element, 0, dim);
+        index_->addPoint(element, rowid, index_->allow_replace_deleted_);
+        calibration.pending[rowid] = std::vector<float>(input, input + dim);
+        if (calibration.pending.size() >= param->calibration_size) {
+          return CalibrateInt8();
+        }
+      }
+
+    } else if (space_.vector_type == vectorlite::VectorType::Binary) {
+      BinarySpaceParam* param = space_.binary_param();
+      ops::QuantizeF32ToBinary(input, element, dim);
+      index_->addPoint(element, rowid, index_->allow_replace_deleted_);
+      if (param->rerank_factor > 0) {
+        param->rerank_store.Put(rowid, input);
+      }
+
+    } else if (space_.vector_type ==
+               vectorlite::VectorType::ProductQuantized) {
+      PQSpaceParam* param = space_.pq_param();
+      ProductQuantizer& quantizer = param->quantizer;
+      if (quantizer.trained()) {
+        quantizer.Encode(input, element);
+        index_->addPoint(element, rowid, index_->allow_replace_deleted_);
+      } else {
+        // Until the codebooks are trained, the index holds an all-zero
+        // placeholder code so that rowid lookups and deletes work as usual,
+        // and the vector is kept in float32.
+        std::memset(element, 0, quantizer.code_size());
+        index_->addPoint(element, rowid, index_->allow_replace_deleted_);
+        quantizer.pending()[rowid] = std::vector<float>(input, input + dim);
+        if (quantizer.pending().size() >= param->train_size) {
+          return TrainProductQuantizer();
+        }
       }
 
     } else {
@@ -718,6 +1061,135 @@ int VirtualTable::InsertOrUpdateVector(VectorView vector, Cursor::Rowid rowid) {
   return SQLITE_OK;
 }
 
+int VirtualTable::InsertOrUpdateNativeVector(const uint8_t* element,
+                                             Cursor::Rowid rowid) {
+  try {
+    if (space_.normalize) {
+      if (element_scratch_.size() < index_->data_size_) {
+        element_scratch_.resize(index_->data_size_);
+      }
+      std::memcpy(element_scratch_.data(), element, index_->data_size_);
+      if (space_.vector_type == vectorlite::VectorType::BFloat16) {
+        ops::Normalize(
+            reinterpret_cast<hwy::bfloat16_t*>(element_scratch_.data()),
+            dimension());
+      } else {
+        VECTORLITE_ASSERT(space_.vector_type ==
+                          vectorlite::VectorType::Float16);
+        ops::Normalize(
+            reinterpret_cast<hwy::float16_t*>(element_scratch_.data()),
+            dimension());
+      }
+      element = element_scratch_.data();
+    }
+    index_->addPoint(element, rowid, index_->allow_replace_deleted_);
+  } catch (const std::runtime_error& e) {
+    SetZErrMsg(&this->zErrMsg, "Failed to insert row %lld due to: %s", rowid,
+               e.what());
+    return SQLITE_ERROR;
+  }
+  return SQLITE_OK;
+}
+
+int VirtualTable::TrainProductQuantizer() {
+  PQSpaceParam* param = space_.pq_param();
+  VECTORLITE_ASSERT(param != nullptr);
+  ProductQuantizer& quantizer = param->quantizer;
+  VECTORLITE_ASSERT(!quantizer.trained() && !quantizer.pending().empty());
+
+  std::vector<hnswlib::labeltype> labels;
+  std::vector<float> vectors;
+  labels.reserve(quantizer.pending().size());
+  vectors.reserve(quantizer.pending().size() * dimension());
+  for (const auto& [rowid, vector] : quantizer.pending()) {
+    labels.push_back(rowid);
+    vectors.insert(vectors.end(), vector.begin(), vector.end());
+  }
+
+  // The table definition was validated when it was created.
+  auto options = IndexOptions::FromString(handle_->index_options_str);
+  VECTORLITE_ASSERT(options.ok());
+  quantizer.Train(vectors.data(), labels.size(), options->random_seed);
+
+  std::vector<uint8_t> codes(labels.size() * quantizer.code_size());
+  for (size_t i = 0; i < labels.size(); ++i) {
+    quantizer.Encode(vectors.data() + i * dimension(),
+                     codes.data() + i * quantizer.code_size());
+  }
+  int rc = RebuildIndex(labels, codes, "Failed to train product quantizer");
+  if (rc != SQLITE_OK) {
+    return rc;
+  }
+  quantizer.pending().clear();
+  return SQLITE_OK;
+}
+
+int VirtualTable::CalibrateInt8() {
+  Int8Calibration* calibration = space_.int8_calibration();
+  VECTORLITE_ASSERT(calibration != nullptr);
+  VECTORLITE_ASSERT(!calibration->calibrated() &&
+                    !calibration->pending.empty());
+
+  const size_t dim = dimension();
+  std::vector<hnswlib::labeltype> labels;
+  std::vector<float> vectors;
+  labels.reserve(calibration->pending.size());
+  vectors.reserve(calibration->pending.size() * dim);
+  for (const auto& [rowid, vector] : calibration->pending) {
+    labels.push_back(rowid);
+    vectors.insert(vectors.end(), vector.begin(), vector.end());
+  }
+
+  Int8Calibration calibrated = Int8Calibration::FromVectors(
+      vectors.data(), labels.size(), dim,
+      space_.distance_type != DistanceType::L2);
+  std::vector<uint8_t> codes(vectors.size());
+  ops::QuantizeF32ToI8(vectors.data(), reinterpret_cast<int8_t*>(codes.data()),
+                       vectors.size(), calibrated.scale, calibrated.offset);
+  // The distance functions read the calibration, so it must be in place while
+  // the index is rebuilt.
+  calibration->scale = calibrated.scale;
+  calibration->offset = calibrated.offset;
+  int rc = RebuildIndex(labels, codes, "Failed to calibrate int8 vectors");
+  if (rc != SQLITE_OK) {
+    // Stay uncalibrated, so that the pending vectors are still used.
+    calibration->scale = 0.0f;
+    calibration->offset = 0.0f;
+    return rc;
+  }
+  calibration->pending.clear();
+  return SQLITE_OK;
+}
+
+int VirtualTable::RebuildIndex(const std::vector<hnswlib::labeltype>& labels,
+                               const std::vector<uint8_t>& elements,
+                               const char* error) {
+  VECTORLITE_ASSERT(elements.size() == labels.size() * index_->data_size_);
+  // The table definition was validated when it was created.
+  auto options = IndexOptions::FromString(handle_->index_options_str);
+  VECTORLITE_ASSERT(options.ok());
+
+  // The graph of the placeholder codes was built without meaningful
+  // distances, so rebuild the index from the real codes.
+  try {
+    auto new_index = std::make_unique<hnswlib::HierarchicalNSW<float>>(
+        space_.space.get(), index_->max_elements_, options->M,
+        options->ef_construction, options->random_seed,
+        allow_replace_deleted_);
+    new_index->setEf(index_->ef_);
+    for (size_t i = 0; i < labels.size(); ++i) {
+      new_index->addPoint(elements.data() + i * index_->data_size_,
+                          labels[i]);
+    }
+    index_ = std::move(new_index);
+    ++handle_->index_generation;
+  } catch (const std::exception& ex) {
+    SetZErrMsg(&this->zErrMsg, "%s: %s", error, ex.what());
+    return SQLITE_ERROR;
+  }
+  return SQLITE_OK;
+}
+
 int VirtualTable::ExecutePersistenceCommand(sqlite3_value** argv) {
   sqlite3_value* op_value = argv[2 + kColumnIndexOperation];
   std::string operation(
@@ -792,9 +1264,20 @@ int VirtualTable::Update(sqlite3_vtab* pVTab, int argc, sqlite3_value** argv,
       return SQLITE_ERROR;
     }
 
-    auto vector = VectorView::FromBlob(std::string_view(
+    std::string_view vector_blob(
         reinterpret_cast<const char*>(sqlite3_value_blob(argv[2])),
-        sqlite3_value_bytes(argv[2])));
+        sqlite3_value_bytes(argv[2]));
+    if (vtab->handle_->native_input) {
+      absl::Status status = vtab->space_.CheckNativeBlob(vector_blob);
+      if (!status.ok()) {
+        SetZErrMsg(&vtab->zErrMsg, "Failed to perform insertion due to: %s",
+                   absl::StatusMessageAsCStr(status));
+        return SQLITE_ERROR;
+      }
+      return vtab->InsertOrUpdateNativeVector(
+          reinterpret_cast<const uint8_t*>(vector_blob.data()), rowid);
+    }
+    auto vector = VectorView::FromBlob(vector_blob);
     if (vector.ok()) {
       if (vector->dim() != vtab->dimension()) {
         SetZErrMsg(&vtab->zErrMsg,
@@ -827,6 +1310,15 @@ int VirtualTable::Update(sqlite3_vtab* pVTab, int argc, sqlite3_value** argv,
                  ex.what());
       return SQLITE_ERROR;
     }
+    if (PQSpaceParam* pq_param = vtab->space_.pq_param()) {
+      pq_param->quantizer.pending().erase(rowid);
+    }
+    if (Int8Calibration* calibration = vtab->space_.int8_calibration()) {
+      calibration->pending.erase(rowid);
+    }
+    if (BinarySpaceParam* binary_param = vtab->space_.binary_param()) {
+      binary_param->rerank_store.Erase(rowid);
+    }
     return SQLITE_OK;
   } else if (argc > 1 && argv0_type != SQLITE_NULL) {
     DLOG(INFO) << "Update a single row";
@@ -861,9 +1353,20 @@ int VirtualTable::Update(sqlite3_vtab* pVTab, int argc, sqlite3_value** argv,
       SetZErrMsg(&vtab->zErrMsg, "vector must be of type Blob");
       return SQLITE_ERROR;
     }
-    auto vector = VectorView::FromBlob(std::string_view(
+    std::string_view vector_blob(
         reinterpret_cast<const char*>(sqlite3_value_blob(argv[2])),
-        sqlite3_value_bytes(argv[2])));
+        sqlite3_value_bytes(argv[2]));
+    if (vtab->handle_->native_input) {
+      absl::Status status = vtab->space_.CheckNativeBlob(vector_blob);
+      if (!status.ok()) {
+        SetZErrMsg(&vtab->zErrMsg, "Failed to perform update due to: %s",
+                   absl::StatusMessageAsCStr(status));
+        return SQLITE_ERROR;
+      }
+      return vtab->InsertOrUpdateNativeVector(
+          reinterpret_cast<const uint8_t*>(vector_blob.data()), rowid);
+    }
+    auto vector = VectorView::FromBlob(vector_blob);
 
     if (vector.ok()) {
       if (vector->dim() != vtab->dimension()) {
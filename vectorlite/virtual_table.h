@@ -1,12 +1,15 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <set>
 #include <string_view>
 #include <utility>  // std::pair
+#include <vector>
 
 #include "absl/status/statusor.h"
+#include "constraint.h"
 #include "hnswlib/hnswlib.h"
 #include "index_options.h"
 #include "index_registry.h"
@@ -41,6 +44,24 @@ class VirtualTable : public sqlite3_vtab {
     ResultSet result;           // result rowid set, pair is (distance, rowid)
     ResultSetIter current_row;  // points to current row
     Vector query_vector;        // query vector
+    // For a knn_batch_param() search, the query index of each row in result.
+    // Empty otherwise.
+    std::vector<uint32_t> query_indices;
+    // For a knn_stream_param() search answered by graph search, the rows yet
+    // to come. result then only holds the current row.
+    std::unique_ptr<KnnStream> stream;
+    // IndexHandle::index_generation when stream was created. The stream walks
+    // the index, so it is stopped if the index has been replaced since.
+    uint64_t index_generation = 0;
+
+    // Replaces result with the next row of stream, or with nothing at its end.
+    void NextFromStream() {
+      result.clear();
+      if (auto row = stream->Next()) {
+        result.push_back(*row);
+      }
+      current_row = result.cbegin();
+    }
   };
 
   ~VirtualTable();
@@ -98,8 +119,25 @@ class VirtualTable : public sqlite3_vtab {
                           void** ppArg);
 
  private:
-  absl::StatusOr<Vector> GetVectorByRowid(int64_t rowid) const;
+  // Sets the float32 vector of `rowid` as the result of `ctx`, or its stored
+  // elements if the table has native_output.
+  // Float32 vectors are copied as they are, others are dequantized or copied
+  // into a buffer owned by SQLite.
+  int ResultVector(sqlite3_context* ctx, Cursor::Rowid rowid) const;
   int InsertOrUpdateVector(VectorView vector, Cursor::Rowid rowid);
+  // Like InsertOrUpdateVector, but `element` is already in the bfloat16 or
+  // float16 encoding of the table, see IndexOptions::native_input.
+  int InsertOrUpdateNativeVector(const uint8_t* element, Cursor::Rowid rowid);
+  // Trains a product quantized table's codebooks on its pending vectors and
+  // rebuilds the index from their codes.
+  int TrainProductQuantizer();
+  // Derives an int8 table's calibration from its pending vectors and rebuilds
+  // the index from their codes.
+  int CalibrateInt8();
+  // Replaces the index with one holding `elements`, index_->data_size_ bytes
+  // for each of `labels` back to back. `error` prefixes the error message.
+  int RebuildIndex(const std::vector<hnswlib::labeltype>& labels,
+                   const std::vector<uint8_t>& elements, const char* error);
   // Handles an INSERT carrying a non-NULL `operation` column.
   int ExecutePersistenceCommand(sqlite3_value** argv);
 
@@ -112,6 +150,10 @@ class VirtualTable : public sqlite3_vtab {
   NamedVectorSpace& space_;
   std::unique_ptr<hnswlib::HierarchicalNSW<float>>& index_;
   bool& allow_replace_deleted_;
+  // Reused by InsertOrUpdateVector so that inserts don't allocate. The
+  // normalized float32 input, and the element handed to hnswlib.
+  std::vector<float> normalized_scratch_;
+  std::vector<uint8_t> element_scratch_;
 };
 
 // Just a marker function that tells BestIndex that this is a vector search
@@ -121,4 +163,16 @@ void KnnSearch(sqlite3_context* context, int argc, sqlite3_value** argv);
 // including inpupt vector, k
 void KnnParamFunc(sqlite3_context* context, int argc, sqlite3_value** argv);
 
+// Like KnnParamFunc, but takes a blob of any number of float32 query vectors
+// back to back, all of which are searched in one knn_search. Each row's query
+// is told by the hidden query_index column.
+void KnnBatchParamFunc(sqlite3_context* context, int argc,
+                       sqlite3_value** argv);
+
+// Like KnnParamFunc, but the neighbors are searched lazily as rows are read,
+// so a LIMIT or a filter that stops the query early also stops the search.
+// k only caps the number of rows.
+void KnnStreamParamFunc(sqlite3_context* context, int argc,
+                        sqlite3_value** argv);
+
 }  // end namespace vectorlite